@@ -8,6 +8,7 @@
 
 #include <new>
 
+#include "brick/allocator/buildflags.h"
 #include "brick/atomicops.h"
 #include "brick/logging.h"
 #include "brick/macros.h"
@@ -299,10 +300,10 @@ ALWAYS_INLINE void ShimFreeDefiniteSize(void* ptr, size_t size, void* context) {
 #include "brick/allocator/allocator_shim_override_libc_symbols.h"
 #endif
 
-// In the case of tcmalloc we also want to plumb into the glibc hooks
-// to avoid that allocations made in glibc itself (e.g., strdup()) get
-// accidentally performed on the glibc heap instead of the tcmalloc one.
-#if defined(USE_TCMALLOC)
+// In the case of tcmalloc or PartitionAlloc we also want to plumb into the
+// glibc hooks to avoid that allocations made in glibc itself (e.g., strdup())
+// get accidentally performed on the glibc heap instead of the shim one.
+#if defined(USE_TCMALLOC) || BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
 #include "brick/allocator/allocator_shim_override_glibc_weak_symbols.h"
 #endif
 
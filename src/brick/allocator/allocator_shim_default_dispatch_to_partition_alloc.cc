@@ -0,0 +1,271 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/allocator/allocator_shim_default_dispatch_to_partition_alloc.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include "brick/allocator/allocator_shim.h"
+#include "brick/allocator/allocator_shim_internals.h"
+#include "brick/allocator/partition_allocator/partition_alloc.h"
+#include "brick/allocator/partition_allocator/spin_lock.h"
+#include "brick/bits.h"
+#include "brick/compiler_specific.h"
+#include "brick/logging.h"
+#include "brick/numerics/checked_math.h"
+
+// This translation unit defines a default dispatch for the allocator shim which
+// routes allocations to a generic partition of PartitionAlloc.
+
+namespace {
+
+using base::allocator::AllocatorDispatch;
+
+// The alignment of malloc(). Rounding the sizes up to a multiple of it keeps
+// the slots aligned: slot spans start on partition page boundaries, and the
+// buckets of such sizes have slot sizes multiple of it.
+constexpr size_t kAlignment = alignof(max_align_t);
+static_assert(kAlignment >= base::kGenericSmallestBucket &&
+                  base::bits::IsPowerOfTwo(kAlignment),
+              "Unexpected malloc() alignment");
+
+// Slot spans are aligned on partition pages, so page alignment is enough for
+// valloc() and pvalloc() without moving the allocation inside of its slot.
+// Larger alignments are served by aligning inside of a larger slot, see
+// AllocatedAddress().
+constexpr size_t kMaxSlotAlignment = base::kSystemPageSize;
+
+// The partition is set up by the first allocation of the process, which can
+// come before any static initializer ran, and is never destroyed since
+// allocations outlive the exit-time destructors.
+alignas(base::PartitionAllocatorGeneric) char
+    g_allocator_storage[sizeof(base::PartitionAllocatorGeneric)];
+std::atomic<base::PartitionRootGeneric*> g_root{nullptr};
+base::subtle::SpinLock g_initialization_lock;
+
+NOINLINE base::PartitionRootGeneric* InitializeRoot() {
+  bool initialized_root = false;
+  base::PartitionRootGeneric* root;
+  {
+    base::subtle::SpinLock::Guard guard(g_initialization_lock);
+    root = g_root.load(std::memory_order_relaxed);
+    if (!root) {
+      auto* allocator =
+          new (g_allocator_storage) base::PartitionAllocatorGeneric();
+      allocator->init();
+      root = allocator->root();
+      g_root.store(root, std::memory_order_release);
+      initialized_root = true;
+    }
+  }
+  // Setting up the thread caches allocates, which has to find the partition
+  // ready and the lock released. Until then, allocations take the partition
+  // lock; EnableThreadCache() publishes the caches to the threads that already
+  // use the partition.
+  if (initialized_root)
+    root->EnableThreadCache();
+  return root;
+}
+
+ALWAYS_INLINE base::PartitionRootGeneric* Root() {
+  base::PartitionRootGeneric* root = g_root.load(std::memory_order_acquire);
+  if (LIKELY(root))
+    return root;
+  return InitializeRoot();
+}
+
+// Returns the address that the partition allocated for the slot of |address|.
+// They differ for the allocations aligned inside of a larger slot, and for all
+// the aligned allocations when the slots start with a cookie.
+ALWAYS_INLINE void* AllocatedAddress(void* address) {
+#if !DCHECK_IS_ON()
+  // Without cookies, only the allocations aligned on more than
+  // kMaxSlotAlignment can be inside of their slot, and they are aligned on
+  // twice that at least.
+  if (LIKELY(reinterpret_cast<uintptr_t>(address) &
+             (2 * kMaxSlotAlignment - 1))) {
+    return address;
+  }
+#endif
+  if (!address)
+    return nullptr;
+  char* char_address = static_cast<char*>(address);
+  base::internal::PartitionPage* page =
+      base::internal::PartitionPage::FromPointerNoAlignmentCheck(char_address);
+  char* slot_span =
+      static_cast<char*>(base::internal::PartitionPage::ToPointer(page));
+  size_t slot_size = page->bucket->slot_size;
+  size_t offset = char_address - slot_span;
+#if DCHECK_IS_ON()
+  return slot_span + offset - offset % slot_size + base::internal::kCookieSize;
+#else
+  return slot_span + offset - offset % slot_size;
+#endif
+}
+
+ALWAYS_INLINE size_t AllocationSize(size_t size) {
+  return base::bits::Align(std::max<size_t>(size, 1), kAlignment);
+}
+
+void* Allocate(size_t size) {
+  // Also keeps AllocationSize() from overflowing.
+  if (UNLIKELY(size > base::kGenericMaxDirectMapped))
+    return nullptr;
+  return base::PartitionAllocGenericFlags(
+      Root(), base::PartitionAllocReturnNull, AllocationSize(size), nullptr);
+}
+
+size_t UsableSize(void* address) {
+  void* allocated_address = AllocatedAddress(address);
+  return base::PartitionAllocGetSize(allocated_address) -
+         (static_cast<char*>(address) -
+          static_cast<char*>(allocated_address));
+}
+
+void* PartitionShimMalloc(const AllocatorDispatch*,
+                          size_t size,
+                          void* context) {
+  return Allocate(size);
+}
+
+void* PartitionShimCalloc(const AllocatorDispatch*,
+                          size_t n,
+                          size_t size,
+                          void* context) {
+  size_t total_size;
+  if (!base::CheckMul(n, size).AssignIfValid(&total_size))
+    return nullptr;
+  void* ptr = Allocate(total_size);
+  if (ptr)
+    memset(ptr, 0, total_size);
+  return ptr;
+}
+
+void* PartitionShimMemalign(const AllocatorDispatch*,
+                            size_t alignment,
+                            size_t size,
+                            void* context) {
+  if (alignment <= kAlignment)
+    return Allocate(size);
+  // Also keeps the sizes below from overflowing.
+  if (UNLIKELY(alignment > base::kGenericMaxDirectMapped ||
+               size > base::kGenericMaxDirectMapped)) {
+    return nullptr;
+  }
+  // Like glibc, use the next power of two for other alignments.
+  alignment = size_t{1} << base::bits::Log2Ceiling(
+                  static_cast<uint32_t>(alignment));
+
+#if !DCHECK_IS_ON()
+  if (alignment <= kMaxSlotAlignment) {
+    // The slots of a bucket are aligned on its slot size if that's a power of
+    // two. From kGenericNumBucketsPerOrder times the alignment, all the slot
+    // sizes are multiples of it.
+    size = base::bits::Align(std::max(size, alignment), alignment);
+    if (size < base::kGenericNumBucketsPerOrder * alignment) {
+      size = size_t{1}
+             << base::bits::Log2Ceiling(static_cast<uint32_t>(size));
+    }
+    return Allocate(size);
+  }
+#endif
+
+  // Align the allocation inside of a larger slot, see AllocatedAddress(). The
+  // metadata of a direct mapped slot only covers its first partition page,
+  // which the aligned address must not leave, so that rules out alignments of
+  // a partition page or more for the largest allocations.
+  if (UNLIKELY(size + alignment > base::kGenericMaxBucketed &&
+               alignment >= base::kPartitionPageSize)) {
+    return nullptr;
+  }
+  char* ptr = static_cast<char*>(Allocate(size + alignment));
+  if (!ptr)
+    return nullptr;
+  return reinterpret_cast<void*>(
+      base::bits::Align(reinterpret_cast<uintptr_t>(ptr), alignment));
+}
+
+void* PartitionShimRealloc(const AllocatorDispatch*,
+                           void* address,
+                           size_t size,
+                           void* context) {
+  base::PartitionRootGeneric* root = Root();
+  if (UNLIKELY(!size && address)) {
+    root->Free(AllocatedAddress(address));
+    return nullptr;
+  }
+  if (UNLIKELY(size > base::kGenericMaxDirectMapped))
+    return nullptr;
+
+  void* allocated_address = AllocatedAddress(address);
+  if (UNLIKELY(allocated_address != address)) {
+    // The data of an aligned allocation doesn't start where the partition
+    // expects it.
+    void* ptr = Allocate(size);
+    if (!ptr)
+      return nullptr;
+    memcpy(ptr, address, std::min(size, UsableSize(address)));
+    root->Free(allocated_address);
+    return ptr;
+  }
+  return base::PartitionReallocGenericFlags(root,
+                                            base::PartitionAllocReturnNull,
+                                            address, AllocationSize(size),
+                                            nullptr);
+}
+
+void PartitionShimFree(const AllocatorDispatch*,
+                       void* address,
+                       void* context) {
+  Root()->Free(AllocatedAddress(address));
+}
+
+size_t PartitionShimGetSizeEstimate(const AllocatorDispatch*,
+                                    void* address,
+                                    void* context) {
+  if (!address)
+    return 0;
+  return UsableSize(address);
+}
+
+}  // namespace
+
+namespace base {
+namespace allocator {
+
+// static
+PartitionRootGeneric* PartitionAllocMalloc::Allocator() {
+  return Root();
+}
+
+}  // namespace allocator
+}  // namespace base
+
+const AllocatorDispatch AllocatorDispatch::default_dispatch = {
+    &PartitionShimMalloc,          /* alloc_function */
+    &PartitionShimCalloc,          /* alloc_zero_initialized_function */
+    &PartitionShimMemalign,        /* alloc_aligned_function */
+    &PartitionShimRealloc,         /* realloc_function */
+    &PartitionShimFree,            /* free_function */
+    &PartitionShimGetSizeEstimate, /* get_size_estimate_function */
+    nullptr,                       /* batch_malloc_function */
+    nullptr,                       /* batch_free_function */
+    nullptr,                       /* free_definite_size_function */
+    nullptr,                       /* next */
+};
+
+// glibc's malloc_usable_size() doesn't know about the partition.
+
+extern "C" {
+
+SHIM_ALWAYS_EXPORT size_t malloc_usable_size(void* address) __THROW {
+  return PartitionShimGetSizeEstimate(nullptr, address, nullptr);
+}
+
+}  // extern "C"
@@ -0,0 +1,28 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_ALLOCATOR_ALLOCATOR_SHIM_DEFAULT_DISPATCH_TO_PARTITION_ALLOC_H_
+#define BRICK_ALLOCATOR_ALLOCATOR_SHIM_DEFAULT_DISPATCH_TO_PARTITION_ALLOC_H_
+
+#include "brick/base_export.h"
+
+namespace base {
+
+struct PartitionRootGeneric;
+
+namespace allocator {
+
+// The partition behind malloc() and operator new when building with
+// use_allocator = "partition".
+class BRICK_EXPORT PartitionAllocMalloc {
+ public:
+  // Returns the partition, which is set up by the first allocation of the
+  // process and never destroyed.
+  static PartitionRootGeneric* Allocator();
+};
+
+}  // namespace allocator
+}  // namespace base
+
+#endif  // BRICK_ALLOCATOR_ALLOCATOR_SHIM_DEFAULT_DISPATCH_TO_PARTITION_ALLOC_H_
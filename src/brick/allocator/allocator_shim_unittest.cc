@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
 #include <memory>
 #include <new>
 #include <vector>
@@ -37,6 +38,12 @@
 #include <unistd.h>
 #endif
 
+#if BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+#include <stddef.h>
+
+#include "brick/allocator/allocator_shim_default_dispatch_to_partition_alloc.h"
+#endif
+
 // Some new Android NDKs (64 bit) does not expose (p)valloc anymore. These
 // functions are implemented at the shim-layer level.
 #if defined(OS_ANDROID)
@@ -462,6 +469,52 @@ TEST_F(AllocatorShimTest, ShimReplacesCRTHeapWhenEnabled) {
 }
 #endif  // defined(OS_WIN) && BUILDFLAG(USE_ALLOCATOR_SHIM)
 
+#if BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+TEST_F(AllocatorShimTest, MallocIsPartitionAlloc) {
+  ASSERT_TRUE(PartitionAllocMalloc::Allocator());
+  for (size_t size : {0, 1, 15, 17, 100, 1000, 100000, 2000000}) {
+    void* ptr = malloc(size);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % alignof(max_align_t));
+    // Only a pointer of the partition has a size there.
+    EXPECT_EQ(PartitionAllocGetSize(ptr), malloc_usable_size(ptr));
+    EXPECT_LE(size, malloc_usable_size(ptr));
+    memset(ptr, 0x5a, size);
+    free(ptr);
+  }
+
+  // Allocations made by glibc itself also come from the partition.
+  char* duplicate = strdup("partition");
+  ASSERT_NE(nullptr, duplicate);
+  EXPECT_EQ(PartitionAllocGetSize(duplicate), malloc_usable_size(duplicate));
+  free(duplicate);
+}
+
+TEST_F(AllocatorShimTest, PartitionAllocAlignedAllocations) {
+  for (size_t alignment = 2 * sizeof(void*); alignment <= 256 * 1024;
+       alignment *= 2) {
+    for (size_t size : {1, 100, 5000, 100000, 2000000}) {
+      // A direct mapped allocation can only be aligned inside of its first
+      // partition page.
+      if (size > kGenericMaxBucketed && alignment >= kPartitionPageSize)
+        continue;
+      void* ptr = nullptr;
+      ASSERT_EQ(0, posix_memalign(&ptr, alignment, size));
+      EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % alignment);
+      EXPECT_LE(size, malloc_usable_size(ptr));
+      memset(ptr, 0x5a, size);
+
+      // The data moves along when the allocation grows.
+      char* new_ptr = static_cast<char*>(realloc(ptr, size * 2));
+      ASSERT_NE(nullptr, new_ptr);
+      EXPECT_EQ(size, static_cast<size_t>(std::count(
+                          new_ptr, new_ptr + size, static_cast<char>(0x5a))));
+      free(new_ptr);
+    }
+  }
+}
+#endif  // BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+
 }  // namespace
 }  // namespace allocator
 }  // namespace base
@@ -0,0 +1,230 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures allocation heavy workloads through malloc() and operator new, to
+// compare the allocators that use_allocator can put behind them. The results
+// are named after the allocator of the build; glibc's numbers come from a
+// build with use_allocator = "none", since the other allocators override its
+// symbols.
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "brick/allocator/buildflags.h"
+#include "brick/macros.h"
+#include "brick/strings/stringprintf.h"
+#include "brick/synchronization/waitable_event.h"
+#include "brick/threading/platform_thread.h"
+#include "brick/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+namespace allocator {
+
+namespace {
+
+#if BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+constexpr char kAllocatorName[] = "partition_alloc";
+#elif defined(USE_TCMALLOC)
+constexpr char kAllocatorName[] = "tcmalloc";
+#else
+constexpr char kAllocatorName[] = "system";
+#endif
+
+constexpr int kNumOperations = 1000000;
+constexpr size_t kNumLiveAllocations = 128;
+
+// Xorshift, so that the measurement doesn't include a locked generator.
+uint32_t NextRandom(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// Mostly small sizes, sometimes up to a few kilobytes.
+size_t RandomSize(uint32_t random) {
+  size_t size = 8 + ((random >> 8) % 248);
+  if (!(random & 0xf0000000))
+    size *= 16;
+  return size;
+}
+
+void PrintCallRate(const std::string& measurement,
+                   const std::string& trace,
+                   double num_calls,
+                   TimeDelta elapsed) {
+  perf_test::PrintResult(measurement, std::string("_") + kAllocatorName, trace,
+                         num_calls / elapsed.InMicrosecondsF(), "calls/us",
+                         true);
+}
+
+// Allocates and frees objects of the same size in a loop, the best case of
+// every allocator.
+TEST(MallocPerfTest, SmallObjectChurn) {
+  for (size_t size : {16, 64, 256}) {
+    const TimeTicks start = TimeTicks::Now();
+    for (int i = 0; i < kNumOperations; ++i) {
+      auto* ptr = static_cast<char*>(malloc(size));
+      ptr[0] = 1;
+      free(ptr);
+    }
+    PrintCallRate("malloc_churn", StringPrintf("%zu_bytes", size),
+                  2.0 * kNumOperations, TimeTicks::Now() - start);
+  }
+
+  // Same through operator new, which shares the shim with malloc().
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumOperations; ++i) {
+    auto object = std::make_unique<std::pair<void*, size_t>>(nullptr, i);
+    object->first = object.get();
+  }
+  PrintCallRate("new_churn", "16_bytes", 2.0 * kNumOperations,
+                TimeTicks::Now() - start);
+}
+
+// Grows buffers the way strings and vectors do.
+TEST(MallocPerfTest, Growth) {
+  constexpr int kNumBuffers = 10000;
+  constexpr size_t kMaxSize = 4096;
+
+  TimeTicks start = TimeTicks::Now();
+  int num_calls = 0;
+  for (int i = 0; i < kNumBuffers; ++i) {
+    void* ptr = nullptr;
+    for (size_t size = 16; size <= kMaxSize; size *= 2) {
+      ptr = realloc(ptr, size);
+      static_cast<char*>(ptr)[size - 1] = 1;
+      ++num_calls;
+    }
+    free(ptr);
+    ++num_calls;
+  }
+  PrintCallRate("realloc_growth", "16_to_4096_bytes", num_calls,
+                TimeTicks::Now() - start);
+
+  start = TimeTicks::Now();
+  size_t total_size = 0;
+  for (int i = 0; i < kNumBuffers; ++i) {
+    std::string string;
+    std::vector<int> vector;
+    for (size_t j = 0; j < kMaxSize / sizeof(int); ++j) {
+      string.push_back('a');
+      vector.push_back(j);
+    }
+    total_size += string.size() + vector.size();
+  }
+  EXPECT_EQ(kNumBuffers * 2 * kMaxSize / sizeof(int), total_size);
+  perf_test::PrintResult("container_growth", std::string("_") + kAllocatorName,
+                         "string_and_vector",
+                         (TimeTicks::Now() - start).InMillisecondsF(), "ms",
+                         true);
+}
+
+// Keeps a set of allocations of mixed sizes alive on each thread, and
+// replaces them in a random order.
+class MixedSizesWorkload : public PlatformThread::Delegate {
+ public:
+  explicit MixedSizesWorkload(uint32_t seed) : random_state_(seed) {}
+
+  void ThreadMain() override {
+    void* live[kNumLiveAllocations] = {};
+    for (int i = 0; i < kNumOperations; ++i) {
+      uint32_t random = NextRandom(&random_state_);
+      size_t index = random % kNumLiveAllocations;
+      free(live[index]);
+      live[index] = malloc(RandomSize(random));
+      static_cast<char*>(live[index])[0] = 1;
+    }
+    for (void* ptr : live)
+      free(ptr);
+  }
+
+ private:
+  uint32_t random_state_;
+
+  DISALLOW_COPY_AND_ASSIGN(MixedSizesWorkload);
+};
+
+TEST(MallocPerfTest, MixedSizesMultiThreaded) {
+  for (int num_threads : {1, 2, 4, 8}) {
+    std::vector<std::unique_ptr<MixedSizesWorkload>> workloads;
+    std::vector<PlatformThreadHandle> handles(num_threads);
+    const TimeTicks start = TimeTicks::Now();
+    for (int i = 0; i < num_threads; ++i) {
+      workloads.push_back(
+          std::make_unique<MixedSizesWorkload>(2463534242u + i));
+      ASSERT_TRUE(
+          PlatformThread::Create(0, workloads.back().get(), &handles[i]));
+    }
+    for (PlatformThreadHandle handle : handles)
+      PlatformThread::Join(handle);
+    PrintCallRate("malloc_mixed_sizes",
+                  StringPrintf("%d_threads", num_threads),
+                  2.0 * kNumOperations * num_threads,
+                  TimeTicks::Now() - start);
+  }
+}
+
+// Allocates batches on one thread and frees them on another, like a producer
+// handing tasks to a consumer.
+class Producer : public PlatformThread::Delegate {
+ public:
+  static constexpr size_t kBatchSize = 1024;
+  static constexpr int kNumBatches = kNumOperations / kBatchSize;
+
+  Producer(void** batch, WaitableEvent* produced, WaitableEvent* consumed)
+      : batch_(batch), produced_(produced), consumed_(consumed) {}
+
+  void ThreadMain() override {
+    uint32_t random_state = 88172645u;
+    for (int i = 0; i < kNumBatches; ++i) {
+      for (size_t j = 0; j < kBatchSize; ++j)
+        batch_[j] = malloc(RandomSize(NextRandom(&random_state)));
+      produced_->Signal();
+      consumed_->Wait();
+    }
+  }
+
+ private:
+  void** const batch_;
+  WaitableEvent* const produced_;
+  WaitableEvent* const consumed_;
+
+  DISALLOW_COPY_AND_ASSIGN(Producer);
+};
+
+TEST(MallocPerfTest, CrossThreadFree) {
+  void* batch[Producer::kBatchSize];
+  WaitableEvent produced(WaitableEvent::ResetPolicy::AUTOMATIC,
+                         WaitableEvent::InitialState::NOT_SIGNALED);
+  WaitableEvent consumed(WaitableEvent::ResetPolicy::AUTOMATIC,
+                         WaitableEvent::InitialState::NOT_SIGNALED);
+  Producer producer(batch, &produced, &consumed);
+  PlatformThreadHandle handle;
+
+  const TimeTicks start = TimeTicks::Now();
+  ASSERT_TRUE(PlatformThread::Create(0, &producer, &handle));
+  for (int i = 0; i < Producer::kNumBatches; ++i) {
+    produced.Wait();
+    for (void* ptr : batch)
+      free(ptr);
+    consumed.Signal();
+  }
+  PlatformThread::Join(handle);
+  PrintCallRate("malloc_cross_thread_free", "2_threads",
+                2.0 * Producer::kBatchSize * Producer::kNumBatches,
+                TimeTicks::Now() - start);
+}
+
+}  // namespace
+
+}  // namespace allocator
+}  // namespace base
@@ -223,6 +223,20 @@ void DiscardSystemPages(void* address, size_t length) {
   DiscardSystemPagesInternal(address, length);
 }
 
+bool AdviseHugePages(void* address, size_t length) {
+  DCHECK(!(reinterpret_cast<uintptr_t>(address) & kSystemPageOffsetMask));
+  DCHECK_EQ(0UL, length & kSystemPageOffsetMask);
+  return AdviseHugePagesInternal(address, length);
+}
+
+bool SetNumaNodeForPages(void* address, size_t length, int node) {
+  DCHECK(!(reinterpret_cast<uintptr_t>(address) & kSystemPageOffsetMask));
+  DCHECK_EQ(0UL, length & kSystemPageOffsetMask);
+  if (node < 0)
+    return false;
+  return SetNumaNodeForPagesInternal(address, length, node);
+}
+
 bool ReserveAddressSpace(size_t size) {
   // To avoid deadlock, call only SystemAllocPages.
   subtle::SpinLock::Guard guard(s_reserveLock.Get());
@@ -133,6 +133,27 @@ BRICK_EXPORT WARN_UNUSED_RESULT bool RecommitSystemPages(
 // based on the original page content, or a page of zeroes.
 BRICK_EXPORT void DiscardSystemPages(void* address, size_t length);
 
+// Ask the system to back the pages starting at |address| and continuing for
+// |length| bytes with huge pages of |kHugePageSize| bytes, which cover more
+// memory per TLB entry. |address| and |length| must be multiples of
+// |kSystemPageSize|.
+//
+// Only the parts of the range which are aligned on |kHugePageSize| and have
+// the same accessibility throughout can get huge pages. A huge page becomes
+// resident as a whole when any of it is touched, and discarding part of it
+// splits it.
+//
+// Returns false if the system doesn't support huge pages.
+BRICK_EXPORT bool AdviseHugePages(void* address, size_t length);
+
+// Allocate the physical pages starting at |address| and continuing for
+// |length| bytes from NUMA node |node| when they are first touched, falling
+// back to other nodes when it has no free memory left. |address| and |length|
+// must be multiples of |kSystemPageSize|.
+//
+// Returns false if the system doesn't support it, or if |node| has no memory.
+BRICK_EXPORT bool SetNumaNodeForPages(void* address, size_t length, int node);
+
 // Rounds up |address| to the next multiple of |kSystemPageSize|. Returns
 // 0 for an |address| of 0.
 constexpr ALWAYS_INLINE uintptr_t RoundUpToSystemPage(uintptr_t address) {
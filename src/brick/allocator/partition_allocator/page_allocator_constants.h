@@ -34,6 +34,9 @@ static_assert((kSystemPageSize & (kSystemPageSize - 1)) == 0,
               "kSystemPageSize must be power of 2");
 static constexpr size_t kSystemPageBaseMask = ~kSystemPageOffsetMask;
 
+// The size of the transparent huge pages of Linux, see AdviseHugePages().
+static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
 static constexpr size_t kPageMetadataShift = 5;  // 32 bytes per partition page.
 static constexpr size_t kPageMetadataSize = 1 << kPageMetadataShift;
 
@@ -14,6 +14,10 @@
 #if defined(OS_LINUX)
 #include <sys/resource.h>
 #endif
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include "build/build_config.h"
 
@@ -178,6 +182,35 @@ void DiscardSystemPagesInternal(void* address, size_t length) {
 #endif
 }
 
+bool AdviseHugePagesInternal(void* address, size_t length) {
+#if (defined(OS_LINUX) || defined(OS_ANDROID)) && defined(MADV_HUGEPAGE)
+  // Fails if the kernel was built without transparent huge pages.
+  return !madvise(address, length, MADV_HUGEPAGE);
+#else
+  return false;
+#endif
+}
+
+bool SetNumaNodeForPagesInternal(void* address, size_t length, int node) {
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // From <linux/mempolicy.h>. MPOL_BIND would make the faults fail once the
+  // node is full, rather than falling back to another node.
+  constexpr int kMpolPreferred = 1;
+  constexpr size_t kMaxNumaNodes = 1024;
+  constexpr size_t kBitsPerLong = 8 * sizeof(unsigned long);
+  if (static_cast<size_t>(node) >= kMaxNumaNodes)
+    return false;
+  unsigned long node_mask[kMaxNumaNodes / kBitsPerLong] = {};
+  node_mask[node / kBitsPerLong] = 1UL << (node % kBitsPerLong);
+  // The wrapper of mbind() is in libnuma, which isn't a dependency. The kernel
+  // ignores the last bit of |maxnode|.
+  return !syscall(__NR_mbind, address, length, kMpolPreferred, node_mask,
+                  kMaxNumaNodes + 1, 0);
+#else
+  return false;
+#endif
+}
+
 }  // namespace base
 
 #endif  // BRICK_ALLOCATOR_PARTITION_ALLOCATOR_PAGE_ALLOCATOR_INTERNALS_POSIX_H_
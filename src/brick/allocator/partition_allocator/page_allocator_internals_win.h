@@ -116,6 +116,16 @@ void DiscardSystemPagesInternal(void* address, size_t length) {
   }
 }
 
+bool AdviseHugePagesInternal(void* address, size_t length) {
+  // Large pages have to be requested when allocating, and need a privilege.
+  return false;
+}
+
+bool SetNumaNodeForPagesInternal(void* address, size_t length, int node) {
+  // The node has to be chosen when allocating, with VirtualAllocExNuma().
+  return false;
+}
+
 }  // namespace base
 
 #endif  // BRICK_ALLOCATOR_PARTITION_ALLOCATOR_PAGE_ALLOCATOR_INTERNALS_WIN_H_
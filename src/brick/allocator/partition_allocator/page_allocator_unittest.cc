@@ -8,6 +8,7 @@
 #include <string.h>
 
 #include "brick/allocator/partition_allocator/address_space_randomization.h"
+#include "brick/compiler_specific.h"
 #include "build/build_config.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -133,6 +134,37 @@ TEST(PageAllocatorTest, AllocAndFreePages) {
   FreePages(buffer, kPageAllocationGranularity);
 }
 
+TEST(PageAllocatorTest, AdviseHugePages) {
+  void* buffer =
+      AllocPages(nullptr, 2 * kHugePageSize, kHugePageSize, PageReadWrite);
+  ASSERT_TRUE(buffer);
+  bool advised = AdviseHugePages(buffer, 2 * kHugePageSize);
+#if defined(OS_WIN) || defined(OS_MACOSX)
+  EXPECT_FALSE(advised);
+#endif
+  ALLOW_UNUSED_LOCAL(advised);
+  // The pages work the same either way.
+  memset(buffer, 42, 2 * kHugePageSize);
+  EXPECT_EQ(42, static_cast<char*>(buffer)[2 * kHugePageSize - 1]);
+  FreePages(buffer, 2 * kHugePageSize);
+}
+
+TEST(PageAllocatorTest, SetNumaNodeForPages) {
+  void* buffer = AllocPages(nullptr, kPageAllocationGranularity,
+                            kPageAllocationGranularity, PageReadWrite);
+  ASSERT_TRUE(buffer);
+  EXPECT_FALSE(SetNumaNodeForPages(buffer, kPageAllocationGranularity, -1));
+  // Node 0 exists on all machines, but the kernel may not support NUMA.
+  bool set = SetNumaNodeForPages(buffer, kPageAllocationGranularity, 0);
+#if defined(OS_WIN) || defined(OS_MACOSX)
+  EXPECT_FALSE(set);
+#endif
+  ALLOW_UNUSED_LOCAL(set);
+  memset(buffer, 42, kPageAllocationGranularity);
+  EXPECT_EQ(42, static_cast<char*>(buffer)[kPageAllocationGranularity - 1]);
+  FreePages(buffer, kPageAllocationGranularity);
+}
+
 // Test permission setting on POSIX, where we can set a trap handler.
 #if defined(OS_POSIX) && !defined(OS_FUCHSIA)
 
@@ -54,7 +54,10 @@ internal::PartitionRootBase::~PartitionRootBase() = default;
 PartitionRoot::PartitionRoot() = default;
 PartitionRoot::~PartitionRoot() = default;
 PartitionRootGeneric::PartitionRootGeneric() = default;
-PartitionRootGeneric::~PartitionRootGeneric() = default;
+PartitionRootGeneric::~PartitionRootGeneric() {
+  if (with_thread_cache)
+    internal::PartitionThreadCache::DisableForPartition(this);
+}
 PartitionAllocatorGeneric::PartitionAllocatorGeneric() = default;
 PartitionAllocatorGeneric::~PartitionAllocatorGeneric() = default;
 
@@ -501,7 +504,29 @@ void PartitionRoot::PurgeMemory(int flags) {
   // at the moment.
 }
 
+void PartitionRootGeneric::EnableThreadCache() {
+  DCHECK(this->initialized);
+  DCHECK(!with_thread_cache);
+  internal::PartitionThreadCache::EnableForPartition(this);
+  // Publishes the setup above to the threads already allocating.
+  with_thread_cache.store(true, std::memory_order_release);
+}
+
 void PartitionRootGeneric::PurgeMemory(int flags) {
+  if ((flags & PartitionPurgeThreadCaches) && with_thread_cache) {
+    // Purging takes the lock.
+    internal::PartitionThreadCache* current_cache =
+        internal::PartitionThreadCache::Get(this);
+    if (current_cache)
+      current_cache->Purge();
+    subtle::SpinLock::Guard guard(this->lock);
+    for (internal::PartitionThreadCache* cache = thread_caches; cache;
+         cache = cache->next()) {
+      if (cache != current_cache)
+        cache->RequestPurge();
+    }
+  }
+
   subtle::SpinLock::Guard guard(this->lock);
   if (flags & PartitionPurgeDecommitEmptyPages)
     DecommitEmptyPages();
@@ -617,9 +642,15 @@ void PartitionRootGeneric::DumpStats(const char* partition_name,
 
   PartitionBucketMemoryStats bucket_stats[kGenericNumBuckets];
   size_t num_direct_mapped_allocations = 0;
+  PartitionThreadCacheStats thread_cache_stats = {};
   {
     subtle::SpinLock::Guard guard(this->lock);
 
+    for (const internal::PartitionThreadCache* cache = thread_caches; cache;
+         cache = cache->next()) {
+      cache->AccumulateStats(&thread_cache_stats);
+    }
+
     for (size_t i = 0; i < kGenericNumBuckets; ++i) {
       const internal::PartitionBucket* bucket = &this->buckets[i];
       // Don't report the pseudo buckets that the generic allocator sets up in
@@ -630,6 +661,7 @@ void PartitionRootGeneric::DumpStats(const char* partition_name,
       else
         PartitionDumpBucketStats(&bucket_stats[i], bucket);
       if (bucket_stats[i].is_valid) {
+        bucket_stats[i].num_allocs = bucket_num_allocs[i];
         stats.total_resident_bytes += bucket_stats[i].resident_bytes;
         stats.total_active_bytes += bucket_stats[i].active_bytes;
         stats.total_decommittable_bytes += bucket_stats[i].decommittable_bytes;
@@ -648,6 +680,11 @@ void PartitionRootGeneric::DumpStats(const char* partition_name,
         continue;
       direct_map_lengths[num_direct_mapped_allocations] = slot_size;
     }
+
+    stats.num_slow_path_allocs = num_slow_path_allocs;
+    stats.num_direct_map_allocs = num_direct_map_allocs;
+    stats.slow_path_time = slow_path_time;
+    stats.direct_map_time = direct_map_time;
   }
 
   if (!is_light_dump) {
@@ -674,6 +711,11 @@ void PartitionRootGeneric::DumpStats(const char* partition_name,
     }
   }
 
+  if (with_thread_cache) {
+    dumper->PartitionDumpThreadCacheStats(partition_name,
+                                          &thread_cache_stats);
+  }
+
   stats.total_resident_bytes += direct_mapped_allocations_total_size;
   stats.total_active_bytes += direct_mapped_allocations_total_size;
   dumper->PartitionDumpTotals(partition_name, &stats);
@@ -686,6 +728,8 @@ void PartitionRoot::DumpStats(const char* partition_name,
   stats.total_mmapped_bytes = this->total_size_of_super_pages;
   stats.total_committed_bytes = this->total_size_of_committed_pages;
   DCHECK(!this->total_size_of_direct_mapped_pages);
+  stats.num_slow_path_allocs = this->num_slow_path_allocs;
+  stats.slow_path_time = this->slow_path_time;
 
   static const size_t kMaxReportableBuckets = 4096 / sizeof(void*);
   std::unique_ptr<PartitionBucketMemoryStats[]> memory_stats;
@@ -63,12 +63,15 @@
 #include <limits.h>
 #include <string.h>
 
+#include <atomic>
+
 #include "brick/allocator/partition_allocator/page_allocator.h"
 #include "brick/allocator/partition_allocator/partition_alloc_constants.h"
 #include "brick/allocator/partition_allocator/partition_bucket.h"
 #include "brick/allocator/partition_allocator/partition_cookie.h"
 #include "brick/allocator/partition_allocator/partition_page.h"
 #include "brick/allocator/partition_allocator/partition_root_base.h"
+#include "brick/allocator/partition_allocator/partition_thread_cache.h"
 #include "brick/allocator/partition_allocator/spin_lock.h"
 #include "brick/base_export.h"
 #include "brick/bits.h"
@@ -76,6 +79,7 @@
 #include "brick/logging.h"
 #include "brick/macros.h"
 #include "brick/sys_byteorder.h"
+#include "brick/time/time.h"
 #include "build/build_config.h"
 
 #if defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
@@ -94,6 +98,10 @@ enum PartitionPurgeFlags {
   // size. It often frees a similar amount of memory to decommitting the empty
   // pages, though.
   PartitionPurgeDiscardUnusedSystemPages = 1 << 1,
+  // Returns the slots held by the thread caches to the partition. The cache
+  // of the calling thread is purged right away, the other ones at their next
+  // allocation or free.
+  PartitionPurgeThreadCaches = 1 << 2,
 };
 
 // Never instantiate a PartitionRoot directly, instead use PartitionAlloc.
@@ -140,10 +148,23 @@ struct BRICK_EXPORT PartitionRootGeneric : public internal::PartitionRootBase {
       bucket_lookups[((kBitsPerSizeT + 1) * kGenericNumBucketsPerOrder) + 1] =
           {};
   internal::PartitionBucket buckets[kGenericNumBuckets] = {};
+  // Set by EnableThreadCache(), possibly while other threads allocate.
+  std::atomic<bool> with_thread_cache{false};
+  // The caches of the threads using the partition. Protected by |lock|.
+  internal::PartitionThreadCache* thread_caches = nullptr;
+  // The number of allocations from each bucket, an always-on histogram of
+  // the allocation sizes. Protected by |lock|. The thread caches count their
+  // allocations on their own, and add them up here when they take the lock.
+  size_t bucket_num_allocs[kGenericNumBuckets] = {};
 
   // Public API.
   void Init();
 
+  // Lets the threads allocate small slots from caches of their own, without
+  // taking |lock|. Call after Init(), before the partition is used. Only one
+  // partition of the process can have thread caches.
+  void EnableThreadCache();
+
   ALWAYS_INLINE void* Alloc(size_t size, const char* type_name);
   ALWAYS_INLINE void Free(void* ptr);
 
@@ -151,6 +172,9 @@ struct BRICK_EXPORT PartitionRootGeneric : public internal::PartitionRootBase {
 
   ALWAYS_INLINE size_t ActualSize(size_t size);
 
+  // Counts an allocation from |bucket|, with |lock| held.
+  ALWAYS_INLINE void CountAlloc(const internal::PartitionBucket* bucket);
+
   void PurgeMemory(int flags);
 
   void DumpStats(const char* partition_name,
@@ -167,6 +191,10 @@ struct PartitionMemoryStats {
   size_t total_active_bytes;     // Total active bytes in the partition.
   size_t total_decommittable_bytes;  // Total bytes that could be decommitted.
   size_t total_discardable_bytes;    // Total bytes that could be discarded.
+  size_t num_slow_path_allocs;       // Allocations which took the slow path.
+  size_t num_direct_map_allocs;      // Direct mapped allocations.
+  TimeDelta slow_path_time;          // Time spent in the slow path.
+  TimeDelta direct_map_time;         // Part of it spent mapping memory.
 };
 
 // Struct used to retrieve memory statistics about a partition bucket. Used by
@@ -189,6 +217,19 @@ struct PartitionBucketMemoryStats {
                                  // but not decommitted.
   uint32_t num_decommitted_pages;  // Number of pages that are empty
                                    // and decommitted.
+  size_t num_allocs;  // Allocations from the bucket so far, for the regular
+                      // buckets of generic partitions.
+};
+
+// Struct used to retrieve statistics about the thread caches of a partition.
+// Used by PartitionStatsDumper implementation.
+struct PartitionThreadCacheStats {
+  size_t num_thread_caches;  // Number of threads with a cache.
+  size_t cached_bytes;       // Total size of the slots held by the caches.
+  size_t num_allocs;         // Allocations served by the caches.
+  size_t num_refills;        // Batches of slots taken from the partition.
+  size_t num_frees;          // Frees taken by the caches.
+  size_t num_flushes;        // Batches of slots returned to the partition.
 };
 
 // Interface that is passed to PartitionDumpStats and
@@ -202,6 +243,12 @@ class BRICK_EXPORT PartitionStatsDumper {
   // Called to dump stats about buckets, for each bucket.
   virtual void PartitionsDumpBucketStats(const char* partition_name,
                                          const PartitionBucketMemoryStats*) = 0;
+
+  // Called to dump stats about the thread caches, once per partition which
+  // has them.
+  virtual void PartitionDumpThreadCacheStats(const char* partition_name,
+                                             const PartitionThreadCacheStats*) {
+  }
 };
 
 BRICK_EXPORT void PartitionAllocGlobalInit(void (*oom_handling_function)());
@@ -324,9 +371,17 @@ ALWAYS_INLINE void* PartitionAllocGenericFlags(PartitionRootGeneric* root,
   size = internal::PartitionCookieSizeAdjustAdd(size);
   internal::PartitionBucket* bucket = PartitionGenericSizeToBucket(root, size);
   void* ret = nullptr;
-  {
+  if (root->with_thread_cache.load(std::memory_order_acquire)) {
+    internal::PartitionThreadCache* cache =
+        internal::PartitionThreadCache::Get(root);
+    if (LIKELY(cache))
+      ret = cache->Alloc(bucket, size);
+  }
+  if (!ret) {
     subtle::SpinLock::Guard guard(root->lock);
     ret = root->AllocFromBucket(bucket, flags, size);
+    if (LIKELY(ret))
+      root->CountAlloc(bucket);
   }
   PartitionAllocHooks::AllocationHookIfEnabled(ret, requested_size, type_name);
   return ret;
@@ -352,6 +407,12 @@ ALWAYS_INLINE void PartitionRootGeneric::Free(void* ptr) {
   internal::PartitionPage* page = internal::PartitionPage::FromPointer(ptr);
   // TODO(palmer): See if we can afford to make this a CHECK.
   DCHECK(IsValidPage(page));
+  if (this->with_thread_cache.load(std::memory_order_acquire)) {
+    internal::PartitionThreadCache* cache =
+        internal::PartitionThreadCache::Get(this);
+    if (LIKELY(cache) && cache->Free(page->bucket, ptr))
+      return;
+  }
   {
     subtle::SpinLock::Guard guard(this->lock);
     page->Free(ptr);
@@ -359,6 +420,16 @@ ALWAYS_INLINE void PartitionRootGeneric::Free(void* ptr) {
 #endif
 }
 
+ALWAYS_INLINE void PartitionRootGeneric::CountAlloc(
+    const internal::PartitionBucket* bucket) {
+  // The pseudo buckets of the direct mapped sizes are not in the array.
+  size_t index = (reinterpret_cast<uintptr_t>(bucket) -
+                  reinterpret_cast<uintptr_t>(buckets)) /
+                 sizeof(internal::PartitionBucket);
+  if (LIKELY(index < kGenericNumBuckets))
+    ++bucket_num_allocs[index];
+}
+
 BRICK_EXPORT void* PartitionReallocGenericFlags(PartitionRootGeneric* root,
                                                int flags,
                                                void* ptr,
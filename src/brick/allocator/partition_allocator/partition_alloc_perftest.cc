@@ -0,0 +1,248 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures a malloc()-like workload on a generic partition from one to eight
+// threads, with and without thread caches, to show how the allocator scales,
+// and random accesses to a large heap with and without huge pages.
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "brick/allocator/partition_allocator/partition_alloc.h"
+#include "brick/macros.h"
+#include "brick/strings/stringprintf.h"
+#include "brick/threading/platform_thread.h"
+#include "brick/time/time.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+#if defined(OS_LINUX)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace base {
+
+namespace {
+
+constexpr int kNumOperations = 1000000;
+// The number of allocations each thread keeps alive, freed in a different
+// order than they were allocated.
+constexpr size_t kNumLiveAllocations = 128;
+
+class MallocWorkload : public PlatformThread::Delegate {
+ public:
+  MallocWorkload(PartitionRootGeneric* root, uint32_t seed)
+      : root_(root), random_state_(seed) {}
+
+  void ThreadMain() override {
+    void* live[kNumLiveAllocations] = {};
+    for (int i = 0; i < kNumOperations; ++i) {
+      uint32_t random = NextRandom();
+      size_t index = random % kNumLiveAllocations;
+      if (live[index])
+        root_->Free(live[index]);
+      // Mostly small sizes, as seen by malloc().
+      size_t size = 8 + ((random >> 8) % 248);
+      if (!(random & 0xf0000000))
+        size *= 8;
+      live[index] = root_->Alloc(size, "MallocWorkload");
+      static_cast<char*>(live[index])[0] = 1;
+    }
+    for (void* ptr : live) {
+      if (ptr)
+        root_->Free(ptr);
+    }
+  }
+
+ private:
+  uint32_t NextRandom() {
+    // Xorshift, so that the measurement doesn't include a locked generator.
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    return random_state_;
+  }
+
+  PartitionRootGeneric* const root_;
+  uint32_t random_state_;
+
+  DISALLOW_COPY_AND_ASSIGN(MallocWorkload);
+};
+
+// Counts the data TLB misses of the current thread, where the system lets
+// the process read the hardware counters.
+class DataTlbMissCounter {
+ public:
+  DataTlbMissCounter() {
+#if defined(OS_LINUX)
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  ~DataTlbMissCounter() {
+#if defined(OS_LINUX)
+    if (fd_ >= 0)
+      close(fd_);
+#endif
+  }
+
+  bool IsAvailable() const { return fd_ >= 0; }
+
+  void Start() {
+#if defined(OS_LINUX)
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  // Returns the number of misses since Start().
+  uint64_t Stop() {
+    uint64_t count = 0;
+#if defined(OS_LINUX)
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd_, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+    }
+#endif
+    return count;
+  }
+
+ private:
+  int fd_ = -1;
+
+  DISALLOW_COPY_AND_ASSIGN(DataTlbMissCounter);
+};
+
+// 256 MiB of 256 byte allocations, far more than the TLB covers with 4 KiB
+// pages.
+constexpr size_t kNumHeapNodes = 1 << 20;
+constexpr size_t kHeapNodeSize = 256;
+constexpr int kNumHeapAccesses = 10000000;
+
+struct HeapNode {
+  HeapNode* next;
+};
+
+void RunRandomHeapAccesses(bool with_huge_pages) {
+  PartitionAllocatorGeneric allocator;
+  allocator.init();
+  if (with_huge_pages)
+    allocator.root()->EnableHugePages();
+
+  std::vector<HeapNode*> nodes(kNumHeapNodes);
+  for (HeapNode*& node : nodes) {
+    node = static_cast<HeapNode*>(
+        allocator.root()->Alloc(kHeapNodeSize, "HeapNode"));
+  }
+  // Link the nodes in a random cycle, so that each access depends on the
+  // previous one and is likely on another page.
+  std::vector<size_t> order(kNumHeapNodes);
+  for (size_t i = 0; i < kNumHeapNodes; ++i)
+    order[i] = i;
+  uint32_t random_state = 2463534242u;
+  for (size_t i = kNumHeapNodes - 1; i > 0; --i) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    std::swap(order[i], order[random_state % (i + 1)]);
+  }
+  for (size_t i = 0; i < kNumHeapNodes; ++i)
+    nodes[order[i]]->next = nodes[order[(i + 1) % kNumHeapNodes]];
+
+  DataTlbMissCounter tlb_misses;
+  HeapNode* node = nodes[order[0]];
+  tlb_misses.Start();
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumHeapAccesses; ++i)
+    node = node->next;
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  const uint64_t num_tlb_misses = tlb_misses.Stop();
+  // Keeps the loop from being optimized out.
+  EXPECT_TRUE(node);
+
+  const char* trace = with_huge_pages ? "_huge_pages" : "";
+  perf_test::PrintResult(
+      "random_heap_access", trace, "time",
+      elapsed.InNanoseconds() / static_cast<double>(kNumHeapAccesses),
+      "ns/access", true);
+  if (tlb_misses.IsAvailable()) {
+    perf_test::PrintResult(
+        "random_heap_access", trace, "dtlb_misses",
+        num_tlb_misses / static_cast<double>(kNumHeapAccesses),
+        "misses/access", true);
+  }
+
+  for (HeapNode* node_to_free : nodes)
+    allocator.root()->Free(node_to_free);
+}
+
+void RunMallocWorkload(bool with_thread_cache) {
+  for (int num_threads : {1, 2, 4, 8}) {
+    PartitionAllocatorGeneric allocator;
+    allocator.init();
+    if (with_thread_cache)
+      allocator.root()->EnableThreadCache();
+
+    std::vector<std::unique_ptr<MallocWorkload>> workloads;
+    std::vector<PlatformThreadHandle> handles(num_threads);
+    const TimeTicks start = TimeTicks::Now();
+    for (int i = 0; i < num_threads; ++i) {
+      workloads.push_back(
+          std::make_unique<MallocWorkload>(allocator.root(), 2463534242u + i));
+      ASSERT_TRUE(
+          PlatformThread::Create(0, workloads.back().get(), &handles[i]));
+    }
+    for (PlatformThreadHandle handle : handles)
+      PlatformThread::Join(handle);
+    const TimeDelta elapsed = TimeTicks::Now() - start;
+
+    // Alloc() and Free() per operation.
+    const double num_calls = 2.0 * kNumOperations * num_threads;
+    perf_test::PrintResult(
+        "malloc_workload",
+        with_thread_cache ? "_thread_cache" : "",
+        StringPrintf("%d_threads", num_threads),
+        num_calls / elapsed.InMicrosecondsF(), "calls/us", true);
+  }
+}
+
+}  // namespace
+
+TEST(PartitionAllocPerfTest, MallocWorkload) {
+  RunMallocWorkload(false);
+}
+
+TEST(PartitionAllocPerfTest, MallocWorkloadWithThreadCache) {
+  RunMallocWorkload(true);
+}
+
+TEST(PartitionAllocPerfTest, RandomHeapAccesses) {
+  RunRandomHeapAccesses(false);
+}
+
+TEST(PartitionAllocPerfTest, RandomHeapAccessesWithHugePages) {
+  RunRandomHeapAccesses(true);
+}
+
+}  // namespace base
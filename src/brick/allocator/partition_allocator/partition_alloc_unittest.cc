@@ -14,6 +14,7 @@
 #include "brick/bit_cast.h"
 #include "brick/bits.h"
 #include "brick/sys_info.h"
+#include "brick/threading/platform_thread.h"
 #include "build/build_config.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -329,6 +330,91 @@ class MockPartitionStatsDumper : public PartitionStatsDumper {
   std::vector<PartitionBucketMemoryStats> bucket_stats;
 };
 
+class ThreadCacheStatsDumper : public PartitionStatsDumper {
+ public:
+  void PartitionDumpTotals(const char* partition_name,
+                           const PartitionMemoryStats* stats) override {}
+  void PartitionsDumpBucketStats(
+      const char* partition_name,
+      const PartitionBucketMemoryStats* stats) override {}
+  void PartitionDumpThreadCacheStats(
+      const char* partition_name,
+      const PartitionThreadCacheStats* stats) override {
+    dumped = true;
+    thread_cache_stats = *stats;
+  }
+
+  bool dumped = false;
+  PartitionThreadCacheStats thread_cache_stats = {};
+};
+
+// Keeps the totals and the regular buckets of a dump.
+class CountersDumper : public PartitionStatsDumper {
+ public:
+  void PartitionDumpTotals(const char* partition_name,
+                           const PartitionMemoryStats* stats) override {
+    totals = *stats;
+  }
+  void PartitionsDumpBucketStats(
+      const char* partition_name,
+      const PartitionBucketMemoryStats* stats) override {
+    if (!stats->is_direct_map)
+      bucket_stats.push_back(*stats);
+  }
+
+  const PartitionBucketMemoryStats* GetBucketStats(size_t bucket_size) {
+    for (const PartitionBucketMemoryStats& stats : bucket_stats) {
+      if (stats.bucket_slot_size == bucket_size)
+        return &stats;
+    }
+    return nullptr;
+  }
+
+  PartitionMemoryStats totals = {};
+  std::vector<PartitionBucketMemoryStats> bucket_stats;
+};
+
+PartitionThreadCacheStats GetThreadCacheStats(PartitionRootGeneric* root) {
+  ThreadCacheStatsDumper dumper;
+  root->DumpStats("thread_cache", true /* is_light_dump */, &dumper);
+  EXPECT_TRUE(dumper.dumped);
+  return dumper.thread_cache_stats;
+}
+
+class ThreadCacheAllocatingThread : public PlatformThread::Delegate {
+ public:
+  explicit ThreadCacheAllocatingThread(PartitionRootGeneric* root)
+      : root_(root) {}
+
+  void ThreadMain() override {
+    std::vector<void*> ptrs;
+    for (int round = 0; round < 100; ++round) {
+      for (size_t size = 1; size <= 512; size += 37) {
+        char* ptr = static_cast<char*>(root_->Alloc(size, "ThreadCache"));
+        memset(ptr, 'A', size);
+        ptrs.push_back(ptr);
+      }
+      // Keep half of the allocations for another round, so that the slots
+      // are not always freed in the order they were allocated.
+      std::vector<void*> kept;
+      for (size_t i = 0; i < ptrs.size(); ++i) {
+        if (i % 2 == static_cast<size_t>(round % 2))
+          root_->Free(ptrs[i]);
+        else
+          kept.push_back(ptrs[i]);
+      }
+      ptrs.swap(kept);
+    }
+    for (void* ptr : ptrs)
+      root_->Free(ptr);
+  }
+
+ private:
+  PartitionRootGeneric* const root_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadCacheAllocatingThread);
+};
+
 }  // namespace
 
 // Check that the most basic of allocate / free pairs work.
@@ -1685,6 +1771,28 @@ TEST_F(PartitionAllocTest, DumpMemoryStats) {
   }
 }
 
+// Tests the always-on counters of the allocations.
+TEST_F(PartitionAllocTest, DumpAllocationCounters) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 10; ++i)
+    ptrs.push_back(root->Alloc(128 - kExtraAllocSize, type_name));
+  ptrs.push_back(root->Alloc(kGenericMaxBucketed + 1, type_name));
+
+  CountersDumper dumper;
+  root->DumpStats("counters", false /* detailed dump */, &dumper);
+  const PartitionBucketMemoryStats* stats = dumper.GetBucketStats(128);
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(10u, stats->num_allocs);
+  // The first slot of the bucket, and the direct mapped allocation.
+  EXPECT_EQ(2u, dumper.totals.num_slow_path_allocs);
+  EXPECT_EQ(1u, dumper.totals.num_direct_map_allocs);
+  EXPECT_GE(dumper.totals.slow_path_time, dumper.totals.direct_map_time);
+
+  for (void* ptr : ptrs)
+    root->Free(ptr);
+}
+
 // Tests the API to purge freeable memory.
 TEST_F(PartitionAllocTest, Purge) {
   char* ptr = reinterpret_cast<char*>(
@@ -2123,6 +2231,155 @@ TEST_F(PartitionAllocTest, SmallReallocDoesNotMoveTrailingCookie) {
   generic_allocator.root()->Free(ptr);
 }
 
+// Huge pages and NUMA nodes are hints, the partition works the same with or
+// without them.
+TEST_F(PartitionAllocTest, HugePagesAndNumaNode) {
+  PartitionAllocatorGeneric huge_page_allocator;
+  huge_page_allocator.init();
+  PartitionRootGeneric* root = huge_page_allocator.root();
+  root->EnableHugePages();
+  root->SetNumaNode(0);
+
+  const size_t sizes[] = {16, 1000, kGenericMaxBucketed - 1,
+                          kGenericMaxBucketed + 1, 4 * kHugePageSize};
+  void* ptrs[arraysize(sizes)];
+  for (size_t i = 0; i < arraysize(sizes); ++i) {
+    ptrs[i] = root->Alloc(sizes[i], type_name);
+    ASSERT_TRUE(ptrs[i]);
+    memset(ptrs[i], 'A', sizes[i]);
+  }
+  // The slot spans which come after the first one are usable too.
+  void* more_ptrs[64];
+  for (void*& ptr : more_ptrs) {
+    ptr = root->Alloc(kSystemPageSize, type_name);
+    ASSERT_TRUE(ptr);
+    memset(ptr, 'B', kSystemPageSize);
+  }
+  for (size_t i = 0; i < arraysize(sizes); ++i) {
+    EXPECT_EQ('A', static_cast<char*>(ptrs[i])[sizes[i] - 1]);
+    root->Free(ptrs[i]);
+  }
+  for (void* ptr : more_ptrs)
+    root->Free(ptr);
+  root->PurgeMemory(PartitionPurgeDecommitEmptyPages |
+                    PartitionPurgeDiscardUnusedSystemPages);
+}
+
+TEST_F(PartitionAllocTest, ThreadCacheReusesSlots) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  root->EnableThreadCache();
+
+  void* ptr = root->Alloc(40, type_name);
+  EXPECT_TRUE(ptr);
+  root->Free(ptr);
+  void* reused_ptr = root->Alloc(40, type_name);
+  EXPECT_EQ(ptr, reused_ptr);
+  root->Free(reused_ptr);
+
+  PartitionThreadCacheStats stats = GetThreadCacheStats(root);
+  EXPECT_EQ(1u, stats.num_thread_caches);
+  EXPECT_EQ(2u, stats.num_allocs);
+  EXPECT_EQ(2u, stats.num_frees);
+  EXPECT_EQ(1u, stats.num_refills);
+  EXPECT_EQ(0u, stats.num_flushes);
+  EXPECT_NE(0u, stats.cached_bytes);
+}
+
+TEST_F(PartitionAllocTest, ThreadCacheSkipsLargeSlots) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  root->EnableThreadCache();
+
+  void* ptr =
+      root->Alloc(PartitionThreadCache::kMaxCachedSlotSize + 1, type_name);
+  EXPECT_TRUE(ptr);
+  root->Free(ptr);
+  ptr = root->Alloc(kGenericMaxBucketed + 1, type_name);
+  EXPECT_TRUE(ptr);
+  root->Free(ptr);
+
+  PartitionThreadCacheStats stats = GetThreadCacheStats(root);
+  EXPECT_EQ(0u, stats.num_allocs);
+  EXPECT_EQ(0u, stats.num_frees);
+  EXPECT_EQ(0u, stats.cached_bytes);
+}
+
+TEST_F(PartitionAllocTest, ThreadCacheIsBounded) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  root->EnableThreadCache();
+
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 1000; ++i)
+    ptrs.push_back(root->Alloc(16, type_name));
+  for (void* ptr : ptrs)
+    root->Free(ptr);
+
+  PartitionThreadCacheStats stats = GetThreadCacheStats(root);
+  EXPECT_EQ(1000u, stats.num_frees);
+  EXPECT_NE(0u, stats.num_flushes);
+  EXPECT_LE(stats.cached_bytes, PartitionThreadCache::kMaxCachedBytesPerBucket);
+  EXPECT_NE(0u, stats.cached_bytes);
+}
+
+TEST_F(PartitionAllocTest, ThreadCachePurge) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  root->EnableThreadCache();
+
+  void* ptr = root->Alloc(100, type_name);
+  root->Free(ptr);
+  EXPECT_NE(0u, GetThreadCacheStats(root).cached_bytes);
+
+  root->PurgeMemory(PartitionPurgeThreadCaches);
+  EXPECT_EQ(0u, GetThreadCacheStats(root).cached_bytes);
+
+  // Once purged, the page of the slot is empty again.
+  internal::PartitionPage* page = internal::PartitionPage::FromPointer(
+      internal::PartitionCookieFreePointerAdjust(ptr));
+  EXPECT_EQ(0, page->num_allocated_slots);
+}
+
+TEST_F(PartitionAllocTest, ThreadCacheCountsAllocations) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  root->EnableThreadCache();
+
+  for (int i = 0; i < 100; ++i)
+    root->Free(root->Alloc(128 - kExtraAllocSize, type_name));
+  // The cache adds its counts to the partition when it takes the lock.
+  root->PurgeMemory(PartitionPurgeThreadCaches);
+
+  CountersDumper dumper;
+  root->DumpStats("counters", false /* detailed dump */, &dumper);
+  const PartitionBucketMemoryStats* stats = dumper.GetBucketStats(128);
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(100u, stats->num_allocs);
+}
+
+TEST_F(PartitionAllocTest, ThreadCacheMultipleThreads) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  root->EnableThreadCache();
+
+  constexpr size_t kNumThreads = 4;
+  std::vector<std::unique_ptr<ThreadCacheAllocatingThread>> delegates;
+  PlatformThreadHandle handles[kNumThreads];
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    delegates.push_back(std::make_unique<ThreadCacheAllocatingThread>(root));
+    ASSERT_TRUE(PlatformThread::Create(0, delegates[i].get(), &handles[i]));
+  }
+  for (size_t i = 0; i < kNumThreads; ++i)
+    PlatformThread::Join(handles[i]);
+
+  // The caches of the threads are gone, along with their slots.
+  PartitionThreadCacheStats stats = GetThreadCacheStats(root);
+  EXPECT_EQ(0u, stats.num_thread_caches);
+  EXPECT_EQ(0u, stats.cached_bytes);
+  for (size_t i = 0; i < kGenericNumBuckets; ++i) {
+    for (internal::PartitionPage* page = root->buckets[i].active_pages_head;
+         page && page != internal::PartitionPage::get_sentinel_page();
+         page = page->next_page) {
+      EXPECT_EQ(0, page->num_allocated_slots);
+    }
+  }
+}
+
 }  // namespace internal
 }  // namespace base
 
@@ -10,6 +10,8 @@
 #include "brick/allocator/partition_allocator/partition_oom.h"
 #include "brick/allocator/partition_allocator/partition_page.h"
 #include "brick/allocator/partition_allocator/partition_root_base.h"
+#include "brick/macros.h"
+#include "brick/time/time.h"
 #include "build/build_config.h"
 
 namespace base {
@@ -17,9 +19,26 @@ namespace internal {
 
 namespace {
 
+// Adds the time spent in its scope to a counter of the partition. Reading the
+// clock is cheap next to the work of the slow path, which can map memory.
+class ScopedAllocTimer {
+ public:
+  explicit ScopedAllocTimer(TimeDelta* total)
+      : total_(total), start_(TimeTicks::Now()) {}
+  ~ScopedAllocTimer() { *total_ += TimeTicks::Now() - start_; }
+
+ private:
+  TimeDelta* const total_;
+  const TimeTicks start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedAllocTimer);
+};
+
 ALWAYS_INLINE PartitionPage* PartitionDirectMap(PartitionRootBase* root,
                                                 int flags,
                                                 size_t raw_size) {
+  ScopedAllocTimer timer(&root->direct_map_time);
+  ++root->num_direct_map_allocs;
   size_t size = PartitionBucket::get_direct_map_size(raw_size);
 
   // Because we need to fake looking like a super page, we need to allocate
@@ -43,6 +62,11 @@ ALWAYS_INLINE PartitionPage* PartitionDirectMap(PartitionRootBase* root,
       AllocPages(nullptr, map_size, kSuperPageSize, PageReadWrite));
   if (UNLIKELY(!ptr))
     return nullptr;
+  // Before the pages are touched. Both are best effort.
+  if (root->numa_node >= 0)
+    SetNumaNodeForPages(ptr, map_size, root->numa_node);
+  if (root->use_huge_pages)
+    AdviseHugePages(ptr + kPartitionPageSize, size);
 
   size_t committed_page_size = size + kSystemPageSize;
   root->total_size_of_direct_mapped_pages += committed_page_size;
@@ -222,6 +246,11 @@ ALWAYS_INLINE void* PartitionBucket::AllocNewSlotSpan(
       requestedAddress, kSuperPageSize, kSuperPageSize, PageReadWrite));
   if (UNLIKELY(!super_page))
     return nullptr;
+  // Before the pages are touched. Both are best effort.
+  if (root->numa_node >= 0)
+    SetNumaNodeForPages(super_page, kSuperPageSize, root->numa_node);
+  const bool huge_pages =
+      root->use_huge_pages && AdviseHugePages(super_page, kSuperPageSize);
 
   root->total_size_of_super_pages += kSuperPageSize;
   root->IncreaseCommittedPages(total_size);
@@ -235,26 +264,30 @@ ALWAYS_INLINE void* PartitionBucket::AllocNewSlotSpan(
   char* ret = super_page + kPartitionPageSize;
   root->next_partition_page = ret + total_size;
   root->next_partition_page_end = root->next_super_page - kPartitionPageSize;
-  // Make the first partition page in the super page a guard page, but leave a
-  // hole in the middle.
-  // This is where we put page metadata and also a tiny amount of extent
-  // metadata.
-  CHECK(SetSystemPagesAccess(super_page, kSystemPageSize, PageInaccessible));
-  CHECK(SetSystemPagesAccess(super_page + (kSystemPageSize * 2),
-                             kPartitionPageSize - (kSystemPageSize * 2),
-                             PageInaccessible));
-  //  CHECK(SetSystemPagesAccess(super_page + (kSuperPageSize -
-  //  kPartitionPageSize),
-  //                             kPartitionPageSize, PageInaccessible));
-  // All remaining slotspans for the unallocated PartitionPages inside the
-  // SuperPage are conceptually decommitted. Correctly set the state here
-  // so they do not occupy resources.
-  //
-  // TODO(ajwong): Refactor Page Allocator API so the SuperPage comes in
-  // decommited initially.
-  CHECK(SetSystemPagesAccess(super_page + kPartitionPageSize + total_size,
-                             (kSuperPageSize - kPartitionPageSize - total_size),
-                             PageInaccessible));
+  // A huge page must have the same accessibility throughout, so the super
+  // page stays accessible as a whole.
+  if (!huge_pages) {
+    // Make the first partition page in the super page a guard page, but leave
+    // a hole in the middle.
+    // This is where we put page metadata and also a tiny amount of extent
+    // metadata.
+    CHECK(SetSystemPagesAccess(super_page, kSystemPageSize, PageInaccessible));
+    CHECK(SetSystemPagesAccess(super_page + (kSystemPageSize * 2),
+                               kPartitionPageSize - (kSystemPageSize * 2),
+                               PageInaccessible));
+    //  CHECK(SetSystemPagesAccess(super_page + (kSuperPageSize -
+    //  kPartitionPageSize),
+    //                             kPartitionPageSize, PageInaccessible));
+    // All remaining slotspans for the unallocated PartitionPages inside the
+    // SuperPage are conceptually decommitted. Correctly set the state here
+    // so they do not occupy resources.
+    //
+    // TODO(ajwong): Refactor Page Allocator API so the SuperPage comes in
+    // decommited initially.
+    CHECK(SetSystemPagesAccess(
+        super_page + kPartitionPageSize + total_size,
+        (kSuperPageSize - kPartitionPageSize - total_size), PageInaccessible));
+  }
 
   // If we were after a specific address, but didn't get it, assume that
   // the system chose a lousy address. Here most OS'es have a default
@@ -318,12 +351,9 @@ ALWAYS_INLINE void PartitionBucket::InitializeSlotSpan(PartitionPage* page) {
 
   page->Reset();
 
-  // If this page has just a single slot, do not set up page offsets for any
-  // page metadata other than the first one. This ensures that attempts to
-  // touch invalid page metadata fail.
-  if (page->num_unprovisioned_slots == 1)
-    return;
-
+  // Set up the page offsets even if the span has a single slot: the allocator
+  // shim aligns allocations inside of their slot, and maps them back to their
+  // slot through the page of the aligned address.
   uint16_t num_partition_pages = get_pages_per_slot_span();
   char* page_char_ptr = reinterpret_cast<char*>(page);
   for (uint16_t i = 1; i < num_partition_pages; ++i) {
@@ -453,6 +483,8 @@ void* PartitionBucket::SlowPathAlloc(PartitionRootBase* root,
                                      size_t size) {
   // The slow path is called when the freelist is empty.
   DCHECK(!this->active_pages_head->freelist_head);
+  ScopedAllocTimer timer(&root->slow_path_time);
+  ++root->num_slow_path_allocs;
 
   PartitionPage* new_page = nullptr;
 
@@ -27,6 +27,21 @@ NOINLINE void PartitionRootBase::OutOfMemory() {
   OOM_CRASH();
 }
 
+void PartitionRootBase::EnableHugePages() {
+  DCHECK(initialized);
+  DCHECK(!total_size_of_super_pages && !total_size_of_direct_mapped_pages);
+  static_assert(!(kSuperPageSize % kHugePageSize),
+                "Super pages must be made of huge pages");
+  use_huge_pages = true;
+}
+
+void PartitionRootBase::SetNumaNode(int node) {
+  DCHECK(initialized);
+  DCHECK(!total_size_of_super_pages && !total_size_of_direct_mapped_pages);
+  DCHECK_GE(node, 0);
+  numa_node = node;
+}
+
 void PartitionRootBase::DecommitEmptyPages() {
   for (size_t i = 0; i < kMaxFreeableSpans; ++i) {
     internal::PartitionPage* page = global_empty_page_ring[i];
@@ -10,6 +10,7 @@
 #include "brick/allocator/partition_allocator/partition_bucket.h"
 #include "brick/allocator/partition_allocator/partition_direct_map_extent.h"
 #include "brick/allocator/partition_allocator/partition_page.h"
+#include "brick/time/time.h"
 
 namespace base {
 namespace internal {
@@ -52,8 +53,36 @@ struct BRICK_EXPORT PartitionRootBase {
   int16_t global_empty_page_ring_index = 0;
   uintptr_t inverted_self = 0;
 
+  // Always-on counters of the expensive allocations, reported by DumpStats().
+  // Direct mapped allocations are a subset of the slow path ones.
+  size_t num_slow_path_allocs = 0;
+  size_t num_direct_map_allocs = 0;
+  TimeDelta slow_path_time;
+  TimeDelta direct_map_time;
+
+  // Set by EnableHugePages() and SetNumaNode().
+  bool use_huge_pages = false;
+  int numa_node = -1;
+
   // Public API
 
+  // Backs the super pages and the direct mapped allocations of the partition
+  // with transparent huge pages where the system supports them, for fewer TLB
+  // misses on large heaps. A huge page can't span pages with different
+  // accessibilities, so the super pages then have no guard pages, and their
+  // unused partition pages are not made inaccessible. Each super page also
+  // becomes resident as a whole when first touched.
+  //
+  // Call after Init(), before the partition is used.
+  void EnableHugePages();
+
+  // Allocates the memory of the partition from NUMA node |node| when it has
+  // some left, so that the threads running on that node use local memory.
+  // Has no effect where the system doesn't support it.
+  //
+  // Call after Init(), before the partition is used.
+  void SetNumaNode(int node);
+
   // Allocates out of the given bucket. Properly, this function should probably
   // be in PartitionBucket, but because the implementation needs to be inlined
   // for performance, and because it needs to inspect PartitionPage,
@@ -0,0 +1,264 @@
+// Copyright (c) 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/allocator/partition_allocator/partition_thread_cache.h"
+
+#include <algorithm>
+#include <new>
+
+#include "brick/allocator/partition_allocator/page_allocator.h"
+#include "brick/allocator/partition_allocator/partition_alloc.h"
+#include "brick/allocator/partition_allocator/partition_page.h"
+#include "brick/allocator/partition_allocator/spin_lock.h"
+#include "brick/no_destructor.h"
+#include "brick/threading/platform_thread.h"
+#include "brick/threading/thread_local_storage.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+constexpr size_t kCacheAllocationSize =
+    (sizeof(PartitionThreadCache) + kPageAllocationGranularity - 1) &
+    kPageAllocationGranularityBaseMask;
+
+// The partition with thread caches, and the number of times thread caches
+// were enabled. A cache made for another generation is stale: its partition
+// is gone, even if a new one took its address.
+std::atomic<PartitionRootGeneric*> g_thread_cache_root{nullptr};
+std::atomic<uint32_t> g_thread_cache_generation{0};
+
+ThreadLocalStorage::Slot& ThreadCacheSlot(
+    ThreadLocalStorage::TLSDestructorFunc on_thread_exit) {
+  static NoDestructor<ThreadLocalStorage::Slot> thread_cache_slot(
+      on_thread_exit);
+  return *thread_cache_slot;
+}
+
+}  // namespace
+
+// static
+void PartitionThreadCache::EnableForPartition(PartitionRootGeneric* root) {
+  // Initialize the slot now rather than from an allocation.
+  ThreadCacheSlot(&OnThreadExit);
+  PartitionRootGeneric* expected = nullptr;
+  CHECK(g_thread_cache_root.compare_exchange_strong(expected, root))
+      << "Only one partition can have thread caches";
+  g_thread_cache_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+// static
+void PartitionThreadCache::DisableForPartition(PartitionRootGeneric* root) {
+  // The caches of the threads are freed as they exit, or as the threads
+  // allocate from another partition with thread caches.
+  DCHECK_EQ(root, g_thread_cache_root.load());
+  g_thread_cache_generation.fetch_add(1, std::memory_order_relaxed);
+  g_thread_cache_root.store(nullptr);
+}
+
+// static
+PartitionThreadCache* PartitionThreadCache::Get(PartitionRootGeneric* root) {
+  if (UNLIKELY(ThreadLocalStorage::HasBeenDestroyed()))
+    return nullptr;
+  ThreadLocalStorage::Slot& slot = ThreadCacheSlot(&OnThreadExit);
+  auto* cache = static_cast<PartitionThreadCache*>(slot.Get());
+  const uint32_t generation =
+      g_thread_cache_generation.load(std::memory_order_relaxed);
+  if (LIKELY(cache && cache->generation_ == generation))
+    return cache;
+
+  if (cache) {
+    // The slots belong to a partition which is gone.
+    cache->~PartitionThreadCache();
+    FreePages(cache, kCacheAllocationSize);
+  }
+  void* memory = AllocPages(nullptr, kCacheAllocationSize,
+                            kPageAllocationGranularity, PageReadWrite);
+  if (!memory) {
+    slot.Set(nullptr);
+    return nullptr;
+  }
+  cache = new (memory) PartitionThreadCache(root, generation);
+  slot.Set(cache);
+  // The first Set() of a thread allocates its TLS vector, which comes back
+  // here if the partition is behind malloc(), and overwrites the cache made
+  // by the inner call.
+  cache->DeleteReentrantCaches();
+  return cache;
+}
+
+PartitionThreadCache::PartitionThreadCache(PartitionRootGeneric* root,
+                                           uint32_t generation)
+    : root_(root),
+      partition_buckets_(root->buckets),
+      generation_(generation),
+      thread_id_(PlatformThread::CurrentId()) {
+  for (size_t i = 0; i < kGenericNumBuckets; ++i) {
+    Bucket& bucket = buckets_[i];
+    bucket.freelist_head = nullptr;
+    bucket.count = 0;
+    bucket.low_water = 0;
+    bucket.limit = 0;
+    bucket.num_allocs = 0;
+    // The pseudo buckets which keep the size to bucket map fast have no slot
+    // size.
+    const size_t slot_size = partition_buckets_[i].slot_size;
+    if (slot_size && slot_size <= kMaxCachedSlotSize) {
+      bucket.limit = static_cast<uint16_t>(
+          std::min<size_t>(kMaxSlotsPerBucket,
+                           std::max<size_t>(1, kMaxCachedBytesPerBucket /
+                                                   slot_size)));
+    }
+  }
+
+  subtle::SpinLock::Guard guard(root_->lock);
+  next_ = root_->thread_caches;
+  if (next_)
+    next_->prev_ = this;
+  root_->thread_caches = this;
+}
+
+PartitionThreadCache::~PartitionThreadCache() = default;
+
+// static
+void PartitionThreadCache::OnThreadExit(void* cache_ptr) {
+  auto* cache = static_cast<PartitionThreadCache*>(cache_ptr);
+  // A stale cache has no partition to return its slots to.
+  if (cache->generation_ ==
+      g_thread_cache_generation.load(std::memory_order_relaxed)) {
+    cache->Release();
+  }
+  cache->~PartitionThreadCache();
+  FreePages(cache, kCacheAllocationSize);
+}
+
+void PartitionThreadCache::Release() {
+  Purge();
+  subtle::SpinLock::Guard guard(root_->lock);
+  if (prev_)
+    prev_->next_ = next_;
+  else
+    root_->thread_caches = next_;
+  if (next_)
+    next_->prev_ = prev_;
+  next_ = prev_ = nullptr;
+}
+
+void PartitionThreadCache::DeleteReentrantCaches() {
+  while (true) {
+    PartitionThreadCache* reentrant_cache = nullptr;
+    {
+      // The caches linked since this one come first.
+      subtle::SpinLock::Guard guard(root_->lock);
+      for (PartitionThreadCache* cache = root_->thread_caches; cache != this;
+           cache = cache->next_) {
+        if (cache->thread_id_ == thread_id_) {
+          reentrant_cache = cache;
+          break;
+        }
+      }
+    }
+    if (!reentrant_cache)
+      return;
+    reentrant_cache->Release();
+    reentrant_cache->~PartitionThreadCache();
+    FreePages(reentrant_cache, kCacheAllocationSize);
+  }
+}
+
+void PartitionThreadCache::Purge() {
+  purge_requested_.store(false, std::memory_order_relaxed);
+  subtle::SpinLock::Guard guard(root_->lock);
+  for (size_t i = 0; i < kGenericNumBuckets; ++i) {
+    if (buckets_[i].count)
+      FlushLocked(i, buckets_[i].count);
+    buckets_[i].low_water = 0;
+    CountAllocsLocked(i);
+  }
+}
+
+void PartitionThreadCache::AccumulateStats(
+    PartitionThreadCacheStats* stats) const {
+  ++stats->num_thread_caches;
+  stats->cached_bytes += cached_bytes_.load(std::memory_order_relaxed);
+  stats->num_allocs += num_allocs_.load(std::memory_order_relaxed);
+  stats->num_refills += num_refills_.load(std::memory_order_relaxed);
+  stats->num_frees += num_frees_.load(std::memory_order_relaxed);
+  stats->num_flushes += num_flushes_.load(std::memory_order_relaxed);
+}
+
+bool PartitionThreadCache::Refill(size_t index, size_t size) {
+  Bucket& cached = buckets_[index];
+  PartitionBucket* bucket = &partition_buckets_[index];
+  const size_t batch_size = (cached.limit + 1) / 2;
+  subtle::SpinLock::Guard guard(root_->lock);
+  CountAllocsLocked(index);
+  for (size_t i = 0; i < batch_size; ++i) {
+    // Let the caller's allocation deal with running out of memory.
+    void* ret = root_->AllocFromBucket(bucket, PartitionAllocReturnNull, size);
+    if (!ret)
+      break;
+    PartitionFreelistEntry* entry = static_cast<PartitionFreelistEntry*>(
+        PartitionCookieFreePointerAdjust(ret));
+    entry->next = PartitionFreelistEntry::Transform(cached.freelist_head);
+    cached.freelist_head = entry;
+    ++cached.count;
+    Increment(&cached_bytes_, bucket->slot_size);
+  }
+  Increment(&num_refills_, 1);
+  return cached.freelist_head != nullptr;
+}
+
+void PartitionThreadCache::Flush(size_t index, size_t count) {
+  subtle::SpinLock::Guard guard(root_->lock);
+  FlushLocked(index, count);
+}
+
+void PartitionThreadCache::FlushLocked(size_t index, size_t count) {
+  Bucket& cached = buckets_[index];
+  const size_t slot_size = partition_buckets_[index].slot_size;
+  DCHECK_LE(count, cached.count);
+  for (size_t i = 0; i < count; ++i) {
+    PartitionFreelistEntry* entry = cached.freelist_head;
+    cached.freelist_head = PartitionFreelistEntry::Transform(entry->next);
+#if DCHECK_IS_ON()
+    // PartitionPage::Free() checks the cookies, which the cache overwrote.
+    PartitionCookieWriteValue(entry);
+    PartitionCookieWriteValue(reinterpret_cast<char*>(entry) + slot_size -
+                              kCookieSize);
+#endif
+    PartitionPage::FromPointer(entry)->Free(entry);
+  }
+  cached.count -= static_cast<uint16_t>(count);
+  if (cached.low_water > cached.count)
+    cached.low_water = cached.count;
+  Decrement(&cached_bytes_, count * slot_size);
+  Increment(&num_flushes_, 1);
+}
+
+void PartitionThreadCache::PeriodicPurge() {
+  operations_ = 0;
+  if (purge_requested_.load(std::memory_order_relaxed)) {
+    Purge();
+    return;
+  }
+  subtle::SpinLock::Guard guard(root_->lock);
+  for (size_t i = 0; i < kGenericNumBuckets; ++i) {
+    Bucket& cached = buckets_[i];
+    // The slots below the low water mark weren't needed for a whole interval.
+    if (cached.low_water)
+      FlushLocked(i, cached.low_water);
+    cached.low_water = cached.count;
+    CountAllocsLocked(i);
+  }
+}
+
+void PartitionThreadCache::CountAllocsLocked(size_t index) {
+  root_->bucket_num_allocs[index] += buckets_[index].num_allocs;
+  buckets_[index].num_allocs = 0;
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,242 @@
+// Copyright (c) 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_ALLOCATOR_PARTITION_ALLOCATOR_PARTITION_THREAD_CACHE_H_
+#define BRICK_ALLOCATOR_PARTITION_ALLOCATOR_PARTITION_THREAD_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "brick/allocator/partition_allocator/partition_alloc_constants.h"
+#include "brick/allocator/partition_allocator/partition_bucket.h"
+#include "brick/allocator/partition_allocator/partition_cookie.h"
+#include "brick/allocator/partition_allocator/partition_freelist_entry.h"
+#include "brick/base_export.h"
+#include "brick/compiler_specific.h"
+#include "brick/logging.h"
+#include "brick/macros.h"
+#include "brick/threading/platform_thread.h"
+
+namespace base {
+
+struct PartitionRootGeneric;
+struct PartitionThreadCacheStats;
+
+namespace internal {
+
+// A per-thread cache of free slots of the small buckets of a generic
+// partition, enabled with PartitionRootGeneric::EnableThreadCache(). Slots are
+// allocated from and freed to the cache of the current thread without taking
+// the partition lock; the lock is only taken to refill a cache in batches, or
+// to return slots to the partition.
+//
+// The cache is bounded: each bucket holds at most kMaxCachedBytesPerBucket
+// bytes, and at most kMaxSlotsPerBucket slots. Every kPurgeInterval
+// operations, the slots that stayed unused since the previous purge are
+// returned to the partition, so that an idle bucket doesn't hold on to memory.
+//
+// Only one partition of the process can have thread caches at a time, which
+// is expected to be the partition behind malloc(). A cache lives in pages of
+// its own, so that creating it doesn't allocate from the partition.
+class BRICK_EXPORT PartitionThreadCache {
+ public:
+  // Larger slots are never cached.
+  static constexpr size_t kMaxCachedSlotSize = 1024;
+  static constexpr size_t kMaxCachedBytesPerBucket = 8 * 1024;
+  static constexpr uint16_t kMaxSlotsPerBucket = 64;
+  static constexpr uint32_t kPurgeInterval = 1 << 16;
+
+  // Called by PartitionRootGeneric::EnableThreadCache() and when the partition
+  // goes away.
+  static void EnableForPartition(PartitionRootGeneric* root);
+  static void DisableForPartition(PartitionRootGeneric* root);
+
+  // Returns the cache of the current thread for |root|, which must have
+  // thread caches, creating it if needed. Returns nullptr while the thread is
+  // exiting.
+  static PartitionThreadCache* Get(PartitionRootGeneric* root);
+
+  // Returns a slot of |bucket| with the layout of PartitionRootBase::
+  // AllocFromBucket(), or nullptr if |bucket| isn't cached or the partition
+  // couldn't refill the cache. |size| is the requested size, with cookies.
+  ALWAYS_INLINE void* Alloc(PartitionBucket* bucket, size_t size);
+
+  // Takes |slot|, the start of a slot of |bucket|, unless |bucket| isn't
+  // cached.
+  ALWAYS_INLINE bool Free(PartitionBucket* bucket, void* slot);
+
+  // Returns all the slots of the cache to the partition.
+  void Purge();
+
+  // Asks the cache to purge itself at its next operation. Called with the
+  // partition lock held, from any thread.
+  void RequestPurge() {
+    purge_requested_.store(true, std::memory_order_relaxed);
+  }
+
+  // Adds the statistics of the cache to |stats|. Called with the partition
+  // lock held, from any thread.
+  void AccumulateStats(PartitionThreadCacheStats* stats) const;
+
+  // Links the caches of a partition, under the partition lock.
+  PartitionThreadCache* next() const { return next_; }
+
+ private:
+  struct Bucket {
+    PartitionFreelistEntry* freelist_head;
+    uint16_t count;
+    // Zero for buckets which are not cached.
+    uint16_t limit;
+    // The lowest |count| since the last periodic purge.
+    uint16_t low_water;
+    // Allocations not yet added to PartitionRootGeneric::bucket_num_allocs.
+    uint32_t num_allocs;
+  };
+
+  PartitionThreadCache(PartitionRootGeneric* root, uint32_t generation);
+  ~PartitionThreadCache();
+
+  // ThreadLocalStorage destructor of the current thread's cache.
+  static void OnThreadExit(void* cache);
+
+  // Returns the slots to the partition, and unlinks the cache from it.
+  void Release();
+  // Releases and deletes the caches of the thread made while setting up this
+  // one.
+  void DeleteReentrantCaches();
+
+  // Returns the index of |bucket| in the partition, or kGenericNumBuckets if
+  // it is not a regular bucket of the partition.
+  ALWAYS_INLINE size_t BucketIndex(const PartitionBucket* bucket) const;
+
+  // Counts an operation, and purges the cache if it's time to.
+  ALWAYS_INLINE void Tick();
+
+  // Takes a batch of slots from the partition. Returns false if there were
+  // none to get.
+  bool Refill(size_t index, size_t size);
+  // Returns |count| slots of bucket |index| to the partition.
+  void Flush(size_t index, size_t count);
+  void FlushLocked(size_t index, size_t count);
+  void PeriodicPurge();
+  // Adds the allocations of bucket |index| to the counts of the partition,
+  // with its lock held.
+  void CountAllocsLocked(size_t index);
+
+  // The counters are only written by the owning thread, and read by
+  // AccumulateStats().
+  static void Increment(std::atomic<size_t>* counter, size_t value) {
+    counter->store(counter->load(std::memory_order_relaxed) + value,
+                   std::memory_order_relaxed);
+  }
+  static void Decrement(std::atomic<size_t>* counter, size_t value) {
+    counter->store(counter->load(std::memory_order_relaxed) - value,
+                   std::memory_order_relaxed);
+  }
+
+  PartitionRootGeneric* const root_;
+  PartitionBucket* const partition_buckets_;
+  const uint32_t generation_;
+  const PlatformThreadId thread_id_;
+  uint32_t operations_ = 0;
+  std::atomic<bool> purge_requested_{false};
+
+  std::atomic<size_t> cached_bytes_{0};
+  std::atomic<size_t> num_allocs_{0};
+  std::atomic<size_t> num_refills_{0};
+  std::atomic<size_t> num_frees_{0};
+  std::atomic<size_t> num_flushes_{0};
+
+  // Protected by the partition lock.
+  PartitionThreadCache* next_ = nullptr;
+  PartitionThreadCache* prev_ = nullptr;
+
+  Bucket buckets_[kGenericNumBuckets];
+
+  DISALLOW_COPY_AND_ASSIGN(PartitionThreadCache);
+};
+
+ALWAYS_INLINE size_t
+PartitionThreadCache::BucketIndex(const PartitionBucket* bucket) const {
+  // The pseudo buckets of the direct mapped sizes are not in the array.
+  uintptr_t offset = reinterpret_cast<uintptr_t>(bucket) -
+                     reinterpret_cast<uintptr_t>(partition_buckets_);
+  size_t index = offset / sizeof(PartitionBucket);
+  return index < kGenericNumBuckets ? index : kGenericNumBuckets;
+}
+
+ALWAYS_INLINE void PartitionThreadCache::Tick() {
+  if (UNLIKELY(++operations_ >= kPurgeInterval ||
+               purge_requested_.load(std::memory_order_relaxed))) {
+    PeriodicPurge();
+  }
+}
+
+ALWAYS_INLINE void* PartitionThreadCache::Alloc(PartitionBucket* bucket,
+                                                size_t size) {
+  size_t index = BucketIndex(bucket);
+  if (index == kGenericNumBuckets || !buckets_[index].limit)
+    return nullptr;
+  Tick();
+
+  Bucket& cached = buckets_[index];
+  if (UNLIKELY(!cached.freelist_head) && !Refill(index, size))
+    return nullptr;
+  PartitionFreelistEntry* entry = cached.freelist_head;
+  cached.freelist_head = PartitionFreelistEntry::Transform(entry->next);
+  --cached.count;
+  if (cached.count < cached.low_water)
+    cached.low_water = cached.count;
+  ++cached.num_allocs;
+  Decrement(&cached_bytes_, bucket->slot_size);
+  Increment(&num_allocs_, 1);
+
+  void* ret = entry;
+#if DCHECK_IS_ON()
+  // Same as a slot from PartitionRootBase::AllocFromBucket().
+  size_t no_cookie_size = PartitionCookieSizeAdjustSubtract(bucket->slot_size);
+  char* char_ret = static_cast<char*>(ret);
+  ret = char_ret + kCookieSize;
+  PartitionCookieWriteValue(char_ret);
+  memset(ret, kUninitializedByte, no_cookie_size);
+  PartitionCookieWriteValue(char_ret + kCookieSize + no_cookie_size);
+#endif
+  return ret;
+}
+
+ALWAYS_INLINE bool PartitionThreadCache::Free(PartitionBucket* bucket,
+                                              void* slot) {
+  size_t index = BucketIndex(bucket);
+  if (index == kGenericNumBuckets || !buckets_[index].limit)
+    return false;
+  Tick();
+
+  Bucket& cached = buckets_[index];
+  if (UNLIKELY(cached.count >= cached.limit))
+    Flush(index, (cached.limit + 1) / 2);
+#if DCHECK_IS_ON()
+  // Same checks as PartitionPage::Free().
+  PartitionCookieCheckValue(slot);
+  PartitionCookieCheckValue(reinterpret_cast<char*>(slot) + bucket->slot_size -
+                            kCookieSize);
+  memset(slot, kFreedByte, bucket->slot_size);
+#endif
+  // Catches an immediate double free.
+  CHECK(slot != cached.freelist_head);
+  PartitionFreelistEntry* entry = static_cast<PartitionFreelistEntry*>(slot);
+  entry->next = PartitionFreelistEntry::Transform(cached.freelist_head);
+  cached.freelist_head = entry;
+  ++cached.count;
+  Increment(&cached_bytes_, bucket->slot_size);
+  Increment(&num_frees_, 1);
+  return true;
+}
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BRICK_ALLOCATOR_PARTITION_ALLOCATOR_PARTITION_THREAD_CACHE_H_
@@ -804,6 +804,114 @@ struct BindState final : BindStateBase {
   }
 };
 
+// InlineBoundArgs<>
+//
+// Holds the bound arguments of an InlineBindState. Unlike std::tuple, it's
+// trivially copyable if they all are.
+template <size_t index, typename T>
+struct InlineBoundArg {
+  template <typename ForwardT>
+  explicit InlineBoundArg(ForwardT&& value)
+      : value_(std::forward<ForwardT>(value)) {}
+
+  T value_;
+};
+
+template <typename Indices, typename... BoundArgs>
+struct InlineBoundArgs;
+
+template <size_t... indices, typename... BoundArgs>
+struct InlineBoundArgs<std::index_sequence<indices...>, BoundArgs...>
+    : InlineBoundArg<indices, BoundArgs>... {
+  template <typename... ForwardBoundArgs>
+  explicit InlineBoundArgs(ForwardBoundArgs&&... bound_args)
+      : InlineBoundArg<indices, BoundArgs>(
+            std::forward<ForwardBoundArgs>(bound_args))... {}
+};
+
+// Like std::get() on the bound arguments of an InlineBindState.
+template <size_t index, typename T>
+T& GetInlineBoundArg(InlineBoundArg<index, T>& arg) {
+  return arg.value_;
+}
+
+template <size_t index, typename T>
+const T& GetInlineBoundArg(const InlineBoundArg<index, T>& arg) {
+  return arg.value_;
+}
+
+template <size_t index, typename T>
+T&& GetInlineBoundArg(InlineBoundArg<index, T>&& arg) {
+  return std::move(arg.value_);
+}
+
+// InlineBindState<>
+//
+// Stores the state passed into Bind() inside the Callback, when it's small
+// and trivially copyable; see IsInlineBindState. It has no refcount, and
+// the Callback holds the invoke function.
+template <typename Functor, typename... BoundArgs>
+struct InlineBindState {
+  template <typename ForwardFunctor, typename... ForwardBoundArgs>
+  explicit InlineBindState(ForwardFunctor&& functor,
+                           ForwardBoundArgs&&... bound_args)
+      : functor_(std::forward<ForwardFunctor>(functor)),
+        bound_args_(std::forward<ForwardBoundArgs>(bound_args)...) {
+    DCHECK(!IsNull(functor_));
+  }
+
+  Functor functor_;
+  InlineBoundArgs<std::index_sequence_for<BoundArgs...>, BoundArgs...>
+      bound_args_;
+};
+
+// InlineInvoker<>
+//
+// Like Invoker<>, for an InlineBindState. |base| points to the InlineBindState
+// inside the Callback rather than to a BindStateBase.
+template <typename StorageType, typename UnboundRunType>
+struct InlineInvoker;
+
+template <typename Functor,
+          typename... BoundArgs,
+          typename R,
+          typename... UnboundArgs>
+struct InlineInvoker<InlineBindState<Functor, BoundArgs...>,
+                     R(UnboundArgs...)> {
+  using StorageType = InlineBindState<Functor, BoundArgs...>;
+
+  static R RunOnce(BindStateBase* base,
+                   PassingTraitsType<UnboundArgs>... unbound_args) {
+    StorageType* storage = reinterpret_cast<StorageType*>(base);
+    return RunImpl(std::move(storage->functor_),
+                   std::move(storage->bound_args_),
+                   std::index_sequence_for<BoundArgs...>(),
+                   std::forward<UnboundArgs>(unbound_args)...);
+  }
+
+  static R Run(BindStateBase* base,
+               PassingTraitsType<UnboundArgs>... unbound_args) {
+    const StorageType* storage = reinterpret_cast<StorageType*>(base);
+    return RunImpl(storage->functor_, storage->bound_args_,
+                   std::index_sequence_for<BoundArgs...>(),
+                   std::forward<UnboundArgs>(unbound_args)...);
+  }
+
+ private:
+  // InlineBindStates aren't cancellable, so they have no weak calls.
+  template <typename ForwardFunctor, typename BoundArgsType, size_t... indices>
+  static inline R RunImpl(ForwardFunctor&& functor,
+                          BoundArgsType&& bound,
+                          std::index_sequence<indices...>,
+                          UnboundArgs&&... unbound_args) {
+    return InvokeHelper<false, R>::MakeItSo(
+        std::forward<ForwardFunctor>(functor),
+        Unwrap(GetInlineBoundArg<indices>(
+            std::forward<BoundArgsType>(bound)))...,
+        std::forward<UnboundArgs>(unbound_args)...);
+  }
+};
+
 // Used to implement MakeBindStateType.
 template <bool is_method, typename Functor, typename... BoundArgs>
 struct MakeBindStateTypeImpl;
@@ -851,6 +959,89 @@ using MakeBindStateType =
                                    Functor,
                                    BoundArgs...>::Type;
 
+// True if the state of a BindState can be stored inside its Callback instead,
+// as an InlineBindState: it's small enough, copying its bytes copies it, and
+// it can't be cancelled.
+template <typename BindStateType>
+struct IsInlineBindState;
+
+template <typename Functor, typename... BoundArgs>
+struct IsInlineBindState<BindState<Functor, BoundArgs...>>
+    : std::integral_constant<
+          bool,
+          sizeof(InlineBindState<Functor, BoundArgs...>) <=
+                  kInlineBindStateSize &&
+              alignof(InlineBindState<Functor, BoundArgs...>) <=
+                  alignof(void*) &&
+              is_trivially_copyable<
+                  InlineBindState<Functor, BoundArgs...>>::value &&
+              !BindState<Functor, BoundArgs...>::IsCancellable::value> {};
+
+// Returns the invoke function of a CallbackType whose state is run by
+// InvokerType.
+template <typename CallbackType, typename InvokerType>
+BindStateBase::InvokeFuncStorage GetInvokeFunc(std::true_type /* is_once */) {
+  // Store the invoke func into PolymorphicInvoke before casting it to
+  // InvokeFuncStorage, so that we can ensure its type matches to
+  // PolymorphicInvoke, to which CallbackType will cast back.
+  using PolymorphicInvoke = typename CallbackType::PolymorphicInvoke;
+  PolymorphicInvoke invoke_func = &InvokerType::RunOnce;
+  return reinterpret_cast<BindStateBase::InvokeFuncStorage>(invoke_func);
+}
+
+template <typename CallbackType, typename InvokerType>
+BindStateBase::InvokeFuncStorage GetInvokeFunc(std::false_type /* is_once */) {
+  using PolymorphicInvoke = typename CallbackType::PolymorphicInvoke;
+  PolymorphicInvoke invoke_func = &InvokerType::Run;
+  return reinterpret_cast<BindStateBase::InvokeFuncStorage>(invoke_func);
+}
+
+template <typename CallbackType,
+          typename Functor,
+          typename... BoundArgs,
+          typename IsOnce,
+          typename... Args>
+CallbackType CreateCallbackImpl(BindState<Functor, BoundArgs...>*,
+                                IsOnce is_once,
+                                std::true_type /* is_inline */,
+                                Args&&... args) {
+  using InlineBindStateType = InlineBindState<Functor, BoundArgs...>;
+  using InvokerType =
+      InlineInvoker<InlineBindStateType, typename CallbackType::RunType>;
+  return CallbackType(InlineBindStateTag<InlineBindStateType>(),
+                      GetInvokeFunc<CallbackType, InvokerType>(is_once),
+                      std::forward<Args>(args)...);
+}
+
+template <typename CallbackType,
+          typename BindStateType,
+          typename IsOnce,
+          typename... Args>
+CallbackType CreateCallbackImpl(BindStateType*,
+                                IsOnce is_once,
+                                std::false_type /* is_inline */,
+                                Args&&... args) {
+  using InvokerType = Invoker<BindStateType, typename CallbackType::RunType>;
+  return CallbackType(
+      new BindStateType(GetInvokeFunc<CallbackType, InvokerType>(is_once),
+                        std::forward<Args>(args)...));
+}
+
+// Creates a CallbackType which runs a functor with bound arguments, passed in
+// |args|. They're stored inline if IsInlineBindState allows it, and in a
+// BindStateType on the heap otherwise. |is_once| selects the invoke function
+// which moves the bound arguments out.
+template <bool is_once,
+          typename CallbackType,
+          typename BindStateType,
+          typename... Args>
+CallbackType CreateCallback(Args&&... args) {
+  return CreateCallbackImpl<CallbackType>(
+      static_cast<BindStateType*>(nullptr),
+      std::integral_constant<bool, is_once>(),
+      IsInlineBindState<BindStateType>(), std::forward<Args>(args)...);
+}
+
 }  // namespace internal
 
 // An injection point to control |this| pointer behavior on a method invocation.
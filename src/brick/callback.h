@@ -43,6 +43,11 @@
 // will be a no-op. Note that |is_cancelled()| and |is_null()| are distinct:
 // simply cancelling a callback will not also make it null.
 //
+// Callbacks store small bound states, such as a function pointer with one or
+// two integers or raw pointers bound to it, inside themselves rather than on
+// the heap. Only trivially copyable bound states qualify, so anything that
+// holds a reference, like a WeakPtr or a scoped_refptr, is still allocated.
+//
 // base::Callback is currently a type alias for base::RepeatingCallback. In the
 // future, we expect to flip this to default to base::OnceCallback.
 //
@@ -62,6 +67,15 @@ class OnceCallback<R(Args...)> : public internal::CallbackBase {
   explicit OnceCallback(internal::BindStateBase* bind_state)
       : internal::CallbackBase(bind_state) {}
 
+  template <typename InlineBindStateType, typename... BindArgs>
+  OnceCallback(internal::InlineBindStateTag<InlineBindStateType> tag,
+               InvokeFuncStorage invoke_func,
+               BindArgs&&... args)
+      : internal::CallbackBase(tag,
+                               invoke_func,
+                               0,
+                               std::forward<BindArgs>(args)...) {}
+
   OnceCallback(const OnceCallback&) = delete;
   OnceCallback& operator=(const OnceCallback&) = delete;
 
@@ -93,7 +107,7 @@ class OnceCallback<R(Args...)> : public internal::CallbackBase {
     OnceCallback cb = std::move(*this);
     PolymorphicInvoke f =
         reinterpret_cast<PolymorphicInvoke>(cb.polymorphic_invoke());
-    return f(cb.bind_state_.get(), std::forward<Args>(args)...);
+    return f(cb.bind_state_for_invoke(), std::forward<Args>(args)...);
   }
 };
 
@@ -109,6 +123,14 @@ class RepeatingCallback<R(Args...)> : public internal::CallbackBaseCopyable {
   explicit RepeatingCallback(internal::BindStateBase* bind_state)
       : internal::CallbackBaseCopyable(bind_state) {}
 
+  template <typename InlineBindStateType, typename... BindArgs>
+  RepeatingCallback(internal::InlineBindStateTag<InlineBindStateType> tag,
+                    InvokeFuncStorage invoke_func,
+                    BindArgs&&... args)
+      : internal::CallbackBaseCopyable(tag,
+                                       invoke_func,
+                                       std::forward<BindArgs>(args)...) {}
+
   // Copyable and movable.
   RepeatingCallback(const RepeatingCallback&) = default;
   RepeatingCallback& operator=(const RepeatingCallback&) = default;
@@ -122,7 +144,7 @@ class RepeatingCallback<R(Args...)> : public internal::CallbackBaseCopyable {
   R Run(Args... args) const & {
     PolymorphicInvoke f =
         reinterpret_cast<PolymorphicInvoke>(this->polymorphic_invoke());
-    return f(this->bind_state_.get(), std::forward<Args>(args)...);
+    return f(this->bind_state_for_invoke(), std::forward<Args>(args)...);
   }
 
   R Run(Args... args) && {
@@ -133,7 +155,7 @@ class RepeatingCallback<R(Args...)> : public internal::CallbackBaseCopyable {
     RepeatingCallback cb = std::move(*this);
     PolymorphicInvoke f =
         reinterpret_cast<PolymorphicInvoke>(cb.polymorphic_invoke());
-    return f(cb.bind_state_.get(), std::forward<Args>(args)...);
+    return f(cb.bind_state_for_invoke(), std::forward<Args>(args)...);
   }
 };
 
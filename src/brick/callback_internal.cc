@@ -4,7 +4,16 @@
 
 #include "brick/callback_internal.h"
 
+#include <string.h>
+
+#include <atomic>
+#include <new>
+
+#include "brick/compiler_specific.h"
 #include "brick/logging.h"
+#include "brick/no_destructor.h"
+#include "brick/synchronization/lock.h"
+#include "brick/threading/thread_local_storage.h"
 
 namespace base {
 namespace internal {
@@ -17,6 +26,286 @@ bool ReturnFalse(const BindStateBase*) {
 
 }  // namespace
 
+constexpr size_t BindStateAllocator::kSizeClassGranularity;
+constexpr size_t BindStateAllocator::kMaxCachedSize;
+constexpr size_t BindStateAllocator::kBatchSize;
+constexpr size_t BindStateAllocator::kMaxDepotBatches;
+
+#if defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+
+// static
+void* BindStateAllocator::Allocate(size_t size) {
+  return ::operator new(size);
+}
+
+// static
+void BindStateAllocator::Free(void* block, size_t size) {
+  ::operator delete(block);
+}
+
+// static
+size_t BindStateAllocator::GetCachedBlockCountForTesting() {
+  return 0;
+}
+
+// static
+void BindStateAllocator::PurgeForTesting() {}
+
+#else  // defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+
+namespace {
+
+constexpr size_t kNumSizeClasses =
+    BindStateAllocator::kMaxCachedSize /
+    BindStateAllocator::kSizeClassGranularity;
+
+struct FreeBlock {
+  FreeBlock* next;
+  // Links the batches of the depot, set on the first block of each batch.
+  FreeBlock* next_batch;
+};
+
+static_assert(sizeof(FreeBlock) <= BindStateAllocator::kSizeClassGranularity,
+              "a free block must fit in the smallest size class");
+
+}  // namespace
+
+struct ThreadBlockCache {
+  FreeBlock* free_lists[kNumSizeClasses] = {};
+  size_t counts[kNumSizeClasses] = {};
+};
+
+namespace {
+
+// Full batches of free blocks given up by threads, plus the blocks left over
+// by exiting threads, which are gathered into a partial batch.
+class Depot {
+ public:
+  Depot() = default;
+
+  // Takes a full batch of blocks of size class |index|, or the partial batch
+  // if there is none. Returns the number of blocks taken.
+  size_t TakeBatch(size_t index, FreeBlock** batch) {
+    AutoLock auto_lock(lock_);
+    if (FreeBlock* full_batch = batches_[index]) {
+      batches_[index] = full_batch->next_batch;
+      --batch_counts_[index];
+      *batch = full_batch;
+      return BindStateAllocator::kBatchSize;
+    }
+    *batch = partial_batches_[index];
+    const size_t count = partial_counts_[index];
+    partial_batches_[index] = nullptr;
+    partial_counts_[index] = 0;
+    return count;
+  }
+
+  // Returns false if the depot is full, in which case |batch| isn't taken.
+  bool AddBatch(size_t index, FreeBlock* batch) {
+    AutoLock auto_lock(lock_);
+    if (batch_counts_[index] >= BindStateAllocator::kMaxDepotBatches)
+      return false;
+    batch->next_batch = batches_[index];
+    batches_[index] = batch;
+    ++batch_counts_[index];
+    return true;
+  }
+
+  // Returns false if the depot is full, in which case |block| isn't taken.
+  bool AddBlock(size_t index, FreeBlock* block) {
+    AutoLock auto_lock(lock_);
+    if (partial_counts_[index] == BindStateAllocator::kBatchSize) {
+      if (batch_counts_[index] >= BindStateAllocator::kMaxDepotBatches)
+        return false;
+      partial_batches_[index]->next_batch = batches_[index];
+      batches_[index] = partial_batches_[index];
+      ++batch_counts_[index];
+      partial_batches_[index] = nullptr;
+      partial_counts_[index] = 0;
+    }
+    block->next = partial_batches_[index];
+    partial_batches_[index] = block;
+    ++partial_counts_[index];
+    return true;
+  }
+
+  void Purge() {
+    AutoLock auto_lock(lock_);
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+      while (FreeBlock* batch = batches_[i]) {
+        batches_[i] = batch->next_batch;
+        DeleteBlocks(batch);
+      }
+      DeleteBlocks(partial_batches_[i]);
+      partial_batches_[i] = nullptr;
+      batch_counts_[i] = 0;
+      partial_counts_[i] = 0;
+    }
+  }
+
+  static void DeleteBlocks(FreeBlock* block) {
+    while (block) {
+      FreeBlock* next = block->next;
+      ::operator delete(block);
+      block = next;
+    }
+  }
+
+ private:
+  Lock lock_;
+  FreeBlock* batches_[kNumSizeClasses] = {};
+  size_t batch_counts_[kNumSizeClasses] = {};
+  FreeBlock* partial_batches_[kNumSizeClasses] = {};
+  size_t partial_counts_[kNumSizeClasses] = {};
+
+  DISALLOW_COPY_AND_ASSIGN(Depot);
+};
+
+Depot& GetDepot() {
+  static NoDestructor<Depot> depot;
+  return *depot;
+}
+
+size_t SizeClassIndex(size_t size) {
+  DCHECK_LE(size, BindStateAllocator::kMaxCachedSize);
+  if (!size)
+    return 0;
+  return (size - 1) / BindStateAllocator::kSizeClassGranularity;
+}
+
+size_t SizeClassBytes(size_t index) {
+  return (index + 1) * BindStateAllocator::kSizeClassGranularity;
+}
+
+// Moves kBatchSize blocks of size class |index| from |cache| to the depot, or
+// to the heap if the depot is full.
+void FlushBatch(ThreadBlockCache* cache, size_t index) {
+  DCHECK_GE(cache->counts[index], BindStateAllocator::kBatchSize);
+  FreeBlock* batch = cache->free_lists[index];
+  FreeBlock* last = batch;
+  for (size_t i = 1; i < BindStateAllocator::kBatchSize; ++i)
+    last = last->next;
+  cache->free_lists[index] = last->next;
+  cache->counts[index] -= BindStateAllocator::kBatchSize;
+  last->next = nullptr;
+  if (!GetDepot().AddBatch(index, batch))
+    Depot::DeleteBlocks(batch);
+}
+
+// Moves all the blocks of |cache| to the depot, or to the heap if the depot
+// is full. The blocks left over from the full batches are gathered into the
+// partial batches of the depot.
+void FlushCache(ThreadBlockCache* cache) {
+  for (size_t i = 0; i < kNumSizeClasses; ++i) {
+    while (cache->counts[i] >= BindStateAllocator::kBatchSize)
+      FlushBatch(cache, i);
+    while (FreeBlock* block = cache->free_lists[i]) {
+      cache->free_lists[i] = block->next;
+      if (!GetDepot().AddBlock(i, block))
+        ::operator delete(block);
+    }
+    cache->counts[i] = 0;
+  }
+}
+
+void DestructThreadBlockCache(void* cache) {
+  ThreadBlockCache* block_cache = static_cast<ThreadBlockCache*>(cache);
+  FlushCache(block_cache);
+  delete block_cache;
+}
+
+ThreadLocalStorage::Slot& ThreadBlockCacheTLS() {
+  static NoDestructor<ThreadLocalStorage::Slot> tls_block_cache(
+      &DestructThreadBlockCache);
+  return *tls_block_cache;
+}
+
+}  // namespace
+
+// static
+ThreadBlockCache* BindStateAllocator::GetThreadBlockCache(bool create) {
+  // The blocks allocated or freed once the TLS of the thread is gone go to
+  // the heap.
+  if (UNLIKELY(ThreadLocalStorage::HasBeenDestroyed()))
+    return nullptr;
+  ThreadBlockCache* cache =
+      static_cast<ThreadBlockCache*>(ThreadBlockCacheTLS().Get());
+  if (!cache && create) {
+    cache = new ThreadBlockCache;
+    ThreadBlockCacheTLS().Set(cache);
+  }
+  return cache;
+}
+
+// static
+void* BindStateAllocator::Allocate(size_t size) {
+  if (size > kMaxCachedSize)
+    return ::operator new(size);
+
+  const size_t index = SizeClassIndex(size);
+  ThreadBlockCache* cache = GetThreadBlockCache(true);
+  if (!cache)
+    return ::operator new(SizeClassBytes(index));
+
+  if (!cache->free_lists[index]) {
+    cache->counts[index] =
+        GetDepot().TakeBatch(index, &cache->free_lists[index]);
+  }
+  if (FreeBlock* block = cache->free_lists[index]) {
+    cache->free_lists[index] = block->next;
+    --cache->counts[index];
+    return block;
+  }
+  return ::operator new(SizeClassBytes(index));
+}
+
+// static
+void BindStateAllocator::Free(void* block, size_t size) {
+  if (!block)
+    return;
+  if (size > kMaxCachedSize) {
+    ::operator delete(block);
+    return;
+  }
+
+  // Threads which only free BindStates, like the workers which run the tasks
+  // posted by other threads, get a cache too, so that their blocks reach the
+  // depot a batch at a time rather than one lock acquisition per block.
+  ThreadBlockCache* cache = GetThreadBlockCache(true);
+  if (!cache) {
+    ::operator delete(block);
+    return;
+  }
+
+  const size_t index = SizeClassIndex(size);
+  FreeBlock* free_block = static_cast<FreeBlock*>(block);
+  free_block->next = cache->free_lists[index];
+  cache->free_lists[index] = free_block;
+  if (++cache->counts[index] == 2 * kBatchSize)
+    FlushBatch(cache, index);
+}
+
+// static
+size_t BindStateAllocator::GetCachedBlockCountForTesting() {
+  ThreadBlockCache* cache = GetThreadBlockCache(false);
+  if (!cache)
+    return 0;
+  size_t count = 0;
+  for (size_t i = 0; i < kNumSizeClasses; ++i)
+    count += cache->counts[i];
+  return count;
+}
+
+// static
+void BindStateAllocator::PurgeForTesting() {
+  ThreadBlockCache* cache = GetThreadBlockCache(false);
+  if (cache)
+    FlushCache(cache);
+  GetDepot().Purge();
+}
+
+#endif  // defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+
 void BindStateBaseRefCountTraits::Destruct(const BindStateBase* bind_state) {
   bind_state->destructor_(bind_state);
 }
@@ -33,57 +322,123 @@ BindStateBase::BindStateBase(InvokeFuncStorage polymorphic_invoke,
       destructor_(destructor),
       is_cancelled_(is_cancelled) {}
 
-CallbackBase::CallbackBase(CallbackBase&& c) noexcept = default;
-CallbackBase& CallbackBase::operator=(CallbackBase&& c) noexcept = default;
-CallbackBase::CallbackBase(const CallbackBaseCopyable& c)
-    : bind_state_(c.bind_state_) {}
+CallbackBase::CallbackBase(CallbackBase&& c) noexcept {
+  MoveBindStateFrom(&c);
+}
+
+CallbackBase& CallbackBase::operator=(CallbackBase&& c) noexcept {
+  if (this != &c) {
+    // Like scoped_refptr, release the previous BindState last, since it may
+    // be holding the last ref to whatever object owns |c|.
+    CallbackBase previous(std::move(*this));
+    MoveBindStateFrom(&c);
+  }
+  return *this;
+}
+
+CallbackBase::CallbackBase(const CallbackBaseCopyable& c) {
+  CopyBindStateFrom(c);
+}
 
 CallbackBase& CallbackBase::operator=(const CallbackBaseCopyable& c) {
-  bind_state_ = c.bind_state_;
+  if (this != &c) {
+    CallbackBase previous(std::move(*this));
+    CopyBindStateFrom(c);
+  }
   return *this;
 }
 
-CallbackBase::CallbackBase(CallbackBaseCopyable&& c) noexcept
-    : bind_state_(std::move(c.bind_state_)) {}
+CallbackBase::CallbackBase(CallbackBaseCopyable&& c) noexcept {
+  MoveBindStateFrom(&c);
+}
 
 CallbackBase& CallbackBase::operator=(CallbackBaseCopyable&& c) noexcept {
-  bind_state_ = std::move(c.bind_state_);
-  return *this;
+  return *this = static_cast<CallbackBase&&>(c);
 }
 
 void CallbackBase::Reset() {
-  // NULL the bind_state_ last, since it may be holding the last ref to whatever
-  // object owns us, and we may be deleted after that.
-  bind_state_ = nullptr;
+  // NULL the bind_state_ before destroying it, since it may be holding the
+  // last ref to whatever object owns us, and we may be deleted after that.
+  CallbackBase previous(std::move(*this));
 }
 
 bool CallbackBase::IsCancelled() const {
-  DCHECK(bind_state_);
+  DCHECK(!is_null());
+  // InlineBindStates hold nothing that can be cancelled.
+  if (inline_invoke_)
+    return false;
   return bind_state_->IsCancelled();
 }
 
 bool CallbackBase::EqualsInternal(const CallbackBase& other) const {
+  // Callbacks are equal only if one was copied from the other; being bound to
+  // the same functor and arguments isn't enough. The InlineBindStates of
+  // move-only callbacks have no identity, since they have no copies.
+  if (inline_invoke_ || other.inline_invoke_) {
+    return inline_invoke_ == other.inline_invoke_ &&
+           inline_id_ == other.inline_id_ && (inline_id_ || this == &other);
+  }
   return bind_state_ == other.bind_state_;
 }
 
 CallbackBase::CallbackBase(BindStateBase* bind_state)
     : bind_state_(bind_state ? AdoptRef(bind_state) : nullptr) {
-  DCHECK(!bind_state_.get() || bind_state_->HasOneRef());
+  DCHECK(!bind_state_ || bind_state_->HasOneRef());
 }
 
-CallbackBase::~CallbackBase() = default;
+CallbackBase::~CallbackBase() {
+  // InlineBindStates are trivially destructible.
+  if (!inline_invoke_)
+    bind_state_.~HeapBindStateRef();
+}
 
-CallbackBaseCopyable::CallbackBaseCopyable(const CallbackBaseCopyable& c)
-    : CallbackBase(nullptr) {
-  bind_state_ = c.bind_state_;
+// static
+uint64_t CallbackBase::NextInlineBindStateId() {
+  // 0 is the identity of the InlineBindStates of move-only callbacks, which
+  // only Equals() themselves.
+  static std::atomic<uint64_t> next_id{1};
+  const uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+  DCHECK_NE(0u, id);
+  return id;
+}
+
+void CallbackBase::MoveBindStateFrom(CallbackBase* other) {
+  DCHECK(is_null());
+  if (!other->inline_invoke_) {
+    bind_state_ = std::move(other->bind_state_);
+    return;
+  }
+  // InlineBindStates are trivially copyable, so copying their bytes moves
+  // them. |other| is left null.
+  bind_state_.~HeapBindStateRef();
+  inline_invoke_ = other->inline_invoke_;
+  inline_id_ = other->inline_id_;
+  memcpy(inline_state_, other->inline_state_, sizeof(inline_state_));
+  other->inline_invoke_ = nullptr;
+  new (&other->bind_state_) HeapBindStateRef();
 }
 
+void CallbackBase::CopyBindStateFrom(const CallbackBase& other) {
+  DCHECK(is_null());
+  if (!other.inline_invoke_) {
+    bind_state_ = other.bind_state_;
+    return;
+  }
+  bind_state_.~HeapBindStateRef();
+  inline_invoke_ = other.inline_invoke_;
+  inline_id_ = other.inline_id_;
+  memcpy(inline_state_, other.inline_state_, sizeof(inline_state_));
+}
+
+CallbackBaseCopyable::CallbackBaseCopyable(const CallbackBaseCopyable& c)
+    : CallbackBase(c) {}
+
 CallbackBaseCopyable::CallbackBaseCopyable(CallbackBaseCopyable&& c) noexcept =
     default;
 
 CallbackBaseCopyable& CallbackBaseCopyable::operator=(
     const CallbackBaseCopyable& c) {
-  bind_state_ = c.bind_state_;
+  CallbackBase::operator=(c);
   return *this;
 }
 
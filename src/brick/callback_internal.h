@@ -8,10 +8,17 @@
 #ifndef BRICK_CALLBACK_INTERNAL_H_
 #define BRICK_CALLBACK_INTERNAL_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+#include <utility>
+
 #include "brick/base_export.h"
 #include "brick/callback_forward.h"
 #include "brick/macros.h"
 #include "brick/memory/ref_counted.h"
+#include "brick/template_util.h"
 
 namespace base {
 
@@ -47,6 +54,51 @@ struct PassingTraits<T, true> {
 template <typename T>
 using PassingTraitsType = typename PassingTraits<T>::Type;
 
+struct ThreadBlockCache;
+
+// Allocates the BindStates of all Callbacks. Sizes are rounded up to size
+// classes of kSizeClassGranularity bytes, up to kMaxCachedSize, and the blocks
+// of each size class are recycled through bounded per-thread free lists, so
+// that creating and destroying callbacks doesn't go through malloc and free.
+// Callbacks are often created on one thread and destroyed on another, like
+// posted tasks, so a thread whose free list is full moves a batch of blocks
+// to a process-wide depot, from which threads with an empty free list take a
+// batch back. Larger BindStates go straight to the general heap, as do the
+// blocks which neither the thread nor the depot have room for.
+//
+// Builds with MEMORY_TOOL_REPLACES_ALLOCATOR use the general heap for all
+// BindStates, so that the memory tools see every allocation.
+class BRICK_EXPORT BindStateAllocator {
+ public:
+  static constexpr size_t kSizeClassGranularity = 16;
+  static constexpr size_t kMaxCachedSize = 256;
+
+  // Number of blocks moved between the free lists of a thread and the depot
+  // at once. A thread keeps up to twice as many free blocks per size class.
+  static constexpr size_t kBatchSize = 32;
+
+  // Maximum number of batches of each size class in the depot.
+  static constexpr size_t kMaxDepotBatches = 8;
+
+  static void* Allocate(size_t size);
+
+  // |size| must be the value that was passed to Allocate().
+  static void Free(void* block, size_t size);
+
+  // Returns the number of free blocks cached by the calling thread.
+  static size_t GetCachedBlockCountForTesting();
+
+  // Releases the free blocks cached by the calling thread and by the depot.
+  static void PurgeForTesting();
+
+ private:
+  // Returns the block cache of the calling thread, or null if it has none and
+  // |create| is false, or if the TLS of the thread was torn down.
+  static ThreadBlockCache* GetThreadBlockCache(bool create);
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(BindStateAllocator);
+};
+
 // BindStateBase is used to provide an opaque handle that the Callback
 // class can use to represent a function object with bound arguments.  It
 // behaves as an existential type that is used by a corresponding
@@ -65,6 +117,15 @@ class BRICK_EXPORT BindStateBase
 
   using InvokeFuncStorage = void(*)();
 
+  // BindStates, which are deleted through their own type, come from
+  // BindStateAllocator.
+  static void* operator new(size_t size) {
+    return BindStateAllocator::Allocate(size);
+  }
+  static void operator delete(void* bind_state, size_t size) {
+    BindStateAllocator::Free(bind_state, size);
+  }
+
  private:
   BindStateBase(InvokeFuncStorage polymorphic_invoke,
                 void (*destructor)(const BindStateBase*));
@@ -102,6 +163,17 @@ class BRICK_EXPORT BindStateBase
   DISALLOW_COPY_AND_ASSIGN(BindStateBase);
 };
 
+// Maximum size of the functor and bound arguments that a Callback stores
+// inside itself rather than in a BindState on the heap. It fits a method with
+// an Unretained() receiver, or a function with two pointers bound to it. Only
+// trivially copyable InlineBindStates are stored inline; see IsInlineBindState.
+constexpr size_t kInlineBindStateSize = 3 * sizeof(void*);
+
+// Selects the constructor of Callbacks that stores a new |InlineBindStateType|
+// inline.
+template <typename InlineBindStateType>
+struct InlineBindStateTag {};
+
 // Holds the Callback methods that don't require specialization to reduce
 // template bloat.
 // CallbackBase<MoveOnly> is a direct base class of MoveOnly callbacks, and
@@ -118,7 +190,7 @@ class BRICK_EXPORT CallbackBase {
   CallbackBase& operator=(CallbackBaseCopyable&& c) noexcept;
 
   // Returns true if Callback is null (doesn't refer to anything).
-  bool is_null() const { return !bind_state_; }
+  bool is_null() const { return !inline_invoke_ && !bind_state_; }
   explicit operator bool() const { return !is_null(); }
 
   // Returns true if the callback invocation will be nop due to an cancellation.
@@ -136,20 +208,73 @@ class BRICK_EXPORT CallbackBase {
 
   constexpr inline CallbackBase();
 
-  // Allow initializing of |bind_state_| via the constructor to avoid default
-  // initialization of the scoped_refptr.
+  // Takes ownership of |bind_state|, which has been allocated on the heap.
   explicit CallbackBase(BindStateBase* bind_state);
 
+  // Constructs an InlineBindStateType from |args| inside the callback, which
+  // |invoke_func| runs. InlineBindStateType is trivially copyable, so that it
+  // is copied and moved along with the callback and isn't destroyed.
+  // |inline_id| is shared by the copies of the callback, which Equals() one
+  // another; move-only callbacks have no copies and pass 0.
+  template <typename InlineBindStateType, typename... Args>
+  CallbackBase(InlineBindStateTag<InlineBindStateType>,
+               InvokeFuncStorage invoke_func,
+               uint64_t inline_id,
+               Args&&... args)
+      : inline_invoke_(invoke_func), inline_id_(inline_id) {
+    static_assert(sizeof(InlineBindStateType) <= kInlineBindStateSize,
+                  "InlineBindStateType is too large to be stored inline");
+    static_assert(alignof(InlineBindStateType) <= alignof(void*),
+                  "InlineBindStateType is too aligned to be stored inline");
+    static_assert(is_trivially_copyable<InlineBindStateType>::value,
+                  "InlineBindStateType must be relocatable with memcpy()");
+    ::new (inline_state_) InlineBindStateType(std::forward<Args>(args)...);
+  }
+
   InvokeFuncStorage polymorphic_invoke() const {
-    return bind_state_->polymorphic_invoke_;
+    return inline_invoke_ ? inline_invoke_ : bind_state_->polymorphic_invoke_;
+  }
+
+  // Returns what polymorphic_invoke() expects: the BindState on the heap, or
+  // the InlineBindState inside the callback, which the invoke function casts
+  // back to its own type.
+  BindStateBase* bind_state_for_invoke() const {
+    return inline_invoke_ ? reinterpret_cast<BindStateBase*>(
+                                const_cast<char*>(inline_state_))
+                          : bind_state_.get();
   }
 
+  // Returns a new identity for an InlineBindState, which its copies share so
+  // that Equals() tells them apart from other callbacks bound to the same
+  // functor and arguments.
+  static uint64_t NextInlineBindStateId();
+
   // Force the destructor to be instantiated inside this translation unit so
   // that our subclasses will not get inlined versions.  Avoids more template
   // bloat.
   ~CallbackBase();
 
-  scoped_refptr<BindStateBase> bind_state_;
+ private:
+  using HeapBindStateRef = scoped_refptr<BindStateBase>;
+
+  // These expect the callback to be null.
+  void MoveBindStateFrom(CallbackBase* other);
+  void CopyBindStateFrom(const CallbackBase& other);
+
+  // The function which runs the InlineBindState in |inline_state_|, or null if
+  // the BindState, if any, is on the heap.
+  InvokeFuncStorage inline_invoke_ = nullptr;
+
+  // |bind_state_| is the active member unless |inline_invoke_| is set.
+  union {
+    // The BindState on the heap, if any.
+    HeapBindStateRef bind_state_ = nullptr;
+
+    // The identity of the InlineBindState.
+    uint64_t inline_id_;
+  };
+
+  alignas(void*) char inline_state_[kInlineBindStateSize] = {};
 };
 
 constexpr CallbackBase::CallbackBase() = default;
@@ -166,6 +291,14 @@ class BRICK_EXPORT CallbackBaseCopyable : public CallbackBase {
   constexpr CallbackBaseCopyable() = default;
   explicit CallbackBaseCopyable(BindStateBase* bind_state)
       : CallbackBase(bind_state) {}
+  template <typename InlineBindStateType, typename... Args>
+  CallbackBaseCopyable(InlineBindStateTag<InlineBindStateType> tag,
+                       InvokeFuncStorage invoke_func,
+                       Args&&... args)
+      : CallbackBase(tag,
+                     invoke_func,
+                     NextInlineBindStateId(),
+                     std::forward<Args>(args)...) {}
   ~CallbackBaseCopyable() = default;
 };
 
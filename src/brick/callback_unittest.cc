@@ -4,12 +4,17 @@
 
 #include "brick/callback.h"
 
+#include <algorithm>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "brick/bind.h"
 #include "brick/callback_helpers.h"
 #include "brick/callback_internal.h"
+#include "brick/macros.h"
 #include "brick/memory/ref_counted.h"
+#include "brick/threading/simple_thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
@@ -183,5 +188,216 @@ TEST_F(CallbackTest, CallbackHasLastRefOnContainingObject) {
   ASSERT_TRUE(deleted);
 }
 
+int Add(int a, int b) {
+  return a + b;
+}
+
+class RefCountedInt : public RefCountedThreadSafe<RefCountedInt> {
+ public:
+  explicit RefCountedInt(int value) : value_(value) {}
+  int value() const { return value_; }
+
+ private:
+  friend class RefCountedThreadSafe<RefCountedInt>;
+  ~RefCountedInt() = default;
+
+  const int value_;
+};
+
+int AddRefCounted(scoped_refptr<RefCountedInt> a, int b) {
+  return a->value() + b;
+}
+
+struct Adder {
+  int Add(int b) const { return a + b; }
+
+  int a;
+};
+
+// Exposes the identities given to the inline BindStates of RepeatingCallbacks.
+class InlineBindStateIds : public internal::CallbackBase {
+ public:
+  static uint64_t Next() { return NextInlineBindStateId(); }
+};
+
+TEST_F(CallbackTest, SmallBindStatesAreInline) {
+  using internal::BindStateAllocator;
+  BindStateAllocator::PurgeForTesting();
+
+  // A BindState on the heap goes to the cache of the thread once freed.
+  EXPECT_EQ(3, BindOnce(&AddRefCounted, MakeRefCounted<RefCountedInt>(1))
+                   .Run(2));
+#if !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+  EXPECT_EQ(1u, BindStateAllocator::GetCachedBlockCountForTesting());
+#endif
+  BindStateAllocator::PurgeForTesting();
+
+  EXPECT_EQ(3, BindOnce(&Add, 1).Run(2));
+  Adder adder = {1};
+  EXPECT_EQ(3, BindOnce(&Adder::Add, Unretained(&adder)).Run(2));
+  EXPECT_EQ(0u, BindStateAllocator::GetCachedBlockCountForTesting());
+}
+
+TEST_F(CallbackTest, InlineBindStateCopyAndMove) {
+  RepeatingCallback<int(int)> callback = BindRepeating(&Add, 1);
+  RepeatingCallback<int(int)> copy = callback;
+  EXPECT_TRUE(callback.Equals(copy));
+  EXPECT_FALSE(callback.Equals(BindRepeating(&Add, 2)));
+  EXPECT_FALSE(copy.IsCancelled());
+  EXPECT_EQ(3, copy.Run(2));
+
+  OnceCallback<int(int)> once_callback = std::move(copy);
+  EXPECT_TRUE(copy.is_null());
+  OnceCallback<int(int)> moved_once_callback = std::move(once_callback);
+  EXPECT_TRUE(once_callback.is_null());
+  EXPECT_EQ(4, std::move(moved_once_callback).Run(3));
+  EXPECT_TRUE(moved_once_callback.is_null());
+
+  // Reassigning a heap BindState over an inline one and back.
+  callback = BindRepeating(&AddRefCounted, MakeRefCounted<RefCountedInt>(5));
+  EXPECT_EQ(7, callback.Run(2));
+  callback = BindRepeating(&Add, 6);
+  EXPECT_EQ(8, callback.Run(2));
+  callback.Reset();
+  EXPECT_TRUE(callback.is_null());
+}
+
+// 0 is the identity of the inline BindStates of OnceCallbacks, which are equal
+// only to themselves. Even the first RepeatingCallback bound in the process
+// must be equal to its copies.
+TEST_F(CallbackTest, InlineBindStateIdsAreNotZero) {
+  EXPECT_NE(0u, InlineBindStateIds::Next());
+  RepeatingCallback<int(int)> callback = BindRepeating(&Add, 1);
+  RepeatingCallback<int(int)> copy = callback;
+  EXPECT_TRUE(callback.Equals(copy));
+}
+
+// Callbacks are equal to their copies only, and not to the callbacks bound
+// separately to the same functor and arguments, be it inline or on the heap.
+TEST_F(CallbackTest, EqualsSeparatelyBoundCallbacks) {
+  RepeatingCallback<int(int)> inline_callback = BindRepeating(&Add, 1);
+  RepeatingCallback<int(int)> inline_copy = inline_callback;
+  EXPECT_TRUE(inline_callback.Equals(inline_copy));
+  RepeatingCallback<int(int)> moved_inline_copy = std::move(inline_copy);
+  EXPECT_TRUE(inline_callback.Equals(moved_inline_copy));
+  EXPECT_FALSE(inline_callback.Equals(BindRepeating(&Add, 1)));
+
+  scoped_refptr<RefCountedInt> value = MakeRefCounted<RefCountedInt>(1);
+  RepeatingCallback<int(int)> heap_callback =
+      BindRepeating(&AddRefCounted, value);
+  RepeatingCallback<int(int)> heap_copy = heap_callback;
+  EXPECT_TRUE(heap_callback.Equals(heap_copy));
+  EXPECT_FALSE(heap_callback.Equals(BindRepeating(&AddRefCounted, value)));
+
+  EXPECT_FALSE(inline_callback.Equals(heap_callback));
+  EXPECT_FALSE(heap_callback.Equals(inline_callback));
+  EXPECT_FALSE(inline_callback.Equals(RepeatingCallback<int(int)>()));
+  EXPECT_FALSE(RepeatingCallback<int(int)>().Equals(inline_callback));
+
+  // OnceCallbacks can't be copied, so they are equal only to themselves.
+  OnceCallback<int(int)> inline_once = BindOnce(&Add, 1);
+  EXPECT_TRUE(inline_once.Equals(inline_once));
+  OnceCallback<int(int)> other_inline_once = BindOnce(&Add, 1);
+  EXPECT_FALSE(inline_once.Equals(other_inline_once));
+  OnceCallback<int(int)> moved_inline_once = std::move(inline_once);
+  EXPECT_TRUE(moved_inline_once.Equals(moved_inline_once));
+  EXPECT_FALSE(moved_inline_once.Equals(other_inline_once));
+}
+
+#if !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+// Frees blocks of BindStateAllocator on a thread which never allocated one.
+class BlockFreeingDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  BlockFreeingDelegate(const std::vector<void*>& blocks, size_t size)
+      : blocks_(blocks), size_(size) {}
+
+  void Run() override {
+    for (void* block : blocks_)
+      internal::BindStateAllocator::Free(block, size_);
+    cached_block_count_ =
+        internal::BindStateAllocator::GetCachedBlockCountForTesting();
+  }
+
+  size_t cached_block_count() const { return cached_block_count_; }
+
+ private:
+  const std::vector<void*> blocks_;
+  const size_t size_;
+  size_t cached_block_count_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockFreeingDelegate);
+};
+
+TEST(BindStateAllocatorTest, ReusesFreedBlocks) {
+  using internal::BindStateAllocator;
+  BindStateAllocator::PurgeForTesting();
+
+  // 40 and 48 bytes are in the same size class.
+  void* block = BindStateAllocator::Allocate(40);
+  BindStateAllocator::Free(block, 40);
+  EXPECT_EQ(1u, BindStateAllocator::GetCachedBlockCountForTesting());
+  void* reused_block = BindStateAllocator::Allocate(48);
+  EXPECT_EQ(block, reused_block);
+  EXPECT_EQ(0u, BindStateAllocator::GetCachedBlockCountForTesting());
+  BindStateAllocator::Free(reused_block, 48);
+
+  BindStateAllocator::PurgeForTesting();
+  EXPECT_EQ(0u, BindStateAllocator::GetCachedBlockCountForTesting());
+}
+
+TEST(BindStateAllocatorTest, BoundsThreadCache) {
+  using internal::BindStateAllocator;
+  BindStateAllocator::PurgeForTesting();
+
+  std::vector<void*> blocks;
+  for (size_t i = 0; i < 2 * BindStateAllocator::kBatchSize; ++i)
+    blocks.push_back(BindStateAllocator::Allocate(16));
+  for (void* block : blocks)
+    BindStateAllocator::Free(block, 16);
+  // A batch went to the depot when the free list filled up.
+  EXPECT_EQ(BindStateAllocator::kBatchSize,
+            BindStateAllocator::GetCachedBlockCountForTesting());
+
+  BindStateAllocator::PurgeForTesting();
+}
+
+TEST(BindStateAllocatorTest, LargeBlocksBypassCache) {
+  using internal::BindStateAllocator;
+  BindStateAllocator::PurgeForTesting();
+
+  const size_t size = BindStateAllocator::kMaxCachedSize + 1;
+  BindStateAllocator::Free(BindStateAllocator::Allocate(size), size);
+  EXPECT_EQ(0u, BindStateAllocator::GetCachedBlockCountForTesting());
+}
+
+TEST(BindStateAllocatorTest, ReusesBlocksFreedOnOtherThread) {
+  using internal::BindStateAllocator;
+  BindStateAllocator::PurgeForTesting();
+
+  const size_t kNumBlocks = 4;
+  std::vector<void*> blocks;
+  for (size_t i = 0; i < kNumBlocks; ++i)
+    blocks.push_back(BindStateAllocator::Allocate(64));
+
+  BlockFreeingDelegate delegate(blocks, 64);
+  DelegateSimpleThread thread(&delegate, "BlockFreeingThread");
+  thread.Start();
+  thread.Join();
+  // The freeing thread cached the blocks, and handed them to the depot as it
+  // exited.
+  EXPECT_EQ(kNumBlocks, delegate.cached_block_count());
+  EXPECT_EQ(0u, BindStateAllocator::GetCachedBlockCountForTesting());
+
+  // The blocks come back from the depot in a batch.
+  void* block = BindStateAllocator::Allocate(64);
+  EXPECT_NE(blocks.end(), std::find(blocks.begin(), blocks.end(), block));
+  EXPECT_EQ(kNumBlocks - 1,
+            BindStateAllocator::GetCachedBlockCountForTesting());
+  BindStateAllocator::Free(block, 64);
+
+  BindStateAllocator::PurgeForTesting();
+}
+#endif  // !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+
 }  // namespace
 }  // namespace base
@@ -417,16 +417,21 @@ void FeatureList::GetFeatureOverridesImpl(std::string* enable_overrides,
 }
 
 bool FeatureList::CheckFeatureIdentity(const Feature& feature) {
-  AutoLock auto_lock(feature_identity_tracker_lock_);
-
-  auto it = feature_identity_tracker_.find(feature.name);
-  if (it == feature_identity_tracker_.end()) {
-    // If it's not tracked yet, register it.
-    feature_identity_tracker_[feature.name] = &feature;
-    return true;
+  {
+    AutoReadLock auto_lock(feature_identity_tracker_lock_);
+    auto it = feature_identity_tracker_.find(feature.name);
+    if (it != feature_identity_tracker_.end()) {
+      // Compare address of |feature| to the existing tracked entry.
+      return it->second == &feature;
+    }
   }
-  // Compare address of |feature| to the existing tracked entry.
-  return it->second == &feature;
+
+  // If it's not tracked yet, register it. Another thread may have done so
+  // since the lookup above, in which case this is a no-op.
+  AutoWriteLock auto_lock(feature_identity_tracker_lock_);
+  auto result =
+      feature_identity_tracker_.insert(std::make_pair(feature.name, &feature));
+  return result.first->second == &feature;
 }
 
 FeatureList::OverrideEntry::OverrideEntry(OverrideState overridden_state,
@@ -15,7 +15,8 @@
 #include "brick/macros.h"
 #include "brick/metrics/persistent_memory_allocator.h"
 #include "brick/strings/string_piece.h"
-#include "brick/synchronization/lock.h"
+#include "brick/synchronization/read_write_lock.h"
+#include "brick/thread_annotations.h"
 
 namespace base {
 
@@ -291,9 +292,11 @@ class BRICK_EXPORT FeatureList {
 
   // Locked map that keeps track of seen features, to ensure a single feature is
   // only defined once. This verification is only done in builds with DCHECKs
-  // enabled.
-  Lock feature_identity_tracker_lock_;
-  std::map<std::string, const Feature*> feature_identity_tracker_;
+  // enabled, on every IsEnabled() call; after the first lookup of each feature
+  // it only needs the lock in shared mode.
+  ReadWriteLock feature_identity_tracker_lock_;
+  std::map<std::string, const Feature*> feature_identity_tracker_
+      GUARDED_BY(feature_identity_tracker_lock_);
 
   // Whether this object has been fully initialized. This gets set to true as a
   // result of FinalizeInitialization().
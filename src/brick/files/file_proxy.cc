@@ -9,17 +9,34 @@
 #include "brick/bind.h"
 #include "brick/bind_helpers.h"
 #include "brick/files/file.h"
+#include "brick/files/files_buildflags.h"
 #include "brick/files/file_util.h"
 #include "brick/location.h"
 #include "brick/macros.h"
+#include "brick/memory/ptr_util.h"
 #include "brick/task_runner.h"
 #include "brick/task_runner_util.h"
 
+#if BUILDFLAG(USE_IO_URING)
+#include "brick/files/io_uring_file_engine_linux.h"
+#include "brick/threading/sequenced_task_runner_handle.h"
+#endif
+
 namespace {
 
 void FileDeleter(base::File file) {
 }
 
+#if BUILDFLAG(USE_IO_URING)
+// Returns the engine to use instead of the TaskRunner, if any. Completions are
+// posted back to the current sequence, so there has to be one.
+base::IOUringFileEngine* GetIOUringFileEngine() {
+  if (!base::SequencedTaskRunnerHandle::IsSet())
+    return nullptr;
+  return base::IOUringFileEngine::Get();
+}
+#endif
+
 }  // namespace
 
 namespace base {
@@ -33,6 +50,8 @@ class FileHelper {
         proxy_(AsWeakPtr(proxy)) {
    }
 
+   PlatformFile platform_file() const { return file_.GetPlatformFile(); }
+
    void PassFile() {
      if (proxy_)
        proxy_->SetFile(std::move(file_));
@@ -79,6 +98,12 @@ class GenericFileHelper : public FileHelper {
       error_ = File::FILE_OK;
   }
 
+  void OnFlushDone(FileProxy::StatusCallback callback, int result) {
+    if (result == 0)
+      error_ = File::FILE_OK;
+    Reply(std::move(callback));
+  }
+
   void Reply(FileProxy::StatusCallback callback) {
     PassFile();
     if (!callback.is_null())
@@ -186,6 +211,14 @@ class ReadHelper : public FileHelper {
     error_ = (bytes_read_ < 0) ? File::FILE_ERROR_FAILED : File::FILE_OK;
   }
 
+  char* buffer() { return buffer_.get(); }
+
+  void OnReadDone(FileProxy::ReadCallback callback, int result) {
+    bytes_read_ = result;
+    error_ = (bytes_read_ < 0) ? File::FILE_ERROR_FAILED : File::FILE_OK;
+    Reply(std::move(callback));
+  }
+
   void Reply(FileProxy::ReadCallback callback) {
     PassFile();
     DCHECK(!callback.is_null());
@@ -216,6 +249,14 @@ class WriteHelper : public FileHelper {
     error_ = (bytes_written_ < 0) ? File::FILE_ERROR_FAILED : File::FILE_OK;
   }
 
+  const char* buffer() const { return buffer_.get(); }
+
+  void OnWriteDone(FileProxy::WriteCallback callback, int result) {
+    bytes_written_ = result;
+    error_ = (bytes_written_ < 0) ? File::FILE_ERROR_FAILED : File::FILE_OK;
+    Reply(std::move(callback));
+  }
+
   void Reply(FileProxy::WriteCallback callback) {
     PassFile();
     if (!callback.is_null())
@@ -229,6 +270,87 @@ class WriteHelper : public FileHelper {
   DISALLOW_COPY_AND_ASSIGN(WriteHelper);
 };
 
+class ReadManyHelper : public FileHelper {
+ public:
+  ReadManyHelper(FileProxy* proxy,
+                 File file,
+                 std::vector<FileProxy::ReadRange> ranges)
+      : FileHelper(proxy, std::move(file)),
+        ranges_(std::move(ranges)),
+        data_(ranges_.size()) {
+    for (size_t i = 0; i < ranges_.size(); ++i)
+      data_[i].resize(ranges_[i].size);
+    error_ = File::FILE_OK;
+  }
+
+  void RunWork() {
+    for (size_t i = 0; i < ranges_.size(); ++i)
+      OnRangeRead(i, file_.Read(ranges_[i].offset, &data_[i][0],
+                                ranges_[i].size));
+  }
+
+  void Reply(FileProxy::ReadManyCallback callback) {
+    PassFile();
+    DCHECK(!callback.is_null());
+    std::move(callback).Run(error_, std::move(data_));
+  }
+
+#if BUILDFLAG(USE_IO_URING)
+  // Starts all the reads on |engine|, and replies once they have all
+  // completed. The completions share the ownership of |helper|, so it's
+  // deleted with the last of them even if some are never run.
+  static void Start(std::unique_ptr<ReadManyHelper> helper,
+                    IOUringFileEngine* engine,
+                    FileProxy::ReadManyCallback callback) {
+    ReadManyHelper* self = helper.get();
+    DCHECK(!self->ranges_.empty());
+    self->callback_ = std::move(callback);
+    self->pending_reads_ = self->ranges_.size();
+    auto shared_helper = MakeRefCounted<SharedHelper>(std::move(helper));
+    std::vector<IOUringFileEngine::ReadRequest> requests;
+    requests.reserve(self->ranges_.size());
+    for (size_t i = 0; i < self->ranges_.size(); ++i) {
+      requests.emplace_back(
+          self->file_.GetPlatformFile(), self->ranges_[i].offset,
+          &self->data_[i][0], self->ranges_[i].size,
+          BindOnce(&ReadManyHelper::OnEngineReadDone, shared_helper, i));
+    }
+    engine->ReadBatch(std::move(requests));
+  }
+#endif
+
+ private:
+  void OnRangeRead(size_t index, int result) {
+    if (result < 0) {
+      if (error_ == File::FILE_OK)
+        error_ = File::FILE_ERROR_FAILED;
+      result = 0;
+    }
+    data_[index].resize(result);
+  }
+
+#if BUILDFLAG(USE_IO_URING)
+  using SharedHelper = RefCountedData<std::unique_ptr<ReadManyHelper>>;
+
+  static void OnEngineReadDone(const scoped_refptr<SharedHelper>& helper,
+                               size_t index,
+                               int result) {
+    ReadManyHelper* self = helper->data.get();
+    self->OnRangeRead(index, result);
+    if (--self->pending_reads_)
+      return;
+    self->Reply(std::move(self->callback_));
+  }
+
+  size_t pending_reads_ = 0;
+  FileProxy::ReadManyCallback callback_;
+#endif
+
+  std::vector<FileProxy::ReadRange> ranges_;
+  std::vector<std::string> data_;
+  DISALLOW_COPY_AND_ASSIGN(ReadManyHelper);
+};
+
 }  // namespace
 
 FileProxy::FileProxy(TaskRunner* task_runner) : task_runner_(task_runner) {
@@ -306,11 +428,44 @@ bool FileProxy::Read(int64_t offset, int bytes_to_read, ReadCallback callback) {
     return false;
 
   ReadHelper* helper = new ReadHelper(this, std::move(file_), bytes_to_read);
+#if BUILDFLAG(USE_IO_URING)
+  if (IOUringFileEngine* engine = GetIOUringFileEngine()) {
+    engine->Read(helper->platform_file(), offset, helper->buffer(),
+                 bytes_to_read,
+                 BindOnce(&ReadHelper::OnReadDone, Owned(helper),
+                          std::move(callback)));
+    return true;
+  }
+#endif
   return task_runner_->PostTaskAndReply(
       FROM_HERE, BindOnce(&ReadHelper::RunWork, Unretained(helper), offset),
       BindOnce(&ReadHelper::Reply, Owned(helper), std::move(callback)));
 }
 
+bool FileProxy::ReadMany(std::vector<ReadRange> ranges,
+                         ReadManyCallback callback) {
+  DCHECK(file_.IsValid());
+  for (const ReadRange& range : ranges) {
+    if (range.size < 0)
+      return false;
+  }
+
+#if BUILDFLAG(USE_IO_URING)
+  IOUringFileEngine* engine = ranges.empty() ? nullptr : GetIOUringFileEngine();
+#endif
+  ReadManyHelper* helper =
+      new ReadManyHelper(this, std::move(file_), std::move(ranges));
+#if BUILDFLAG(USE_IO_URING)
+  if (engine) {
+    ReadManyHelper::Start(WrapUnique(helper), engine, std::move(callback));
+    return true;
+  }
+#endif
+  return task_runner_->PostTaskAndReply(
+      FROM_HERE, BindOnce(&ReadManyHelper::RunWork, Unretained(helper)),
+      BindOnce(&ReadManyHelper::Reply, Owned(helper), std::move(callback)));
+}
+
 bool FileProxy::Write(int64_t offset,
                       const char* buffer,
                       int bytes_to_write,
@@ -321,6 +476,15 @@ bool FileProxy::Write(int64_t offset,
 
   WriteHelper* helper =
       new WriteHelper(this, std::move(file_), buffer, bytes_to_write);
+#if BUILDFLAG(USE_IO_URING)
+  if (IOUringFileEngine* engine = GetIOUringFileEngine()) {
+    engine->Write(helper->platform_file(), offset, helper->buffer(),
+                  bytes_to_write,
+                  BindOnce(&WriteHelper::OnWriteDone, Owned(helper),
+                           std::move(callback)));
+    return true;
+  }
+#endif
   return task_runner_->PostTaskAndReply(
       FROM_HERE, BindOnce(&WriteHelper::RunWork, Unretained(helper), offset),
       BindOnce(&WriteHelper::Reply, Owned(helper), std::move(callback)));
@@ -350,6 +514,14 @@ bool FileProxy::SetLength(int64_t length, StatusCallback callback) {
 bool FileProxy::Flush(StatusCallback callback) {
   DCHECK(file_.IsValid());
   GenericFileHelper* helper = new GenericFileHelper(this, std::move(file_));
+#if BUILDFLAG(USE_IO_URING)
+  if (IOUringFileEngine* engine = GetIOUringFileEngine()) {
+    engine->Flush(helper->platform_file(),
+                  BindOnce(&GenericFileHelper::OnFlushDone, Owned(helper),
+                           std::move(callback)));
+    return true;
+  }
+#endif
   return task_runner_->PostTaskAndReply(
       FROM_HERE, BindOnce(&GenericFileHelper::Flush, Unretained(helper)),
       BindOnce(&GenericFileHelper::Reply, Owned(helper), std::move(callback)));
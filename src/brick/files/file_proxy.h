@@ -7,6 +7,9 @@
 
 #include <stdint.h>
 
+#include <string>
+#include <vector>
+
 #include "brick/base_export.h"
 #include "brick/callback_forward.h"
 #include "brick/files/file.h"
@@ -35,6 +38,11 @@ class Time;
 //   proxy.Write(...);
 //
 // means the second Write will always fail.
+//
+// When built with use_io_uring, Read, ReadMany, Write and Flush are handed to
+// the kernel through IOUringFileEngine instead, and only fall back to the
+// TaskRunner when io_uring isn't available. Their callbacks still run on the
+// calling sequence.
 class BRICK_EXPORT FileProxy : public SupportsWeakPtr<FileProxy> {
  public:
   // This callback is used by methods that report only an error code. It is
@@ -48,6 +56,16 @@ class BRICK_EXPORT FileProxy : public SupportsWeakPtr<FileProxy> {
   using ReadCallback =
       OnceCallback<void(File::Error, const char* data, int bytes_read)>;
   using WriteCallback = OnceCallback<void(File::Error, int bytes_written)>;
+  // |data| holds one string per range, in the order of the ranges, each
+  // shortened to the number of bytes actually read.
+  using ReadManyCallback =
+      OnceCallback<void(File::Error, std::vector<std::string> data)>;
+
+  // A range of ReadMany.
+  struct ReadRange {
+    int64_t offset;
+    int size;
+  };
 
   FileProxy();
   explicit FileProxy(TaskRunner* task_runner);
@@ -106,6 +124,13 @@ class BRICK_EXPORT FileProxy : public SupportsWeakPtr<FileProxy> {
   // if task posting to |task_runner| has failed.
   bool Read(int64_t offset, int bytes_to_read, ReadCallback callback);
 
+  // Reads all |ranges| as a single operation, which is cheaper than one Read
+  // per range. The callback can't be null, and is given the first error if any
+  // read failed.
+  // This returns false if the size of a range is less than zero, or if task
+  // posting to |task_runner| has failed.
+  bool ReadMany(std::vector<ReadRange> ranges, ReadManyCallback callback);
+
   // Proxies File::Write. The callback can be null.
   // This returns false if |bytes_to_write| is less than or equal to zero,
   // if |buffer| is NULL, or if task posting to |task_runner| has failed.
@@ -7,7 +7,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "brick/bind.h"
 #include "brick/files/file.h"
@@ -70,6 +72,12 @@ class FileProxyTest : public testing::Test {
     RunLoop::QuitCurrentWhenIdleDeprecated();
   }
 
+  void DidReadMany(File::Error error, std::vector<std::string> data) {
+    error_ = error;
+    read_many_data_ = std::move(data);
+    RunLoop::QuitCurrentWhenIdleDeprecated();
+  }
+
   void DidWrite(File::Error error,
                 int bytes_written) {
     error_ = error;
@@ -100,6 +108,7 @@ class FileProxyTest : public testing::Test {
   FilePath path_;
   File::Info file_info_;
   std::vector<char> buffer_;
+  std::vector<std::string> read_many_data_;
   int bytes_written_;
   WeakPtrFactory<FileProxyTest> weak_factory_;
 };
@@ -284,6 +293,43 @@ TEST_F(FileProxyTest, Read) {
   }
 }
 
+TEST_F(FileProxyTest, ReadMany) {
+  // Setup.
+  const char expected_data[] = "0123456789";
+  ASSERT_EQ(10, base::WriteFile(TestPath(), expected_data, 10));
+
+  // Run.
+  FileProxy proxy(file_task_runner());
+  CreateProxy(File::FLAG_OPEN | File::FLAG_READ, &proxy);
+
+  // The last range goes past the end of the file.
+  std::vector<FileProxy::ReadRange> ranges = {{6, 2}, {0, 3}, {0, 0}, {8, 5}};
+  EXPECT_TRUE(proxy.ReadMany(
+      std::move(ranges),
+      BindOnce(&FileProxyTest::DidReadMany, weak_factory_.GetWeakPtr())));
+  RunLoop().Run();
+
+  // Verify.
+  EXPECT_EQ(File::FILE_OK, error_);
+  ASSERT_EQ(4u, read_many_data_.size());
+  EXPECT_EQ("67", read_many_data_[0]);
+  EXPECT_EQ("012", read_many_data_[1]);
+  EXPECT_EQ("", read_many_data_[2]);
+  EXPECT_EQ("89", read_many_data_[3]);
+  EXPECT_TRUE(proxy.IsValid());
+}
+
+TEST_F(FileProxyTest, ReadMany_NegativeSize) {
+  FileProxy proxy(file_task_runner());
+  CreateProxy(File::FLAG_CREATE | File::FLAG_READ, &proxy);
+
+  std::vector<FileProxy::ReadRange> ranges = {{0, 1}, {1, -1}};
+  EXPECT_FALSE(proxy.ReadMany(
+      std::move(ranges),
+      BindOnce(&FileProxyTest::DidReadMany, weak_factory_.GetWeakPtr())));
+  EXPECT_TRUE(proxy.IsValid());
+}
+
 TEST_F(FileProxyTest, WriteAndFlush) {
   FileProxy proxy(file_task_runner());
   CreateProxy(File::FLAG_CREATE | File::FLAG_WRITE, &proxy);
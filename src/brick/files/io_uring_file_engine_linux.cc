@@ -0,0 +1,415 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/files/io_uring_file_engine_linux.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "brick/bind.h"
+#include "brick/bind_helpers.h"
+#include "brick/location.h"
+#include "brick/logging.h"
+#include "brick/message_loop/message_loop_current.h"
+#include "brick/posix/eintr_wrapper.h"
+#include "brick/sequenced_task_runner.h"
+#include "brick/threading/sequenced_task_runner_handle.h"
+#include "brick/time/time.h"
+
+namespace base {
+
+namespace {
+
+// Number of submission queue entries. The kernel makes the completion queue
+// twice as large.
+constexpr uint32_t kQueueDepth = 256;
+
+// How long to wait before retrying a submission the kernel had no resources
+// for, when no completion will trigger a retry.
+constexpr TimeDelta kSubmitRetryDelay = TimeDelta::FromMilliseconds(1);
+
+int IOUringSetup(uint32_t entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IOUringEnter(int ring_fd, uint32_t to_submit) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, nullptr, 0));
+}
+
+int IOUringRegister(int ring_fd,
+                    unsigned opcode,
+                    const void* arg,
+                    unsigned nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+// The ring indices are shared with the kernel, which reads and writes them
+// concurrently.
+uint32_t LoadAcquire(const uint32_t* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(uint32_t* p, uint32_t value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+void* MapRing(int ring_fd, size_t size, off_t offset) {
+  void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+  return ring == MAP_FAILED ? nullptr : ring;
+}
+
+}  // namespace
+
+struct IOUringFileEngine::Operation {
+  uint8_t opcode;
+  PlatformFile file;
+  int64_t offset;
+  char* buffer;
+  int size;
+  // Bytes transferred by previous submissions of a partial read or write.
+  int transferred = 0;
+  // Points at the remaining part of |buffer|. Read by the kernel when the
+  // operation is submitted.
+  iovec iov;
+  CompletionCallback callback;
+  scoped_refptr<SequencedTaskRunner> reply_task_runner;
+};
+
+IOUringFileEngine::ReadRequest::ReadRequest(PlatformFile file,
+                                            int64_t offset,
+                                            char* buffer,
+                                            int size,
+                                            CompletionCallback callback)
+    : file(file),
+      offset(offset),
+      buffer(buffer),
+      size(size),
+      callback(std::move(callback)) {}
+
+IOUringFileEngine::ReadRequest::ReadRequest(ReadRequest&& other) = default;
+
+IOUringFileEngine::ReadRequest::~ReadRequest() = default;
+
+// static
+IOUringFileEngine* IOUringFileEngine::Get() {
+  static IOUringFileEngine* const engine = []() -> IOUringFileEngine* {
+    // Leaked so that operations can complete during shutdown.
+    IOUringFileEngine* engine = new IOUringFileEngine;
+    if (engine->Init())
+      return engine;
+    delete engine;
+    return nullptr;
+  }();
+  return engine;
+}
+
+IOUringFileEngine::IOUringFileEngine()
+    : completion_thread_("IOUringFileEngine") {}
+
+IOUringFileEngine::~IOUringFileEngine() {
+  // Only reached when Init() fails, before any operation was submitted.
+  DCHECK(!completion_thread_.IsRunning());
+  if (sqes_)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_)
+    munmap(sq_ring_, sq_ring_size_);
+}
+
+bool IOUringFileEngine::Init() {
+  io_uring_params params = {};
+  ring_fd_.reset(IOUringSetup(kQueueDepth, &params));
+  if (!ring_fd_.is_valid()) {
+    DVPLOG(1) << "io_uring_setup";
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  // Since Linux 5.4 both rings share a single mapping.
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap)
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+  sq_ring_ = MapRing(ring_fd_.get(), sq_ring_size_, IORING_OFF_SQ_RING);
+  if (!sq_ring_) {
+    DPLOG(ERROR) << "mmap";
+    return false;
+  }
+  cq_ring_ = single_mmap
+                 ? sq_ring_
+                 : MapRing(ring_fd_.get(), cq_ring_size_, IORING_OFF_CQ_RING);
+  if (!cq_ring_) {
+    DPLOG(ERROR) << "mmap";
+    return false;
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(
+      MapRing(ring_fd_.get(), sqes_size_, IORING_OFF_SQES));
+  if (!sqes_) {
+    DPLOG(ERROR) << "mmap";
+    return false;
+  }
+
+  char* sq_ring = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.tail);
+  sq_array_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.array);
+  sq_mask_ = *reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+
+  char* cq_ring = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.tail);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+  cq_mask_ = *reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.ring_mask);
+
+  event_fd_.reset(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+  if (!event_fd_.is_valid()) {
+    DPLOG(ERROR) << "eventfd";
+    return false;
+  }
+  const int event_fd = event_fd_.get();
+  if (IOUringRegister(ring_fd_.get(), IORING_REGISTER_EVENTFD, &event_fd, 1) <
+      0) {
+    DPLOG(ERROR) << "io_uring_register";
+    return false;
+  }
+
+  if (!completion_thread_.StartWithOptions(
+          Thread::Options(MessageLoop::TYPE_IO, 0))) {
+    return false;
+  }
+  // Completions that arrive before the watch starts leave the eventfd
+  // readable, so they aren't missed.
+  completion_thread_.task_runner()->PostTask(
+      FROM_HERE,
+      BindOnce(&IOUringFileEngine::StartWatching, Unretained(this)));
+  return true;
+}
+
+void IOUringFileEngine::StartWatching() {
+  watch_controller_ =
+      std::make_unique<MessagePumpForIO::FdWatchController>(FROM_HERE);
+  const bool watching = MessageLoopCurrentForIO::Get()->WatchFileDescriptor(
+      event_fd_.get(), true, MessagePumpForIO::WATCH_READ,
+      watch_controller_.get(), this);
+  CHECK(watching);
+}
+
+void IOUringFileEngine::Read(PlatformFile file,
+                             int64_t offset,
+                             char* buffer,
+                             int size,
+                             CompletionCallback callback) {
+  std::vector<ReadRequest> requests;
+  requests.emplace_back(file, offset, buffer, size, std::move(callback));
+  ReadBatch(std::move(requests));
+}
+
+void IOUringFileEngine::ReadBatch(std::vector<ReadRequest> requests) {
+  scoped_refptr<SequencedTaskRunner> reply_task_runner =
+      SequencedTaskRunnerHandle::Get();
+  std::vector<std::unique_ptr<Operation>> operations;
+  operations.reserve(requests.size());
+  for (ReadRequest& request : requests) {
+    DCHECK_GE(request.size, 0);
+    auto operation = std::make_unique<Operation>();
+    operation->opcode = IORING_OP_READV;
+    operation->file = request.file;
+    operation->offset = request.offset;
+    operation->buffer = request.buffer;
+    operation->size = request.size;
+    operation->callback = std::move(request.callback);
+    operation->reply_task_runner = reply_task_runner;
+    operations.push_back(std::move(operation));
+  }
+  Submit(std::move(operations));
+}
+
+void IOUringFileEngine::Write(PlatformFile file,
+                              int64_t offset,
+                              const char* buffer,
+                              int size,
+                              CompletionCallback callback) {
+  DCHECK_GE(size, 0);
+  auto operation = std::make_unique<Operation>();
+  operation->opcode = IORING_OP_WRITEV;
+  operation->file = file;
+  operation->offset = offset;
+  // The kernel doesn't write to |buffer|.
+  operation->buffer = const_cast<char*>(buffer);
+  operation->size = size;
+  operation->callback = std::move(callback);
+  operation->reply_task_runner = SequencedTaskRunnerHandle::Get();
+  std::vector<std::unique_ptr<Operation>> operations;
+  operations.push_back(std::move(operation));
+  Submit(std::move(operations));
+}
+
+void IOUringFileEngine::Flush(PlatformFile file, CompletionCallback callback) {
+  auto operation = std::make_unique<Operation>();
+  operation->opcode = IORING_OP_FSYNC;
+  operation->file = file;
+  operation->offset = 0;
+  operation->buffer = nullptr;
+  operation->size = 0;
+  operation->callback = std::move(callback);
+  operation->reply_task_runner = SequencedTaskRunnerHandle::Get();
+  std::vector<std::unique_ptr<Operation>> operations;
+  operations.push_back(std::move(operation));
+  Submit(std::move(operations));
+}
+
+void IOUringFileEngine::Submit(
+    std::vector<std::unique_ptr<Operation>> operations) {
+  AutoLock auto_lock(lock_);
+  for (auto& operation : operations)
+    backlog_.push_back(std::move(operation));
+
+  // Only submitters write the tail, and they hold |lock_|.
+  uint32_t tail = *sq_tail_;
+  while (!backlog_.empty() && in_flight_ < sq_entries_) {
+    const uint32_t index = tail & sq_mask_;
+    PrepareLocked(&sqes_[index], backlog_.front().release());
+    backlog_.pop_front();
+    sq_array_[index] = index;
+    ++tail;
+    ++in_flight_;
+    ++unsubmitted_;
+  }
+  if (!unsubmitted_)
+    return;
+  StoreRelease(sq_tail_, tail);
+
+  const int submitted =
+      HANDLE_EINTR(IOUringEnter(ring_fd_.get(), unsubmitted_));
+  if (submitted >= 0) {
+    unsubmitted_ -= submitted;
+    return;
+  }
+
+  if (errno == EAGAIN || errno == EBUSY) {
+    // The kernel is out of resources. The entries stay queued, and are
+    // submitted again once some completion is reaped; if nothing is in flight
+    // to trigger that, retry shortly.
+    if (in_flight_ == unsubmitted_) {
+      completion_thread_.task_runner()->PostDelayedTask(
+          FROM_HERE,
+          BindOnce(&IOUringFileEngine::Submit, Unretained(this),
+                   std::vector<std::unique_ptr<Operation>>()),
+          kSubmitRetryDelay);
+    }
+    return;
+  }
+
+  // Anything else is unexpected. The kernel only consumes entries inside
+  // io_uring_enter(), so take back the ones it didn't and fail them.
+  const int error = errno;
+  DPLOG(ERROR) << "io_uring_enter";
+  for (uint32_t i = tail - unsubmitted_; i != tail; ++i) {
+    std::unique_ptr<Operation> operation(reinterpret_cast<Operation*>(
+        sqes_[sq_array_[i & sq_mask_]].user_data));
+    operation->reply_task_runner->PostTask(
+        FROM_HERE, BindOnce(std::move(operation->callback), -error));
+  }
+  StoreRelease(sq_tail_, tail - unsubmitted_);
+  in_flight_ -= unsubmitted_;
+  unsubmitted_ = 0;
+}
+
+void IOUringFileEngine::PrepareLocked(io_uring_sqe* sqe,
+                                      Operation* operation) {
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = operation->opcode;
+  sqe->fd = operation->file;
+  sqe->user_data = reinterpret_cast<uint64_t>(operation);
+  if (operation->opcode == IORING_OP_FSYNC) {
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    return;
+  }
+
+  // The kernel reads the iovec when the entry is submitted, and |operation|
+  // outlives that.
+  operation->iov.iov_base = operation->buffer + operation->transferred;
+  operation->iov.iov_len = operation->size - operation->transferred;
+  sqe->addr = reinterpret_cast<uint64_t>(&operation->iov);
+  sqe->len = 1;
+  sqe->off = operation->offset + operation->transferred;
+}
+
+void IOUringFileEngine::ReapCompletions() {
+  std::vector<std::unique_ptr<Operation>> resubmit;
+  uint32_t completed = 0;
+
+  uint32_t head = *cq_head_;
+  const uint32_t tail = LoadAcquire(cq_tail_);
+  for (; head != tail; ++head, ++completed) {
+    const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    std::unique_ptr<Operation> operation(
+        reinterpret_cast<Operation*>(cqe.user_data));
+    const int result = cqe.res;
+
+    if (result == -EINTR || result == -EAGAIN) {
+      resubmit.push_back(std::move(operation));
+      continue;
+    }
+    // Like File::Read() and File::Write(), keep going after a short transfer
+    // until everything is transferred, the end of the file is reached or an
+    // error occurs.
+    if (result > 0 && operation->opcode != IORING_OP_FSYNC) {
+      operation->transferred += result;
+      if (operation->transferred < operation->size) {
+        resubmit.push_back(std::move(operation));
+        continue;
+      }
+    }
+
+    int reply;
+    if (operation->opcode == IORING_OP_FSYNC)
+      reply = result;
+    else
+      reply = operation->transferred ? operation->transferred : result;
+    operation->reply_task_runner->PostTask(
+        FROM_HERE, BindOnce(std::move(operation->callback), reply));
+  }
+  StoreRelease(cq_head_, head);
+
+  if (!completed)
+    return;
+  {
+    AutoLock auto_lock(lock_);
+    in_flight_ -= completed;
+  }
+  // Also submits whatever was waiting for room in the ring.
+  Submit(std::move(resubmit));
+}
+
+void IOUringFileEngine::OnFileCanReadWithoutBlocking(int fd) {
+  DCHECK_EQ(event_fd_.get(), fd);
+  uint64_t value;
+  if (HANDLE_EINTR(read(fd, &value, sizeof(value))) < 0 && errno != EAGAIN)
+    DPLOG(ERROR) << "read";
+  ReapCompletions();
+}
+
+void IOUringFileEngine::OnFileCanWriteWithoutBlocking(int fd) {
+  NOTREACHED();
+}
+
+}  // namespace base
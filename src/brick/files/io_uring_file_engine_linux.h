@@ -0,0 +1,167 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_FILES_IO_URING_FILE_ENGINE_LINUX_H_
+#define BRICK_FILES_IO_URING_FILE_ENGINE_LINUX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "brick/base_export.h"
+#include "brick/callback.h"
+#include "brick/containers/circular_deque.h"
+#include "brick/files/platform_file.h"
+#include "brick/files/scoped_file.h"
+#include "brick/macros.h"
+#include "brick/message_loop/message_pump_for_io.h"
+#include "brick/synchronization/lock.h"
+#include "brick/threading/thread.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace base {
+
+// Asynchronous file I/O on top of io_uring. Operations can be started from any
+// sequence and are handed to the kernel with one io_uring_enter() per call, no
+// matter how many of them are batched together. They complete on a dedicated
+// TYPE_IO thread that watches the ring's completion eventfd, and each callback
+// is then posted back to the sequence that started the operation.
+//
+// Compared to posting blocking File calls to a TaskRunner, outstanding
+// operations don't each hold a thread, and there is no thread hop on the way
+// in.
+//
+// io_uring needs Linux 5.1 or later and can be blocked by seccomp policies.
+// Get() returns null in that case, and callers should fall back to blocking
+// File calls on a TaskRunner, as FileProxy does.
+class BRICK_EXPORT IOUringFileEngine : public MessagePumpForIO::FdWatcher {
+ public:
+  // Receives the number of bytes transferred, or a negative errno value.
+  using CompletionCallback = OnceCallback<void(int result)>;
+
+  // One read of ReadBatch().
+  struct BRICK_EXPORT ReadRequest {
+    ReadRequest(PlatformFile file,
+                int64_t offset,
+                char* buffer,
+                int size,
+                CompletionCallback callback);
+    ReadRequest(ReadRequest&& other);
+    ~ReadRequest();
+
+    PlatformFile file;
+    int64_t offset;
+    char* buffer;
+    int size;
+    CompletionCallback callback;
+  };
+
+  // Returns the process-wide engine, creating it on first use, or null if
+  // io_uring isn't available.
+  static IOUringFileEngine* Get();
+
+  // All the methods below must be called on a sequence, which is where the
+  // callback runs. |file| must stay open and |buffer| valid until then.
+
+  // Reads like File::Read(): short reads are continued until |size| bytes
+  // have been read or the end of the file is reached.
+  void Read(PlatformFile file,
+            int64_t offset,
+            char* buffer,
+            int size,
+            CompletionCallback callback);
+
+  // Starts all |requests| at once; they complete independently.
+  void ReadBatch(std::vector<ReadRequest> requests);
+
+  // Writes like File::Write().
+  void Write(PlatformFile file,
+             int64_t offset,
+             const char* buffer,
+             int size,
+             CompletionCallback callback);
+
+  // Flushes like File::Flush(). The result is 0 on success.
+  void Flush(PlatformFile file, CompletionCallback callback);
+
+ private:
+  struct Operation;
+
+  IOUringFileEngine();
+  ~IOUringFileEngine() override;
+
+  // Sets up the ring and starts the completion thread. Returns false if
+  // io_uring isn't available.
+  bool Init();
+
+  // Runs on |completion_thread_|.
+  void StartWatching();
+
+  // Queues |operations| and hands as many queued operations to the kernel as
+  // the ring has room for.
+  void Submit(std::vector<std::unique_ptr<Operation>> operations);
+
+  // Fills a submission queue entry for |operation|. |lock_| must be held.
+  void PrepareLocked(io_uring_sqe* sqe, Operation* operation);
+
+  // Runs every completed operation's callback, or resubmits the operations
+  // that only transferred part of their data. Runs on |completion_thread_|.
+  void ReapCompletions();
+
+  // MessagePumpForIO::FdWatcher:
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+  ScopedFD ring_fd_;
+  // Signaled by the kernel when completions are posted.
+  ScopedFD event_fd_;
+
+  // Memory shared with the kernel.
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  // Submission queue. The kernel advances the head; submitters advance the
+  // tail with |lock_| held.
+  uint32_t* sq_head_ = nullptr;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t* sq_array_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  uint32_t sq_entries_ = 0;
+
+  // Completion queue. The kernel advances the tail, |completion_thread_|
+  // advances the head.
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+  uint32_t cq_mask_ = 0;
+
+  // Protects the members below.
+  Lock lock_;
+  // Operations waiting for room in the ring.
+  circular_deque<std::unique_ptr<Operation>> backlog_;
+  // Operations in the ring, including the ones the kernel hasn't consumed
+  // yet. Never exceeds |sq_entries_|, so neither queue can overflow.
+  uint32_t in_flight_ = 0;
+  // Entries added to the submission queue but not consumed by the kernel yet,
+  // e.g. because io_uring_enter() failed with EAGAIN.
+  uint32_t unsubmitted_ = 0;
+
+  Thread completion_thread_;
+  // Only used on |completion_thread_|.
+  std::unique_ptr<MessagePumpForIO::FdWatchController> watch_controller_;
+
+  DISALLOW_COPY_AND_ASSIGN(IOUringFileEngine);
+};
+
+}  // namespace base
+
+#endif  // BRICK_FILES_IO_URING_FILE_ENGINE_LINUX_H_
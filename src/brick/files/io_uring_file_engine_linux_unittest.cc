@@ -0,0 +1,189 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/files/io_uring_file_engine_linux.h"
+
+#include <errno.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "brick/bind.h"
+#include "brick/files/file.h"
+#include "brick/files/file_util.h"
+#include "brick/files/scoped_temp_dir.h"
+#include "brick/macros.h"
+#include "brick/message_loop/message_loop.h"
+#include "brick/run_loop.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+void StoreResult(int* result_out, OnceClosure quit_closure, int result) {
+  *result_out = result;
+  std::move(quit_closure).Run();
+}
+
+// Stores the result and runs |quit_closure| once |*remaining| drops to zero.
+void CountDown(int* result_out,
+               int* remaining,
+               const RepeatingClosure& quit_closure,
+               int result) {
+  *result_out = result;
+  if (--*remaining == 0)
+    quit_closure.Run();
+}
+
+class IOUringFileEngineTest : public testing::Test {
+ public:
+  IOUringFileEngineTest() = default;
+
+  void SetUp() override {
+    engine_ = IOUringFileEngine::Get();
+    // io_uring may be missing or forbidden by a seccomp policy.
+    if (!engine_)
+      return;
+    ASSERT_TRUE(dir_.CreateUniqueTempDir());
+  }
+
+ protected:
+  FilePath TestPath() const { return dir_.GetPath().AppendASCII("test"); }
+
+  File OpenTestFile(uint32_t flags) { return File(TestPath(), flags); }
+
+  IOUringFileEngine* engine_ = nullptr;
+  ScopedTempDir dir_;
+  MessageLoopForIO message_loop_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(IOUringFileEngineTest);
+};
+
+}  // namespace
+
+TEST_F(IOUringFileEngineTest, Read) {
+  if (!engine_)
+    return;
+  const char kData[] = "0123456789";
+  ASSERT_EQ(10, WriteFile(TestPath(), kData, 10));
+  File file = OpenTestFile(File::FLAG_OPEN | File::FLAG_READ);
+  ASSERT_TRUE(file.IsValid());
+
+  // Reads past the end of the file stop there.
+  char buffer[16] = {};
+  int result = 0;
+  RunLoop run_loop;
+  engine_->Read(file.GetPlatformFile(), 4, buffer, sizeof(buffer),
+                BindOnce(&StoreResult, &result, run_loop.QuitClosure()));
+  run_loop.Run();
+  EXPECT_EQ(6, result);
+  EXPECT_EQ("456789", std::string(buffer, 6));
+}
+
+TEST_F(IOUringFileEngineTest, ReadInvalidFile) {
+  if (!engine_)
+    return;
+  char buffer[4];
+  int result = 0;
+  RunLoop run_loop;
+  engine_->Read(-1, 0, buffer, sizeof(buffer),
+                BindOnce(&StoreResult, &result, run_loop.QuitClosure()));
+  run_loop.Run();
+  EXPECT_EQ(-EBADF, result);
+}
+
+TEST_F(IOUringFileEngineTest, ReadBatch) {
+  if (!engine_)
+    return;
+  const char kData[] = "abcdefghij";
+  ASSERT_EQ(10, WriteFile(TestPath(), kData, 10));
+  File file = OpenTestFile(File::FLAG_OPEN | File::FLAG_READ);
+  ASSERT_TRUE(file.IsValid());
+
+  char buffers[3][4] = {};
+  int results[3] = {};
+  int remaining = 3;
+  RunLoop run_loop;
+  std::vector<IOUringFileEngine::ReadRequest> requests;
+  const int64_t kOffsets[] = {8, 0, 4};
+  for (int i = 0; i < 3; ++i) {
+    requests.emplace_back(file.GetPlatformFile(), kOffsets[i], buffers[i], 4,
+                          BindOnce(&CountDown, &results[i], &remaining,
+                                   run_loop.QuitClosure()));
+  }
+  engine_->ReadBatch(std::move(requests));
+  run_loop.Run();
+
+  EXPECT_EQ(2, results[0]);
+  EXPECT_EQ("ij", std::string(buffers[0], 2));
+  EXPECT_EQ(4, results[1]);
+  EXPECT_EQ("abcd", std::string(buffers[1], 4));
+  EXPECT_EQ(4, results[2]);
+  EXPECT_EQ("efgh", std::string(buffers[2], 4));
+}
+
+// Batches larger than the ring wait for room instead of failing.
+TEST_F(IOUringFileEngineTest, ReadBatchLargerThanRing) {
+  if (!engine_)
+    return;
+  constexpr int kReads = 2000;
+  std::string data(kReads, '\0');
+  for (int i = 0; i < kReads; ++i)
+    data[i] = static_cast<char>('a' + i % 26);
+  ASSERT_EQ(kReads, WriteFile(TestPath(), data.data(), kReads));
+  File file = OpenTestFile(File::FLAG_OPEN | File::FLAG_READ);
+  ASSERT_TRUE(file.IsValid());
+
+  std::string buffer(kReads, '\0');
+  std::vector<int> results(kReads, -1);
+  int remaining = kReads;
+  RunLoop run_loop;
+  std::vector<IOUringFileEngine::ReadRequest> requests;
+  for (int i = 0; i < kReads; ++i) {
+    requests.emplace_back(file.GetPlatformFile(), i, &buffer[i], 1,
+                          BindOnce(&CountDown, &results[i], &remaining,
+                                   run_loop.QuitClosure()));
+  }
+  engine_->ReadBatch(std::move(requests));
+  run_loop.Run();
+
+  for (int i = 0; i < kReads; ++i)
+    EXPECT_EQ(1, results[i]) << i;
+  EXPECT_EQ(data, buffer);
+}
+
+TEST_F(IOUringFileEngineTest, WriteAndFlush) {
+  if (!engine_)
+    return;
+  File file = OpenTestFile(File::FLAG_CREATE | File::FLAG_WRITE);
+  ASSERT_TRUE(file.IsValid());
+
+  const char kData[] = "written";
+  int result = 0;
+  {
+    RunLoop run_loop;
+    engine_->Write(file.GetPlatformFile(), 3, kData, 7,
+                   BindOnce(&StoreResult, &result, run_loop.QuitClosure()));
+    run_loop.Run();
+  }
+  EXPECT_EQ(7, result);
+
+  result = -1;
+  {
+    RunLoop run_loop;
+    engine_->Flush(file.GetPlatformFile(),
+                   BindOnce(&StoreResult, &result, run_loop.QuitClosure()));
+    run_loop.Run();
+  }
+  EXPECT_EQ(0, result);
+
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(TestPath(), &contents));
+  EXPECT_EQ(std::string("\0\0\0written", 10), contents);
+}
+
+}  // namespace base
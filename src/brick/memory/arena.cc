@@ -0,0 +1,141 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/memory/arena.h"
+
+#include <algorithm>
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+#include "brick/allocator/partition_allocator/partition_alloc.h"
+#endif
+
+namespace base {
+
+struct Arena::Chunk {
+  uintptr_t begin() const {
+    return reinterpret_cast<uintptr_t>(this) + kHeaderSize;
+  }
+  uintptr_t end() const { return reinterpret_cast<uintptr_t>(this) + size; }
+
+  // Keeps the memory after the header aligned like ::operator new() does.
+  static constexpr size_t kHeaderSize =
+      (sizeof(Chunk*) + sizeof(size_t) + kDefaultAlignment - 1) /
+      kDefaultAlignment * kDefaultAlignment;
+
+  Chunk* next;
+  size_t size;
+};
+
+constexpr size_t Arena::kDefaultInitialChunkSize;
+constexpr size_t Arena::kMaxChunkSize;
+constexpr size_t Arena::kDefaultAlignment;
+constexpr size_t Arena::Chunk::kHeaderSize;
+
+Arena::Arena() : Arena(kDefaultInitialChunkSize) {}
+
+Arena::Arena(size_t initial_chunk_size)
+    : next_chunk_size_(std::max(initial_chunk_size, 2 * Chunk::kHeaderSize)) {}
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+Arena::Arena(size_t initial_chunk_size, PartitionRootGeneric* partition)
+    : partition_(partition),
+      next_chunk_size_(std::max(initial_chunk_size, 2 * Chunk::kHeaderSize)) {
+  DCHECK(partition_);
+}
+#endif
+
+Arena::~Arena() {
+  RunDestructors();
+  while (Chunk* chunk = chunks_) {
+    chunks_ = chunk->next;
+    FreeChunk(chunk);
+  }
+}
+
+void Arena::Reset() {
+  RunDestructors();
+  if (!chunks_)
+    return;
+  while (Chunk* chunk = chunks_->next) {
+    chunks_->next = chunk->next;
+    FreeChunk(chunk);
+  }
+  cursor_ = chunks_->begin();
+  end_ = chunks_->end();
+  bytes_allocated_ = 0;
+}
+
+void* Arena::AllocateInNewChunk(size_t size, size_t alignment) {
+  CHECK_LE(size, std::numeric_limits<size_t>::max() - alignment -
+                     Chunk::kHeaderSize);
+  const size_t chunk_size = Chunk::kHeaderSize + size + alignment - 1;
+
+  // An allocation which would use up most of a new chunk gets one to itself,
+  // placed after the current chunk, whose free space is still used. Only
+  // regular chunks become current, since Reset() keeps the current chunk.
+  if (chunk_size > next_chunk_size_ / 2) {
+    if (!chunks_)
+      StartNewChunk();
+    Chunk* chunk = NewChunk(chunk_size);
+    chunk->next = chunks_->next;
+    chunks_->next = chunk;
+    bytes_allocated_ += size;
+    return reinterpret_cast<void*>(bits::Align(chunk->begin(), alignment));
+  }
+
+  StartNewChunk();
+  return Allocate(size, alignment);
+}
+
+void Arena::StartNewChunk() {
+  Chunk* chunk = NewChunk(next_chunk_size_);
+  next_chunk_size_ = std::min(2 * next_chunk_size_, kMaxChunkSize);
+  chunk->next = chunks_;
+  chunks_ = chunk;
+  cursor_ = chunk->begin();
+  end_ = chunk->end();
+}
+
+void Arena::AddDestructor(void* object, void (*destroy)(void*)) {
+  Destructor* destructor = static_cast<Destructor*>(
+      Allocate(sizeof(Destructor), alignof(Destructor)));
+  destructor->destroy = destroy;
+  destructor->object = object;
+  destructor->next = destructors_;
+  destructors_ = destructor;
+}
+
+void Arena::RunDestructors() {
+  while (Destructor* destructor = destructors_) {
+    destructors_ = destructor->next;
+    destructor->destroy(destructor->object);
+  }
+}
+
+Arena::Chunk* Arena::NewChunk(size_t size) {
+  void* memory;
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+  if (partition_)
+    memory = partition_->Alloc(size, "base::Arena");
+  else
+#endif
+    memory = ::operator new(size);
+  chunk_bytes_ += size;
+  Chunk* chunk = static_cast<Chunk*>(memory);
+  chunk->size = size;
+  return chunk;
+}
+
+void Arena::FreeChunk(Chunk* chunk) {
+  chunk_bytes_ -= chunk->size;
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+  if (partition_) {
+    partition_->Free(chunk);
+    return;
+  }
+#endif
+  ::operator delete(chunk);
+}
+
+}  // namespace base
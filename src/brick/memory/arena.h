@@ -0,0 +1,186 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_MEMORY_ARENA_H_
+#define BRICK_MEMORY_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "brick/base_export.h"
+#include "brick/bits.h"
+#include "brick/compiler_specific.h"
+#include "brick/logging.h"
+#include "brick/macros.h"
+#include "brick/partition_alloc_buildflags.h"
+#include "build/build_config.h"
+
+namespace base {
+
+struct PartitionRootGeneric;
+
+// A monotonic arena, for objects which are freed all at once, like the ones
+// allocated to handle a request. Allocating bumps a pointer in the current
+// chunk of memory, and nothing is freed until the arena is reset or destroyed.
+// Chunks double in size from |initial_chunk_size| up to kMaxChunkSize, and the
+// allocations too large to share a chunk get one of their own.
+//
+// The objects created with New() are destroyed when the arena is reset, in the
+// reverse order of their creation. The memory of the containers which use an
+// ArenaAllocator, below, is reclaimed along with the arena, but they must still
+// be destroyed before it.
+//
+// An Arena isn't thread-safe.
+//
+// Example:
+//   base::Arena arena;
+//   Request* request = arena.New<Request>(url);
+//   std::vector<int, base::ArenaAllocator<int>> ids{
+//       base::ArenaAllocator<int>(&arena)};
+class BRICK_EXPORT Arena {
+ public:
+  static constexpr size_t kDefaultInitialChunkSize = 4096;
+  static constexpr size_t kMaxChunkSize = 256 * 1024;
+  static constexpr size_t kDefaultAlignment = alignof(max_align_t);
+
+  Arena();
+  explicit Arena(size_t initial_chunk_size);
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+  // Allocates the chunks from |partition|, which must be initialized and
+  // outlive the arena.
+  Arena(size_t initial_chunk_size, PartitionRootGeneric* partition);
+#endif
+  ~Arena();
+
+  // Returns |size| bytes aligned to |alignment|, which is a power of two.
+  void* Allocate(size_t size, size_t alignment = kDefaultAlignment) {
+    DCHECK(bits::IsPowerOfTwo(alignment));
+    // Zero-sized allocations still get a distinct address.
+    if (UNLIKELY(!size))
+      size = 1;
+    const uintptr_t begin = bits::Align(cursor_, alignment);
+    if (LIKELY(begin <= end_ && size <= end_ - begin)) {
+      cursor_ = begin + size;
+      bytes_allocated_ += size;
+      return reinterpret_cast<void*>(begin);
+    }
+    return AllocateInNewChunk(size, alignment);
+  }
+
+  // Creates a T in the arena. It's destroyed when the arena is reset, unless
+  // it's trivially destructible.
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    T* object = new (Allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value)
+      AddDestructor(object, &DestroyObject<T>);
+    return object;
+  }
+
+  // Destroys the objects created with New() and frees all the memory, except
+  // the current chunk, which is reused by the next allocations.
+  void Reset();
+
+  // Returns the number of bytes allocated since the arena was created or
+  // reset, without the alignment padding.
+  size_t bytes_allocated() const { return bytes_allocated_; }
+
+  // Returns the size of the chunks held by the arena. The memory of the
+  // containers using an ArenaAllocator is accounted here rather than by
+  // estimating the containers.
+  size_t EstimateMemoryUsage() const { return chunk_bytes_; }
+
+ private:
+  struct Chunk;
+
+  struct Destructor {
+    void (*destroy)(void* object);
+    void* object;
+    Destructor* next;
+  };
+
+  template <typename T>
+  static void DestroyObject(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  void* AllocateInNewChunk(size_t size, size_t alignment);
+  // Makes a new regular chunk the current one.
+  void StartNewChunk();
+  void AddDestructor(void* object, void (*destroy)(void*));
+  void RunDestructors();
+
+  Chunk* NewChunk(size_t size);
+  void FreeChunk(Chunk* chunk);
+
+  PartitionRootGeneric* const partition_ = nullptr;
+  size_t next_chunk_size_;
+
+  // The free space of the current chunk.
+  uintptr_t cursor_ = 0;
+  uintptr_t end_ = 0;
+
+  // The current chunk comes first.
+  Chunk* chunks_ = nullptr;
+  size_t chunk_bytes_ = 0;
+
+  Destructor* destructors_ = nullptr;
+  size_t bytes_allocated_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+// An allocator for standard containers, which allocates from an Arena. Its
+// deallocate() doesn't free anything; the memory is reused once the arena is
+// reset. Containers of containers, like trees of nodes, need to pass the
+// allocator of the outer container on to the inner ones, e.g.
+//   using IntVector = std::vector<int, base::ArenaAllocator<int>>;
+//   std::vector<IntVector, base::ArenaAllocator<IntVector>> rows{
+//       base::ArenaAllocator<IntVector>(&arena)};
+//   rows.emplace_back(rows.get_allocator());
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  explicit ArenaAllocator(Arena* arena) : arena_(arena) { DCHECK(arena_); }
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    CHECK_LE(n, std::numeric_limits<size_t>::max() / sizeof(T));
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {}
+
+  Arena* arena() const { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+  return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace base
+
+#endif  // BRICK_MEMORY_ARENA_H_
@@ -0,0 +1,183 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/memory/arena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "brick/trace_event/memory_usage_estimator.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+#include "brick/allocator/partition_allocator/partition_alloc.h"
+#endif
+
+namespace base {
+
+namespace {
+
+class DestructionRecorder {
+ public:
+  DestructionRecorder(std::vector<int>* destroyed, int id)
+      : destroyed_(destroyed), id_(id) {}
+  ~DestructionRecorder() { destroyed_->push_back(id_); }
+
+ private:
+  std::vector<int>* const destroyed_;
+  const int id_;
+
+  DISALLOW_COPY_AND_ASSIGN(DestructionRecorder);
+};
+
+bool IsAligned(const void* p, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+}  // namespace
+
+TEST(ArenaTest, Allocate) {
+  Arena arena;
+  EXPECT_EQ(0u, arena.EstimateMemoryUsage());
+
+  char* first = static_cast<char*>(arena.Allocate(10, 1));
+  char* second = static_cast<char*>(arena.Allocate(10, 1));
+  EXPECT_EQ(first + 10, second);
+  EXPECT_EQ(20u, arena.bytes_allocated());
+  EXPECT_EQ(Arena::kDefaultInitialChunkSize, arena.EstimateMemoryUsage());
+
+  for (size_t alignment = 1; alignment <= 256; alignment *= 2) {
+    void* p = arena.Allocate(3, alignment);
+    EXPECT_TRUE(IsAligned(p, alignment)) << alignment;
+  }
+  EXPECT_TRUE(IsAligned(arena.Allocate(1), Arena::kDefaultAlignment));
+  EXPECT_NE(arena.Allocate(0), arena.Allocate(0));
+}
+
+TEST(ArenaTest, GrowsChunks) {
+  Arena arena(1024);
+  size_t allocated = 0;
+  while (arena.EstimateMemoryUsage() <= 1024) {
+    arena.Allocate(100);
+    allocated += 100;
+  }
+  // The second chunk is twice as large as the first.
+  EXPECT_EQ(3 * 1024u, arena.EstimateMemoryUsage());
+  EXPECT_EQ(allocated, arena.bytes_allocated());
+
+  while (arena.EstimateMemoryUsage() < 16 * Arena::kMaxChunkSize)
+    arena.Allocate(1000);
+  // The chunks stop growing at kMaxChunkSize.
+  const size_t usage = arena.EstimateMemoryUsage();
+  while (arena.EstimateMemoryUsage() == usage)
+    arena.Allocate(1000);
+  EXPECT_EQ(usage + Arena::kMaxChunkSize, arena.EstimateMemoryUsage());
+}
+
+TEST(ArenaTest, LargeAllocationsGetOwnChunk) {
+  Arena arena;
+  char* small = static_cast<char*>(arena.Allocate(8, 1));
+  void* large = arena.Allocate(Arena::kDefaultInitialChunkSize, 64);
+  EXPECT_TRUE(IsAligned(large, 64));
+  EXPECT_GT(arena.EstimateMemoryUsage(), 2 * Arena::kDefaultInitialChunkSize);
+
+  // The current chunk is still used.
+  EXPECT_EQ(small + 8, arena.Allocate(8, 1));
+}
+
+TEST(ArenaTest, ResetFreesLargeFirstAllocation) {
+  Arena arena;
+  arena.Allocate(1024 * 1024);
+  EXPECT_GT(arena.EstimateMemoryUsage(), 1024 * 1024u);
+
+  // Only the regular chunk started along with the large one is kept.
+  arena.Reset();
+  EXPECT_EQ(Arena::kDefaultInitialChunkSize, arena.EstimateMemoryUsage());
+  arena.Allocate(100);
+  EXPECT_EQ(Arena::kDefaultInitialChunkSize, arena.EstimateMemoryUsage());
+}
+
+TEST(ArenaTest, ResetDestroysObjects) {
+  std::vector<int> destroyed;
+  Arena arena;
+  arena.New<DestructionRecorder>(&destroyed, 1);
+  int* value = arena.New<int>(42);
+  EXPECT_EQ(42, *value);
+  arena.New<DestructionRecorder>(&destroyed, 2);
+  arena.Allocate(100 * Arena::kDefaultInitialChunkSize);
+  EXPECT_TRUE(destroyed.empty());
+
+  arena.Reset();
+  EXPECT_EQ(std::vector<int>({2, 1}), destroyed);
+  EXPECT_EQ(0u, arena.bytes_allocated());
+  // Only the current chunk is kept.
+  EXPECT_EQ(Arena::kDefaultInitialChunkSize, arena.EstimateMemoryUsage());
+
+  arena.New<DestructionRecorder>(&destroyed, 3);
+  EXPECT_EQ(Arena::kDefaultInitialChunkSize, arena.EstimateMemoryUsage());
+}
+
+TEST(ArenaTest, DestructorDestroysObjects) {
+  std::vector<int> destroyed;
+  {
+    Arena arena;
+    arena.New<DestructionRecorder>(&destroyed, 1);
+  }
+  EXPECT_EQ(std::vector<int>({1}), destroyed);
+}
+
+TEST(ArenaTest, Containers) {
+  Arena arena;
+  using IntVector = std::vector<int, ArenaAllocator<int>>;
+  using String =
+      std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+  using StringMap =
+      std::map<String, IntVector, std::less<String>,
+               ArenaAllocator<std::pair<const String, IntVector>>>;
+
+  // A tree, whose nodes pass the allocator on to their children.
+  StringMap map{StringMap::allocator_type(&arena)};
+  for (int i = 0; i < 100; ++i) {
+    String key("a key too long to fit in the string itself",
+               map.get_allocator());
+    key.push_back(static_cast<char>('0' + i % 10));
+    auto it = map.emplace(key, IntVector(map.get_allocator())).first;
+    it->second.push_back(i);
+  }
+  EXPECT_EQ(10u, map.size());
+  const IntVector& values = map.begin()->second;
+  EXPECT_EQ(std::vector<int>({0, 10, 20, 30, 40, 50, 60, 70, 80, 90}),
+            std::vector<int>(values.begin(), values.end()));
+
+  // Everything went to the arena.
+  EXPECT_GT(arena.bytes_allocated(), 100 * sizeof(int));
+  EXPECT_EQ(arena.EstimateMemoryUsage(),
+            trace_event::EstimateMemoryUsage(arena));
+
+  EXPECT_TRUE(ArenaAllocator<int>(&arena) == map.get_allocator());
+  Arena other_arena;
+  EXPECT_TRUE(ArenaAllocator<int>(&other_arena) != map.get_allocator());
+}
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+TEST(ArenaTest, PartitionAllocBacking) {
+  PartitionAllocatorGeneric allocator;
+  allocator.init();
+  {
+    Arena arena(Arena::kDefaultInitialChunkSize, allocator.root());
+    char* p = static_cast<char*>(arena.Allocate(100));
+    memset(p, 1, 100);
+    void* large = arena.Allocate(10 * Arena::kDefaultInitialChunkSize);
+    memset(large, 2, 10 * Arena::kDefaultInitialChunkSize);
+    EXPECT_GT(arena.EstimateMemoryUsage(),
+              11 * Arena::kDefaultInitialChunkSize);
+  }
+}
+#endif  // BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+
+}  // namespace base
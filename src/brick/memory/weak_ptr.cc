@@ -4,6 +4,8 @@
 
 #include "brick/memory/weak_ptr.h"
 
+#include <utility>
+
 namespace base {
 namespace internal {
 
@@ -22,10 +24,9 @@ void WeakReference::Flag::Invalidate() {
   is_valid_ = false;
 }
 
-bool WeakReference::Flag::IsValid() const {
-  DCHECK(sequence_checker_.CalledOnValidSequence())
-      << "WeakPtrs must be checked on the same sequenced thread.";
-  return is_valid_;
+void WeakReference::Flag::DetachFromSequence() {
+  DCHECK(HasOneRef());
+  sequence_checker_.DetachFromSequence();
 }
 
 WeakReference::Flag::~Flag() = default;
@@ -40,10 +41,6 @@ WeakReference::WeakReference(WeakReference&& other) = default;
 
 WeakReference::WeakReference(const WeakReference& other) = default;
 
-bool WeakReference::is_valid() const {
-  return flag_ && flag_->IsValid();
-}
-
 WeakReferenceOwner::WeakReferenceOwner() = default;
 
 WeakReferenceOwner::~WeakReferenceOwner() {
@@ -51,9 +48,14 @@ WeakReferenceOwner::~WeakReferenceOwner() {
 }
 
 WeakReference WeakReferenceOwner::GetRef() const {
-  // If we hold the last reference to the Flag then create a new one.
-  if (!HasRefs())
+  // If we hold the last reference to the Flag then no WeakPtr can check it
+  // anymore, so it is unbound from its sequence and reused rather than
+  // replaced by a new one. This keeps the common GetWeakPtr(), bind, run and
+  // destroy cycle from allocating a Flag every time.
+  if (!flag_)
     flag_ = new WeakReference::Flag();
+  else if (flag_->HasOneRef())
+    flag_->DetachFromSequence();
 
   return WeakReference(flag_);
 }
@@ -74,6 +76,11 @@ WeakPtrBase::WeakPtrBase(const WeakReference& ref, uintptr_t ptr)
   DCHECK(ptr_);
 }
 
+WeakPtrBase::WeakPtrBase(WeakReference&& ref, uintptr_t ptr)
+    : ref_(std::move(ref)), ptr_(ptr) {
+  DCHECK(ptr_);
+}
+
 WeakPtrFactoryBase::WeakPtrFactoryBase(uintptr_t ptr) : ptr_(ptr) {
   DCHECK(ptr_);
 }
@@ -72,6 +72,7 @@
 
 #include <cstddef>
 #include <type_traits>
+#include <utility>
 
 #include "brick/base_export.h"
 #include "brick/logging.h"
@@ -97,7 +98,17 @@ class BRICK_EXPORT WeakReference {
     Flag();
 
     void Invalidate();
-    bool IsValid() const;
+
+    // Inlined, since it is checked on every dereference of a WeakPtr.
+    bool IsValid() const {
+      DCHECK(sequence_checker_.CalledOnValidSequence())
+          << "WeakPtrs must be checked on the same sequenced thread.";
+      return is_valid_;
+    }
+
+    // Unbinds the flag from its sequence, like a new one. Only allowed when
+    // there are no WeakPtrs left.
+    void DetachFromSequence();
 
    private:
     friend class base::RefCountedThreadSafe<Flag>;
@@ -117,7 +128,7 @@ class BRICK_EXPORT WeakReference {
   WeakReference& operator=(WeakReference&& other) = default;
   WeakReference& operator=(const WeakReference& other) = default;
 
-  bool is_valid() const;
+  bool is_valid() const { return flag_ && flag_->IsValid(); }
 
  private:
   scoped_refptr<const Flag> flag_;
@@ -159,6 +170,7 @@ class BRICK_EXPORT WeakPtrBase {
 
  protected:
   WeakPtrBase(const WeakReference& ref, uintptr_t ptr);
+  WeakPtrBase(WeakReference&& ref, uintptr_t ptr);
 
   WeakReference ref_;
 
@@ -194,7 +206,8 @@ class SupportsWeakPtrBase {
   static WeakPtr<Derived> AsWeakPtrImpl(SupportsWeakPtr<Base>* t) {
     WeakPtr<Base> ptr = t->AsWeakPtr();
     return WeakPtr<Derived>(
-        ptr.ref_, static_cast<Derived*>(reinterpret_cast<Base*>(ptr.ptr_)));
+        std::move(ptr.ref_),
+        static_cast<Derived*>(reinterpret_cast<Base*>(ptr.ptr_)));
   }
 };
 
@@ -263,6 +276,10 @@ class WeakPtr : public internal::WeakPtrBase {
 
   WeakPtr(const internal::WeakReference& ref, T* ptr)
       : WeakPtrBase(ref, reinterpret_cast<uintptr_t>(ptr)) {}
+  // Takes over the reference of the temporaries returned by
+  // WeakReferenceOwner::GetRef(), saving a refcount increment and decrement.
+  WeakPtr(internal::WeakReference&& ref, T* ptr)
+      : WeakPtrBase(std::move(ref), reinterpret_cast<uintptr_t>(ptr)) {}
 };
 
 // Allow callers to compare WeakPtrs against nullptr to test validity.
@@ -0,0 +1,83 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the cost of WeakPtrs in the pattern of event dispatching code:
+// callbacks bound to a WeakPtr, created and run one after the other.
+
+#include <string>
+
+#include "brick/bind.h"
+#include "brick/callback.h"
+#include "brick/macros.h"
+#include "brick/memory/weak_ptr.h"
+#include "brick/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+constexpr int kNumOperations = 1000000;
+
+class Receiver {
+ public:
+  Receiver() : weak_factory_(this) {}
+
+  void OnEvent(int value) { sum_ += value; }
+
+  WeakPtr<Receiver> GetWeakPtr() { return weak_factory_.GetWeakPtr(); }
+
+  int sum() const { return sum_; }
+
+ private:
+  int sum_ = 0;
+  WeakPtrFactory<Receiver> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(Receiver);
+};
+
+void PrintOperationTime(const std::string& trace, TimeDelta elapsed) {
+  perf_test::PrintResult("operation_time", "", trace,
+                         elapsed.InNanoseconds() /
+                             static_cast<double>(kNumOperations),
+                         "ns/op", true);
+}
+
+}  // namespace
+
+// A new WeakPtr for every callback, while none of the previous ones is left.
+TEST(WeakPtrPerfTest, BindRunWithNewWeakPtr) {
+  Receiver receiver;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumOperations; ++i)
+    BindOnce(&Receiver::OnEvent, receiver.GetWeakPtr(), 1).Run();
+  PrintOperationTime("BindRunWithNewWeakPtr", TimeTicks::Now() - start);
+  EXPECT_EQ(kNumOperations, receiver.sum());
+}
+
+// Copies of a long-lived WeakPtr, while it keeps the flag shared.
+TEST(WeakPtrPerfTest, BindRunWithCopiedWeakPtr) {
+  Receiver receiver;
+  const WeakPtr<Receiver> weak_receiver = receiver.GetWeakPtr();
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumOperations; ++i)
+    BindOnce(&Receiver::OnEvent, weak_receiver, 1).Run();
+  PrintOperationTime("BindRunWithCopiedWeakPtr", TimeTicks::Now() - start);
+  EXPECT_EQ(kNumOperations, receiver.sum());
+}
+
+// A repeating callback bound once, which checks the WeakPtr on every run.
+TEST(WeakPtrPerfTest, RunBoundWeakPtr) {
+  Receiver receiver;
+  RepeatingCallback<void(int)> callback =
+      BindRepeating(&Receiver::OnEvent, receiver.GetWeakPtr());
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumOperations; ++i)
+    callback.Run(1);
+  PrintOperationTime("RunBoundWeakPtr", TimeTicks::Now() - start);
+  EXPECT_EQ(kNumOperations, receiver.sum());
+}
+
+}  // namespace base
@@ -3,6 +3,8 @@
 // found in the LICENSE file.
 
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "brick/atomicops.h"
@@ -160,6 +162,36 @@ class MessageLoopPerfTest : public ::testing::TestWithParam<int> {
     DISALLOW_COPY_AND_ASSIGN(ContinuouslyPostTasks);
   };
 
+  // Like ContinuouslyPostTasks, but binds a new callback for every task, as
+  // most callers of PostTask() do. The BindStates are allocated on the posting
+  // threads and freed on the message loop thread. The std::string makes them
+  // too large and not trivially copyable, so they aren't stored inside the
+  // callbacks.
+  class ContinuouslyBindAndPostTasks final : public PostingThread::Action {
+   public:
+    ContinuouslyBindAndPostTasks(MessageLoopPerfTest* outer) : outer_(outer) {
+      DCHECK(outer_);
+    }
+    ~ContinuouslyBindAndPostTasks() override = default;
+
+   private:
+    void Run() override {
+      while (!outer_->stop_posting_threads_.IsSet()) {
+        outer_->message_loop_task_runner_->PostTask(
+            FROM_HERE,
+            BindOnce([](size_t* num_tasks_run,
+                        const std::string&) { ++*num_tasks_run; },
+                     &outer_->num_tasks_run_, task_name_));
+        subtle::NoBarrier_AtomicIncrement(&outer_->num_tasks_posted_, 1);
+      }
+    }
+
+    MessageLoopPerfTest* const outer_;
+    const std::string task_name_ = "bound task";
+
+    DISALLOW_COPY_AND_ASSIGN(ContinuouslyBindAndPostTasks);
+  };
+
   void SetUp() override {
     // This check is here because we can't ASSERT_TRUE in the constructor.
     ASSERT_TRUE(message_loop_task_runner_);
@@ -202,6 +234,20 @@ class MessageLoopPerfTest : public ::testing::TestWithParam<int> {
     tasks_posted_duration_ = TimeTicks::Now() - post_task_start;
   }
 
+  void PrintTaskRates(const std::string& posting_measurement,
+                      const std::string& running_measurement) {
+    perf_test::PrintResult(posting_measurement, "",
+                           PostingThreadCountToString(GetParam()),
+                           tasks_posted_duration().InMicroseconds() /
+                               static_cast<double>(num_tasks_posted()),
+                           "us/task", true);
+    perf_test::PrintResult(running_measurement, "",
+                           PostingThreadCountToString(GetParam()),
+                           tasks_run_duration().InMicroseconds() /
+                               static_cast<double>(num_tasks_run()),
+                           "us/task", true);
+  }
+
   size_t num_tasks_posted() const {
     return subtle::NoBarrier_Load(&num_tasks_posted_);
   }
@@ -235,16 +281,55 @@ TEST_P(MessageLoopPerfTest, PostTaskRate) {
   // Measures the average rate of posting tasks from different threads and the
   // average rate that the message loop is running those tasks.
   RunTest<ContinuouslyPostTasks>(GetParam(), TimeDelta::FromSeconds(3));
-  perf_test::PrintResult("task_posting", "",
-                         PostingThreadCountToString(GetParam()),
-                         tasks_posted_duration().InMicroseconds() /
-                             static_cast<double>(num_tasks_posted()),
-                         "us/task", true);
-  perf_test::PrintResult("task_running", "",
-                         PostingThreadCountToString(GetParam()),
-                         tasks_run_duration().InMicroseconds() /
-                             static_cast<double>(num_tasks_run()),
-                         "us/task", true);
+  PrintTaskRates("task_posting", "task_running");
+}
+
+TEST_P(MessageLoopPerfTest, BindAndPostTaskRate) {
+  // Same as PostTaskRate, including the cost of creating and destroying a
+  // callback for every task.
+  RunTest<ContinuouslyBindAndPostTasks>(GetParam(),
+                                        TimeDelta::FromSeconds(3));
+  PrintTaskRates("bound_task_posting", "bound_task_running");
+}
+
+TEST(CallbackPerfTest, BindAndDestroyRate) {
+  // Measures the cost of the callbacks alone, created and destroyed on the
+  // same thread. Like in BindAndPostTaskRate, the std::string keeps the
+  // BindStates out of the callbacks, on the BindStateAllocator.
+  constexpr int kNumCallbacks = 1000000;
+  const std::string name = "callback";
+  size_t num_callbacks_run = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumCallbacks; ++i) {
+    OnceClosure callback =
+        BindOnce([](size_t* num_run, const std::string&) { ++*num_run; },
+                 &num_callbacks_run, name);
+    std::move(callback).Run();
+  }
+  perf_test::PrintResult("callback_bind_destroy", "", "",
+                         (TimeTicks::Now() - start).InNanoseconds() /
+                             static_cast<double>(kNumCallbacks),
+                         "ns/callback", true);
+  EXPECT_EQ(static_cast<size_t>(kNumCallbacks), num_callbacks_run);
+}
+
+TEST(CallbackPerfTest, InlineBindAndDestroyRate) {
+  // Same as BindAndDestroyRate, with BindStates small enough to be stored
+  // inside the callbacks.
+  constexpr int kNumCallbacks = 1000000;
+  size_t num_callbacks_run = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumCallbacks; ++i) {
+    OnceClosure callback =
+        BindOnce([](size_t* num_run, int) { ++*num_run; }, &num_callbacks_run,
+                 i);
+    std::move(callback).Run();
+  }
+  perf_test::PrintResult("inline_callback_bind_destroy", "", "",
+                         (TimeTicks::Now() - start).InNanoseconds() /
+                             static_cast<double>(kNumCallbacks),
+                         "ns/callback", true);
+  EXPECT_EQ(static_cast<size_t>(kNumCallbacks), num_callbacks_run);
 }
 
 INSTANTIATE_TEST_CASE_P(,
@@ -0,0 +1,460 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/message_loop/message_pump_epoll.h"
+
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "brick/auto_reset.h"
+#include "brick/logging.h"
+#include "brick/posix/eintr_wrapper.h"
+#include "brick/trace_event/trace_event.h"
+
+namespace base {
+
+namespace {
+
+// Initial size of the epoll_wait() batch. It doubles every time a batch comes
+// back full, up to kMaxEvents.
+constexpr size_t kInitialMaxEvents = 16;
+constexpr size_t kMaxEvents = 1024;
+
+// Batch size used by nested loops, which can't use the outer loop's buffer.
+constexpr int kNestedMaxEvents = 16;
+
+}  // namespace
+
+MessagePumpEpoll::FdWatchController::FdWatchController(
+    const Location& from_here)
+    : FdWatchControllerInterface(from_here) {}
+
+MessagePumpEpoll::FdWatchController::~FdWatchController() {
+  if (pump_) {
+    StopWatchingFileDescriptor();
+  }
+  if (was_destroyed_) {
+    DCHECK(!*was_destroyed_);
+    *was_destroyed_ = true;
+  }
+}
+
+bool MessagePumpEpoll::FdWatchController::StopWatchingFileDescriptor() {
+  if (!pump_)
+    return true;
+
+  bool result = pump_->DetachController(this);
+  fd_ = -1;
+  mode_ = 0;
+  persistent_ = false;
+  armed_ = false;
+  pump_ = nullptr;
+  watcher_ = nullptr;
+  return result;
+}
+
+void MessagePumpEpoll::FdWatchController::OnFileCanReadWithoutBlocking(
+    int fd) {
+  // Since OnFileCanWriteWithoutBlocking() gets called first, it can stop
+  // watching the file descriptor.
+  if (!watcher_)
+    return;
+  watcher_->OnFileCanReadWithoutBlocking(fd);
+}
+
+void MessagePumpEpoll::FdWatchController::OnFileCanWriteWithoutBlocking(
+    int fd) {
+  DCHECK(watcher_);
+  watcher_->OnFileCanWriteWithoutBlocking(fd);
+}
+
+MessagePumpEpoll::EpollEntry::EpollEntry() = default;
+
+MessagePumpEpoll::EpollEntry::~EpollEntry() = default;
+
+MessagePumpEpoll::MessagePumpEpoll()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      wakeup_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      timer_fd_(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      events_(kInitialMaxEvents) {
+  PCHECK(epoll_fd_.is_valid()) << "epoll_create1";
+  PCHECK(wakeup_fd_.is_valid()) << "eventfd";
+  PCHECK(timer_fd_.is_valid()) << "timerfd_create";
+
+  // Both are edge-triggered so that they never need to be drained: every
+  // write() to the eventfd and every expiration of the timerfd is reported as
+  // a new edge. ScheduleWork() writes at most once per wakeup, so the eventfd
+  // counter can't realistically overflow, and timerfd_settime() resets the
+  // timerfd's expiration count.
+  epoll_event event = {};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = wakeup_fd_.get();
+  PCHECK(epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, wakeup_fd_.get(), &event) ==
+         0)
+      << "epoll_ctl";
+  event.data.fd = timer_fd_.get();
+  PCHECK(epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, timer_fd_.get(), &event) ==
+         0)
+      << "epoll_ctl";
+}
+
+MessagePumpEpoll::~MessagePumpEpoll() {
+  DCHECK(!dispatch_frame_);
+  // Unlike MessagePumpLibevent, tolerate controllers that outlive the pump.
+  for (auto& fd_and_entry : entries_) {
+    for (FdWatchController* controller : fd_and_entry.second.controllers) {
+      controller->fd_ = -1;
+      controller->armed_ = false;
+      controller->pump_ = nullptr;
+      controller->watcher_ = nullptr;
+    }
+  }
+}
+
+bool MessagePumpEpoll::WatchFileDescriptor(int fd,
+                                           bool persistent,
+                                           int mode,
+                                           FdWatchController* controller,
+                                           FdWatcher* delegate) {
+  DCHECK_GE(fd, 0);
+  DCHECK(controller);
+  DCHECK(delegate);
+  DCHECK(mode == WATCH_READ || mode == WATCH_WRITE || mode == WATCH_READ_WRITE);
+  // WatchFileDescriptor should be called on the pump thread. It is not
+  // threadsafe, and your watcher may never be registered.
+  DCHECK(watch_file_descriptor_caller_checker_.CalledOnValidThread());
+
+  if (controller->pump_) {
+    // It's illegal to use this function to listen on 2 separate fds with the
+    // same |controller|.
+    if (controller->fd_ != fd) {
+      NOTREACHED() << "FDs don't match" << controller->fd_ << "!=" << fd;
+      return false;
+    }
+    DCHECK_EQ(this, controller->pump_);
+
+    // Combine old/new event masks.
+    mode |= controller->mode_;
+    persistent |= controller->persistent_;
+  } else {
+    entries_[fd].controllers.push_back(controller);
+  }
+
+  controller->fd_ = fd;
+  controller->mode_ = mode;
+  controller->persistent_ = persistent;
+  controller->armed_ = true;
+  controller->pump_ = this;
+  controller->watcher_ = delegate;
+
+  if (!UpdateRegistration(fd)) {
+    controller->StopWatchingFileDescriptor();
+    return false;
+  }
+  return true;
+}
+
+// Reentrant!
+void MessagePumpEpoll::Run(Delegate* delegate) {
+  AutoReset<bool> auto_reset_keep_running(&keep_running_, true);
+  AutoReset<bool> auto_reset_in_run(&in_run_, true);
+
+  for (;;) {
+    bool did_work = delegate->DoWork();
+    if (!keep_running_)
+      break;
+
+    did_work |= WaitForEvents(0);
+    if (!keep_running_)
+      break;
+
+    did_work |= delegate->DoDelayedWork(&delayed_work_time_);
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    did_work = delegate->DoIdleWork();
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    if (delayed_work_time_.is_null()) {
+      WaitForEvents(-1);
+    } else {
+      TimeDelta delay = delayed_work_time_ - TimeTicks::Now();
+      if (delay > TimeDelta()) {
+        if (ArmTimer()) {
+          WaitForEvents(-1);
+        } else {
+          WaitForEvents(static_cast<int>(
+              std::min<int64_t>(delay.InMillisecondsRoundedUp(),
+                                std::numeric_limits<int>::max())));
+        }
+      } else {
+        // It looks like delayed_work_time_ indicates a time in the past, so we
+        // need to call DoDelayedWork now.
+        delayed_work_time_ = TimeTicks();
+      }
+    }
+
+    if (!keep_running_)
+      break;
+  }
+}
+
+void MessagePumpEpoll::Quit() {
+  DCHECK(in_run_) << "Quit was called outside of Run!";
+  // Tell Run that it should break out of its loop.
+  keep_running_ = false;
+  ScheduleWork();
+}
+
+void MessagePumpEpoll::ScheduleWork() {
+  // A wakeup is already on its way; the pump will see this work when it
+  // handles it.
+  if (wakeup_pending_.exchange(true, std::memory_order_acq_rel))
+    return;
+
+  const uint64_t value = 1;
+  ssize_t nwrite = HANDLE_EINTR(write(wakeup_fd_.get(), &value, sizeof(value)));
+  DPCHECK(nwrite == sizeof(value) || errno == EAGAIN) << "write";
+}
+
+void MessagePumpEpoll::ScheduleDelayedWork(const TimeTicks& delayed_work_time) {
+  // We know that we can't be blocked right now since this method can only be
+  // called on the same thread as Run, so we only need to update our record of
+  // how long to sleep when we do sleep. The timerfd is programmed lazily by
+  // ArmTimer().
+  delayed_work_time_ = delayed_work_time;
+}
+
+bool MessagePumpEpoll::WaitForEvents(int timeout_ms) {
+  // A nested loop run from a watcher must not clobber the events that the
+  // outer loop hasn't dispatched yet.
+  epoll_event nested_events[kNestedMaxEvents];
+  const bool is_outermost = !dispatch_frame_;
+  epoll_event* const events = is_outermost ? events_.data() : nested_events;
+  const int max_events =
+      is_outermost ? static_cast<int>(events_.size()) : kNestedMaxEvents;
+
+  int num_events =
+      HANDLE_EINTR(epoll_wait(epoll_fd_.get(), events, max_events, timeout_ms));
+  if (num_events < 0) {
+    DPLOG(ERROR) << "epoll_wait";
+    return false;
+  }
+
+  // Handle the pump's own descriptors first: a watcher that runs a nested
+  // loop must not wait for a wakeup or an expiration that was already
+  // harvested here.
+  bool did_work = false;
+  for (int i = 0; i < num_events; ++i) {
+    const int fd = events[i].data.fd;
+    if (fd == wakeup_fd_.get()) {
+      // Work scheduled from now on needs a new wakeup. This synchronizes with
+      // the ScheduleWork() calls that skipped their write().
+      wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+      did_work = true;
+    } else if (fd == timer_fd_.get()) {
+      armed_delayed_work_time_ = TimeTicks();
+    } else {
+      continue;
+    }
+    events[i].data.fd = -1;
+  }
+
+  {
+    DispatchFrame frame = {events, num_events, 0, dispatch_frame_};
+    AutoReset<DispatchFrame*> auto_reset_dispatch_frame(&dispatch_frame_,
+                                                        &frame);
+    while (frame.next_event < frame.num_events) {
+      const epoll_event& event = frame.events[frame.next_event++];
+      if (event.data.fd < 0)
+        continue;
+      OnFdReady(event.data.fd, event.events);
+      did_work = true;
+    }
+  }
+
+  // More events may be ready than fit in the buffer. Grow it so that the next
+  // call harvests them all at once.
+  if (is_outermost && static_cast<size_t>(num_events) == events_.size() &&
+      events_.size() < kMaxEvents) {
+    events_.resize(events_.size() * 2);
+  }
+  return did_work;
+}
+
+void MessagePumpEpoll::OnFdReady(int fd, uint32_t events) {
+  auto it = entries_.find(fd);
+  if (it == entries_.end())
+    return;
+
+  // Like libevent, report errors and hangups to every watcher so that they
+  // notice them on their next read or write.
+  int ready_mode = 0;
+  if (events & (EPOLLERR | EPOLLHUP)) {
+    ready_mode = WATCH_READ_WRITE;
+  } else {
+    if (events & EPOLLIN)
+      ready_mode |= WATCH_READ;
+    if (events & EPOLLOUT)
+      ready_mode |= WATCH_WRITE;
+  }
+  for (FdWatchController* controller : it->second.controllers) {
+    controller->pending_mode_ =
+        controller->armed_ ? controller->mode_ & ready_mode : 0;
+  }
+
+  for (;;) {
+    // Watchers can add, stop and delete controllers for |fd|, so look them up
+    // again after every callback.
+    it = entries_.find(fd);
+    if (it == entries_.end())
+      return;
+    const auto& controllers = it->second.controllers;
+    auto next = std::find_if(controllers.begin(), controllers.end(),
+                             [](const FdWatchController* controller) {
+                               return controller->pending_mode_ != 0;
+                             });
+    if (next == controllers.end())
+      return;
+
+    FdWatchController* controller = *next;
+    const int mode = controller->pending_mode_;
+    controller->pending_mode_ = 0;
+
+    TRACE_EVENT2("toplevel", "MessagePumpEpoll::OnFdReady", "src_file",
+                 controller->created_from_location().file_name(), "src_func",
+                 controller->created_from_location().function_name());
+    TRACE_HEAP_PROFILER_API_SCOPED_TASK_EXECUTION heap_profiler_scope(
+        controller->created_from_location().file_name());
+
+    if (!controller->persistent_) {
+      // Like libevent, disarm a non-persistent watch before running it.
+      controller->armed_ = false;
+      UpdateRegistration(fd);
+    }
+
+    if (mode == WATCH_READ_WRITE) {
+      // Both callbacks will be called. It is necessary to check that
+      // |controller| is not destroyed.
+      bool controller_was_destroyed = false;
+      controller->was_destroyed_ = &controller_was_destroyed;
+      controller->OnFileCanWriteWithoutBlocking(fd);
+      if (!controller_was_destroyed)
+        controller->OnFileCanReadWithoutBlocking(fd);
+      if (!controller_was_destroyed)
+        controller->was_destroyed_ = nullptr;
+    } else if (mode & WATCH_WRITE) {
+      controller->OnFileCanWriteWithoutBlocking(fd);
+    } else {
+      controller->OnFileCanReadWithoutBlocking(fd);
+    }
+  }
+}
+
+bool MessagePumpEpoll::DetachController(FdWatchController* controller) {
+  auto it = entries_.find(controller->fd_);
+  DCHECK(it != entries_.end());
+  auto& controllers = it->second.controllers;
+  controllers.erase(
+      std::find(controllers.begin(), controllers.end(), controller));
+  controller->pending_mode_ = 0;
+  return UpdateRegistration(controller->fd_);
+}
+
+bool MessagePumpEpoll::UpdateRegistration(int fd) {
+  auto it = entries_.find(fd);
+  DCHECK(it != entries_.end());
+  EpollEntry& entry = it->second;
+
+  uint32_t events = 0;
+  for (const FdWatchController* controller : entry.controllers) {
+    if (!controller->armed_)
+      continue;
+    if (controller->mode_ & WATCH_READ)
+      events |= EPOLLIN;
+    if (controller->mode_ & WATCH_WRITE)
+      events |= EPOLLOUT;
+  }
+
+  const uint32_t registered_events = entry.registered_events;
+  if (!events) {
+    // Drop events for |fd| that were harvested but not dispatched yet, or
+    // they could reach a watcher that starts watching a recycled descriptor.
+    for (DispatchFrame* frame = dispatch_frame_; frame; frame = frame->outer) {
+      for (int i = frame->next_event; i < frame->num_events; ++i) {
+        if (frame->events[i].data.fd == fd)
+          frame->events[i].data.fd = -1;
+      }
+    }
+    if (entry.controllers.empty())
+      entries_.erase(it);
+    else
+      entry.registered_events = 0;
+
+    if (registered_events &&
+        epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, fd, nullptr) < 0) {
+      DPLOG(ERROR) << "epoll_ctl(EPOLL_CTL_DEL, fd=" << fd << ")";
+      return false;
+    }
+    return true;
+  }
+
+  if (events == registered_events)
+    return true;
+
+  epoll_event event = {};
+  event.events = events;
+  event.data.fd = fd;
+  int rv;
+  if (registered_events) {
+    rv = epoll_ctl(epoll_fd_.get(), EPOLL_CTL_MOD, fd, &event);
+    // The descriptor was closed, which removed it from the epoll set, and its
+    // number was reused.
+    if (rv < 0 && errno == ENOENT)
+      rv = epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, fd, &event);
+  } else {
+    rv = epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, fd, &event);
+  }
+  if (rv < 0) {
+    DPLOG(ERROR) << "epoll_ctl(fd=" << fd << ")";
+    return false;
+  }
+  entry.registered_events = events;
+  return true;
+}
+
+bool MessagePumpEpoll::ArmTimer() {
+  if (delayed_work_time_ == armed_delayed_work_time_)
+    return true;
+  // Never expires.
+  if (delayed_work_time_.is_max())
+    return true;
+
+  // TimeTicks are CLOCK_MONOTONIC on Linux, so the deadline can be handed to
+  // the timerfd as is.
+  itimerspec spec = {};
+  spec.it_value = (delayed_work_time_ - TimeTicks()).ToTimeSpec();
+  if (timerfd_settime(timer_fd_.get(), TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+    DPLOG(ERROR) << "timerfd_settime";
+    armed_delayed_work_time_ = TimeTicks();
+    return false;
+  }
+  armed_delayed_work_time_ = delayed_work_time_;
+  return true;
+}
+
+}  // namespace base
@@ -0,0 +1,174 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
+#define BRICK_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "brick/base_export.h"
+#include "brick/files/scoped_file.h"
+#include "brick/macros.h"
+#include "brick/message_loop/message_pump.h"
+#include "brick/message_loop/watchable_io_message_pump_posix.h"
+#include "brick/threading/thread_checker.h"
+#include "brick/time/time.h"
+
+namespace base {
+
+// MessagePump for I/O on Linux that talks to epoll directly rather than going
+// through libevent:
+//  - ScheduleWork() signals an eventfd, and only does so once per wakeup no
+//    matter how many threads post work in the meantime.
+//  - Delayed work is driven by a timerfd with an absolute CLOCK_MONOTONIC
+//    deadline, which is only reprogrammed when the deadline changes.
+//  - Ready file descriptors are harvested in batches by a single
+//    epoll_wait(); the batch grows when it comes back full so that busy pumps
+//    don't need several calls per wakeup.
+//
+// File descriptor watches keep the level-triggered semantics of
+// MessagePumpLibevent; only the pump's own eventfd and timerfd are
+// edge-triggered, which saves draining them on every wakeup.
+class BRICK_EXPORT MessagePumpEpoll : public MessagePump,
+                                     public WatchableIOMessagePumpPosix {
+ public:
+  class FdWatchController : public FdWatchControllerInterface {
+   public:
+    explicit FdWatchController(const Location& from_here);
+
+    // Implicitly calls StopWatchingFileDescriptor.
+    ~FdWatchController() override;
+
+    // FdWatchControllerInterface:
+    bool StopWatchingFileDescriptor() override;
+
+   private:
+    friend class MessagePumpEpoll;
+    friend class MessagePumpEpollTest;
+
+    void OnFileCanReadWithoutBlocking(int fd);
+    void OnFileCanWriteWithoutBlocking(int fd);
+
+    // The watched file descriptor, or -1 if not attached to a pump.
+    int fd_ = -1;
+    // Combination of WATCH_READ and WATCH_WRITE.
+    int mode_ = 0;
+    bool persistent_ = false;
+    // False once a non-persistent watch has fired. The controller stays
+    // attached so that WatchFileDescriptor() can re-arm it.
+    bool armed_ = false;
+    // Subset of |mode_| that is ready but hasn't been dispatched yet.
+    int pending_mode_ = 0;
+
+    MessagePumpEpoll* pump_ = nullptr;
+    FdWatcher* watcher_ = nullptr;
+    // If this pointer is non-NULL, the pointee is set to true in the
+    // destructor.
+    bool* was_destroyed_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(FdWatchController);
+  };
+
+  MessagePumpEpoll();
+  ~MessagePumpEpoll() override;
+
+  bool WatchFileDescriptor(int fd,
+                           bool persistent,
+                           int mode,
+                           FdWatchController* controller,
+                           FdWatcher* delegate);
+
+  // MessagePump methods:
+  void Run(Delegate* delegate) override;
+  void Quit() override;
+  void ScheduleWork() override;
+  void ScheduleDelayedWork(const TimeTicks& delayed_work_time) override;
+
+ private:
+  friend class MessagePumpEpollTest;
+
+  // Several controllers may watch the same file descriptor, but epoll only
+  // allows one registration per descriptor, so they share an entry.
+  struct EpollEntry {
+    EpollEntry();
+    ~EpollEntry();
+
+    // Controllers attached to the descriptor, in registration order.
+    std::vector<FdWatchController*> controllers;
+    // The events the descriptor is registered for in the epoll set, i.e. the
+    // union of what the armed controllers watch.
+    uint32_t registered_events = 0;
+  };
+
+  // Events harvested by one epoll_wait() that haven't been dispatched yet.
+  // Frames nest when a watcher runs a nested loop.
+  struct DispatchFrame {
+    epoll_event* events;
+    int num_events;
+    int next_event;
+    DispatchFrame* outer;
+  };
+
+  // Waits for at most |timeout_ms| (-1 for no limit) and dispatches every
+  // event that is ready. Returns true if a watcher ran or work was scheduled.
+  bool WaitForEvents(int timeout_ms);
+
+  // Invokes the watchers of |fd| that are interested in |events|.
+  void OnFdReady(int fd, uint32_t events);
+
+  // Detaches |controller| from its descriptor and updates the epoll set.
+  // Returns false if epoll_ctl() failed.
+  bool DetachController(FdWatchController* controller);
+
+  // Brings the epoll registration of |fd| in line with the armed controllers
+  // of its entry, and removes the entry once no controller is attached.
+  bool UpdateRegistration(int fd);
+
+  // Programs |timer_fd_| for |delayed_work_time_| unless it already is.
+  // Returns false if the timer couldn't be armed.
+  bool ArmTimer();
+
+  // This flag is set to false when Run should return.
+  bool keep_running_ = true;
+
+  // This flag is set when inside Run.
+  bool in_run_ = false;
+
+  // The time at which we should call DoDelayedWork.
+  TimeTicks delayed_work_time_;
+
+  // The deadline |timer_fd_| is currently armed for, or null if disarmed.
+  TimeTicks armed_delayed_work_time_;
+
+  ScopedFD epoll_fd_;
+  // ScheduleWork() writes to it.
+  ScopedFD wakeup_fd_;
+  // Expires at |armed_delayed_work_time_|.
+  ScopedFD timer_fd_;
+
+  // Set when |wakeup_fd_| has been signaled but the pump hasn't woken up for
+  // it yet. Lets ScheduleWork() skip the write() when a wakeup is pending.
+  std::atomic<bool> wakeup_pending_{false};
+
+  // Keyed by file descriptor.
+  std::map<int, EpollEntry> entries_;
+
+  // Buffer for the outermost epoll_wait(). Grows when it comes back full.
+  std::vector<epoll_event> events_;
+
+  // Innermost dispatch in progress, if any.
+  DispatchFrame* dispatch_frame_ = nullptr;
+
+  ThreadChecker watch_file_descriptor_caller_checker_;
+  DISALLOW_COPY_AND_ASSIGN(MessagePumpEpoll);
+};
+
+}  // namespace base
+
+#endif  // BRICK_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
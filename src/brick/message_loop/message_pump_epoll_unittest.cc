@@ -0,0 +1,335 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/message_loop/message_pump_epoll.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <utility>
+
+#include "brick/bind.h"
+#include "brick/bind_helpers.h"
+#include "brick/files/file_util.h"
+#include "brick/memory/ptr_util.h"
+#include "brick/message_loop/message_loop.h"
+#include "brick/posix/eintr_wrapper.h"
+#include "brick/run_loop.h"
+#include "brick/test/gtest_util.h"
+#include "brick/threading/thread_task_runner_handle.h"
+#include "brick/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+class MessagePumpEpollTest : public testing::Test {
+ protected:
+  MessagePumpEpollTest() = default;
+  ~MessagePumpEpollTest() override = default;
+
+  void SetUp() override {
+    int ret = pipe(pipefds_);
+    ASSERT_EQ(0, ret);
+  }
+
+  void TearDown() override {
+    if (IGNORE_EINTR(close(pipefds_[0])) < 0)
+      PLOG(ERROR) << "close";
+    if (IGNORE_EINTR(close(pipefds_[1])) < 0)
+      PLOG(ERROR) << "close";
+  }
+
+  void OnFdReady(MessagePumpEpoll* pump,
+                 MessagePumpEpoll::FdWatchController* controller) {
+    pump->OnFdReady(controller->fd_, EPOLLIN | EPOLLOUT);
+  }
+
+  int pipefds_[2];
+};
+
+namespace {
+
+TEST_F(MessagePumpEpollTest, QuitOutsideOfRun) {
+  std::unique_ptr<MessagePumpEpoll> pump(new MessagePumpEpoll);
+  ASSERT_DCHECK_DEATH(pump->Quit());
+}
+
+class BaseWatcher : public MessagePumpEpoll::FdWatcher {
+ public:
+  explicit BaseWatcher(MessagePumpEpoll::FdWatchController* controller)
+      : controller_(controller) {
+    DCHECK(controller_);
+  }
+  ~BaseWatcher() override = default;
+
+  // base:MessagePumpEpoll::FdWatcher interface
+  void OnFileCanReadWithoutBlocking(int /* fd */) override { NOTREACHED(); }
+
+  void OnFileCanWriteWithoutBlocking(int /* fd */) override { NOTREACHED(); }
+
+ protected:
+  MessagePumpEpoll::FdWatchController* controller_;
+};
+
+class DeleteWatcher : public BaseWatcher {
+ public:
+  explicit DeleteWatcher(MessagePumpEpoll::FdWatchController* controller)
+      : BaseWatcher(controller) {}
+
+  ~DeleteWatcher() override { DCHECK(!controller_); }
+
+  void OnFileCanWriteWithoutBlocking(int /* fd */) override {
+    DCHECK(controller_);
+    delete controller_;
+    controller_ = nullptr;
+  }
+};
+
+TEST_F(MessagePumpEpollTest, DeleteWatcher) {
+  std::unique_ptr<MessagePumpEpoll> pump(new MessagePumpEpoll);
+  MessagePumpEpoll::FdWatchController* watcher =
+      new MessagePumpEpoll::FdWatchController(FROM_HERE);
+  DeleteWatcher delegate(watcher);
+  pump->WatchFileDescriptor(pipefds_[1], false,
+                            MessagePumpEpoll::WATCH_READ_WRITE, watcher,
+                            &delegate);
+
+  // Spoof an epoll notification.
+  OnFdReady(pump.get(), watcher);
+}
+
+class StopWatcher : public BaseWatcher {
+ public:
+  explicit StopWatcher(MessagePumpEpoll::FdWatchController* controller)
+      : BaseWatcher(controller) {}
+
+  ~StopWatcher() override = default;
+
+  void OnFileCanWriteWithoutBlocking(int /* fd */) override {
+    controller_->StopWatchingFileDescriptor();
+  }
+};
+
+TEST_F(MessagePumpEpollTest, StopWatcher) {
+  std::unique_ptr<MessagePumpEpoll> pump(new MessagePumpEpoll);
+  MessagePumpEpoll::FdWatchController watcher(FROM_HERE);
+  StopWatcher delegate(&watcher);
+  pump->WatchFileDescriptor(pipefds_[1], false,
+                            MessagePumpEpoll::WATCH_READ_WRITE, &watcher,
+                            &delegate);
+
+  // Spoof an epoll notification.
+  OnFdReady(pump.get(), &watcher);
+}
+
+void QuitMessageLoopAndStart(const Closure& quit_closure) {
+  quit_closure.Run();
+
+  RunLoop runloop(RunLoop::Type::kNestableTasksAllowed);
+  ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE, runloop.QuitClosure());
+  runloop.Run();
+}
+
+class NestedPumpWatcher : public MessagePumpEpoll::FdWatcher {
+ public:
+  NestedPumpWatcher() = default;
+  ~NestedPumpWatcher() override = default;
+
+  void OnFileCanReadWithoutBlocking(int /* fd */) override {
+    RunLoop runloop;
+    ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, BindOnce(&QuitMessageLoopAndStart, runloop.QuitClosure()));
+    runloop.Run();
+  }
+
+  void OnFileCanWriteWithoutBlocking(int /* fd */) override {}
+};
+
+TEST_F(MessagePumpEpollTest, NestedPumpWatcher) {
+  MessagePumpEpoll* pump = new MessagePumpEpoll;  // owned by |loop|.
+  MessageLoop loop(WrapUnique(pump));
+  MessagePumpEpoll::FdWatchController watcher(FROM_HERE);
+  NestedPumpWatcher delegate;
+  pump->WatchFileDescriptor(pipefds_[1], false, MessagePumpEpoll::WATCH_READ,
+                            &watcher, &delegate);
+
+  // Spoof an epoll notification.
+  OnFdReady(pump, &watcher);
+}
+
+// Reads one byte when the pipe becomes readable, then runs the quit closure.
+class ReadAndQuitWatcher : public MessagePumpEpoll::FdWatcher {
+ public:
+  ReadAndQuitWatcher() = default;
+  ~ReadAndQuitWatcher() override = default;
+
+  void OnFileCanReadWithoutBlocking(int fd) override {
+    char buf;
+    ASSERT_EQ(1, HANDLE_EINTR(read(fd, &buf, 1)));
+    ++read_count_;
+    if (quit_closure_)
+      std::move(quit_closure_).Run();
+  }
+
+  void OnFileCanWriteWithoutBlocking(int /* fd */) override { NOTREACHED(); }
+
+  void set_quit_closure(OnceClosure quit_closure) {
+    quit_closure_ = std::move(quit_closure);
+  }
+  int read_count() const { return read_count_; }
+
+ private:
+  OnceClosure quit_closure_;
+  int read_count_ = 0;
+};
+
+TEST_F(MessagePumpEpollTest, NonPersistentWatchFiresOnce) {
+  MessagePumpEpoll* pump = new MessagePumpEpoll;  // owned by |loop|.
+  MessageLoop loop(WrapUnique(pump));
+  const char buf[2] = {0, 0};
+  ASSERT_TRUE(WriteFileDescriptor(pipefds_[1], buf, 2));
+
+  RunLoop run_loop;
+  MessagePumpEpoll::FdWatchController controller(FROM_HERE);
+  ReadAndQuitWatcher delegate;
+  delegate.set_quit_closure(run_loop.QuitClosure());
+  ASSERT_TRUE(pump->WatchFileDescriptor(
+      pipefds_[0], false, MessagePumpEpoll::WATCH_READ, &controller, &delegate));
+  run_loop.Run();
+
+  // The pipe is still readable, but the watch is disarmed.
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, delegate.read_count());
+
+  // Until it is re-armed.
+  RunLoop second_run_loop;
+  delegate.set_quit_closure(second_run_loop.QuitClosure());
+  ASSERT_TRUE(pump->WatchFileDescriptor(
+      pipefds_[0], false, MessagePumpEpoll::WATCH_READ, &controller, &delegate));
+  second_run_loop.Run();
+  EXPECT_EQ(2, delegate.read_count());
+}
+
+TEST_F(MessagePumpEpollTest, PersistentWatchKeepsFiring) {
+  MessagePumpEpoll* pump = new MessagePumpEpoll;  // owned by |loop|.
+  MessageLoop loop(WrapUnique(pump));
+  MessagePumpEpoll::FdWatchController controller(FROM_HERE);
+  ReadAndQuitWatcher delegate;
+  ASSERT_TRUE(pump->WatchFileDescriptor(
+      pipefds_[0], true, MessagePumpEpoll::WATCH_READ, &controller, &delegate));
+
+  for (int i = 1; i <= 3; ++i) {
+    RunLoop run_loop;
+    delegate.set_quit_closure(run_loop.QuitClosure());
+    const char buf = 0;
+    ASSERT_TRUE(WriteFileDescriptor(pipefds_[1], &buf, 1));
+    run_loop.Run();
+    EXPECT_EQ(i, delegate.read_count());
+  }
+}
+
+class CountingWatcher : public MessagePumpEpoll::FdWatcher {
+ public:
+  CountingWatcher() = default;
+  ~CountingWatcher() override = default;
+
+  void OnFileCanReadWithoutBlocking(int /* fd */) override { ++read_count_; }
+  void OnFileCanWriteWithoutBlocking(int /* fd */) override {
+    ++write_count_;
+  }
+
+  int read_count() const { return read_count_; }
+  int write_count() const { return write_count_; }
+
+ private:
+  int read_count_ = 0;
+  int write_count_ = 0;
+};
+
+// Separate controllers for reading and writing can watch the same descriptor,
+// which epoll only allows to be registered once.
+TEST_F(MessagePumpEpollTest, TwoControllersOnSameFd) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+  ScopedFD socket0(sockets[0]);
+  ScopedFD socket1(sockets[1]);
+
+  MessagePumpEpoll* pump = new MessagePumpEpoll;  // owned by |loop|.
+  MessageLoop loop(WrapUnique(pump));
+
+  MessagePumpEpoll::FdWatchController read_controller(FROM_HERE);
+  MessagePumpEpoll::FdWatchController write_controller(FROM_HERE);
+  CountingWatcher read_delegate;
+  CountingWatcher write_delegate;
+  ASSERT_TRUE(pump->WatchFileDescriptor(socket0.get(), false,
+                                        MessagePumpEpoll::WATCH_READ,
+                                        &read_controller, &read_delegate));
+  ASSERT_TRUE(pump->WatchFileDescriptor(socket0.get(), false,
+                                        MessagePumpEpoll::WATCH_WRITE,
+                                        &write_controller, &write_delegate));
+
+  // The socket is writable but not readable.
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(0, read_delegate.read_count());
+  EXPECT_EQ(1, write_delegate.write_count());
+
+  const char buf = 0;
+  ASSERT_TRUE(WriteFileDescriptor(socket1.get(), &buf, 1));
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, read_delegate.read_count());
+  EXPECT_EQ(0, read_delegate.write_count());
+  EXPECT_EQ(1, write_delegate.write_count());
+
+  // Stopping one controller leaves the other one registered.
+  EXPECT_TRUE(read_controller.StopWatchingFileDescriptor());
+  ASSERT_TRUE(pump->WatchFileDescriptor(socket0.get(), false,
+                                        MessagePumpEpoll::WATCH_WRITE,
+                                        &write_controller, &write_delegate));
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, read_delegate.read_count());
+  EXPECT_EQ(2, write_delegate.write_count());
+}
+
+TEST_F(MessagePumpEpollTest, ControllerOutlivesPump) {
+  MessagePumpEpoll::FdWatchController controller(FROM_HERE);
+  CountingWatcher delegate;
+  {
+    MessagePumpEpoll pump;
+    ASSERT_TRUE(pump.WatchFileDescriptor(pipefds_[0], true,
+                                         MessagePumpEpoll::WATCH_READ,
+                                         &controller, &delegate));
+  }
+  EXPECT_TRUE(controller.StopWatchingFileDescriptor());
+}
+
+// Tests that delayed work runs on time, which relies on the timerfd.
+TEST_F(MessagePumpEpollTest, DelayedWork) {
+  MessageLoop loop(std::make_unique<MessagePumpEpoll>());
+  const TimeDelta kDelay = TimeDelta::FromMilliseconds(20);
+
+  RunLoop run_loop;
+  const TimeTicks start = TimeTicks::Now();
+  TimeTicks run_time;
+  ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE,
+      BindOnce(
+          [](TimeTicks* run_time, OnceClosure quit_closure) {
+            *run_time = TimeTicks::Now();
+            std::move(quit_closure).Run();
+          },
+          &run_time, run_loop.QuitClosure()),
+      kDelay);
+  // A later task must not delay the first one.
+  ThreadTaskRunnerHandle::Get()->PostDelayedTask(FROM_HERE, DoNothing(),
+                                                 kDelay * 10);
+  run_loop.Run();
+
+  EXPECT_GE(run_time - start, kDelay);
+  EXPECT_LT(run_time - start, kDelay * 10);
+}
+
+}  // namespace
+
+}  // namespace base
@@ -8,6 +8,7 @@
 // This header is a forwarding header to coalesce the various platform specific
 // types representing MessagePumpForIO.
 
+#include "brick/message_loop/message_pump_buildflags.h"
 #include "build/build_config.h"
 
 #if defined(OS_WIN)
@@ -18,6 +19,8 @@
 #include "brick/message_loop/message_pump_default.h"
 #elif defined(OS_FUCHSIA)
 #include "brick/message_loop/message_pump_fuchsia.h"
+#elif BUILDFLAG(USE_EPOLL_MESSAGE_PUMP)
+#include "brick/message_loop/message_pump_epoll.h"
 #elif defined(OS_POSIX)
 #include "brick/message_loop/message_pump_libevent.h"
 #endif
@@ -33,6 +36,8 @@ using MessagePumpForIO = MessagePumpIOSForIO;
 using MessagePumpForIO = MessagePumpDefault;
 #elif defined(OS_FUCHSIA)
 using MessagePumpForIO = MessagePumpFuchsia;
+#elif BUILDFLAG(USE_EPOLL_MESSAGE_PUMP)
+using MessagePumpForIO = MessagePumpEpoll;
 #elif defined(OS_POSIX)
 using MessagePumpForIO = MessagePumpLibevent;
 #else
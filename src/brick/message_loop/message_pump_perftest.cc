@@ -10,6 +10,7 @@
 #include "brick/format_macros.h"
 #include "brick/memory/ptr_util.h"
 #include "brick/message_loop/message_loop.h"
+#include "brick/message_loop/message_pump_buildflags.h"
 #include "brick/single_thread_task_runner.h"
 #include "brick/strings/stringprintf.h"
 #include "brick/synchronization/condition_variable.h"
@@ -25,6 +26,19 @@
 #include "brick/android/java_handler_thread.h"
 #endif
 
+#if BUILDFLAG(USE_EPOLL_MESSAGE_PUMP)
+#include <unistd.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "brick/files/file_util.h"
+#include "brick/files/scoped_file.h"
+#include "brick/message_loop/message_pump_epoll.h"
+#include "brick/message_loop/message_pump_libevent.h"
+#include "brick/posix/eintr_wrapper.h"
+#endif
+
 namespace base {
 
 class ScheduleWorkTest : public testing::Test {
@@ -303,4 +317,169 @@ TEST_F(PostTaskTest, OneHundredTasksPerReload) {
   Run(1000, 100);
 }
 
+#if BUILDFLAG(USE_EPOLL_MESSAGE_PUMP)
+// Compares MessagePumpLibevent and MessagePumpEpoll on the work an I/O thread
+// typically does: waking up for tasks posted from another thread, and
+// dispatching file descriptor readiness.
+template <typename PumpType>
+class IOPumpPerfTest : public testing::Test {
+ public:
+  IOPumpPerfTest()
+      : done_(WaitableEvent::ResetPolicy::AUTOMATIC,
+              WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+ protected:
+  // Starts |thread| on a PumpType and returns the pump.
+  static PumpType* StartThread(Thread* thread) {
+    PumpType* pump = nullptr;
+    Thread::Options options;
+    options.message_pump_factory = BindRepeating(
+        [](PumpType** pump) -> std::unique_ptr<MessagePump> {
+          auto new_pump = std::make_unique<PumpType>();
+          *pump = new_pump.get();
+          return new_pump;
+        },
+        &pump);
+    CHECK(thread->StartWithOptions(options));
+    thread->WaitUntilThreadStarted();
+    return pump;
+  }
+
+  // Bounces a task between two threads. Every hop wakes up a pump that is
+  // blocked waiting for work.
+  void PingPong(const char* trace) {
+    Thread ping("ping");
+    Thread pong("pong");
+    StartThread(&ping);
+    StartThread(&pong);
+    ping_runner_ = ping.task_runner();
+    pong_runner_ = pong.task_runner();
+
+    const TimeTicks start = TimeTicks::Now();
+    ping_runner_->PostTask(FROM_HERE,
+                           BindOnce(&IOPumpPerfTest::Ping, Unretained(this),
+                                    kRoundTrips));
+    done_.Wait();
+    const TimeDelta elapsed = TimeTicks::Now() - start;
+
+    perf_test::PrintResult("wakeup", "_round_trip", trace,
+                           elapsed.InMicrosecondsF() / kRoundTrips,
+                           "us/round_trip", true);
+  }
+
+  // Makes |kNumPipes| watched pipes readable at once and waits for all of
+  // them to be dispatched.
+  void FdReadiness(const char* trace) {
+    Thread thread("watcher");
+    PumpType* pump = StartThread(&thread);
+
+    ScopedFD write_ends[kNumPipes];
+    thread.task_runner()->PostTask(
+        FROM_HERE, BindOnce(&IOPumpPerfTest::WatchPipes, Unretained(this),
+                            Unretained(pump), Unretained(write_ends)));
+    done_.Wait();
+
+    const TimeTicks start = TimeTicks::Now();
+    const char buf = 0;
+    for (int i = 0; i < kReadinessRounds; ++i) {
+      pending_reads_.store(kNumPipes, std::memory_order_relaxed);
+      for (ScopedFD& write_end : write_ends)
+        CHECK(WriteFileDescriptor(write_end.get(), &buf, 1));
+      done_.Wait();
+    }
+    const TimeDelta elapsed = TimeTicks::Now() - start;
+
+    thread.task_runner()->PostTask(
+        FROM_HERE,
+        BindOnce(&IOPumpPerfTest::StopWatching, Unretained(this)));
+    thread.Stop();
+
+    perf_test::PrintResult(
+        "fd_readiness", "", trace,
+        elapsed.InMicrosecondsF() / (kReadinessRounds * kNumPipes),
+        "us/event", true);
+  }
+
+ private:
+  class PipeReader : public WatchableIOMessagePumpPosix::FdWatcher {
+   public:
+    explicit PipeReader(IOPumpPerfTest* test) : test_(test) {}
+
+    void OnFileCanReadWithoutBlocking(int fd) override {
+      char buf;
+      CHECK_EQ(1, HANDLE_EINTR(read(fd, &buf, 1)));
+      if (test_->pending_reads_.fetch_sub(1, std::memory_order_relaxed) == 1)
+        test_->done_.Signal();
+    }
+    void OnFileCanWriteWithoutBlocking(int fd) override { NOTREACHED(); }
+
+   private:
+    IOPumpPerfTest* const test_;
+  };
+
+  void Ping(int remaining) {
+    if (!remaining) {
+      done_.Signal();
+      return;
+    }
+    pong_runner_->PostTask(FROM_HERE, BindOnce(&IOPumpPerfTest::Pong,
+                                               Unretained(this), remaining));
+  }
+
+  void Pong(int remaining) {
+    ping_runner_->PostTask(FROM_HERE, BindOnce(&IOPumpPerfTest::Ping,
+                                               Unretained(this),
+                                               remaining - 1));
+  }
+
+  void WatchPipes(PumpType* pump, ScopedFD* write_ends) {
+    for (int i = 0; i < kNumPipes; ++i) {
+      int fds[2];
+      CHECK(CreateLocalNonBlockingPipe(fds));
+      read_ends_[i].reset(fds[0]);
+      write_ends[i].reset(fds[1]);
+      controllers_[i] =
+          std::make_unique<typename PumpType::FdWatchController>(FROM_HERE);
+      CHECK(pump->WatchFileDescriptor(fds[0], true, PumpType::WATCH_READ,
+                                      controllers_[i].get(), &reader_));
+    }
+    done_.Signal();
+  }
+
+  void StopWatching() {
+    for (auto& controller : controllers_)
+      controller.reset();
+  }
+
+  static constexpr int kRoundTrips = 20000;
+  static constexpr int kNumPipes = 64;
+  static constexpr int kReadinessRounds = 2000;
+
+  WaitableEvent done_;
+  scoped_refptr<SingleThreadTaskRunner> ping_runner_;
+  scoped_refptr<SingleThreadTaskRunner> pong_runner_;
+
+  std::atomic<int> pending_reads_{0};
+  PipeReader reader_{this};
+  ScopedFD read_ends_[kNumPipes];
+  std::unique_ptr<typename PumpType::FdWatchController>
+      controllers_[kNumPipes];
+};
+
+using IOPumpTypes = testing::Types<MessagePumpLibevent, MessagePumpEpoll>;
+TYPED_TEST_CASE(IOPumpPerfTest, IOPumpTypes);
+
+TYPED_TEST(IOPumpPerfTest, WakeupLatency) {
+  this->PingPong(std::is_same<TypeParam, MessagePumpEpoll>::value
+                     ? "epoll"
+                     : "libevent");
+}
+
+TYPED_TEST(IOPumpPerfTest, FdReadiness) {
+  this->FdReadiness(std::is_same<TypeParam, MessagePumpEpoll>::value
+                        ? "epoll"
+                        : "libevent");
+}
+#endif  // BUILDFLAG(USE_EPOLL_MESSAGE_PUMP)
+
 }  // namespace base
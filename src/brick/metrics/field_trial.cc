@@ -507,7 +507,7 @@ FieldTrialList::FieldTrialList(
 }
 
 FieldTrialList::~FieldTrialList() {
-  AutoLock auto_lock(lock_);
+  AutoWriteLock auto_lock(lock_);
   while (!registered_.empty()) {
     RegistrationMap::iterator it = registered_.begin();
     it->second->Release();
@@ -602,7 +602,7 @@ FieldTrial* FieldTrialList::FactoryGetFieldTrialWithRandomizationSeed(
 FieldTrial* FieldTrialList::Find(const std::string& trial_name) {
   if (!global_)
     return nullptr;
-  AutoLock auto_lock(global_->lock_);
+  AutoReadLock auto_lock(global_->lock_);
   return global_->PreLockedFind(trial_name);
 }
 
@@ -656,7 +656,7 @@ void FieldTrialList::AllStatesToString(std::string* output,
                                        bool include_expired) {
   if (!global_)
     return;
-  AutoLock auto_lock(global_->lock_);
+  AutoWriteLock auto_lock(global_->lock_);
 
   for (const auto& registered : global_->registered_) {
     FieldTrial::State trial;
@@ -725,7 +725,7 @@ void FieldTrialList::GetActiveFieldTrialGroups(
   DCHECK(active_groups->empty());
   if (!global_)
     return;
-  AutoLock auto_lock(global_->lock_);
+  AutoReadLock auto_lock(global_->lock_);
 
   for (RegistrationMap::iterator it = global_->registered_.begin();
        it != global_->registered_.end(); ++it) {
@@ -1015,7 +1015,7 @@ void FieldTrialList::OnGroupFinalized(bool is_locked, FieldTrial* field_trial) {
     AddToAllocatorWhileLocked(global_->field_trial_allocator_.get(),
                               field_trial);
   } else {
-    AutoLock auto_lock(global_->lock_);
+    AutoWriteLock auto_lock(global_->lock_);
     AddToAllocatorWhileLocked(global_->field_trial_allocator_.get(),
                               field_trial);
   }
@@ -1027,7 +1027,7 @@ void FieldTrialList::NotifyFieldTrialGroupSelection(FieldTrial* field_trial) {
     return;
 
   {
-    AutoLock auto_lock(global_->lock_);
+    AutoWriteLock auto_lock(global_->lock_);
     if (field_trial->group_reported_)
       return;
     field_trial->group_reported_ = true;
@@ -1062,7 +1062,7 @@ void FieldTrialList::NotifyFieldTrialGroupSelection(FieldTrial* field_trial) {
 size_t FieldTrialList::GetFieldTrialCount() {
   if (!global_)
     return 0;
-  AutoLock auto_lock(global_->lock_);
+  AutoReadLock auto_lock(global_->lock_);
   return global_->registered_.size();
 }
 
@@ -1082,7 +1082,7 @@ bool FieldTrialList::GetParamsFromSharedMemory(
   //   If this is the case, then you are calling this too early. The field trial
   //   allocator should get set up very early in the lifecycle. Try to see if
   //   you can call it after it's been set up.
-  AutoLock auto_lock(global_->lock_);
+  AutoReadLock auto_lock(global_->lock_);
   if (!global_->field_trial_allocator_)
     return false;
 
@@ -1108,7 +1108,7 @@ void FieldTrialList::ClearParamsFromSharedMemoryForTesting() {
   if (!global_)
     return;
 
-  AutoLock auto_lock(global_->lock_);
+  AutoWriteLock auto_lock(global_->lock_);
   if (!global_->field_trial_allocator_)
     return;
 
@@ -1173,7 +1173,7 @@ void FieldTrialList::DumpAllFieldTrialsToPersistentAllocator(
     PersistentMemoryAllocator* allocator) {
   if (!global_)
     return;
-  AutoLock auto_lock(global_->lock_);
+  AutoWriteLock auto_lock(global_->lock_);
   for (const auto& registered : global_->registered_) {
     AddToAllocatorWhileLocked(allocator, registered.second);
   }
@@ -1367,7 +1367,7 @@ bool FieldTrialList::CreateTrialsFromSharedMemory(
 void FieldTrialList::InstantiateFieldTrialAllocatorIfNeeded() {
   if (!global_)
     return;
-  AutoLock auto_lock(global_->lock_);
+  AutoWriteLock auto_lock(global_->lock_);
   // Create the allocator if not already created and add all existing trials.
   if (global_->field_trial_allocator_ != nullptr)
     return;
@@ -1502,7 +1502,7 @@ void FieldTrialList::Register(FieldTrial* trial) {
     used_without_global_ = true;
     return;
   }
-  AutoLock auto_lock(global_->lock_);
+  AutoWriteLock auto_lock(global_->lock_);
   CHECK(!global_->PreLockedFind(trial->trial_name())) << trial->trial_name();
   trial->AddRef();
   trial->SetTrialRegistered();
@@ -1513,7 +1513,7 @@ void FieldTrialList::Register(FieldTrial* trial) {
 FieldTrialList::RegistrationMap FieldTrialList::GetRegisteredTrials() {
   RegistrationMap output;
   if (global_) {
-    AutoLock auto_lock(global_->lock_);
+    AutoReadLock auto_lock(global_->lock_);
     output = global_->registered_;
   }
   return output;
@@ -78,7 +78,7 @@
 #include "brick/pickle.h"
 #include "brick/process/launch.h"
 #include "brick/strings/string_piece.h"
-#include "brick/synchronization/lock.h"
+#include "brick/synchronization/read_write_lock.h"
 #include "brick/time/time.h"
 #include "build/build_config.h"
 
@@ -745,7 +745,8 @@ class BRICK_EXPORT FieldTrialList {
   static const FieldTrial::EntropyProvider*
       GetEntropyProviderForOneTimeRandomization();
 
-  // Helper function should be called only while holding lock_.
+  // Helper function should be called only while holding lock_, in either
+  // mode.
   FieldTrial* PreLockedFind(const std::string& name);
 
   // Register() stores a pointer to the given trial in a global map.
@@ -764,8 +765,9 @@ class BRICK_EXPORT FieldTrialList {
   // FieldTrialList is created after that.
   static bool used_without_global_;
 
-  // Lock for access to registered_ and field_trial_allocator_.
-  Lock lock_;
+  // Lock for access to registered_ and field_trial_allocator_. Lookups, which
+  // happen on every feature and field trial check, only take it for reading.
+  ReadWriteLock lock_;
   RegistrationMap registered_;
 
   std::map<std::string, std::string> seen_states_;
@@ -0,0 +1,118 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/profiler/frame_pointer_unwinder.h"
+
+#include "brick/compiler_specific.h"
+#include "brick/no_destructor.h"
+#include "brick/threading/thread_local_storage.h"
+#include "build/build_config.h"
+
+#if defined(OS_POSIX)
+#include <pthread.h>
+#endif
+
+namespace base {
+
+namespace {
+
+// Values of the TLS slot other than the stack end: the stack end isn't known
+// yet, or is being looked up, or couldn't be found.
+constexpr uintptr_t kStackEndNotLookedUp = 0;
+constexpr uintptr_t kStackEndLookingUp = 1;
+constexpr uintptr_t kStackEndUnknown = 2;
+
+// Without the stack end, frames larger than this end the unwinding.
+constexpr uintptr_t kMaxFrameSizeWithoutStackEnd = 100000;
+
+#if defined(__arm__) && defined(__GNUC__) && !defined(__clang__)
+// GCC and LLVM generate slightly different frames on ARM, see
+// https://llvm.org/bugs/show_bug.cgi?id=18505 - LLVM generates
+// x86-compatible frame, while GCC needs adjustment.
+constexpr uintptr_t kStackFrameAdjustment = sizeof(uintptr_t);
+#else
+constexpr uintptr_t kStackFrameAdjustment = 0;
+#endif
+
+ThreadLocalStorage::Slot& StackEndTLS() {
+  static NoDestructor<ThreadLocalStorage::Slot> stack_end_tls;
+  return *stack_end_tls;
+}
+
+uintptr_t LookUpStackEnd() {
+#if defined(OS_MACOSX)
+  return reinterpret_cast<uintptr_t>(pthread_get_stackaddr_np(pthread_self()));
+#elif defined(OS_POSIX) && !defined(OS_NACL) && !defined(OS_FUCHSIA)
+  pthread_attr_t attributes;
+  if (pthread_getattr_np(pthread_self(), &attributes))
+    return 0;
+  void* stack_address;
+  size_t stack_size;
+  const int result =
+      pthread_attr_getstack(&attributes, &stack_address, &stack_size);
+  pthread_attr_destroy(&attributes);
+  if (result)
+    return 0;
+  return reinterpret_cast<uintptr_t>(stack_address) + stack_size;
+#else
+  return 0;
+#endif
+}
+
+}  // namespace
+
+uintptr_t GetThreadStackEnd() {
+  ThreadLocalStorage::Slot& slot = StackEndTLS();
+  uintptr_t stack_end = reinterpret_cast<uintptr_t>(slot.Get());
+  if (LIKELY(stack_end > kStackEndUnknown))
+    return stack_end;
+  if (stack_end != kStackEndNotLookedUp)
+    return 0;
+
+  slot.Set(reinterpret_cast<void*>(kStackEndLookingUp));
+  stack_end = LookUpStackEnd();
+  if (stack_end <= kStackEndUnknown)
+    stack_end = kStackEndUnknown;
+  slot.Set(reinterpret_cast<void*>(stack_end));
+  return stack_end == kStackEndUnknown ? 0 : stack_end;
+}
+
+NOINLINE size_t UnwindFramePointers(const void** frames,
+                                    size_t max_depth,
+                                    size_t skip_frames) {
+  // Each frame starts with the frame pointer of its caller, followed by the
+  // return address into it.
+  uintptr_t frame_pointer =
+      reinterpret_cast<uintptr_t>(__builtin_frame_address(0)) -
+      kStackFrameAdjustment;
+  const uintptr_t stack_end = GetThreadStackEnd();
+  size_t depth = 0;
+  while (depth < max_depth) {
+    if (frame_pointer & (sizeof(uintptr_t) - 1))
+      break;
+    if (stack_end && frame_pointer + 2 * sizeof(uintptr_t) > stack_end)
+      break;
+    const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(frame_pointer);
+    const uintptr_t return_address = frame[1];
+    if (!return_address)
+      break;
+    if (skip_frames)
+      --skip_frames;
+    else
+      frames[depth++] = reinterpret_cast<const void*>(return_address);
+
+    // The stack grows down, so the frames of the callers are above.
+    const uintptr_t next_frame_pointer = frame[0] - kStackFrameAdjustment;
+    if (next_frame_pointer <= frame_pointer)
+      break;
+    if (!stack_end &&
+        next_frame_pointer - frame_pointer > kMaxFrameSizeWithoutStackEnd) {
+      break;
+    }
+    frame_pointer = next_frame_pointer;
+  }
+  return depth;
+}
+
+}  // namespace base
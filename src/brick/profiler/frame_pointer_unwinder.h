@@ -0,0 +1,39 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_PROFILER_FRAME_POINTER_UNWINDER_H_
+#define BRICK_PROFILER_FRAME_POINTER_UNWINDER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "brick/base_export.h"
+
+namespace base {
+
+// Returns the end (highest address) of the stack of the current thread, or 0
+// if it isn't known. The first call on a thread looks the stack up with
+// pthread_getattr_np(), and the later ones return the cached value.
+//
+// Safe to call from allocator hooks: the lookup may allocate, and a call made
+// by such an allocation returns 0.
+BRICK_EXPORT uintptr_t GetThreadStackEnd();
+
+// Writes the return addresses of the current stack to |frames|, starting
+// with the caller of UnwindFramePointers() and skipping |skip_frames| of them,
+// and returns how many it wrote, at most |max_depth|.
+//
+// Frame pointers are followed as long as they point to increasing, aligned
+// addresses of the stack of the thread, so unwinding stops at the first frame
+// of code built without frame pointers instead of crashing. That makes it
+// usable where base::debug::StackTrace is too slow, e.g. for every sampled
+// allocation, as long as the build keeps frame pointers
+// (BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS)).
+BRICK_EXPORT size_t UnwindFramePointers(const void** frames,
+                                        size_t max_depth,
+                                        size_t skip_frames);
+
+}  // namespace base
+
+#endif  // BRICK_PROFILER_FRAME_POINTER_UNWINDER_H_
@@ -0,0 +1,112 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/profiler/frame_pointer_unwinder.h"
+
+#include <stdint.h>
+
+#include "brick/compiler_specific.h"
+#include "brick/debug/debugging_buildflags.h"
+#include "brick/macros.h"
+#include "brick/threading/simple_thread.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+constexpr size_t kMaxDepth = 32;
+
+struct UnwindResult {
+  const void* frames[kMaxDepth];
+  size_t depth = 0;
+  // Where UnwindFromInner() and UnwindFromMiddle() return to.
+  const void* inner_return_address = nullptr;
+  const void* middle_return_address = nullptr;
+  // Incremented after each call, so that none is a tail call.
+  int returns = 0;
+};
+
+NOINLINE void UnwindFromInner(UnwindResult* result, size_t skip_frames) {
+  result->inner_return_address = __builtin_return_address(0);
+  result->depth = UnwindFramePointers(result->frames, kMaxDepth, skip_frames);
+  ++result->returns;
+}
+
+NOINLINE void UnwindFromMiddle(UnwindResult* result, size_t skip_frames) {
+  result->middle_return_address = __builtin_return_address(0);
+  UnwindFromInner(result, skip_frames);
+  ++result->returns;
+}
+
+NOINLINE void UnwindFromOuter(UnwindResult* result, size_t skip_frames) {
+  UnwindFromMiddle(result, skip_frames);
+  ++result->returns;
+}
+
+class StackEndThread : public SimpleThread {
+ public:
+  StackEndThread() : SimpleThread("StackEndThread") {}
+
+  void Run() override {
+    int local = 0;
+    local_address_ = reinterpret_cast<uintptr_t>(&local);
+    stack_end_ = GetThreadStackEnd();
+  }
+
+  uintptr_t local_address() const { return local_address_; }
+  uintptr_t stack_end() const { return stack_end_; }
+
+ private:
+  uintptr_t local_address_ = 0;
+  uintptr_t stack_end_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(StackEndThread);
+};
+
+}  // namespace
+
+#if defined(OS_LINUX) || defined(OS_ANDROID) || defined(OS_MACOSX)
+TEST(FramePointerUnwinderTest, GetThreadStackEnd) {
+  int local = 0;
+  const uintptr_t stack_end = GetThreadStackEnd();
+  EXPECT_GT(stack_end, reinterpret_cast<uintptr_t>(&local));
+  // The second call hits the cache.
+  EXPECT_EQ(stack_end, GetThreadStackEnd());
+
+  StackEndThread thread;
+  thread.Start();
+  thread.Join();
+  EXPECT_GT(thread.stack_end(), thread.local_address());
+  EXPECT_NE(stack_end, thread.stack_end());
+}
+#endif
+
+#if BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS)
+TEST(FramePointerUnwinderTest, Unwind) {
+  UnwindResult result;
+  UnwindFromOuter(&result, 0);
+  // The first frame is in UnwindFromInner(), then come its callers.
+  ASSERT_GE(result.depth, 3u);
+  EXPECT_EQ(result.inner_return_address, result.frames[1]);
+  EXPECT_EQ(result.middle_return_address, result.frames[2]);
+}
+
+TEST(FramePointerUnwinderTest, SkipFrames) {
+  UnwindResult result;
+  UnwindFromOuter(&result, 1);
+  ASSERT_GE(result.depth, 2u);
+  EXPECT_EQ(result.inner_return_address, result.frames[0]);
+  EXPECT_EQ(result.middle_return_address, result.frames[1]);
+}
+
+TEST(FramePointerUnwinderTest, MaxDepth) {
+  const void* frames[2];
+  EXPECT_EQ(2u, UnwindFramePointers(frames, arraysize(frames), 0));
+  EXPECT_EQ(0u, UnwindFramePointers(frames, 0, 0));
+}
+#endif  // BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS)
+
+}  // namespace base
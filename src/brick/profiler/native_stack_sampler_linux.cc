@@ -0,0 +1,619 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/profiler/native_stack_sampler.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <link.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "brick/bits.h"
+#include "brick/compiler_specific.h"
+#include "brick/files/file_path.h"
+#include "brick/files/file_util.h"
+#include "brick/logging.h"
+#include "brick/macros.h"
+#include "brick/no_destructor.h"
+#include "brick/strings/string_number_conversions.h"
+#include "brick/strings/string_split.h"
+#include "brick/synchronization/futex_linux.h"
+#include "brick/synchronization/lock.h"
+#include "brick/time/time.h"
+#include "build/build_config.h"
+
+namespace base {
+
+namespace {
+
+// The signal which asks the sampled thread to copy its stack. SIGURG is
+// ignored by default and has few users, unlike SIGPROF which other profilers
+// install handlers for.
+constexpr int kSampleSignal = SIGURG;
+
+// How long to wait for the sampled thread to run the signal handler. The
+// sample is dropped if the thread blocks the signal or doesn't get scheduled
+// in time.
+constexpr TimeDelta kSignalHandlerTimeout = TimeDelta::FromMilliseconds(100);
+
+// Maps a module's address range (half-open) in memory to an index in a separate
+// data structure.
+struct ModuleIndex {
+  ModuleIndex(uintptr_t start, uintptr_t end, size_t idx)
+      : base_address(start), end_address(end), index(idx) {}
+  // Base address of the represented module.
+  uintptr_t base_address;
+  // First address off the end of the represented module.
+  uintptr_t end_address;
+  // An index to the represented module in a separate container.
+  size_t index;
+};
+
+// Registers needed to walk the stack.
+struct RegisterState {
+  uintptr_t pc;
+  uintptr_t sp;
+  uintptr_t fp;
+};
+
+// Memory mappings -------------------------------------------------------------
+
+// A line of /proc/self/maps.
+struct MappedRegion {
+  uintptr_t start;
+  uintptr_t end;
+  uintptr_t offset;
+  bool executable;
+  std::string path;
+};
+
+// Reads the memory mappings of the process, sorted by address.
+bool ReadMappedRegions(std::vector<MappedRegion>* regions) {
+  std::string maps;
+  if (!ReadFileToString(FilePath("/proc/self/maps"), &maps))
+    return false;
+  regions->clear();
+  for (const std::string& line :
+       SplitString(maps, "\n", KEEP_WHITESPACE, SPLIT_WANT_NONEMPTY)) {
+    MappedRegion region;
+    char permissions[5];
+    int path_index = 0;
+    if (sscanf(line.c_str(),
+               "%" SCNxPTR "-%" SCNxPTR " %4c %" SCNxPTR " %*s %*d %n",
+               &region.start, &region.end, permissions, &region.offset,
+               &path_index) < 4) {
+      continue;
+    }
+    region.executable = permissions[2] == 'x';
+    if (path_index > 0)
+      region.path = line.substr(path_index);
+    regions->push_back(std::move(region));
+  }
+  return true;
+}
+
+// Returns the region of |regions| which contains |address|, or nullptr.
+const MappedRegion* FindMappedRegion(const std::vector<MappedRegion>& regions,
+                                     uintptr_t address) {
+  auto it = std::upper_bound(regions.begin(), regions.end(), address,
+                             [](uintptr_t address, const MappedRegion& region) {
+                               return address < region.start;
+                             });
+  if (it == regions.begin() || address >= (--it)->end)
+    return nullptr;
+  return &*it;
+}
+
+// Returns the address where the file mapped by |region| starts in memory,
+// which is where its first segment is mapped.
+uintptr_t GetModuleBaseAddress(const std::vector<MappedRegion>& regions,
+                               const MappedRegion& region) {
+  uintptr_t base_address = region.start - region.offset;
+  for (const MappedRegion& other : regions) {
+    if (other.start > region.start)
+      break;
+    if (!other.offset && other.path == region.path)
+      base_address = other.start;
+  }
+  return base_address;
+}
+
+// Module identifiers ----------------------------------------------------------
+
+struct BuildIdSearch {
+  uintptr_t address;
+  std::string build_id;
+};
+
+// dl_iterate_phdr() callback which reads the .note.gnu.build-id of the module
+// containing |search->address|. The loader lock held by dl_iterate_phdr()
+// keeps the module from being unloaded while its notes are read.
+int FindBuildId(struct dl_phdr_info* info, size_t size, void* data) {
+  BuildIdSearch* search = static_cast<BuildIdSearch*>(data);
+  bool contains_address = false;
+  for (int i = 0; i < info->dlpi_phnum; ++i) {
+    const ElfW(Phdr)& header = info->dlpi_phdr[i];
+    uintptr_t start = info->dlpi_addr + header.p_vaddr;
+    if (header.p_type == PT_LOAD && search->address >= start &&
+        search->address < start + header.p_memsz) {
+      contains_address = true;
+      break;
+    }
+  }
+  if (!contains_address)
+    return 0;
+
+  for (int i = 0; i < info->dlpi_phnum; ++i) {
+    const ElfW(Phdr)& header = info->dlpi_phdr[i];
+    if (header.p_type != PT_NOTE)
+      continue;
+    const char* note = reinterpret_cast<const char*>(info->dlpi_addr +
+                                                     header.p_vaddr);
+    const char* notes_end = note + header.p_memsz;
+    while (note + sizeof(ElfW(Nhdr)) <= notes_end) {
+      const ElfW(Nhdr)* note_header =
+          reinterpret_cast<const ElfW(Nhdr)*>(note);
+      const char* name = note + sizeof(ElfW(Nhdr));
+      const char* desc = name + bits::Align(note_header->n_namesz, 4);
+      if (desc + note_header->n_descsz > notes_end)
+        break;
+      if (note_header->n_type == NT_GNU_BUILD_ID &&
+          note_header->n_namesz == sizeof(ELF_NOTE_GNU) &&
+          !memcmp(name, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU))) {
+        search->build_id = HexEncode(desc, note_header->n_descsz);
+        return 1;
+      }
+      note = desc + bits::Align(note_header->n_descsz, 4);
+    }
+  }
+  return 1;
+}
+
+// Returns the build ID of the module containing |address|, or the empty string
+// if it has none.
+std::string GetBuildId(uintptr_t address) {
+  BuildIdSearch search = {address, std::string()};
+  dl_iterate_phdr(&FindBuildId, &search);
+  return search.build_id;
+}
+
+// Stack copying ---------------------------------------------------------------
+
+// The request from the sampling thread to the signal handler of the sampled
+// thread. There is one sample in flight at a time in the process, guarded by
+// SampleRequestLock() on the sampling side.
+struct SampleRequest {
+  enum State : int32_t { kIdle, kRequested, kCopying, kCopied };
+
+  // Moves from kRequested to kCopying when the handler takes the request, and
+  // then to kCopied. The sampling thread can cancel a request which wasn't
+  // taken by moving it back to kIdle.
+  std::atomic<int32_t> state{kIdle};
+
+  // Written by the sampling thread before the request is made.
+  pid_t thread_id = 0;
+  // The copy ends at |stack_top|, or at the end of the buffer. If it's 0, the
+  // handler only reports the registers.
+  uintptr_t stack_top = 0;
+  uintptr_t* buffer = nullptr;
+  size_t buffer_size = 0;
+
+  // Written by the signal handler.
+  RegisterState registers = {};
+  size_t stack_size = 0;
+};
+
+SampleRequest g_sample_request;
+
+Lock& SampleRequestLock() {
+  static NoDestructor<Lock> lock;
+  return *lock;
+}
+
+// Reads the registers of the interrupted code from |context|.
+void GetRegisterState(const ucontext_t* context, RegisterState* registers) {
+#if defined(ARCH_CPU_X86_64)
+  registers->pc = context->uc_mcontext.gregs[REG_RIP];
+  registers->sp = context->uc_mcontext.gregs[REG_RSP];
+  registers->fp = context->uc_mcontext.gregs[REG_RBP];
+#elif defined(ARCH_CPU_X86)
+  registers->pc = context->uc_mcontext.gregs[REG_EIP];
+  registers->sp = context->uc_mcontext.gregs[REG_ESP];
+  registers->fp = context->uc_mcontext.gregs[REG_EBP];
+#elif defined(ARCH_CPU_ARM64)
+  registers->pc = context->uc_mcontext.pc;
+  registers->sp = context->uc_mcontext.sp;
+  registers->fp = context->uc_mcontext.regs[29];
+#endif
+}
+
+// If the value at |pointer| points to the original stack, rewrites it to point
+// to the corresponding location in the copied stack.
+uintptr_t RewritePointerIfInOriginalStack(uintptr_t original_stack_bottom,
+                                          uintptr_t original_stack_top,
+                                          uintptr_t stack_copy_bottom,
+                                          uintptr_t pointer) {
+  if (pointer < original_stack_bottom || pointer >= original_stack_top)
+    return pointer;
+  return stack_copy_bottom + (pointer - original_stack_bottom);
+}
+
+// Copies the stack to a buffer while rewriting possible pointers to locations
+// within the stack to point to the corresponding locations in the copy, so
+// that frame pointers lead to the copy. See the Mac implementation for why this
+// is safe.
+//
+// Note that this runs in a signal handler. It may only use async-signal-safe
+// functions.
+void CopyStackAndRewritePointers(uintptr_t* stack_copy_bottom,
+                                 const uintptr_t* original_stack_bottom,
+                                 const uintptr_t* original_stack_top,
+                                 RegisterState* registers)
+    NO_SANITIZE("address") {
+  const auto bottom = reinterpret_cast<uintptr_t>(original_stack_bottom);
+  const auto top = reinterpret_cast<uintptr_t>(original_stack_top);
+  const auto copy_bottom = reinterpret_cast<uintptr_t>(stack_copy_bottom);
+  size_t count = original_stack_top - original_stack_bottom;
+  for (size_t pos = 0; pos < count; ++pos) {
+    stack_copy_bottom[pos] = RewritePointerIfInOriginalStack(
+        bottom, top, copy_bottom, original_stack_bottom[pos]);
+  }
+  registers->sp =
+      RewritePointerIfInOriginalStack(bottom, top, copy_bottom, registers->sp);
+  registers->fp =
+      RewritePointerIfInOriginalStack(bottom, top, copy_bottom, registers->fp);
+}
+
+// Handler of kSampleSignal, run by the sampled thread.
+void HandleSampleSignal(int signal, siginfo_t* info, void* context) {
+  const int saved_errno = errno;
+  SampleRequest& request = g_sample_request;
+  int32_t expected = SampleRequest::kRequested;
+  if (!request.state.compare_exchange_strong(expected,
+                                             SampleRequest::kCopying,
+                                             std::memory_order_acquire)) {
+    // A signal from someone else, or for a cancelled request.
+    errno = saved_errno;
+    return;
+  }
+  if (request.thread_id != syscall(SYS_gettid)) {
+    // A signal from someone else, while another thread is being sampled.
+    request.state.store(SampleRequest::kRequested, std::memory_order_release);
+    errno = saved_errno;
+    return;
+  }
+
+  RegisterState registers;
+  GetRegisterState(static_cast<const ucontext_t*>(context), &registers);
+  size_t stack_size = 0;
+  const uintptr_t stack_bottom = registers.sp & ~(sizeof(uintptr_t) - 1);
+  if (request.stack_top > stack_bottom) {
+    // Frames past the end of the buffer are lost.
+    stack_size = std::min<size_t>(request.stack_top - stack_bottom,
+                                  request.buffer_size);
+    stack_size &= ~(sizeof(uintptr_t) - 1);
+    CopyStackAndRewritePointers(
+        request.buffer, reinterpret_cast<const uintptr_t*>(stack_bottom),
+        reinterpret_cast<const uintptr_t*>(stack_bottom + stack_size),
+        &registers);
+  }
+  request.registers = registers;
+  request.stack_size = stack_size;
+  request.state.store(SampleRequest::kCopied, std::memory_order_release);
+  internal::FutexWake(&request.state, 1);
+  errno = saved_errno;
+}
+
+// Installs HandleSampleSignal(), unless the process has a handler of its own
+// for kSampleSignal.
+bool InstallSampleSignalHandler() {
+  struct sigaction action = {};
+  action.sa_sigaction = &HandleSampleSignal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  struct sigaction old_action;
+  if (sigaction(kSampleSignal, nullptr, &old_action) != 0)
+    return false;
+  if ((old_action.sa_flags & SA_SIGINFO) ||
+      (old_action.sa_handler != SIG_DFL && old_action.sa_handler != SIG_IGN)) {
+    DLOG(WARNING) << "Signal " << kSampleSignal << " is in use, stack "
+                  << "sampling is disabled";
+    return false;
+  }
+  return sigaction(kSampleSignal, &action, nullptr) == 0;
+}
+
+// Signals |thread_id| to copy its stack up to |stack_top| into |stack_buffer|,
+// and waits for it. |stack_top| may be 0 to only get the registers. Returns
+// false if the thread didn't respond, else sets |registers| and |stack_size|,
+// the size of the copy at the beginning of |stack_buffer|.
+bool CopyThreadStack(pid_t thread_id,
+                     uintptr_t stack_top,
+                     NativeStackSampler::StackBuffer* stack_buffer,
+                     RegisterState* registers,
+                     size_t* stack_size) {
+  AutoLock lock(SampleRequestLock());
+  SampleRequest& request = g_sample_request;
+  DCHECK_EQ(SampleRequest::kIdle, request.state.load());
+  request.thread_id = thread_id;
+  request.stack_top = stack_top;
+  request.buffer = static_cast<uintptr_t*>(stack_buffer->buffer());
+  request.buffer_size = stack_buffer->size();
+  request.state.store(SampleRequest::kRequested, std::memory_order_release);
+  if (syscall(SYS_tgkill, getpid(), thread_id, kSampleSignal) != 0) {
+    request.state.store(SampleRequest::kIdle, std::memory_order_relaxed);
+    return false;
+  }
+
+  const TimeTicks deadline = TimeTicks::Now() + kSignalHandlerTimeout;
+  while (true) {
+    int32_t state = request.state.load(std::memory_order_acquire);
+    if (state == SampleRequest::kCopied)
+      break;
+    TimeDelta remaining = deadline - TimeTicks::Now();
+    if (state == SampleRequest::kRequested && remaining <= TimeDelta() &&
+        request.state.compare_exchange_strong(state, SampleRequest::kIdle,
+                                              std::memory_order_relaxed)) {
+      return false;
+    }
+    // Once the handler took the request, it finishes quickly.
+    internal::FutexWaitFor(
+        &request.state, state,
+        std::max(remaining, TimeDelta::FromMilliseconds(1)));
+  }
+  *registers = request.registers;
+  *stack_size = request.stack_size;
+  request.state.store(SampleRequest::kIdle, std::memory_order_relaxed);
+  return true;
+}
+
+// NativeStackSamplerLinux -----------------------------------------------------
+
+class NativeStackSamplerLinux : public NativeStackSampler {
+ public:
+  NativeStackSamplerLinux(pid_t thread_id,
+                          AnnotateCallback annotator,
+                          NativeStackSamplerTestDelegate* test_delegate);
+  ~NativeStackSamplerLinux() override;
+
+  // StackSamplingProfiler::NativeStackSampler:
+  void ProfileRecordingStarting(
+      std::vector<StackSamplingProfiler::Module>* modules) override;
+  void RecordStackSample(StackBuffer* stack_buffer,
+                         StackSamplingProfiler::Sample* sample) override;
+  void ProfileRecordingStopped() override;
+
+ private:
+  // Returns the end of the stack of the thread, found from the mapping which
+  // contains its stack pointer. Returns 0 on failure.
+  uintptr_t GetStackTop(StackBuffer* stack_buffer);
+
+  // Walks the frame pointers of the stack copied in |stack_buffer|, which
+  // ends at |stack_copy_top|, recording the frames into |sample|.
+  void WalkStack(const RegisterState& registers,
+                 uintptr_t stack_copy_top,
+                 StackBuffer* stack_buffer,
+                 StackSamplingProfiler::Sample* sample);
+
+  // Gets the index for the Module containing |instruction_pointer| in
+  // |current_modules_|, adding it if it's not already present. Returns
+  // StackSamplingProfiler::Frame::kUnknownModuleIndex if no Module can be
+  // determined for |instruction_pointer|.
+  size_t GetModuleIndex(uintptr_t instruction_pointer);
+
+  const pid_t thread_id_;
+
+  const AnnotateCallback annotator_;
+
+  NativeStackSamplerTestDelegate* const test_delegate_;
+
+  // The end of the stack of the thread, found on the first sample.
+  uintptr_t thread_stack_top_ = 0;
+
+  // Weak. Points to the modules associated with the profile being recorded
+  // between ProfileRecordingStarting() and ProfileRecordingStopped().
+  std::vector<StackSamplingProfiler::Module>* current_modules_ = nullptr;
+
+  // Maps a module's address range to the corresponding Module's index within
+  // current_modules_.
+  std::vector<ModuleIndex> profile_module_index_;
+
+  // The mappings of the process, read at most once per sample to find the
+  // modules which are not in |profile_module_index_| yet.
+  std::vector<MappedRegion> mapped_regions_;
+  bool mapped_regions_are_current_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(NativeStackSamplerLinux);
+};
+
+NativeStackSamplerLinux::NativeStackSamplerLinux(
+    pid_t thread_id,
+    AnnotateCallback annotator,
+    NativeStackSamplerTestDelegate* test_delegate)
+    : thread_id_(thread_id),
+      annotator_(annotator),
+      test_delegate_(test_delegate) {
+  DCHECK(annotator_);
+}
+
+NativeStackSamplerLinux::~NativeStackSamplerLinux() = default;
+
+void NativeStackSamplerLinux::ProfileRecordingStarting(
+    std::vector<StackSamplingProfiler::Module>* modules) {
+  current_modules_ = modules;
+  profile_module_index_.clear();
+}
+
+void NativeStackSamplerLinux::RecordStackSample(
+    StackBuffer* stack_buffer,
+    StackSamplingProfiler::Sample* sample) {
+  DCHECK(current_modules_);
+
+  if (!thread_stack_top_) {
+    thread_stack_top_ = GetStackTop(stack_buffer);
+    if (!thread_stack_top_)
+      return;
+  }
+
+  RegisterState registers;
+  size_t stack_size;
+  if (!CopyThreadStack(thread_id_, thread_stack_top_, stack_buffer,
+                       &registers, &stack_size)) {
+    return;
+  }
+  // The thread runs again, the annotations are as close as possible to the
+  // time of the sample.
+  (*annotator_)(sample);
+
+  if (test_delegate_)
+    test_delegate_->OnPreStackWalk();
+
+  mapped_regions_are_current_ = false;
+  WalkStack(registers,
+            reinterpret_cast<uintptr_t>(stack_buffer->buffer()) + stack_size,
+            stack_buffer, sample);
+}
+
+void NativeStackSamplerLinux::ProfileRecordingStopped() {
+  current_modules_ = nullptr;
+}
+
+uintptr_t NativeStackSamplerLinux::GetStackTop(StackBuffer* stack_buffer) {
+  RegisterState registers;
+  size_t stack_size;
+  if (!CopyThreadStack(thread_id_, 0, stack_buffer, &registers, &stack_size))
+    return 0;
+  std::vector<MappedRegion> regions;
+  if (!ReadMappedRegions(&regions))
+    return 0;
+  // Thread stacks are mappings of their own, and the stack of the main thread
+  // is the [stack] mapping.
+  const MappedRegion* region = FindMappedRegion(regions, registers.sp);
+  return region ? region->end : 0;
+}
+
+void NativeStackSamplerLinux::WalkStack(const RegisterState& registers,
+                                        uintptr_t stack_copy_top,
+                                        StackBuffer* stack_buffer,
+                                        StackSamplingProfiler::Sample* sample) {
+  // Reserve enough memory for most stacks, to avoid repeated allocations.
+  // Approximately 99.9% of recorded stacks are 128 frames or fewer.
+  sample->frames.reserve(128);
+
+  const auto stack_copy_bottom =
+      reinterpret_cast<uintptr_t>(stack_buffer->buffer());
+  uintptr_t instruction_pointer = registers.pc;
+  uintptr_t frame_pointer = registers.fp;
+  uintptr_t previous_frame_pointer = stack_copy_bottom;
+  while (true) {
+    // The walk stops at code outside of the modules, which can't be
+    // symbolized, and whose frames may not follow the conventions.
+    size_t module_index = GetModuleIndex(instruction_pointer);
+    if (module_index == StackSamplingProfiler::Frame::kUnknownModuleIndex)
+      return;
+    sample->frames.emplace_back(instruction_pointer, module_index);
+
+    // A frame record is the caller's frame pointer followed by the return
+    // address. The records are at increasing addresses of the copy, which
+    // catches most of the code which doesn't keep a frame pointer: the walk
+    // ends after the first function called from such code.
+    if (frame_pointer < previous_frame_pointer ||
+        frame_pointer > stack_copy_top - 2 * sizeof(uintptr_t) ||
+        frame_pointer % sizeof(uintptr_t)) {
+      return;
+    }
+    const uintptr_t* frame_record =
+        reinterpret_cast<const uintptr_t*>(frame_pointer);
+    instruction_pointer = frame_record[1];
+    if (!instruction_pointer)
+      return;
+    previous_frame_pointer = frame_pointer + 2 * sizeof(uintptr_t);
+    frame_pointer = frame_record[0];
+  }
+}
+
+size_t NativeStackSamplerLinux::GetModuleIndex(uintptr_t instruction_pointer) {
+  // Check if |instruction_pointer| is in the address range of a module we've
+  // already seen.
+  auto module_index =
+      std::find_if(profile_module_index_.begin(), profile_module_index_.end(),
+                   [instruction_pointer](const ModuleIndex& index) {
+                     return instruction_pointer >= index.base_address &&
+                            instruction_pointer < index.end_address;
+                   });
+  if (module_index != profile_module_index_.end())
+    return module_index->index;
+
+  if (!mapped_regions_are_current_) {
+    mapped_regions_are_current_ = true;
+    if (!ReadMappedRegions(&mapped_regions_))
+      mapped_regions_.clear();
+  }
+  const MappedRegion* region =
+      FindMappedRegion(mapped_regions_, instruction_pointer);
+  if (!region || !region->executable || region->path.empty())
+    return StackSamplingProfiler::Frame::kUnknownModuleIndex;
+
+  // A module has a mapping for each of its executable segments.
+  const uintptr_t base_address = GetModuleBaseAddress(mapped_regions_, *region);
+  const FilePath filename(region->path);
+  size_t index = 0;
+  while (index < current_modules_->size() &&
+         ((*current_modules_)[index].base_address != base_address ||
+          (*current_modules_)[index].filename != filename)) {
+    ++index;
+  }
+  if (index == current_modules_->size()) {
+    current_modules_->emplace_back(base_address,
+                                   GetBuildId(instruction_pointer), filename);
+  }
+  profile_module_index_.emplace_back(region->start, region->end, index);
+  return index;
+}
+
+}  // namespace
+
+std::unique_ptr<NativeStackSampler> NativeStackSampler::Create(
+    PlatformThreadId thread_id,
+    AnnotateCallback annotator,
+    NativeStackSamplerTestDelegate* test_delegate) {
+#if defined(ARCH_CPU_X86_FAMILY) || defined(ARCH_CPU_ARM64)
+  // Installed once, and never removed since a signal can still be pending.
+  static const bool signal_handler_installed = InstallSampleSignalHandler();
+  if (!signal_handler_installed)
+    return nullptr;
+  return std::make_unique<NativeStackSamplerLinux>(thread_id, annotator,
+                                                   test_delegate);
+#else
+  // The frame records of 32-bit ARM depend on the compiler and instruction set.
+  return nullptr;
+#endif
+}
+
+size_t NativeStackSampler::GetStackBufferSize() {
+  // glibc uses RLIMIT_STACK as the default size of the thread stacks too, so
+  // it is good for use here.
+  struct rlimit stack_rlimit;
+  if (getrlimit(RLIMIT_STACK, &stack_rlimit) == 0 &&
+      stack_rlimit.rlim_cur != RLIM_INFINITY) {
+    return stack_rlimit.rlim_cur;
+  }
+
+  // Larger stacks are truncated: their outermost frames are lost.
+  return 8 * 1024 * 1024;
+}
+
+}  // namespace base
@@ -0,0 +1,271 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/profiler/pprof_profile_writer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "brick/logging.h"
+#include "brick/trace_event/binary_trace_format.h"
+
+namespace base {
+
+namespace {
+
+namespace wire = trace_event::binary_trace;
+
+// Field numbers of profile.proto.
+enum ProfileField : uint32_t {
+  kProfileSampleType = 1,
+  kProfileSample = 2,
+  kProfileMapping = 3,
+  kProfileLocation = 4,
+  kProfileStringTable = 6,
+  kProfileDurationNanos = 10,
+  kProfilePeriodType = 11,
+  kProfilePeriod = 12,
+};
+
+enum ValueTypeField : uint32_t {
+  kValueTypeType = 1,
+  kValueTypeUnit = 2,
+};
+
+enum SampleField : uint32_t {
+  kSampleLocationId = 1,
+  kSampleValue = 2,
+  kSampleLabel = 3,
+};
+
+enum LabelField : uint32_t {
+  kLabelKey = 1,
+  kLabelNum = 3,
+};
+
+enum MappingField : uint32_t {
+  kMappingId = 1,
+  kMappingMemoryStart = 2,
+  kMappingMemoryLimit = 3,
+  kMappingFilename = 5,
+  kMappingBuildId = 6,
+};
+
+enum LocationField : uint32_t {
+  kLocationId = 1,
+  kLocationMappingId = 2,
+  kLocationAddress = 3,
+};
+
+void AppendVarintField(uint32_t field, uint64_t value, std::string* out) {
+  wire::AppendTag(field, wire::kWireTypeVarint, out);
+  wire::AppendVarint(value, out);
+}
+
+void AppendBytesField(uint32_t field,
+                      const char* data,
+                      size_t size,
+                      std::string* out) {
+  wire::AppendTag(field, wire::kWireTypeLengthDelimited, out);
+  wire::AppendVarint(size, out);
+  out->append(data, size);
+}
+
+// Appends |values| as a packed repeated field.
+void AppendPackedField(uint32_t field,
+                       const std::vector<uint64_t>& values,
+                       std::string* out) {
+  std::string packed;
+  for (uint64_t value : values)
+    wire::AppendVarint(value, &packed);
+  AppendBytesField(field, packed.data(), packed.size(), out);
+}
+
+}  // namespace
+
+constexpr size_t PprofProfileWriter::kFlushThreshold;
+
+PprofProfileWriter::PprofProfileWriter(File file) : file_(std::move(file)) {
+  DCHECK(file_.IsValid());
+  buffer_.reserve(kFlushThreshold * 5 / 4);
+  WriteHeader();
+}
+
+PprofProfileWriter::PprofProfileWriter(std::string* output)
+    : output_(output) {
+  DCHECK(output_);
+  WriteHeader();
+}
+
+PprofProfileWriter::~PprofProfileWriter() {
+  Finish();
+}
+
+void PprofProfileWriter::AddProfile(
+    const StackSamplingProfiler::CallStackProfile& profile) {
+  DCHECK(!finished_);
+  std::vector<uint64_t> mapping_ids;
+  mapping_ids.reserve(profile.modules.size());
+  for (const StackSamplingProfiler::Module& module : profile.modules)
+    mapping_ids.push_back(MappingId(module));
+
+  // Identical stacks are written once, with the number of times they were
+  // sampled.
+  std::map<std::pair<std::vector<uint64_t>, uint32_t>, uint64_t> counts;
+  std::vector<uint64_t> location_ids;
+  for (const StackSamplingProfiler::Sample& sample : profile.samples) {
+    location_ids.clear();
+    for (const StackSamplingProfiler::Frame& frame : sample.frames)
+      location_ids.push_back(LocationId(frame, mapping_ids));
+    ++counts[std::make_pair(location_ids, sample.process_milestones)];
+  }
+
+  const uint64_t period = profile.sampling_period.InNanoseconds();
+  for (const auto& stack : counts) {
+    message_.clear();
+    AppendPackedField(kSampleLocationId, stack.first.first, &message_);
+    AppendPackedField(kSampleValue, {stack.second, stack.second * period},
+                      &message_);
+    if (stack.first.second) {
+      std::string label;
+      AppendVarintField(kLabelKey, milestones_key_, &label);
+      AppendVarintField(kLabelNum, stack.first.second, &label);
+      AppendBytesField(kSampleLabel, label.data(), label.size(), &message_);
+    }
+    AppendMessage(kProfileSample, message_);
+  }
+
+  samples_encoded_ += profile.samples.size();
+  total_duration_ += profile.profile_duration;
+  if (!profile.sampling_period.is_zero())
+    sampling_period_ = profile.sampling_period;
+}
+
+bool PprofProfileWriter::Finish() {
+  if (finished_)
+    return !has_error_;
+  finished_ = true;
+
+  // The extent of a module isn't known, so the mappings are written last,
+  // to end after the highest address sampled in them.
+  for (const Mapping& mapping : mappings_) {
+    message_.clear();
+    AppendVarintField(kMappingId, mapping.id, &message_);
+    AppendVarintField(kMappingMemoryStart, mapping.memory_start, &message_);
+    AppendVarintField(kMappingMemoryLimit, mapping.memory_limit, &message_);
+    AppendVarintField(kMappingFilename, mapping.filename, &message_);
+    AppendVarintField(kMappingBuildId, mapping.build_id, &message_);
+    AppendMessage(kProfileMapping, message_);
+  }
+
+  const size_t old_size = buffer_.size();
+  AppendVarintField(kProfileDurationNanos, total_duration_.InNanoseconds(),
+                    &buffer_);
+  AppendVarintField(kProfilePeriod, sampling_period_.InNanoseconds(),
+                    &buffer_);
+  bytes_encoded_ += buffer_.size() - old_size;
+  return Flush();
+}
+
+bool PprofProfileWriter::Flush() {
+  if (buffer_.empty() || has_error_) {
+    buffer_.clear();
+    return !has_error_;
+  }
+  if (output_) {
+    output_->append(buffer_);
+  } else if (file_.WriteAtCurrentPos(buffer_.data(),
+                                     static_cast<int>(buffer_.size())) !=
+             static_cast<int>(buffer_.size())) {
+    DPLOG(ERROR) << "Failed to write the pprof profile";
+    has_error_ = true;
+  }
+  buffer_.clear();
+  return !has_error_;
+}
+
+void PprofProfileWriter::WriteHeader() {
+  // The first string of the table must be the empty string.
+  Intern(std::string());
+  AppendValueType(kProfileSampleType, "samples", "count");
+  AppendValueType(kProfileSampleType, "cpu", "nanoseconds");
+  AppendValueType(kProfilePeriodType, "cpu", "nanoseconds");
+  milestones_key_ = Intern("process_milestones");
+}
+
+int64_t PprofProfileWriter::Intern(const std::string& str) {
+  auto inserted = string_indices_.emplace(
+      str, static_cast<int64_t>(string_indices_.size()));
+  if (inserted.second) {
+    const size_t old_size = buffer_.size();
+    AppendBytesField(kProfileStringTable, str.data(), str.size(), &buffer_);
+    bytes_encoded_ += buffer_.size() - old_size;
+  }
+  return inserted.first->second;
+}
+
+uint64_t PprofProfileWriter::MappingId(
+    const StackSamplingProfiler::Module& module) {
+  auto inserted = mapping_indices_.emplace(
+      ModuleKey(module.base_address, module.id, module.filename.value()),
+      mappings_.size());
+  if (inserted.second) {
+    Mapping mapping;
+    mapping.id = mappings_.size() + 1;
+    mapping.memory_start = module.base_address;
+    mapping.memory_limit = module.base_address + 1;
+    mapping.filename = Intern(module.filename.AsUTF8Unsafe());
+    mapping.build_id = Intern(module.id);
+    mappings_.push_back(mapping);
+  }
+  return mappings_[inserted.first->second].id;
+}
+
+uint64_t PprofProfileWriter::LocationId(
+    const StackSamplingProfiler::Frame& frame,
+    const std::vector<uint64_t>& mapping_ids) {
+  const uint64_t mapping_id =
+      frame.module_index < mapping_ids.size() ? mapping_ids[frame.module_index]
+                                              : 0;
+  auto inserted = location_ids_.emplace(
+      std::make_pair(mapping_id, frame.instruction_pointer),
+      location_ids_.size() + 1);
+  if (!inserted.second)
+    return inserted.first->second;
+
+  std::string location;
+  AppendVarintField(kLocationId, inserted.first->second, &location);
+  if (mapping_id) {
+    AppendVarintField(kLocationMappingId, mapping_id, &location);
+    Mapping& mapping = mappings_[mapping_id - 1];
+    mapping.memory_limit =
+        std::max(mapping.memory_limit, frame.instruction_pointer + 1);
+  }
+  AppendVarintField(kLocationAddress, frame.instruction_pointer, &location);
+  AppendMessage(kProfileLocation, location);
+  return inserted.first->second;
+}
+
+void PprofProfileWriter::AppendValueType(uint32_t field,
+                                         const std::string& type,
+                                         const std::string& unit) {
+  // Interning may write strings, which can't go in the middle of the message.
+  const int64_t type_index = Intern(type);
+  const int64_t unit_index = Intern(unit);
+  message_.clear();
+  AppendVarintField(kValueTypeType, type_index, &message_);
+  AppendVarintField(kValueTypeUnit, unit_index, &message_);
+  AppendMessage(field, message_);
+}
+
+void PprofProfileWriter::AppendMessage(uint32_t field,
+                                       const std::string& message) {
+  const size_t old_size = buffer_.size();
+  AppendBytesField(field, message.data(), message.size(), &buffer_);
+  bytes_encoded_ += buffer_.size() - old_size;
+  if (buffer_.size() >= kFlushThreshold)
+    Flush();
+}
+
+}  // namespace base
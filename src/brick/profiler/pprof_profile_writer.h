@@ -0,0 +1,137 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_PROFILER_PPROF_PROFILE_WRITER_H_
+#define BRICK_PROFILER_PPROF_PROFILE_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "brick/base_export.h"
+#include "brick/files/file.h"
+#include "brick/macros.h"
+#include "brick/profiler/stack_sampling_profiler.h"
+#include "brick/time/time.h"
+
+namespace base {
+
+// Serializes the CallStackProfiles of a StackSamplingProfiler into an
+// uncompressed pprof profile (profile.proto of
+// https://github.com/google/pprof), which pprof and other standard tools load
+// and merge across processes. The frames are not symbolized: each module
+// becomes a Mapping with its build id, for pprof to symbolize from the
+// binaries.
+//
+// The output is written incrementally. Strings and locations are written the
+// first time they are seen, and the samples of a CallStackProfile are written
+// as soon as it is added, with the identical stacks aggregated. Only the
+// dedup tables and the modules are kept, so the memory used doesn't grow with
+// the number of samples of a long session.
+//
+// Not thread safe; use from one sequence at a time.
+class BRICK_EXPORT PprofProfileWriter {
+ public:
+  // Encoded bytes are written once this many are buffered.
+  static constexpr size_t kFlushThreshold = 64 * 1024;
+
+  // Writes to |file|, which must be valid and open for writing.
+  explicit PprofProfileWriter(File file);
+  // Appends to |output|, which must outlive the writer.
+  explicit PprofProfileWriter(std::string* output);
+  // Implicitly calls Finish().
+  ~PprofProfileWriter();
+
+  // Encodes the samples of |profile|. Each sample is counted once, and for
+  // |profile.sampling_period| of CPU time.
+  void AddProfile(const StackSamplingProfiler::CallStackProfile& profile);
+
+  // Writes the mappings and the totals of the profiles added so far, and
+  // flushes. Nothing can be added afterwards. Returns false if a write
+  // failed.
+  bool Finish();
+
+  // Writes out whatever is buffered. Returns false if this or a previous
+  // write failed, after which the rest of the profile is dropped.
+  bool Flush();
+
+  // Number of bytes encoded so far, including the buffered ones.
+  uint64_t bytes_encoded() const { return bytes_encoded_; }
+  size_t samples_encoded() const { return samples_encoded_; }
+  size_t locations_encoded() const { return location_ids_.size(); }
+
+  bool has_error() const { return has_error_; }
+
+ private:
+  // Keys the modules of all the profiles, which each have their own list.
+  using ModuleKey = std::tuple<uintptr_t, std::string, FilePath::StringType>;
+
+  struct Mapping {
+    uint64_t id;
+    uintptr_t memory_start;
+    // One past the highest address sampled in the module.
+    uintptr_t memory_limit;
+    int64_t filename;
+    int64_t build_id;
+  };
+
+  // Writes the string table's empty string and the value types.
+  void WriteHeader();
+
+  // Returns the index of |str| in the string table, writing it if it is seen
+  // for the first time.
+  int64_t Intern(const std::string& str);
+
+  // Returns the id of the mapping of |module|, adding it if needed.
+  uint64_t MappingId(const StackSamplingProfiler::Module& module);
+
+  // Returns the id of the location of |frame|, writing it if it is seen for
+  // the first time.
+  uint64_t LocationId(const StackSamplingProfiler::Frame& frame,
+                      const std::vector<uint64_t>& mapping_ids);
+
+  // Appends a ValueType message as |field| of the profile.
+  void AppendValueType(uint32_t field,
+                       const std::string& type,
+                       const std::string& unit);
+
+  void AppendMessage(uint32_t field, const std::string& message);
+
+  File file_;
+  std::string* output_ = nullptr;
+
+  // Encoded bytes not written to |file_| yet.
+  std::string buffer_;
+  // Scratch space for the message being encoded; kept to reuse its capacity.
+  std::string message_;
+
+  std::unordered_map<std::string, int64_t> string_indices_;
+  std::map<ModuleKey, size_t> mapping_indices_;
+  std::vector<Mapping> mappings_;
+  // Keyed by mapping id, zero for frames of unknown modules, and address.
+  std::map<std::pair<uint64_t, uintptr_t>, uint64_t> location_ids_;
+
+  // The label key of Sample::process_milestones.
+  int64_t milestones_key_ = 0;
+
+  TimeDelta total_duration_;
+  TimeDelta sampling_period_;
+
+  uint64_t bytes_encoded_ = 0;
+  size_t samples_encoded_ = 0;
+  bool finished_ = false;
+  bool has_error_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(PprofProfileWriter);
+};
+
+}  // namespace base
+
+#endif  // BRICK_PROFILER_PPROF_PROFILE_WRITER_H_
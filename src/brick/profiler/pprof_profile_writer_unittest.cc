@@ -0,0 +1,269 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/profiler/pprof_profile_writer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "brick/files/file.h"
+#include "brick/files/file_path.h"
+#include "brick/files/file_util.h"
+#include "brick/files/scoped_temp_dir.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+using Frame = StackSamplingProfiler::Frame;
+using Module = StackSamplingProfiler::Module;
+using Sample = StackSamplingProfiler::Sample;
+using CallStackProfile = StackSamplingProfiler::CallStackProfile;
+
+// The fields of a profile.proto message, keyed by field number. Varints are
+// in |values|, length delimited fields in |bytes|.
+struct Message {
+  std::multimap<uint32_t, uint64_t> values;
+  std::multimap<uint32_t, std::string> bytes;
+
+  uint64_t value(uint32_t field) const {
+    auto it = values.find(field);
+    return it == values.end() ? 0 : it->second;
+  }
+};
+
+bool ReadVarint(const std::string& in, size_t* pos, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *pos < in.size(); shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(in[(*pos)++]);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// Decodes the varint and length delimited fields of a message, which are the
+// only ones the writer uses.
+bool ParseMessage(const std::string& in, Message* message) {
+  size_t pos = 0;
+  while (pos < in.size()) {
+    uint64_t tag;
+    uint64_t value;
+    if (!ReadVarint(in, &pos, &tag) || !ReadVarint(in, &pos, &value))
+      return false;
+    const uint32_t field = static_cast<uint32_t>(tag >> 3);
+    switch (tag & 7) {
+      case 0:
+        message->values.emplace(field, value);
+        break;
+      case 2:
+        if (value > in.size() - pos)
+          return false;
+        message->bytes.emplace(field, in.substr(pos, value));
+        pos += value;
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+std::vector<uint64_t> ParsePacked(const std::string& in) {
+  std::vector<uint64_t> values;
+  size_t pos = 0;
+  uint64_t value;
+  while (pos < in.size() && ReadVarint(in, &pos, &value))
+    values.push_back(value);
+  return values;
+}
+
+// The parts of a decoded profile that the tests look at.
+struct Profile {
+  std::vector<std::string> strings;
+  std::vector<Message> samples;
+  std::vector<Message> mappings;
+  std::vector<Message> locations;
+  std::vector<Message> sample_types;
+  uint64_t duration_nanos = 0;
+  uint64_t period = 0;
+};
+
+bool ParseProfile(const std::string& in, Profile* profile) {
+  Message message;
+  if (!ParseMessage(in, &message))
+    return false;
+  auto parse_all = [&message](uint32_t field, std::vector<Message>* out) {
+    auto range = message.bytes.equal_range(field);
+    for (auto it = range.first; it != range.second; ++it) {
+      out->emplace_back();
+      if (!ParseMessage(it->second, &out->back()))
+        return false;
+    }
+    return true;
+  };
+  auto strings = message.bytes.equal_range(6);
+  for (auto it = strings.first; it != strings.second; ++it)
+    profile->strings.push_back(it->second);
+  profile->duration_nanos = message.value(10);
+  profile->period = message.value(12);
+  return parse_all(1, &profile->sample_types) &&
+         parse_all(2, &profile->samples) && parse_all(3, &profile->mappings) &&
+         parse_all(4, &profile->locations);
+}
+
+CallStackProfile MakeProfile() {
+  CallStackProfile profile;
+  profile.modules.emplace_back(0x1000, "ABCD",
+                               FilePath(FILE_PATH_LITERAL("libfoo.so")));
+  profile.modules.emplace_back(0x8000, "EF01",
+                               FilePath(FILE_PATH_LITERAL("libbar.so")));
+  const std::vector<Frame> stack = {Frame(0x1010, 0), Frame(0x8020, 1)};
+  profile.samples.emplace_back(stack);
+  profile.samples.emplace_back(stack);
+  profile.samples.emplace_back(
+      std::vector<Frame>{Frame(0x1010, 0), Frame(0x9999, 1),
+                         Frame(0x42, Frame::kUnknownModuleIndex)});
+  profile.samples.back().process_milestones = 5;
+  profile.profile_duration = TimeDelta::FromMilliseconds(30);
+  profile.sampling_period = TimeDelta::FromMilliseconds(10);
+  return profile;
+}
+
+}  // namespace
+
+TEST(PprofProfileWriterTest, EncodesProfile) {
+  std::string output;
+  {
+    PprofProfileWriter writer(&output);
+    writer.AddProfile(MakeProfile());
+    EXPECT_TRUE(writer.Finish());
+    EXPECT_EQ(3u, writer.samples_encoded());
+    EXPECT_EQ(4u, writer.locations_encoded());
+    EXPECT_EQ(output.size(), writer.bytes_encoded());
+  }
+
+  Profile profile;
+  ASSERT_TRUE(ParseProfile(output, &profile));
+  ASSERT_FALSE(profile.strings.empty());
+  EXPECT_EQ("", profile.strings[0]);
+  auto string_at = [&profile](uint64_t index) {
+    return index < profile.strings.size() ? profile.strings[index]
+                                          : "<invalid>";
+  };
+
+  ASSERT_EQ(2u, profile.sample_types.size());
+  EXPECT_EQ("samples", string_at(profile.sample_types[0].value(1)));
+  EXPECT_EQ("cpu", string_at(profile.sample_types[1].value(1)));
+  EXPECT_EQ("nanoseconds", string_at(profile.sample_types[1].value(2)));
+  EXPECT_EQ(30000000u, profile.duration_nanos);
+  EXPECT_EQ(10000000u, profile.period);
+
+  ASSERT_EQ(2u, profile.mappings.size());
+  EXPECT_EQ(1u, profile.mappings[0].value(1));
+  EXPECT_EQ(0x1000u, profile.mappings[0].value(2));
+  EXPECT_EQ(0x1011u, profile.mappings[0].value(3));
+  EXPECT_EQ("libfoo.so", string_at(profile.mappings[0].value(5)));
+  EXPECT_EQ("ABCD", string_at(profile.mappings[0].value(6)));
+  EXPECT_EQ(0x8000u, profile.mappings[1].value(2));
+  EXPECT_EQ(0x999Au, profile.mappings[1].value(3));
+
+  // The location of the frame of an unknown module has no mapping.
+  std::map<uint64_t, std::pair<uint64_t, uint64_t>> locations;
+  for (const Message& location : profile.locations) {
+    locations[location.value(1)] =
+        std::make_pair(location.value(2), location.value(3));
+  }
+  ASSERT_EQ(4u, locations.size());
+  EXPECT_EQ(std::make_pair(uint64_t{0}, uint64_t{0x42}),
+            locations[profile.locations[3].value(1)]);
+
+  // The two identical stacks are aggregated.
+  ASSERT_EQ(2u, profile.samples.size());
+  uint64_t total_count = 0;
+  for (const Message& sample : profile.samples) {
+    const std::vector<uint64_t> location_ids =
+        ParsePacked(sample.bytes.find(1)->second);
+    const std::vector<uint64_t> values =
+        ParsePacked(sample.bytes.find(2)->second);
+    ASSERT_EQ(2u, values.size());
+    EXPECT_EQ(values[0] * 10000000, values[1]);
+    total_count += values[0];
+    if (values[0] == 2) {
+      ASSERT_EQ(2u, location_ids.size());
+      EXPECT_EQ(std::make_pair(uint64_t{1}, uint64_t{0x1010}),
+                locations[location_ids[0]]);
+      EXPECT_EQ(std::make_pair(uint64_t{2}, uint64_t{0x8020}),
+                locations[location_ids[1]]);
+      EXPECT_EQ(0u, sample.bytes.count(3));
+    } else {
+      EXPECT_EQ(3u, location_ids.size());
+      ASSERT_EQ(1u, sample.bytes.count(3));
+      Message label;
+      ASSERT_TRUE(ParseMessage(sample.bytes.find(3)->second, &label));
+      EXPECT_EQ("process_milestones", string_at(label.value(1)));
+      EXPECT_EQ(5u, label.value(3));
+    }
+  }
+  EXPECT_EQ(3u, total_count);
+}
+
+TEST(PprofProfileWriterTest, DeduplicatesAcrossProfiles) {
+  std::string output;
+  PprofProfileWriter writer(&output);
+  writer.AddProfile(MakeProfile());
+  const uint64_t first_size = writer.bytes_encoded();
+  writer.AddProfile(MakeProfile());
+  // The second profile only adds samples.
+  EXPECT_LT(writer.bytes_encoded() - first_size, first_size / 2);
+  EXPECT_TRUE(writer.Finish());
+  EXPECT_EQ(4u, writer.locations_encoded());
+  EXPECT_EQ(6u, writer.samples_encoded());
+
+  Profile profile;
+  ASSERT_TRUE(ParseProfile(output, &profile));
+  EXPECT_EQ(2u, profile.mappings.size());
+  EXPECT_EQ(4u, profile.locations.size());
+  EXPECT_EQ(4u, profile.samples.size());
+  EXPECT_EQ(60000000u, profile.duration_nanos);
+  std::map<std::string, int> string_counts;
+  for (const std::string& str : profile.strings)
+    ++string_counts[str];
+  for (const auto& count : string_counts)
+    EXPECT_EQ(1, count.second) << count.first;
+}
+
+TEST(PprofProfileWriterTest, WritesToFile) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const FilePath path = temp_dir.GetPath().AppendASCII("profile.pb");
+
+  std::string expected;
+  {
+    PprofProfileWriter string_writer(&expected);
+    PprofProfileWriter file_writer(
+        File(path, File::FLAG_CREATE_ALWAYS | File::FLAG_WRITE));
+    // Enough distinct locations to go over kFlushThreshold.
+    CallStackProfile profile = MakeProfile();
+    for (uintptr_t i = 0; i < 20000; ++i)
+      profile.samples.emplace_back(Frame(0x2000 + i, 0));
+    string_writer.AddProfile(profile);
+    file_writer.AddProfile(profile);
+    EXPECT_GT(file_writer.bytes_encoded(), PprofProfileWriter::kFlushThreshold);
+    EXPECT_TRUE(file_writer.Finish());
+  }
+
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(path, &contents));
+  EXPECT_EQ(expected, contents);
+}
+
+}  // namespace base
@@ -42,8 +42,9 @@
 #endif
 
 // STACK_SAMPLING_PROFILER_SUPPORTED is used to conditionally enable the tests
-// below for supported platforms (currently Win x64 and Mac x64).
-#if defined(_WIN64) || (defined(OS_MACOSX) && !defined(OS_IOS))
+// below for supported platforms (currently Win x64, Mac x64 and Linux x64).
+#if defined(_WIN64) || (defined(OS_MACOSX) && !defined(OS_IOS)) || \
+    (defined(OS_LINUX) && defined(ARCH_CPU_X86_64))
 #define STACK_SAMPLING_PROFILER_SUPPORTED 1
 #endif
 
@@ -317,8 +318,8 @@ void SynchronousUnloadNativeLibrary(NativeLibrary library) {
          ::GetLastError() != ERROR_MOD_NOT_FOUND) {
     PlatformThread::Sleep(TimeDelta::FromMilliseconds(1));
   }
-#elif defined(OS_MACOSX)
-// Unloading a library on the Mac is synchronous.
+#elif defined(OS_MACOSX) || defined(OS_LINUX)
+// Unloading a library on the Mac and Linux is synchronous.
 #else
   NOTIMPLEMENTED();
 #endif
@@ -1347,8 +1348,8 @@ PROFILER_TEST_F(StackSamplingProfilerTest, MAYBE_OtherLibrary) {
 
 // Checks that a stack that runs through a library that is unloading produces a
 // stack, and doesn't crash.
-// Unloading is synchronous on the Mac, so this test is inapplicable.
-#if !defined(OS_MACOSX)
+// Unloading is synchronous on the Mac and Linux, so this test is inapplicable.
+#if !defined(OS_MACOSX) && !defined(OS_LINUX)
 #define MAYBE_UnloadingLibrary UnloadingLibrary
 #else
 #define MAYBE_UnloadingLibrary DISABLED_UnloadingLibrary
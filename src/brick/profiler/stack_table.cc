@@ -0,0 +1,91 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/profiler/stack_table.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+namespace base {
+
+namespace {
+
+size_t HashFrames(const void* const* frames, size_t depth) {
+  uint64_t hash = depth;
+  for (size_t i = 0; i < depth; ++i) {
+    hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) *
+           UINT64_C(0x9E3779B97F4A7C15);
+  }
+  return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+}  // namespace
+
+StackTable::StackTable()
+    : buckets_(new std::atomic<const Stack*>[kNumBuckets]()) {}
+
+StackTable::~StackTable() {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    const Stack* stack = buckets_[i].load(std::memory_order_relaxed);
+    while (stack) {
+      const Stack* next = stack->next_;
+      stack->~Stack();
+      ::operator delete(const_cast<Stack*>(stack));
+      stack = next;
+    }
+  }
+}
+
+const StackTable::Stack* StackTable::Intern(const void* const* frames,
+                                            size_t depth) {
+  const size_t hash = HashFrames(frames, depth);
+  std::atomic<const Stack*>& bucket = buckets_[hash & (kNumBuckets - 1)];
+  const Stack* head = bucket.load(std::memory_order_acquire);
+  const Stack* found = Find(head, nullptr, hash, frames, depth);
+  if (found)
+    return found;
+
+  const size_t allocation_size =
+      sizeof(Stack) + (std::max<size_t>(depth, 1) - 1) * sizeof(void*);
+  Stack* stack = new (::operator new(allocation_size)) Stack;
+  stack->hash_ = hash;
+  stack->depth_ = depth;
+  if (depth)
+    memcpy(stack->frames_, frames, depth * sizeof(void*));
+
+  stack->next_ = head;
+  while (!bucket.compare_exchange_weak(stack->next_, stack,
+                                       std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+    // Another thread may have added the same stack meanwhile.
+    found = Find(stack->next_, head, hash, frames, depth);
+    if (found) {
+      stack->~Stack();
+      ::operator delete(stack);
+      return found;
+    }
+    head = stack->next_;
+  }
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return stack;
+}
+
+// static
+const StackTable::Stack* StackTable::Find(const Stack* stack,
+                                          const Stack* end,
+                                          size_t hash,
+                                          const void* const* frames,
+                                          size_t depth) {
+  for (; stack != end; stack = stack->next_) {
+    if (stack->hash_ == hash && stack->depth_ == depth &&
+        std::equal(frames, frames + depth, stack->frames_)) {
+      return stack;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace base
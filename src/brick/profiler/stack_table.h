@@ -0,0 +1,77 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_PROFILER_STACK_TABLE_H_
+#define BRICK_PROFILER_STACK_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "brick/base_export.h"
+#include "brick/macros.h"
+
+namespace base {
+
+// A set of call stacks, which stores each distinct stack once. Profilers
+// which record many samples from a few code paths keep a pointer to the
+// interned stack instead of a copy of its frames.
+//
+// Interning is lock-free, so that allocator hooks on any number of threads
+// can use the same table. Stacks are never removed: they live as long as the
+// table, which is meant to live as long as the profiler using it.
+class BRICK_EXPORT StackTable {
+ public:
+  class Stack {
+   public:
+    size_t depth() const { return depth_; }
+    const void* const* frames() const { return frames_; }
+
+   private:
+    friend class StackTable;
+
+    Stack() = default;
+
+    const Stack* next_;
+    size_t hash_;
+    size_t depth_;
+    // |depth_| frames, allocated with the stack.
+    const void* frames_[1];
+
+    DISALLOW_COPY_AND_ASSIGN(Stack);
+  };
+
+  StackTable();
+  ~StackTable();
+
+  // Returns the stack with the |depth| frames of |frames|, adding it if it
+  // isn't in the table. Thread safe.
+  const Stack* Intern(const void* const* frames, size_t depth);
+
+  // Number of distinct stacks in the table.
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+ private:
+  static constexpr size_t kNumBucketsLog2 = 14;
+  static constexpr size_t kNumBuckets = size_t{1} << kNumBucketsLog2;
+
+  // Returns the stack of the list starting at |stack| which has |frames|,
+  // looking until |end|, or nullptr.
+  static const Stack* Find(const Stack* stack,
+                           const Stack* end,
+                           size_t hash,
+                           const void* const* frames,
+                           size_t depth);
+
+  const std::unique_ptr<std::atomic<const Stack*>[]> buckets_;
+  std::atomic<size_t> size_{0};
+
+  DISALLOW_COPY_AND_ASSIGN(StackTable);
+};
+
+}  // namespace base
+
+#endif  // BRICK_PROFILER_STACK_TABLE_H_
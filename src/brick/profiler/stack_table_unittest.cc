@@ -0,0 +1,105 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/profiler/stack_table.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "brick/macros.h"
+#include "brick/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const void* Frame(uintptr_t address) {
+  return reinterpret_cast<const void*>(address);
+}
+
+constexpr size_t kNumStacks = 1000;
+constexpr size_t kStackDepth = 8;
+
+// Interns |kNumStacks| stacks, which are the same for all the threads.
+class InterningThread : public SimpleThread {
+ public:
+  explicit InterningThread(StackTable* table)
+      : SimpleThread("InterningThread"), table_(table) {}
+
+  void Run() override {
+    for (size_t i = 0; i < kNumStacks; ++i) {
+      const void* frames[kStackDepth];
+      for (size_t j = 0; j < kStackDepth; ++j)
+        frames[j] = Frame(i * 16 + j);
+      stacks_.push_back(table_->Intern(frames, kStackDepth));
+    }
+  }
+
+  const std::vector<const StackTable::Stack*>& stacks() const {
+    return stacks_;
+  }
+
+ private:
+  StackTable* const table_;
+  std::vector<const StackTable::Stack*> stacks_;
+
+  DISALLOW_COPY_AND_ASSIGN(InterningThread);
+};
+
+}  // namespace
+
+TEST(StackTableTest, Intern) {
+  StackTable table;
+  const void* frames[] = {Frame(0x10), Frame(0x20), Frame(0x30)};
+  const StackTable::Stack* stack = table.Intern(frames, arraysize(frames));
+  ASSERT_EQ(3u, stack->depth());
+  EXPECT_EQ(Frame(0x10), stack->frames()[0]);
+  EXPECT_EQ(Frame(0x30), stack->frames()[2]);
+  EXPECT_NE(frames, stack->frames());
+  EXPECT_EQ(1u, table.size());
+
+  // Same frames.
+  const void* same_frames[] = {Frame(0x10), Frame(0x20), Frame(0x30)};
+  EXPECT_EQ(stack, table.Intern(same_frames, arraysize(same_frames)));
+  EXPECT_EQ(1u, table.size());
+
+  // A prefix, and a stack with a different frame.
+  const StackTable::Stack* prefix = table.Intern(frames, 2);
+  EXPECT_NE(stack, prefix);
+  EXPECT_EQ(2u, prefix->depth());
+  same_frames[1] = Frame(0x28);
+  EXPECT_NE(stack, table.Intern(same_frames, arraysize(same_frames)));
+  EXPECT_EQ(3u, table.size());
+
+  const StackTable::Stack* empty = table.Intern(nullptr, 0);
+  EXPECT_EQ(0u, empty->depth());
+  EXPECT_EQ(empty, table.Intern(frames, 0));
+  EXPECT_EQ(4u, table.size());
+}
+
+TEST(StackTableTest, ConcurrentIntern) {
+  StackTable table;
+  std::vector<std::unique_ptr<InterningThread>> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.push_back(std::make_unique<InterningThread>(&table));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads)
+    thread->Join();
+
+  // All the threads got the same stacks.
+  EXPECT_EQ(kNumStacks, table.size());
+  for (auto& thread : threads)
+    EXPECT_EQ(threads[0]->stacks(), thread->stacks());
+  for (size_t i = 0; i < kNumStacks; ++i) {
+    const StackTable::Stack* stack = threads[0]->stacks()[i];
+    ASSERT_EQ(kStackDepth, stack->depth());
+    EXPECT_EQ(Frame(i * 16), stack->frames()[0]);
+  }
+}
+
+}  // namespace base
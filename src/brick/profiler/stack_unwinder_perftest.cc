@@ -0,0 +1,103 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares the cost of capturing the stack of a sampled allocation with
+// base::debug::StackTrace and with UnwindFramePointers(), with and without
+// interning the stack in a StackTable.
+
+#include <stddef.h>
+
+#include <string>
+
+#include "brick/compiler_specific.h"
+#include "brick/debug/debugging_buildflags.h"
+#include "brick/debug/stack_trace.h"
+#include "brick/profiler/frame_pointer_unwinder.h"
+#include "brick/profiler/stack_table.h"
+#include "brick/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+constexpr int kIterations = 100000;
+// Roughly the depth of an allocation made by a task.
+constexpr int kStackDepth = 32;
+constexpr size_t kMaxFrames = 64;
+
+enum class Unwinder {
+  kStackTrace,
+  kFramePointers,
+  kFramePointersAndStackTable,
+};
+
+NOINLINE size_t Unwind(Unwinder unwinder, StackTable* table) {
+  const void* frames[kMaxFrames];
+  switch (unwinder) {
+    case Unwinder::kStackTrace: {
+      debug::StackTrace trace(kMaxFrames);
+      size_t count;
+      trace.Addresses(&count);
+      return count;
+    }
+    case Unwinder::kFramePointers:
+      return UnwindFramePointers(frames, kMaxFrames, 0);
+    case Unwinder::kFramePointersAndStackTable: {
+      const size_t count = UnwindFramePointers(frames, kMaxFrames, 0);
+      return table->Intern(frames, count)->depth();
+    }
+  }
+  return 0;
+}
+
+// Calls itself until the stack is |depth| frames deeper, then times
+// Unwind(). Returns the number of frames of the last unwinding.
+NOINLINE size_t UnwindAtDepth(int depth,
+                              Unwinder unwinder,
+                              StackTable* table,
+                              TimeDelta* elapsed) {
+  if (depth > 0) {
+    // Adding one keeps this from being a tail call.
+    return UnwindAtDepth(depth - 1, unwinder, table, elapsed) + 1;
+  }
+  size_t frames = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i)
+    frames = Unwind(unwinder, table);
+  *elapsed = TimeTicks::Now() - start;
+  return frames;
+}
+
+void RunUnwindTest(Unwinder unwinder, const std::string& trace) {
+  StackTable table;
+  TimeDelta elapsed;
+  const size_t frames = UnwindAtDepth(kStackDepth, unwinder, &table, &elapsed);
+  // Only the frames of UnwindAtDepth() are certain to be found.
+  EXPECT_GE(frames, static_cast<size_t>(kStackDepth));
+  perf_test::PrintResult(
+      "unwind_time", "", trace,
+      elapsed.InNanoseconds() / static_cast<double>(kIterations), "ns/unwind",
+      true);
+}
+
+}  // namespace
+
+TEST(StackUnwinderPerfTest, StackTrace) {
+  RunUnwindTest(Unwinder::kStackTrace, "StackTrace");
+}
+
+#if BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS)
+TEST(StackUnwinderPerfTest, FramePointers) {
+  RunUnwindTest(Unwinder::kFramePointers, "FramePointers");
+}
+
+TEST(StackUnwinderPerfTest, FramePointersAndStackTable) {
+  RunUnwindTest(Unwinder::kFramePointersAndStackTable,
+                "FramePointersAndStackTable");
+}
+#endif  // BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS)
+
+}  // namespace base
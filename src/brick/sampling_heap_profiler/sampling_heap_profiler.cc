@@ -12,12 +12,16 @@
 #include "brick/allocator/buildflags.h"
 #include "brick/allocator/partition_allocator/partition_alloc.h"
 #include "brick/atomicops.h"
+#include "brick/debug/debugging_buildflags.h"
 #include "brick/debug/stack_trace.h"
 #include "brick/macros.h"
 #include "brick/no_destructor.h"
 #include "brick/partition_alloc_buildflags.h"
+#include "brick/profiler/frame_pointer_unwinder.h"
 #include "brick/rand_util.h"
+#include "brick/threading/platform_thread.h"
 #include "brick/threading/thread_local_storage.h"
+#include "brick/trace_event/heap_profiler_allocation_context_tracker.h"
 #include "build/build_config.h"
 
 namespace base {
@@ -34,15 +38,15 @@ const uint32_t kSkipBaseAllocatorFrames = 2;
 
 const size_t kDefaultSamplingIntervalBytes = 128 * 1024;
 
+// Deeper than what base::debug::StackTrace captures.
+const size_t kMaxStackDepth = 64;
+
 // Controls if sample intervals should not be randomized. Used for testing.
 bool g_deterministic;
 
 // A positive value if profiling is running, otherwise it's zero.
 Atomic32 g_running;
 
-// Pointer to the current |SamplingHeapProfiler::SamplesMap|.
-AtomicWord g_current_samples_map;
-
 // Sampling interval parameter, the mean value for intervals between samples.
 AtomicWord g_sampling_interval = kDefaultSamplingIntervalBytes;
 
@@ -161,6 +165,174 @@ ThreadLocalStorage::Slot& AccumulatedBytesTLS() {
 
 }  // namespace
 
+// A hash table of the live samples, keyed by address. Samples are added,
+// removed and looked up without locks:
+// - The buckets are lists of nodes which are never unlinked nor deleted. A
+//   node is free while its address is null, and a sample claims it with a
+//   compare-and-swap, or pushes a new node to its bucket if there is none.
+// - The sample of a node is written like the value of a SeqLock: readers
+//   copying it in CollectSamples() retry if a writer changed it meanwhile.
+// The number of buckets is fixed, and large enough for the samples of a
+// large heap at a sampling interval of tens of KB to take a node or two per
+// bucket.
+class SamplingHeapProfiler::SampleTable {
+ public:
+  SampleTable() : buckets_(new std::atomic<Node*>[kNumBuckets]()) {}
+
+  // Adds a sample for |address|, unless it already has one. Returns whether
+  // it was added.
+  bool Insert(void* address,
+              size_t size,
+              size_t total,
+              uint32_t ordinal,
+              const StackTable::Stack* stack,
+              const char* type_name) {
+    std::atomic<Node*>& bucket = buckets_[BucketIndex(address)];
+    Node* const head = bucket.load(std::memory_order_acquire);
+    for (Node* node = head; node; node = node->next) {
+      if (node->address.load(std::memory_order_relaxed) == address)
+        return false;
+    }
+    Node* node = head;
+    for (; node; node = node->next) {
+      void* expected = nullptr;
+      // Acquire pairs with the release of Remove(), so that the sample the
+      // node held is written before this one.
+      if (node->address.compare_exchange_strong(expected, address,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    if (!node) {
+      node = new Node;
+      node->address.store(address, std::memory_order_relaxed);
+      node->next = bucket.load(std::memory_order_relaxed);
+      while (!bucket.compare_exchange_weak(node->next, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+      }
+    }
+
+    BeginWrite(node);
+    node->size.store(size, std::memory_order_relaxed);
+    node->total.store(total, std::memory_order_relaxed);
+    node->stack.store(stack, std::memory_order_relaxed);
+    node->type_name.store(type_name, std::memory_order_relaxed);
+    node->ordinal.store(ordinal, std::memory_order_relaxed);
+    EndWrite(node);
+    return true;
+  }
+
+  // Removes the sample of |address|. Returns its ordinal, or 0 if there was
+  // none.
+  uint32_t Remove(void* address) {
+    Node* node = Find(address);
+    if (!node)
+      return 0;
+    const uint32_t ordinal = node->ordinal.load(std::memory_order_relaxed);
+    BeginWrite(node);
+    node->ordinal.store(0, std::memory_order_relaxed);
+    EndWrite(node);
+    node->address.store(nullptr, std::memory_order_release);
+    return ordinal;
+  }
+
+  bool Contains(void* address) const { return Find(address) != nullptr; }
+
+  // Appends copies of the samples with ordinals above |profile_id|.
+  void CollectSamples(uint32_t profile_id, std::vector<Sample>* samples) const {
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+      for (Node* node = buckets_[i].load(std::memory_order_acquire); node;
+           node = node->next) {
+        for (;;) {
+          const uint32_t sequence =
+              node->sequence.load(std::memory_order_acquire);
+          if (sequence & 1) {
+            PlatformThread::YieldCurrentThread();
+            continue;
+          }
+          const uint32_t ordinal =
+              node->ordinal.load(std::memory_order_relaxed);
+          const size_t size = node->size.load(std::memory_order_relaxed);
+          const size_t total = node->total.load(std::memory_order_relaxed);
+          const StackTable::Stack* stack =
+              node->stack.load(std::memory_order_relaxed);
+          const char* type_name =
+              node->type_name.load(std::memory_order_relaxed);
+          // Orders the loads above before the sequence check below.
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (node->sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+          if (ordinal > profile_id) {
+            samples->push_back(Sample(size, total, ordinal));
+            samples->back().type_name = type_name;
+            // Interned stacks never change.
+            samples->back().stack.assign(
+                const_cast<void* const*>(stack->frames()),
+                const_cast<void* const*>(stack->frames()) + stack->depth());
+          }
+          break;
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kNumBucketsLog2 = 16;
+  static constexpr size_t kNumBuckets = size_t{1} << kNumBucketsLog2;
+
+  struct Node {
+    // Null while the node is free.
+    std::atomic<void*> address{nullptr};
+    // Set before the node is published, and never changes afterwards.
+    Node* next = nullptr;
+
+    // Odd while the sample is being written.
+    std::atomic<uint32_t> sequence{0};
+    // Zero while the node holds no sample.
+    std::atomic<uint32_t> ordinal{0};
+    std::atomic<size_t> size{0};
+    std::atomic<size_t> total{0};
+    std::atomic<const StackTable::Stack*> stack{nullptr};
+    std::atomic<const char*> type_name{nullptr};
+  };
+
+  static size_t BucketIndex(void* address) {
+    // Fibonacci hashing; the low bits of addresses are mostly zero.
+    const uint64_t key = reinterpret_cast<uintptr_t>(address);
+    return static_cast<size_t>((key * UINT64_C(0x9E3779B97F4A7C15)) >>
+                               (64 - kNumBucketsLog2));
+  }
+
+  Node* Find(void* address) const {
+    for (Node* node = buckets_[BucketIndex(address)].load(
+             std::memory_order_acquire);
+         node; node = node->next) {
+      if (node->address.load(std::memory_order_relaxed) == address)
+        return node;
+    }
+    return nullptr;
+  }
+
+  // Only the thread which claimed a node writes its sample.
+  static void BeginWrite(Node* node) {
+    const uint32_t sequence = node->sequence.load(std::memory_order_relaxed);
+    node->sequence.store(sequence + 1, std::memory_order_relaxed);
+    // Orders the odd sequence number before the stores that follow.
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  static void EndWrite(Node* node) {
+    node->sequence.store(node->sequence.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_release);
+  }
+
+  const std::unique_ptr<std::atomic<Node*>[]> buckets_;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleTable);
+};
+
 SamplingHeapProfiler::Sample::Sample(size_t size,
                                      size_t total,
                                      uint32_t ordinal)
@@ -172,12 +344,10 @@ SamplingHeapProfiler::Sample::~Sample() = default;
 
 SamplingHeapProfiler* SamplingHeapProfiler::instance_;
 
-SamplingHeapProfiler::SamplingHeapProfiler() {
+SamplingHeapProfiler::SamplingHeapProfiler()
+    : samples_(std::make_unique<SampleTable>()),
+      stacks_(std::make_unique<StackTable>()) {
   instance_ = this;
-  auto samples_map = std::make_unique<SamplesMap>(64);
-  base::subtle::NoBarrier_Store(
-      &g_current_samples_map, reinterpret_cast<AtomicWord>(samples_map.get()));
-  sample_maps_.push(std::move(samples_map));
 }
 
 // static
@@ -185,6 +355,9 @@ void SamplingHeapProfiler::InitTLSSlot() {
   // Preallocate the TLS slot early, so it can't cause reentracy issues
   // when sampling is started.
   ignore_result(AccumulatedBytesTLS().Get());
+#if BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS)
+  ignore_result(GetThreadStackEnd());
+#endif
 }
 
 // static
@@ -231,7 +404,7 @@ void SamplingHeapProfiler::SetHooksInstallCallback(
 uint32_t SamplingHeapProfiler::Start() {
   InstallAllocatorHooksOnce();
   base::subtle::Barrier_AtomicIncrement(&g_running, 1);
-  return last_sample_ordinal_;
+  return last_sample_ordinal_.load(std::memory_order_relaxed);
 }
 
 void SamplingHeapProfiler::Stop() {
@@ -304,19 +477,25 @@ void SamplingHeapProfiler::RecordAlloc(void* address,
   instance_->DoRecordAlloc(samples * mean_interval, size, address, skip_frames);
 }
 
-void SamplingHeapProfiler::RecordStackTrace(Sample* sample,
-                                            uint32_t skip_frames) {
-#if !defined(OS_NACL)
-  // TODO(alph): Consider using debug::TraceStackFramePointers. It should be
-  // somewhat faster than base::debug::StackTrace.
-  base::debug::StackTrace trace;
-  size_t count;
-  void* const* addresses = const_cast<void* const*>(trace.Addresses(&count));
+size_t SamplingHeapProfiler::RecordStackTrace(const void** frames,
+                                              size_t max_frames,
+                                              uint32_t skip_frames) {
   const uint32_t kSkipProfilerOwnFrames = 2;
   skip_frames += kSkipProfilerOwnFrames;
-  sample->stack.insert(
-      sample->stack.end(), &addresses[skip_frames],
-      &addresses[std::max(count, static_cast<size_t>(skip_frames))]);
+#if BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS)
+  return UnwindFramePointers(frames, max_frames, skip_frames);
+#elif !defined(OS_NACL)
+  // Slower, but doesn't need frame pointers.
+  base::debug::StackTrace trace;
+  size_t count;
+  const void* const* addresses = trace.Addresses(&count);
+  if (count <= skip_frames)
+    return 0;
+  count = std::min(count - skip_frames, max_frames);
+  std::copy(addresses + skip_frames, addresses + skip_frames + count, frames);
+  return count;
+#else
+  return 0;
 #endif
 }
 
@@ -327,25 +506,43 @@ void SamplingHeapProfiler::DoRecordAlloc(size_t total_allocated,
   if (entered_.Get())
     return;
   entered_.Set(true);
-  {
+  // The stack is captured before the sample is published, so that threads
+  // sampling concurrently don't wait for each other.
+  const void* frames[kMaxStackDepth];
+  const size_t depth = RecordStackTrace(frames, kMaxStackDepth, skip_frames);
+  const StackTable::Stack* stack = stacks_->Intern(frames, depth);
+  const char* type_name = nullptr;
+  if (trace_event::AllocationContextTracker::capture_mode() !=
+      trace_event::AllocationContextTracker::CaptureMode::DISABLED) {
+    // Allocations made by creating the tracker aren't sampled, as |entered_|
+    // is set.
+    trace_event::AllocationContextTracker* tracker =
+        trace_event::AllocationContextTracker::GetInstanceForCurrentThread();
+    if (tracker)
+      type_name = tracker->current_task_context();
+  }
+  const uint32_t ordinal =
+      last_sample_ordinal_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (samples_->Insert(address, size, total_allocated, ordinal, stack,
+                       type_name) &&
+      has_observers_.load(std::memory_order_relaxed)) {
     base::AutoLock lock(mutex_);
-    Sample sample(size, total_allocated, ++last_sample_ordinal_);
-    RecordStackTrace(&sample, skip_frames);
     for (auto* observer : observers_)
-      observer->SampleAdded(sample.ordinal, size, total_allocated);
-    EnsureNoRehashingMap().emplace(address, std::move(sample));
+      observer->SampleAdded(ordinal, size, total_allocated);
   }
   entered_.Set(false);
 }
 
 // static
 void SamplingHeapProfiler::RecordFree(void* address) {
-  const SamplesMap& samples = SamplingHeapProfiler::samples();
-  if (UNLIKELY(samples.find(address) != samples.end()))
+  if (UNLIKELY(instance_->samples_->Contains(address)))
     instance_->DoRecordFree(address);
 }
 
 void SamplingHeapProfiler::DoRecordFree(void* address) {
+  const uint32_t ordinal = samples_->Remove(address);
+  if (!ordinal || !has_observers_.load(std::memory_order_relaxed))
+    return;
   if (UNLIKELY(base::ThreadLocalStorage::HasBeenDestroyed()))
     return;
   if (entered_.Get())
@@ -353,45 +550,12 @@ void SamplingHeapProfiler::DoRecordFree(void* address) {
   entered_.Set(true);
   {
     base::AutoLock lock(mutex_);
-    SamplesMap& samples = this->samples();
-    auto it = samples.find(address);
-    CHECK(it != samples.end());
     for (auto* observer : observers_)
-      observer->SampleRemoved(it->second.ordinal);
-    samples.erase(it);
+      observer->SampleRemoved(ordinal);
   }
   entered_.Set(false);
 }
 
-SamplingHeapProfiler::SamplesMap& SamplingHeapProfiler::EnsureNoRehashingMap() {
-  // The function makes sure we never rehash the current map in place.
-  // Instead if it comes close to the rehashing boundary, we allocate a twice
-  // larger map, copy the samples into it, and atomically switch new readers
-  // to use the new map.
-  // We still have to keep all the old maps alive to resolve the theoretical
-  // race with readers in |RecordFree| that have already obtained the map,
-  // but haven't yet managed to access it.
-  SamplesMap& samples = this->samples();
-  size_t max_items_before_rehash =
-      static_cast<size_t>(samples.bucket_count() * samples.max_load_factor());
-  // Conservatively use 2 instead of 1 to workaround potential rounding errors.
-  bool may_rehash_on_insert = samples.size() + 2 >= max_items_before_rehash;
-  if (!may_rehash_on_insert)
-    return samples;
-  auto new_map = std::make_unique<SamplesMap>(samples.begin(), samples.end(),
-                                              samples.bucket_count() * 2);
-  base::subtle::Release_Store(&g_current_samples_map,
-                              reinterpret_cast<AtomicWord>(new_map.get()));
-  sample_maps_.push(std::move(new_map));
-  return this->samples();
-}
-
-// static
-SamplingHeapProfiler::SamplesMap& SamplingHeapProfiler::samples() {
-  return *reinterpret_cast<SamplesMap*>(
-      base::subtle::NoBarrier_Load(&g_current_samples_map));
-}
-
 // static
 SamplingHeapProfiler* SamplingHeapProfiler::GetInstance() {
   static base::NoDestructor<SamplingHeapProfiler> instance;
@@ -409,6 +573,7 @@ void SamplingHeapProfiler::AddSamplesObserver(SamplesObserver* observer) {
   {
     base::AutoLock lock(mutex_);
     observers_.push_back(observer);
+    has_observers_.store(true, std::memory_order_relaxed);
   }
   entered_.Set(false);
 }
@@ -421,6 +586,7 @@ void SamplingHeapProfiler::RemoveSamplesObserver(SamplesObserver* observer) {
     auto it = std::find(observers_.begin(), observers_.end(), observer);
     CHECK(it != observers_.end());
     observers_.erase(it);
+    has_observers_.store(!observers_.empty(), std::memory_order_relaxed);
   }
   entered_.Set(false);
 }
@@ -430,14 +596,7 @@ std::vector<SamplingHeapProfiler::Sample> SamplingHeapProfiler::GetSamples(
   CHECK(!entered_.Get());
   entered_.Set(true);
   std::vector<Sample> samples;
-  {
-    base::AutoLock lock(mutex_);
-    for (auto& it : this->samples()) {
-      Sample& sample = it.second;
-      if (sample.ordinal > profile_id)
-        samples.push_back(sample);
-    }
-  }
+  samples_->CollectSamples(profile_id, &samples);
   entered_.Set(false);
   return samples;
 }
@@ -5,13 +5,13 @@
 #ifndef BRICK_SAMPLING_HEAP_PROFILER_SAMPLING_HEAP_PROFILER_H_
 #define BRICK_SAMPLING_HEAP_PROFILER_SAMPLING_HEAP_PROFILER_H_
 
+#include <atomic>
 #include <memory>
-#include <stack>
-#include <unordered_map>
 #include <vector>
 
 #include "brick/base_export.h"
 #include "brick/macros.h"
+#include "brick/profiler/stack_table.h"
 #include "brick/synchronization/lock.h"
 #include "brick/threading/thread_local.h"
 
@@ -25,6 +25,13 @@ class NoDestructor;
 // When started it selects and records allocation samples based on
 // the sampling_interval parameter.
 // The recorded samples can then be retrieved using GetSamples method.
+//
+// Samples are recorded without locks: the stack is captured by the allocating
+// thread, by following frame pointers when the build keeps them, interned in
+// a StackTable, and the sample goes to a lock-free hash table keyed by
+// address, so that threads allocating concurrently don't serialize on the
+// profiler. Only the observers are notified under a lock, and only when there
+// are some.
 class BRICK_EXPORT SamplingHeapProfiler {
  public:
   class BRICK_EXPORT Sample {
@@ -34,6 +41,9 @@ class BRICK_EXPORT SamplingHeapProfiler {
 
     size_t size;   // Allocation size.
     size_t total;  // Total size attributed to the sample.
+    // The task context of the AllocationContextTracker when the sample was
+    // recorded, if it was capturing them, which serves as the type name.
+    const char* type_name = nullptr;
     std::vector<void*> stack;
 
    private:
@@ -81,7 +91,7 @@ class BRICK_EXPORT SamplingHeapProfiler {
   static SamplingHeapProfiler* GetInstance();
 
  private:
-  using SamplesMap = std::unordered_map<void*, Sample>;
+  class SampleTable;
 
   SamplingHeapProfiler();
   ~SamplingHeapProfiler() = delete;
@@ -95,15 +105,23 @@ class BRICK_EXPORT SamplingHeapProfiler {
                      void* address,
                      uint32_t skip_frames);
   void DoRecordFree(void* address);
-  void RecordStackTrace(Sample*, uint32_t skip_frames);
-  SamplesMap& EnsureNoRehashingMap();
-  static SamplesMap& samples();
+  // Writes up to |max_frames| return addresses of the current stack to
+  // |frames|, and returns how many it wrote.
+  size_t RecordStackTrace(const void** frames,
+                          size_t max_frames,
+                          uint32_t skip_frames);
 
   base::ThreadLocalBoolean entered_;
+  const std::unique_ptr<SampleTable> samples_;
+  // The stacks of the samples, which are never removed.
+  const std::unique_ptr<StackTable> stacks_;
+  std::atomic<uint32_t> last_sample_ordinal_{0};
+
+  // Protects |observers_|. |has_observers_| is set while there are some, so
+  // that recording a sample only takes |mutex_| to notify them.
   base::Lock mutex_;
-  std::stack<std::unique_ptr<SamplesMap>> sample_maps_;
   std::vector<SamplesObserver*> observers_;
-  uint32_t last_sample_ordinal_ = 0;
+  std::atomic<bool> has_observers_{false};
 
   static SamplingHeapProfiler* instance_;
 
@@ -6,6 +6,9 @@
 
 #include <stdlib.h>
 #include <cinttypes>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include "brick/allocator/allocator_shim.h"
 #include "brick/debug/alias.h"
@@ -62,6 +65,73 @@ TEST_F(SamplingHeapProfilerTest, CollectSamples) {
   CHECK(collector.sample_removed);
 }
 
+// Allocates blocks of its own size, frees every other one, and keeps the
+// rest until asked to free them.
+class SampledAllocationsThread : public SimpleThread {
+ public:
+  static constexpr int kNumAllocations = 2000;
+
+  explicit SampledAllocationsThread(size_t size)
+      : SimpleThread("SampledAllocationsThread"), size_(size) {}
+
+  void Run() override {
+    for (int i = 0; i < kNumAllocations; ++i) {
+      void* p = malloc(size_);
+      if (i % 2)
+        free(p);
+      else
+        live_.push_back(p);
+    }
+  }
+
+  void FreeLive() {
+    for (void* p : live_)
+      free(p);
+    live_.clear();
+  }
+
+ private:
+  const size_t size_;
+  std::vector<void*> live_;
+};
+
+TEST_F(SamplingHeapProfilerTest, ConcurrentSamples) {
+  SamplingHeapProfiler::InitTLSSlot();
+  SamplingHeapProfiler* profiler = SamplingHeapProfiler::GetInstance();
+  profiler->SuppressRandomnessForTest(true);
+  // Every allocation of at least the interval is sampled.
+  profiler->SetSamplingInterval(1024);
+  uint32_t id = profiler->Start();
+
+  const size_t kFirstSize = 2051;
+  const int kNumThreads = 8;
+  std::vector<std::unique_ptr<SampledAllocationsThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(
+        std::make_unique<SampledAllocationsThread>(kFirstSize + i));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads)
+    thread->Join();
+
+  std::map<size_t, int> counts;
+  for (const auto& sample : profiler->GetSamples(id))
+    ++counts[sample.size];
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_EQ(SampledAllocationsThread::kNumAllocations / 2,
+              counts[kFirstSize + i]);
+  }
+
+  for (auto& thread : threads)
+    thread->FreeLive();
+  counts.clear();
+  for (const auto& sample : profiler->GetSamples(id))
+    ++counts[sample.size];
+  for (int i = 0; i < kNumThreads; ++i)
+    EXPECT_EQ(0, counts[kFirstSize + i]);
+  profiler->Stop();
+}
+
 const int kNumberOfAllocations = 10000;
 
 NOINLINE void Allocate1() {
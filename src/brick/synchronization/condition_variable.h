@@ -65,16 +65,21 @@
 #ifndef BRICK_SYNCHRONIZATION_CONDITION_VARIABLE_H_
 #define BRICK_SYNCHRONIZATION_CONDITION_VARIABLE_H_
 
-#if defined(OS_POSIX) || defined(OS_FUCHSIA)
-#include <pthread.h>
-#endif
-
 #include "brick/base_export.h"
 #include "brick/logging.h"
 #include "brick/macros.h"
 #include "brick/synchronization/lock.h"
+#include "brick/synchronization/synchronization_buildflags.h"
 #include "build/build_config.h"
 
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+#include <stdint.h>
+
+#include <atomic>
+#elif defined(OS_POSIX) || defined(OS_FUCHSIA)
+#include <pthread.h>
+#endif
+
 #if defined(OS_WIN)
 #include "brick/win/windows_types.h"
 #endif
@@ -107,6 +112,13 @@ class BRICK_EXPORT ConditionVariable {
 #if defined(OS_WIN)
   CHROME_CONDITION_VARIABLE cv_;
   CHROME_SRWLOCK* const srwlock_;
+#elif BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+  // Bumped by every Signal() and Broadcast(); waiters park on it.
+  std::atomic<int32_t> sequence_{0};
+  // Number of threads in Wait() or TimedWait(), so that Signal() and
+  // Broadcast() can skip the futex syscall when nobody is waiting.
+  std::atomic<int32_t> num_waiters_{0};
+  internal::LockImpl* const user_lock_impl_;
 #elif defined(OS_POSIX) || defined(OS_FUCHSIA)
   pthread_cond_t condition_;
   pthread_mutex_t* user_mutex_;
@@ -0,0 +1,90 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Futex-based ConditionVariable, used on Linux together with the futex-based
+// LockImpl when use_futex_synchronization is set.
+//
+// Waiters park on a sequence number that every Signal() and Broadcast()
+// bumps, so a notification that races with a thread going to sleep is never
+// lost: the kernel refuses to park a thread whose snapshot of the sequence is
+// stale. Broadcast() wakes every waiter rather than requeueing them onto the
+// user lock; see usage note 2 in the header for why that's acceptable.
+
+#include "brick/synchronization/condition_variable.h"
+
+#include <stdint.h>
+
+#include "brick/synchronization/futex_linux.h"
+#include "brick/synchronization/lock.h"
+#include "brick/threading/scoped_blocking_call.h"
+#include "brick/threading/thread_restrictions.h"
+#include "brick/time/time.h"
+
+namespace base {
+
+ConditionVariable::ConditionVariable(Lock* user_lock)
+    : user_lock_impl_(&user_lock->lock_)
+#if DCHECK_IS_ON()
+    , user_lock_(user_lock)
+#endif
+{
+}
+
+ConditionVariable::~ConditionVariable() = default;
+
+void ConditionVariable::Wait() {
+  internal::AssertBaseSyncPrimitivesAllowed();
+  ScopedBlockingCall scoped_blocking_call(BlockingType::MAY_BLOCK);
+#if DCHECK_IS_ON()
+  user_lock_->CheckHeldAndUnmark();
+#endif
+  // Both are updated while holding the user lock, so a signaler that changed
+  // the predicate under that lock is guaranteed to see this waiter.
+  const int32_t sequence = sequence_.load(std::memory_order_relaxed);
+  num_waiters_.fetch_add(1, std::memory_order_relaxed);
+  user_lock_impl_->Unlock();
+
+  internal::FutexWait(&sequence_, sequence);
+
+  user_lock_impl_->Lock();
+  num_waiters_.fetch_sub(1, std::memory_order_relaxed);
+#if DCHECK_IS_ON()
+  user_lock_->CheckUnheldAndMark();
+#endif
+}
+
+void ConditionVariable::TimedWait(const TimeDelta& max_time) {
+  internal::AssertBaseSyncPrimitivesAllowed();
+  ScopedBlockingCall scoped_blocking_call(BlockingType::MAY_BLOCK);
+#if DCHECK_IS_ON()
+  user_lock_->CheckHeldAndUnmark();
+#endif
+  const int32_t sequence = sequence_.load(std::memory_order_relaxed);
+  num_waiters_.fetch_add(1, std::memory_order_relaxed);
+  user_lock_impl_->Unlock();
+
+  // Timing out and being woken up are indistinguishable to the caller, who
+  // has to recheck the predicate either way.
+  internal::FutexWaitFor(&sequence_, sequence, max_time);
+
+  user_lock_impl_->Lock();
+  num_waiters_.fetch_sub(1, std::memory_order_relaxed);
+#if DCHECK_IS_ON()
+  user_lock_->CheckUnheldAndMark();
+#endif
+}
+
+void ConditionVariable::Broadcast() {
+  sequence_.fetch_add(1, std::memory_order_seq_cst);
+  if (num_waiters_.load(std::memory_order_seq_cst) > 0)
+    internal::FutexWakeAll(&sequence_);
+}
+
+void ConditionVariable::Signal() {
+  sequence_.fetch_add(1, std::memory_order_seq_cst);
+  if (num_waiters_.load(std::memory_order_seq_cst) > 0)
+    internal::FutexWake(&sequence_, 1);
+}
+
+}  // namespace base
@@ -0,0 +1,66 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Thin wrappers around the futex(2) system call, used by the Linux
+// implementations of Lock, ConditionVariable and WaitableEvent when
+// use_futex_synchronization is set.
+
+#ifndef BRICK_SYNCHRONIZATION_FUTEX_LINUX_H_
+#define BRICK_SYNCHRONIZATION_FUTEX_LINUX_H_
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <limits>
+
+#include "brick/time/time.h"
+
+namespace base {
+namespace internal {
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "futex words must be plain 32-bit integers");
+
+// Blocks while |*word| == |expected|, until woken by FutexWake(). Returns
+// immediately if |*word| != |expected|. Spurious wakeups are possible, so
+// callers must recheck their condition in a loop.
+inline void FutexWait(std::atomic<int32_t>* word, int32_t expected) {
+  syscall(SYS_futex, reinterpret_cast<int32_t*>(word),
+          FUTEX_WAIT | FUTEX_PRIVATE_FLAG, expected, nullptr, nullptr, 0);
+}
+
+// Like FutexWait() but gives up after |timeout|. Returns false if the wait
+// timed out.
+inline bool FutexWaitFor(std::atomic<int32_t>* word,
+                         int32_t expected,
+                         TimeDelta timeout) {
+  if (timeout <= TimeDelta())
+    return false;
+  struct timespec relative_time = timeout.ToTimeSpec();
+  const long rv =
+      syscall(SYS_futex, reinterpret_cast<int32_t*>(word),
+              FUTEX_WAIT | FUTEX_PRIVATE_FLAG, expected, &relative_time,
+              nullptr, 0);
+  return rv == 0 || errno != ETIMEDOUT;
+}
+
+// Wakes up to |count| threads blocked in FutexWait() on |word|.
+inline void FutexWake(std::atomic<int32_t>* word, int32_t count) {
+  syscall(SYS_futex, reinterpret_cast<int32_t*>(word),
+          FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, nullptr, nullptr, 0);
+}
+
+inline void FutexWakeAll(std::atomic<int32_t>* word) {
+  FutexWake(word, std::numeric_limits<int32_t>::max());
+}
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BRICK_SYNCHRONIZATION_FUTEX_LINUX_H_
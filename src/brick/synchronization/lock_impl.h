@@ -8,10 +8,17 @@
 #include "brick/base_export.h"
 #include "brick/logging.h"
 #include "brick/macros.h"
+#include "brick/synchronization/synchronization_buildflags.h"
 #include "build/build_config.h"
 
 #if defined(OS_WIN)
 #include "brick/win/windows_types.h"
+#elif BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+#include <stdint.h>
+
+#include <atomic>
+
+#include "brick/synchronization/futex_linux.h"
 #elif defined(OS_POSIX) || defined(OS_FUCHSIA)
 #include <errno.h>
 #include <pthread.h>
@@ -27,6 +34,9 @@ class BRICK_EXPORT LockImpl {
  public:
 #if defined(OS_WIN)
   using NativeHandle = CHROME_SRWLOCK;
+#elif BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+  // 0: unlocked, 1: locked, 2: locked and there may be parked waiters.
+  using NativeHandle = std::atomic<int32_t>;
 #elif defined(OS_POSIX) || defined(OS_FUCHSIA)
   using NativeHandle = pthread_mutex_t;
 #endif
@@ -56,6 +66,23 @@ class BRICK_EXPORT LockImpl {
 #endif
 
  private:
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+  enum : int32_t {
+    kUnlocked = 0,
+    kLocked = 1,
+    kLockedWithWaiters = 2,
+  };
+
+  // Contended path of Lock(): spins for a while in the hope that the holder
+  // releases the lock soon, then parks the thread on the futex.
+  void LockSlow();
+
+  // Running average of how many spins it took to acquire the lock on the
+  // contended path, used to size the next spin phase. Only written while the
+  // lock is held; read racily, which is fine for a heuristic.
+  std::atomic<int32_t> spin_estimate_{0};
+#endif
+
   NativeHandle native_handle_;
 
   DISALLOW_COPY_AND_ASSIGN(LockImpl);
@@ -65,6 +92,24 @@ class BRICK_EXPORT LockImpl {
 void LockImpl::Unlock() {
   ::ReleaseSRWLockExclusive(reinterpret_cast<PSRWLOCK>(&native_handle_));
 }
+#elif BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+inline bool LockImpl::Try() {
+  int32_t expected = kUnlocked;
+  return native_handle_.compare_exchange_strong(
+      expected, kLocked, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+inline void LockImpl::Lock() {
+  if (!Try())
+    LockSlow();
+}
+
+void LockImpl::Unlock() {
+  if (native_handle_.exchange(kUnlocked, std::memory_order_release) ==
+      kLockedWithWaiters) {
+    FutexWake(&native_handle_, 1);
+  }
+}
 #elif defined(OS_POSIX) || defined(OS_FUCHSIA)
 void LockImpl::Unlock() {
   int rv = pthread_mutex_unlock(&native_handle_);
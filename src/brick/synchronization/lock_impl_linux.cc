@@ -0,0 +1,106 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Futex-based LockImpl, used on Linux instead of lock_impl_posix.cc when
+// use_futex_synchronization is set. The lock word follows the classic
+// three-state protocol from Ulrich Drepper's "Futexes Are Tricky", and the
+// contended path spins adaptively before parking, like glibc's
+// PTHREAD_MUTEX_ADAPTIVE_NP mutexes.
+
+#include "brick/synchronization/lock_impl.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "brick/debug/activity_tracker.h"
+#include "brick/synchronization/futex_linux.h"
+#include "brick/synchronization/synchronization_buildflags.h"
+#include "build/build_config.h"
+
+#if !BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+#error "lock_impl_linux.cc requires use_futex_synchronization"
+#endif
+
+// See spin_lock.cc for the rationale behind YIELD_PROCESSOR.
+#if defined(ARCH_CPU_X86_64) || defined(ARCH_CPU_X86)
+#define YIELD_PROCESSOR __asm__ __volatile__("pause")
+#elif (defined(ARCH_CPU_ARMEL) && __ARM_ARCH >= 6) || defined(ARCH_CPU_ARM64)
+#define YIELD_PROCESSOR __asm__ __volatile__("yield")
+#elif defined(ARCH_CPU_MIPSEL)
+#define YIELD_PROCESSOR __asm__ __volatile__(".word 0x00000140")
+#elif defined(ARCH_CPU_MIPS64EL) && __mips_isa_rev >= 2
+#define YIELD_PROCESSOR __asm__ __volatile__("pause")
+#elif defined(ARCH_CPU_PPC64_FAMILY)
+#define YIELD_PROCESSOR __asm__ __volatile__("or 31,31,31")
+#else
+#define YIELD_PROCESSOR ((void)0)
+#endif
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Upper bound on the spin phase of a contended acquisition. Matches glibc's
+// default for adaptive mutexes; at roughly 10-100ns per iteration this is in
+// the same ballpark as the cost of a futex wait/wake round trip.
+constexpr int32_t kMaxSpinCount = 100;
+
+// Spinning only helps if the holder can make progress at the same time.
+bool ShouldSpin() {
+  static const bool should_spin = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+  return should_spin;
+}
+
+}  // namespace
+
+LockImpl::LockImpl() : native_handle_(kUnlocked) {}
+
+LockImpl::~LockImpl() {
+  DCHECK_EQ(kUnlocked, native_handle_.load(std::memory_order_relaxed));
+}
+
+void LockImpl::LockSlow() {
+  const int32_t estimate = spin_estimate_.load(std::memory_order_relaxed);
+  const int32_t max_spins =
+      ShouldSpin() ? std::min(kMaxSpinCount, estimate * 2 + 10) : 0;
+
+  int32_t spins = 0;
+  while (spins < max_spins) {
+    ++spins;
+    // Only attempt the CAS when the lock looks free, so that spinning threads
+    // don't keep stealing the cache line from the holder.
+    if (native_handle_.load(std::memory_order_relaxed) == kUnlocked &&
+        Try()) {
+      spin_estimate_.store(estimate + (spins - estimate) / 8,
+                           std::memory_order_relaxed);
+      return;
+    }
+    YIELD_PROCESSOR;
+  }
+
+  // Spinning didn't pay off: park until the holder wakes us up. As in
+  // lock_impl_posix.cc, only the blocking acquisition is tracked.
+  base::debug::ScopedLockAcquireActivity lock_activity(this);
+  // Once a thread has parked, the lock can't tell whether other waiters
+  // remain, so it is always taken in the "with waiters" state here. This
+  // costs at most one spurious FutexWake() in Unlock().
+  while (native_handle_.exchange(kLockedWithWaiters,
+                                 std::memory_order_acquire) != kUnlocked) {
+    FutexWait(&native_handle_, kLockedWithWaiters);
+  }
+  spin_estimate_.store(estimate + (max_spins - estimate) / 8,
+                       std::memory_order_relaxed);
+}
+
+// static
+bool LockImpl::PriorityInheritanceAvailable() {
+  // The futex lock doesn't implement FUTEX_LOCK_PI; builds that need priority
+  // inheritance must keep using the pthread implementation.
+  return false;
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,84 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/synchronization/read_write_lock.h"
+
+#include "brick/logging.h"
+
+namespace base {
+
+ReadWriteLock::ReadWriteLock()
+    : readers_cv_(&slow_path_lock_), writer_cv_(&slow_path_lock_) {}
+
+ReadWriteLock::~ReadWriteLock() {
+  DCHECK_EQ(0, state_.load(std::memory_order_relaxed));
+}
+
+void ReadWriteLock::WriteAcquire() {
+  waiting_writers_.fetch_add(1, std::memory_order_relaxed);
+  writer_lock_.Acquire();
+  waiting_writers_.fetch_sub(1, std::memory_order_relaxed);
+
+  // From here on, new readers take the slow path. The bit may already be set
+  // if the previous writer handed the lock over directly.
+  const int32_t previous_state =
+      state_.fetch_or(kWriterBit, std::memory_order_acquire);
+  if (!(previous_state & kReaderMask))
+    return;
+
+  AutoLock auto_lock(slow_path_lock_);
+  while (state_.load(std::memory_order_acquire) & kReaderMask)
+    writer_cv_.Wait();
+}
+
+void ReadWriteLock::WriteRelease() {
+  DCHECK(state_.load(std::memory_order_relaxed) & kWriterBit);
+
+  // If another writer is queued on |writer_lock_|, keep the writer bit set and
+  // let it go next.
+  if (!waiting_writers_.load(std::memory_order_relaxed)) {
+    AutoLock auto_lock(slow_path_lock_);
+    state_.fetch_and(~kWriterBit, std::memory_order_release);
+    readers_cv_.Broadcast();
+  }
+  writer_lock_.Release();
+}
+
+void ReadWriteLock::ReadAcquireSlow() {
+  // Undo the increment from the fast path first: a writer draining readers
+  // may be waiting for it.
+  ReadRelease();
+
+  AutoLock auto_lock(slow_path_lock_);
+  for (;;) {
+    // kWriterBit is only cleared with |slow_path_lock_| held, so it can't be
+    // cleared between this check and the Wait() below.
+    int32_t state = state_.load(std::memory_order_relaxed);
+    while (!(state & kWriterBit)) {
+      DCHECK_LT(state, kReaderMask);
+      if (state_.compare_exchange_weak(state, state + 1,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return;
+      }
+    }
+    ++blocked_readers_;
+    readers_cv_.Wait();
+    --blocked_readers_;
+  }
+}
+
+int ReadWriteLock::GetBlockedReaderCountForTesting() {
+  AutoLock auto_lock(slow_path_lock_);
+  return blocked_readers_;
+}
+
+void ReadWriteLock::WakeUpWriter() {
+  // The writer checks the reader count with |slow_path_lock_| held before
+  // waiting, so taking it here guarantees that the signal isn't lost.
+  AutoLock auto_lock(slow_path_lock_);
+  writer_cv_.Signal();
+}
+
+}  // namespace base
@@ -0,0 +1,150 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+#define BRICK_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "brick/base_export.h"
+#include "brick/macros.h"
+#include "brick/synchronization/condition_variable.h"
+#include "brick/synchronization/lock.h"
+#include "brick/thread_annotations.h"
+
+namespace base {
+
+// A reader-writer lock for read-mostly data. Any number of readers can hold
+// the lock at the same time, or a single writer can hold it exclusively.
+//
+// Uncontended read acquisitions and releases are a single atomic operation on
+// a shared word, and never block each other. Threads only fall back to
+// blocking on a Lock and ConditionVariable when they actually have to wait.
+//
+// The lock is writer-preferring: as soon as a writer is waiting, new readers
+// block until it is done, so a steady stream of readers can't starve writers.
+// This also means that the lock is NOT reentrant for readers: a thread that
+// already holds a read lock must not take it again, as it would deadlock if a
+// writer started waiting in between.
+//
+// Prefer a plain Lock unless profiling shows contention between readers.
+//
+// Example:
+//
+//   class Registry {
+//    public:
+//     const Entry* Find(const std::string& name) const {
+//       AutoReadLock auto_lock(lock_);
+//       ...
+//     }
+//     void Add(const std::string& name, Entry entry) {
+//       AutoWriteLock auto_lock(lock_);
+//       ...
+//     }
+//
+//    private:
+//     mutable ReadWriteLock lock_;
+//     std::map<std::string, Entry> entries_ GUARDED_BY(lock_);
+//   };
+class LOCKABLE BRICK_EXPORT ReadWriteLock {
+ public:
+  ReadWriteLock();
+  ~ReadWriteLock();
+
+  // Acquires the lock in shared mode, blocking while a writer holds or is
+  // waiting for it.
+  void ReadAcquire() SHARED_LOCK_FUNCTION() {
+    // An unconditional increment rather than a compare-and-swap, so that
+    // concurrent readers never make each other retry.
+    if (!(state_.fetch_add(1, std::memory_order_acquire) & kWriterBit))
+      return;
+    ReadAcquireSlow();
+  }
+
+  void ReadRelease() UNLOCK_FUNCTION() {
+    const int32_t previous_state =
+        state_.fetch_sub(1, std::memory_order_release);
+    // The last reader out wakes up the writer draining them, if any.
+    if (previous_state == (kWriterBit | 1))
+      WakeUpWriter();
+  }
+
+  // Acquires the lock in exclusive mode.
+  void WriteAcquire() EXCLUSIVE_LOCK_FUNCTION();
+  void WriteRelease() UNLOCK_FUNCTION();
+
+  // Returns true while a writer holds the lock or waits for readers to drain.
+  bool HasWriterForTesting() const {
+    return state_.load(std::memory_order_acquire) & kWriterBit;
+  }
+
+  // Returns the number of readers blocked on a writer.
+  int GetBlockedReaderCountForTesting();
+
+ private:
+  // Set while a writer holds the lock or is waiting for readers to drain. The
+  // lower bits count the readers holding the lock, plus readers that are
+  // about to back out of the fast path because the writer bit is set.
+  static constexpr int32_t kWriterBit = 1 << 30;
+  static constexpr int32_t kReaderMask = kWriterBit - 1;
+
+  void ReadAcquireSlow();
+  void WakeUpWriter();
+
+  std::atomic<int32_t> state_{0};
+
+  // Number of writers blocked on |writer_lock_|. A releasing writer leaves
+  // kWriterBit set for them so that readers can't sneak in between.
+  std::atomic<int32_t> waiting_writers_{0};
+
+  // Serializes writers.
+  Lock writer_lock_;
+
+  // Protects the blocking slow paths. Must be acquired after |writer_lock_|.
+  Lock slow_path_lock_;
+  // Number of readers waiting on |readers_cv_|, for tests.
+  int blocked_readers_ GUARDED_BY(slow_path_lock_) = 0;
+  // Signaled when kWriterBit is cleared.
+  ConditionVariable readers_cv_;
+  // Signaled when the last reader leaves while kWriterBit is set.
+  ConditionVariable writer_cv_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadWriteLock);
+};
+
+// Holds |lock| in shared mode while in scope.
+class SCOPED_LOCKABLE AutoReadLock {
+ public:
+  explicit AutoReadLock(ReadWriteLock& lock) SHARED_LOCK_FUNCTION(lock)
+      : lock_(lock) {
+    lock_.ReadAcquire();
+  }
+  ~AutoReadLock() UNLOCK_FUNCTION() { lock_.ReadRelease(); }
+
+ private:
+  ReadWriteLock& lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(AutoReadLock);
+};
+
+// Holds |lock| in exclusive mode while in scope.
+class SCOPED_LOCKABLE AutoWriteLock {
+ public:
+  explicit AutoWriteLock(ReadWriteLock& lock) EXCLUSIVE_LOCK_FUNCTION(lock)
+      : lock_(lock) {
+    lock_.WriteAcquire();
+  }
+  ~AutoWriteLock() UNLOCK_FUNCTION() { lock_.WriteRelease(); }
+
+ private:
+  ReadWriteLock& lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(AutoWriteLock);
+};
+
+}  // namespace base
+
+#endif  // BRICK_SYNCHRONIZATION_READ_WRITE_LOCK_H_
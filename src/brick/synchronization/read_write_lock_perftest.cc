@@ -0,0 +1,146 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares Lock, ReadWriteLock and SeqLock protecting a small struct that is
+// read by several threads and occasionally written.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "brick/macros.h"
+#include "brick/strings/stringprintf.h"
+#include "brick/synchronization/lock.h"
+#include "brick/synchronization/read_write_lock.h"
+#include "brick/synchronization/seq_lock.h"
+#include "brick/threading/simple_thread.h"
+#include "brick/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+constexpr int kOperationsPerThread = 1000000;
+// One write every |kWriteInterval| operations.
+constexpr int kWriteInterval = 1000;
+
+struct Config {
+  int64_t a;
+  int64_t b;
+  int64_t c;
+};
+
+class LockedConfig {
+ public:
+  int64_t Read() {
+    AutoLock auto_lock(lock_);
+    return config_.a + config_.b + config_.c;
+  }
+  void Write(int64_t value) {
+    AutoLock auto_lock(lock_);
+    config_ = {value, value, value};
+  }
+
+ private:
+  Lock lock_;
+  Config config_ = {};
+};
+
+class ReadWriteLockedConfig {
+ public:
+  int64_t Read() {
+    AutoReadLock auto_lock(lock_);
+    return config_.a + config_.b + config_.c;
+  }
+  void Write(int64_t value) {
+    AutoWriteLock auto_lock(lock_);
+    config_ = {value, value, value};
+  }
+
+ private:
+  ReadWriteLock lock_;
+  Config config_ = {};
+};
+
+class SeqLockedConfig {
+ public:
+  int64_t Read() {
+    const Config config = config_.Read();
+    return config.a + config.b + config.c;
+  }
+  void Write(int64_t value) { config_.Write({value, value, value}); }
+
+ private:
+  SeqLock<Config> config_;
+};
+
+template <typename ConfigType>
+class ReadMostlyRunner : public DelegateSimpleThread::Delegate {
+ public:
+  explicit ReadMostlyRunner(ConfigType* config) : config_(config) {}
+
+  void Run() override {
+    int64_t sum = 0;
+    for (int i = 0; i < kOperationsPerThread; ++i) {
+      if (i % kWriteInterval == 0)
+        config_->Write(i);
+      else
+        sum += config_->Read();
+    }
+    // Keep the reads from being optimized away.
+    sink_ = sum;
+  }
+
+ private:
+  ConfigType* const config_;
+  volatile int64_t sink_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadMostlyRunner);
+};
+
+template <typename ConfigType>
+void RunReadMostlyTest(const std::string& trace) {
+  for (int num_threads : {1, 2, 4, 8}) {
+    ConfigType config;
+    std::vector<std::unique_ptr<ReadMostlyRunner<ConfigType>>> runners;
+    std::vector<std::unique_ptr<DelegateSimpleThread>> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      runners.push_back(
+          std::make_unique<ReadMostlyRunner<ConfigType>>(&config));
+      threads.push_back(std::make_unique<DelegateSimpleThread>(
+          runners.back().get(), "ReadWriteLockPerfTest"));
+    }
+
+    const TimeTicks start = TimeTicks::Now();
+    for (auto& thread : threads)
+      thread->Start();
+    for (auto& thread : threads)
+      thread->Join();
+    const TimeDelta elapsed = TimeTicks::Now() - start;
+
+    perf_test::PrintResult(
+        "operation_time", StringPrintf("_%d_threads", num_threads), trace,
+        elapsed.InNanoseconds() /
+            static_cast<double>(kOperationsPerThread * num_threads),
+        "ns/op", true);
+  }
+}
+
+}  // namespace
+
+TEST(ReadWriteLockPerfTest, Lock) {
+  RunReadMostlyTest<LockedConfig>("Lock");
+}
+
+TEST(ReadWriteLockPerfTest, ReadWriteLock) {
+  RunReadMostlyTest<ReadWriteLockedConfig>("ReadWriteLock");
+}
+
+TEST(ReadWriteLockPerfTest, SeqLock) {
+  RunReadMostlyTest<SeqLockedConfig>("SeqLock");
+}
+
+}  // namespace base
@@ -0,0 +1,178 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/synchronization/read_write_lock.h"
+
+#include "brick/macros.h"
+#include "brick/synchronization/atomic_flag.h"
+#include "brick/synchronization/waitable_event.h"
+#include "brick/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+class ReaderThread : public PlatformThread::Delegate {
+ public:
+  ReaderThread(ReadWriteLock* lock, const int* value)
+      : lock_(lock),
+        value_(value),
+        acquired_(WaitableEvent::ResetPolicy::MANUAL,
+                  WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  void ThreadMain() override {
+    AutoReadLock auto_lock(*lock_);
+    observed_value_ = *value_;
+    acquired_.Signal();
+  }
+
+  WaitableEvent* acquired() { return &acquired_; }
+  int observed_value() const { return observed_value_; }
+
+ private:
+  ReadWriteLock* const lock_;
+  const int* const value_;
+  WaitableEvent acquired_;
+  int observed_value_ = -1;
+
+  DISALLOW_COPY_AND_ASSIGN(ReaderThread);
+};
+
+class WriterThread : public PlatformThread::Delegate {
+ public:
+  WriterThread(ReadWriteLock* lock, int* value, int new_value)
+      : lock_(lock), value_(value), new_value_(new_value) {}
+
+  void ThreadMain() override {
+    AutoWriteLock auto_lock(*lock_);
+    *value_ = new_value_;
+  }
+
+ private:
+  ReadWriteLock* const lock_;
+  int* const value_;
+  const int new_value_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriterThread);
+};
+
+// Updates a pair of values that must always be seen equal under the lock.
+class MixedThread : public PlatformThread::Delegate {
+ public:
+  MixedThread(ReadWriteLock* lock, int* first, int* second)
+      : lock_(lock), first_(first), second_(second) {}
+
+  void ThreadMain() override {
+    for (int i = 0; i < 10000; ++i) {
+      if (i % 16 == 0) {
+        AutoWriteLock auto_lock(*lock_);
+        ++*first_;
+        PlatformThread::YieldCurrentThread();
+        ++*second_;
+      } else {
+        AutoReadLock auto_lock(*lock_);
+        if (*first_ != *second_)
+          torn_read_.Set();
+      }
+    }
+  }
+
+  bool saw_torn_read() const { return torn_read_.IsSet(); }
+
+ private:
+  ReadWriteLock* const lock_;
+  int* const first_;
+  int* const second_;
+  AtomicFlag torn_read_;
+
+  DISALLOW_COPY_AND_ASSIGN(MixedThread);
+};
+
+}  // namespace
+
+TEST(ReadWriteLockTest, ConcurrentReaders) {
+  ReadWriteLock lock;
+  int value = 42;
+
+  AutoReadLock auto_lock(lock);
+  ReaderThread reader(&lock, &value);
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &reader, &handle));
+  // The reader gets in while this thread holds the lock too.
+  reader.acquired()->Wait();
+  EXPECT_EQ(42, reader.observed_value());
+  PlatformThread::Join(handle);
+}
+
+TEST(ReadWriteLockTest, WriterWaitsForReaders) {
+  ReadWriteLock lock;
+  int value = 0;
+
+  lock.ReadAcquire();
+  WriterThread writer(&lock, &value, 1);
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &writer, &handle));
+  // The writer can't get in before the reader leaves.
+  while (!lock.HasWriterForTesting())
+    PlatformThread::YieldCurrentThread();
+  EXPECT_EQ(0, value);
+  lock.ReadRelease();
+  PlatformThread::Join(handle);
+
+  AutoReadLock auto_lock(lock);
+  EXPECT_EQ(1, value);
+}
+
+// Once a writer waits, new readers queue up behind it.
+TEST(ReadWriteLockTest, WriterPreferred) {
+  ReadWriteLock lock;
+  int value = 0;
+
+  lock.ReadAcquire();
+  WriterThread writer(&lock, &value, 1);
+  PlatformThreadHandle writer_handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &writer, &writer_handle));
+  while (!lock.HasWriterForTesting())
+    PlatformThread::YieldCurrentThread();
+
+  ReaderThread reader(&lock, &value);
+  PlatformThreadHandle reader_handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &reader, &reader_handle));
+  while (!lock.GetBlockedReaderCountForTesting())
+    PlatformThread::YieldCurrentThread();
+  EXPECT_FALSE(reader.acquired()->IsSignaled());
+
+  lock.ReadRelease();
+  PlatformThread::Join(writer_handle);
+  PlatformThread::Join(reader_handle);
+  EXPECT_EQ(1, reader.observed_value());
+}
+
+TEST(ReadWriteLockTest, MutualExclusion) {
+  ReadWriteLock lock;
+  int first = 0;
+  int second = 0;
+
+  MixedThread thread1(&lock, &first, &second);
+  MixedThread thread2(&lock, &first, &second);
+  MixedThread thread3(&lock, &first, &second);
+  PlatformThreadHandle handle1;
+  PlatformThreadHandle handle2;
+  PlatformThreadHandle handle3;
+  ASSERT_TRUE(PlatformThread::Create(0, &thread1, &handle1));
+  ASSERT_TRUE(PlatformThread::Create(0, &thread2, &handle2));
+  ASSERT_TRUE(PlatformThread::Create(0, &thread3, &handle3));
+  PlatformThread::Join(handle1);
+  PlatformThread::Join(handle2);
+  PlatformThread::Join(handle3);
+
+  EXPECT_FALSE(thread1.saw_torn_read());
+  EXPECT_FALSE(thread2.saw_torn_read());
+  EXPECT_FALSE(thread3.saw_torn_read());
+  EXPECT_EQ(3 * 10000 / 16, first);
+  EXPECT_EQ(first, second);
+}
+
+}  // namespace base
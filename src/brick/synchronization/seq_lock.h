@@ -0,0 +1,109 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_SYNCHRONIZATION_SEQ_LOCK_H_
+#define BRICK_SYNCHRONIZATION_SEQ_LOCK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "brick/macros.h"
+#include "brick/synchronization/lock.h"
+#include "brick/threading/platform_thread.h"
+
+namespace base {
+
+// A SeqLock holds a small, trivially copyable value that is read far more
+// often than it is written, e.g. a struct of configuration values or
+// counters. Readers never write to shared memory: they copy the value and
+// retry if a writer changed it in the meantime, so any number of readers on
+// any number of cores scale perfectly. Writers are serialized and never wait
+// for readers.
+//
+// Readers may have to retry indefinitely under a continuous stream of writes,
+// so SeqLock is only appropriate when writes are rare.
+//
+// Example:
+//
+//   struct Limits {
+//     int max_connections;
+//     TimeDelta timeout;
+//   };
+//   SeqLock<Limits> limits;
+//
+//   // Any thread:
+//   Limits snapshot = limits.Read();
+template <typename T>
+class SeqLock {
+ public:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLock can only hold trivially copyable types");
+  static_assert(sizeof(T) <= 128, "SeqLock is meant for small values");
+
+  SeqLock() : SeqLock(T()) {}
+  explicit SeqLock(const T& value) { StoreValue(value); }
+
+  // Returns a consistent copy of the value.
+  T Read() const {
+    for (;;) {
+      const uint32_t sequence = sequence_.load(std::memory_order_acquire);
+      if (sequence & 1) {
+        // A write is in progress. Writes are short, but the writer may have
+        // been descheduled.
+        PlatformThread::YieldCurrentThread();
+        continue;
+      }
+      uintptr_t words[kWordCount];
+      for (size_t i = 0; i < kWordCount; ++i)
+        words[i] = words_[i].load(std::memory_order_relaxed);
+      // Orders the loads above before the sequence check below.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence_.load(std::memory_order_relaxed) == sequence) {
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+      }
+    }
+  }
+
+  // Replaces the value. Safe to call from multiple threads.
+  void Write(const T& value) {
+    AutoLock auto_lock(write_lock_);
+    const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    // Orders the odd sequence number before the stores below.
+    std::atomic_thread_fence(std::memory_order_release);
+    StoreValue(value);
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+ private:
+  // The value is stored as an array of word-sized atomics so that racing
+  // reads are well-defined; a torn read is detected and retried.
+  static constexpr size_t kWordCount =
+      (sizeof(T) + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+
+  void StoreValue(const T& value) {
+    uintptr_t words[kWordCount] = {};
+    memcpy(words, &value, sizeof(T));
+    for (size_t i = 0; i < kWordCount; ++i)
+      words_[i].store(words[i], std::memory_order_relaxed);
+  }
+
+  // Odd while a write is in progress.
+  std::atomic<uint32_t> sequence_{0};
+  std::atomic<uintptr_t> words_[kWordCount];
+
+  Lock write_lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(SeqLock);
+};
+
+}  // namespace base
+
+#endif  // BRICK_SYNCHRONIZATION_SEQ_LOCK_H_
@@ -0,0 +1,92 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/synchronization/seq_lock.h"
+
+#include "brick/macros.h"
+#include "brick/synchronization/atomic_flag.h"
+#include "brick/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Odd size on purpose, so that it doesn't fill its last word.
+struct Snapshot {
+  int32_t values[5];
+  char tag;
+};
+
+Snapshot MakeSnapshot(int32_t value) {
+  Snapshot snapshot;
+  for (int32_t& v : snapshot.values)
+    v = value;
+  snapshot.tag = static_cast<char>(value);
+  return snapshot;
+}
+
+bool IsConsistent(const Snapshot& snapshot) {
+  for (int32_t v : snapshot.values) {
+    if (v != snapshot.values[0])
+      return false;
+  }
+  return snapshot.tag == static_cast<char>(snapshot.values[0]);
+}
+
+class WriterThread : public PlatformThread::Delegate {
+ public:
+  explicit WriterThread(SeqLock<Snapshot>* seq_lock) : seq_lock_(seq_lock) {}
+
+  void ThreadMain() override {
+    for (int32_t i = 1; !stop_.IsSet(); ++i)
+      seq_lock_->Write(MakeSnapshot(i));
+  }
+
+  void Stop() { stop_.Set(); }
+
+ private:
+  SeqLock<Snapshot>* const seq_lock_;
+  AtomicFlag stop_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriterThread);
+};
+
+}  // namespace
+
+TEST(SeqLockTest, ReadWrite) {
+  SeqLock<Snapshot> seq_lock(MakeSnapshot(7));
+  EXPECT_EQ(7, seq_lock.Read().values[4]);
+
+  seq_lock.Write(MakeSnapshot(8));
+  Snapshot snapshot = seq_lock.Read();
+  EXPECT_TRUE(IsConsistent(snapshot));
+  EXPECT_EQ(8, snapshot.values[0]);
+}
+
+TEST(SeqLockTest, DefaultConstructed) {
+  SeqLock<int64_t> seq_lock;
+  EXPECT_EQ(0, seq_lock.Read());
+}
+
+TEST(SeqLockTest, ReadsAreNeverTorn) {
+  SeqLock<Snapshot> seq_lock(MakeSnapshot(0));
+  WriterThread writer(&seq_lock);
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &writer, &handle));
+
+  int32_t last_value = 0;
+  for (int i = 0; i < 100000; ++i) {
+    const Snapshot snapshot = seq_lock.Read();
+    ASSERT_TRUE(IsConsistent(snapshot));
+    // Values only ever go up.
+    ASSERT_GE(snapshot.values[0], last_value);
+    last_value = snapshot.values[0];
+  }
+
+  writer.Stop();
+  PlatformThread::Join(handle);
+}
+
+}  // namespace base
@@ -24,11 +24,15 @@
 #include "brick/memory/ref_counted.h"
 #include "brick/synchronization/lock.h"
 #elif defined(OS_POSIX) || defined(OS_FUCHSIA)
+#include <stdint.h>
+
+#include <atomic>
 #include <list>
 #include <utility>
 
 #include "brick/memory/ref_counted.h"
 #include "brick/synchronization/lock.h"
+#include "brick/synchronization/synchronization_buildflags.h"
 #endif
 
 namespace base {
@@ -113,6 +117,12 @@ class BRICK_EXPORT WaitableEvent {
   HANDLE handle() const { return handle_.Get(); }
 #endif
 
+#if (defined(OS_POSIX) && !defined(OS_MACOSX)) || defined(OS_FUCHSIA)
+  // Returns the number of threads blocked in Wait() and friends, which a
+  // Signal() would release.
+  size_t GetWaiterCountForTesting() const;
+#endif
+
   // Wait, synchronously, on multiple events.
   //   waitables: an array of WaitableEvent pointers
   //   count: the number of elements in @waitables
@@ -254,6 +264,18 @@ class BRICK_EXPORT WaitableEvent {
     bool signaled_;
     std::list<Waiter*> waiters_;
 
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+    // Threads blocked in TimedWaitUntil() park on this futex word, which
+    // Signal() bumps, instead of enqueuing a SyncWaiter in |waiters_|. Only
+    // modified with |lock_| held.
+    std::atomic<int32_t> futex_sequence_{0};
+    // Number of threads parked on |futex_sequence_|.
+    int futex_waiters_ = 0;
+    // Number of auto-reset signals handed directly to parked threads which
+    // they have not consumed yet. Never exceeds |futex_waiters_|.
+    int futex_handoffs_ = 0;
+#endif
+
    private:
     friend class RefCountedThreadSafe<WaitableEventKernel>;
     ~WaitableEventKernel();
@@ -273,6 +295,12 @@ class BRICK_EXPORT WaitableEvent {
   bool SignalOne();
   void Enqueue(Waiter* waiter);
 
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+  // Blocks on |kernel_->futex_sequence_| until signaled or |end_time| is
+  // reached. Called, and returns, with |kernel_->lock_| held.
+  bool FutexWaitUntilLocked(const TimeTicks& end_time);
+#endif
+
   scoped_refptr<WaitableEventKernel> kernel_;
 #endif
 
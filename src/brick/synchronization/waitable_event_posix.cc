@@ -12,10 +12,15 @@
 #include "brick/logging.h"
 #include "brick/synchronization/condition_variable.h"
 #include "brick/synchronization/lock.h"
+#include "brick/synchronization/synchronization_buildflags.h"
 #include "brick/synchronization/waitable_event.h"
 #include "brick/threading/scoped_blocking_call.h"
 #include "brick/threading/thread_restrictions.h"
 
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+#include "brick/synchronization/futex_linux.h"
+#endif
+
 // -----------------------------------------------------------------------------
 // A WaitableEvent on POSIX is implemented as a wait-list. Currently we don't
 // support cross-process events (where one process can signal an event which
@@ -35,6 +40,11 @@
 // the wait-list of many events. An event passes a pointer to itself when
 // firing a waiter and so we can store that pointer to find out which event
 // triggered.
+//
+// With use_futex_synchronization, a thread blocking on a single event doesn't
+// go through the wait-list at all: it parks on a futex word in the kernel and
+// Signal() wakes it directly, which saves a Lock, a ConditionVariable and a
+// list node per wait. WaitMany() and WaitableEventWatcher still use the list.
 // -----------------------------------------------------------------------------
 
 namespace base {
@@ -181,6 +191,13 @@ bool WaitableEvent::TimedWaitUntil(const TimeTicks& end_time) {
     return true;
   }
 
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+  const bool result = FutexWaitUntilLocked(end_time);
+  // Returning only after re-taking @lock_ ensures that |Signal| has completed,
+  // so that a WaitableEvent can synchronise its own destruction.
+  kernel_->lock_.Release();
+  return result;
+#else
   SyncWaiter sw;
   sw.lock()->Acquire();
 
@@ -223,6 +240,69 @@ bool WaitableEvent::TimedWaitUntil(const TimeTicks& end_time) {
       sw.cv()->Wait();
     }
   }
+#endif  // BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+}
+
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+bool WaitableEvent::FutexWaitUntilLocked(const TimeTicks& end_time) {
+  const bool finite_time = !end_time.is_max();
+  const int32_t initial_sequence =
+      kernel_->futex_sequence_.load(std::memory_order_relaxed);
+  ++kernel_->futex_waiters_;
+
+  bool signaled = false;
+  for (;;) {
+    // @lock_ is held whenever |futex_sequence_| changes, so a Signal() racing
+    // with us going to sleep makes the futex wait return immediately.
+    const int32_t sequence =
+        kernel_->futex_sequence_.load(std::memory_order_relaxed);
+    kernel_->lock_.Release();
+    if (finite_time) {
+      internal::FutexWaitFor(&kernel_->futex_sequence_, sequence,
+                             end_time - TimeTicks::Now());
+    } else {
+      internal::FutexWait(&kernel_->futex_sequence_, sequence);
+    }
+    kernel_->lock_.Acquire();
+
+    if (kernel_->futex_handoffs_) {
+      // An auto-reset Signal() was handed to the parked threads. It doesn't
+      // matter which of them takes it.
+      --kernel_->futex_handoffs_;
+      signaled = true;
+      break;
+    }
+    if (kernel_->signaled_) {
+      if (!kernel_->manual_reset_)
+        kernel_->signaled_ = false;
+      signaled = true;
+      break;
+    }
+    if (kernel_->manual_reset_ &&
+        kernel_->futex_sequence_.load(std::memory_order_relaxed) !=
+            initial_sequence) {
+      // Signaled and Reset() again before we got to run. Like a SyncWaiter
+      // that was fired, this still counts as being signaled.
+      signaled = true;
+      break;
+    }
+    if (finite_time && TimeTicks::Now() >= end_time)
+      break;
+  }
+
+  --kernel_->futex_waiters_;
+  DCHECK_LE(kernel_->futex_handoffs_, kernel_->futex_waiters_);
+  return signaled;
+}
+#endif  // BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+
+size_t WaitableEvent::GetWaiterCountForTesting() const {
+  AutoLock locked(kernel_->lock_);
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+  return kernel_->waiters_.size() + kernel_->futex_waiters_;
+#else
+  return kernel_->waiters_.size();
+#endif
 }
 
 // -----------------------------------------------------------------------------
@@ -389,6 +469,17 @@ bool WaitableEvent::SignalAll() {
   }
 
   kernel_->waiters_.clear();
+
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+  if (kernel_->futex_waiters_) {
+    // Woken while holding @lock_: once we release it a woken thread may
+    // return and delete the event.
+    kernel_->futex_sequence_.fetch_add(1, std::memory_order_relaxed);
+    internal::FutexWakeAll(&kernel_->futex_sequence_);
+    signaled_at_least_one = true;
+  }
+#endif
+
   return signaled_at_least_one;
 }
 
@@ -398,8 +489,21 @@ bool WaitableEvent::SignalAll() {
 // ---------------------------------------------------------------------------
 bool WaitableEvent::SignalOne() {
   for (;;) {
-    if (kernel_->waiters_.empty())
+    if (kernel_->waiters_.empty()) {
+#if BUILDFLAG(USE_FUTEX_SYNCHRONIZATION)
+      // Hand the signal to one of the parked threads that doesn't already
+      // have one, rather than leaving the event signaled for anybody to take.
+      // This matches the list semantics, where two back-to-back signals
+      // release two waiters.
+      if (kernel_->futex_waiters_ > kernel_->futex_handoffs_) {
+        ++kernel_->futex_handoffs_;
+        kernel_->futex_sequence_.fetch_add(1, std::memory_order_relaxed);
+        internal::FutexWake(&kernel_->futex_sequence_, 1);
+        return true;
+      }
+#endif
       return false;
+    }
 
     const bool r = (*kernel_->waiters_.begin())->Fire(this);
     kernel_->waiters_.pop_front();
@@ -9,6 +9,7 @@
 #include <algorithm>
 
 #include "brick/compiler_specific.h"
+#include "brick/macros.h"
 #include "brick/threading/platform_thread.h"
 #include "brick/time/time.h"
 #include "build/build_config.h"
@@ -182,6 +183,40 @@ TEST(WaitableEventTest, WaitAndDelete) {
   PlatformThread::Join(thread);
 }
 
+class WaitableEventWaiter : public PlatformThread::Delegate {
+ public:
+  explicit WaitableEventWaiter(WaitableEvent* event) : event_(event) {}
+
+  void ThreadMain() override { event_->Wait(); }
+
+ private:
+  WaitableEvent* event_;
+};
+
+#if (defined(OS_POSIX) && !defined(OS_MACOSX)) || defined(OS_FUCHSIA)
+// Tests that each Signal() of an auto-reset event releases one blocked waiter,
+// even when the signals come back to back.
+TEST(WaitableEventTest, AutoResetSignalsReleaseEachWaiter) {
+  WaitableEvent ev(WaitableEvent::ResetPolicy::AUTOMATIC,
+                   WaitableEvent::InitialState::NOT_SIGNALED);
+
+  WaitableEventWaiter waiter(&ev);
+  PlatformThreadHandle threads[2];
+  for (PlatformThreadHandle& thread : threads)
+    PlatformThread::Create(0, &waiter, &thread);
+
+  // Both threads must be blocked, or the two signals would coalesce.
+  while (ev.GetWaiterCountForTesting() < arraysize(threads))
+    PlatformThread::YieldCurrentThread();
+  ev.Signal();
+  ev.Signal();
+
+  for (PlatformThreadHandle& thread : threads)
+    PlatformThread::Join(thread);
+  EXPECT_FALSE(ev.IsSignaled());
+}
+#endif  // (defined(OS_POSIX) && !defined(OS_MACOSX)) || defined(OS_FUCHSIA)
+
 // Tests that a WaitableEvent can be safely deleted when |WaitMany| is done
 // without additional synchronization.
 TEST(WaitableEventTest, WaitMany) {
@@ -0,0 +1,114 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/task/co_task.h"
+
+#include "brick/bind.h"
+#include "brick/synchronization/waitable_event.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+void ResumeCoroutineOnEvent(CoTaskPromiseBase* promise, WaitableEvent* event) {
+  promise->Resume();
+}
+
+}  // namespace
+
+void CoTaskPromiseBase::DestroyChain() {
+  CoTaskPromiseBase* root = this;
+  while (root->parent_)
+    root = root->parent_;
+  // Only detached roots can be suspended on a pending resumption: any other
+  // CoTask is either not started yet or is being awaited.
+  DCHECK(root->detached_);
+  root->handle_.destroy();
+}
+
+void CoTaskPromiseBase::StartDetached() {
+  detached_ = true;
+  // |this| may be destroyed by the time Resume() returns.
+  Resume();
+}
+
+std::coroutine_handle<> CoTaskPromiseBase::OnFinalSuspend() noexcept {
+  if (parent_)
+    return parent_->handle_;
+  DCHECK(detached_);
+  handle_.destroy();
+  return std::noop_coroutine();
+}
+
+CoroutineResumer::CoroutineResumer(CoTaskPromiseBase* promise)
+    : promise_(promise) {
+  DCHECK(promise_);
+}
+
+CoroutineResumer::CoroutineResumer(CoroutineResumer&& other)
+    : promise_(std::exchange(other.promise_, nullptr)) {}
+
+CoroutineResumer::~CoroutineResumer() {
+  if (promise_)
+    promise_->DestroyChain();
+}
+
+void CoroutineResumer::Resume() {
+  DCHECK(promise_);
+  std::exchange(promise_, nullptr)->Resume();
+}
+
+void ResumeCoroutine(CoroutineResumer resumer) {
+  resumer.Resume();
+}
+
+ResumeOnAwaiter::ResumeOnAwaiter(scoped_refptr<TaskRunner> task_runner,
+                                 const Location& from_here)
+    : task_runner_(std::move(task_runner)), from_here_(from_here) {
+  DCHECK(task_runner_);
+}
+
+ResumeOnAwaiter::~ResumeOnAwaiter() = default;
+
+void ResumeOnAwaiter::Suspend(CoTaskPromiseBase* promise) {
+  // The coroutine may be resumed, or destroyed if posting fails, before
+  // PostTask() returns; |this| must not be used afterwards.
+  scoped_refptr<TaskRunner> task_runner = task_runner_;
+  task_runner->PostTask(
+      from_here_, BindOnce(&ResumeCoroutine, CoroutineResumer(promise)));
+}
+
+SleepAwaiter::SleepAwaiter(TimeDelta delay, const Location& from_here)
+    : delay_(delay), from_here_(from_here) {}
+
+SleepAwaiter::~SleepAwaiter() = default;
+
+void SleepAwaiter::Suspend(CoTaskPromiseBase* promise) {
+  SequencedTaskRunnerHandle::Get()->PostDelayedTask(
+      from_here_, BindOnce(&ResumeCoroutine, CoroutineResumer(promise)),
+      delay_);
+}
+
+WaitableEventAwaiter::WaitableEventAwaiter(WaitableEvent* event)
+    : event_(event) {
+  DCHECK(event_);
+}
+
+WaitableEventAwaiter::~WaitableEventAwaiter() = default;
+
+bool WaitableEventAwaiter::await_ready() {
+  return event_->IsSignaled();
+}
+
+void WaitableEventAwaiter::Suspend(CoTaskPromiseBase* promise) {
+  // No CoroutineResumer here: |watcher_| lives in the coroutine frame, and
+  // destroying the frame stops the watch, which must not destroy the frame a
+  // second time.
+  watcher_.StartWatching(event_, BindOnce(&ResumeCoroutineOnEvent, promise),
+                         SequencedTaskRunnerHandle::Get());
+}
+
+}  // namespace internal
+}  // namespace base
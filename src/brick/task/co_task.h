@@ -0,0 +1,456 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// CoTask<T> is an opt-in C++20 coroutine type for writing asynchronous
+// pipelines as straight-line code instead of chains of PostTaskAndReply and
+// bound callbacks. It is only available when the build sets
+// enable_coroutines = true.
+//
+//   CoTask<int> LoadAndParse(scoped_refptr<TaskRunner> io_runner) {
+//     co_await ResumeOn(io_runner, FROM_HERE);     // Now on |io_runner|.
+//     std::string contents = ReadTheFile();
+//     co_await SleepFor(TimeDelta::FromMilliseconds(10));
+//     co_return Parse(contents);
+//   }
+//
+//   CoTask<void> Pipeline(...) {
+//     int value = co_await LoadAndParse(io_runner);  // Awaits a child CoTask.
+//     co_await AwaitEvent(&ready_event);
+//     ...
+//   }
+//
+//   PostCoTask(worker_runner.get(), FROM_HERE, LoadAndParse(io_runner),
+//              BindOnce(&OnParsed));
+//
+// A CoTask is lazy: its body does not run until it is either co_awaited from
+// another CoTask or handed to StartCoTask()/PostCoTask(), which take ownership
+// of it. Awaiting a child CoTask resumes the parent directly when the child
+// finishes, without posting a task.
+//
+// Coroutine frames come from internal::CoroutineFrameAllocator, so a
+// steady-state pipeline recycles a handful of pooled frames rather than
+// allocating a BindState per hop.
+//
+// If a resumption is dropped without running (e.g. the TaskRunner passed to
+// ResumeOn() is shutting down and discards its tasks), the whole chain of
+// CoTasks it belongs to is destroyed on the thread that drops it, and the
+// reply passed to StartCoTask()/PostCoTask() never runs.
+
+#ifndef BRICK_TASK_CO_TASK_H_
+#define BRICK_TASK_CO_TASK_H_
+
+#include "brick/task/coroutine_buildflags.h"
+
+#if !BUILDFLAG(ENABLE_COROUTINES)
+#error "brick/task/co_task.h requires enable_coroutines = true"
+#endif
+
+#include <coroutine>
+#include <type_traits>
+#include <utility>
+
+#include "brick/base_export.h"
+#include "brick/bind.h"
+#include "brick/callback.h"
+#include "brick/location.h"
+#include "brick/logging.h"
+#include "brick/macros.h"
+#include "brick/memory/scoped_refptr.h"
+#include "brick/optional.h"
+#include "brick/sequenced_task_runner.h"
+#include "brick/synchronization/waitable_event_watcher.h"
+#include "brick/task/coroutine_frame_allocator.h"
+#include "brick/task_runner.h"
+#include "brick/threading/sequenced_task_runner_handle.h"
+#include "brick/time/time.h"
+
+namespace base {
+
+class WaitableEvent;
+
+template <typename T>
+class CoTask;
+
+namespace internal {
+
+// State shared by every CoTask promise, independent of the result type.
+class BRICK_EXPORT CoTaskPromiseBase {
+ public:
+  static void* operator new(size_t size) {
+    return CoroutineFrameAllocator::Allocate(size);
+  }
+  static void operator delete(void* frame, size_t size) {
+    CoroutineFrameAllocator::Free(frame, size);
+  }
+
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> handle) noexcept {
+      return handle.promise().OnFinalSuspend();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { NOTREACHED(); }
+
+  // Resumes the coroutine owning this promise.
+  void Resume() { handle_.resume(); }
+
+  // Destroys the detached coroutine at the root of the await chain containing
+  // this promise. Called when a pending resumption is dropped.
+  void DestroyChain();
+
+  // Marks this coroutine as owning its own frame and resumes it. Used by
+  // StartCoTask().
+  void StartDetached();
+
+  // Marks this coroutine as owning its own frame without resuming it. Used by
+  // PostCoTask(), which resumes it from a posted task.
+  void Detach() { detached_ = true; }
+
+  void set_parent(CoTaskPromiseBase* parent) {
+    DCHECK(!parent_);
+    DCHECK(!detached_);
+    parent_ = parent;
+  }
+
+ protected:
+  CoTaskPromiseBase() = default;
+  ~CoTaskPromiseBase() = default;
+
+  void set_handle(std::coroutine_handle<> handle) { handle_ = handle; }
+
+ private:
+  // Returns the coroutine to transfer control to once this one has finished.
+  std::coroutine_handle<> OnFinalSuspend() noexcept;
+
+  std::coroutine_handle<> handle_;
+
+  // The promise of the CoTask that co_awaits this one, if any.
+  CoTaskPromiseBase* parent_ = nullptr;
+
+  // True if nothing owns this coroutine's CoTask, in which case the frame
+  // destroys itself when the body completes.
+  bool detached_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(CoTaskPromiseBase);
+};
+
+template <typename T>
+class CoTaskPromise : public CoTaskPromiseBase {
+ public:
+  CoTaskPromise() = default;
+
+  CoTask<T> get_return_object();
+
+  template <typename U>
+  void return_value(U&& value) {
+    result_.emplace(std::forward<U>(value));
+  }
+
+  T TakeResult() {
+    DCHECK(result_);
+    return std::move(*result_);
+  }
+
+ private:
+  Optional<T> result_;
+};
+
+template <>
+class CoTaskPromise<void> : public CoTaskPromiseBase {
+ public:
+  CoTaskPromise() = default;
+
+  CoTask<void> get_return_object();
+
+  void return_void() {}
+  void TakeResult() {}
+};
+
+// Move-only token that resumes a suspended CoTask when Resume() is called.
+// If it is destroyed without being resumed, the chain the CoTask belongs to is
+// destroyed.
+class BRICK_EXPORT CoroutineResumer {
+ public:
+  explicit CoroutineResumer(CoTaskPromiseBase* promise);
+  CoroutineResumer(CoroutineResumer&& other);
+  ~CoroutineResumer();
+
+  void Resume();
+
+ private:
+  CoTaskPromiseBase* promise_;
+
+  DISALLOW_COPY_AND_ASSIGN(CoroutineResumer);
+};
+
+BRICK_EXPORT void ResumeCoroutine(CoroutineResumer resumer);
+
+template <typename Promise>
+CoTaskPromiseBase* GetCoTaskPromise(std::coroutine_handle<Promise> handle) {
+  static_assert(std::is_base_of<CoTaskPromiseBase, Promise>::value,
+                "brick awaitables can only be co_awaited from a CoTask");
+  return &handle.promise();
+}
+
+// Awaiter returned by ResumeOn().
+class BRICK_EXPORT ResumeOnAwaiter {
+ public:
+  ResumeOnAwaiter(scoped_refptr<TaskRunner> task_runner,
+                  const Location& from_here);
+  ~ResumeOnAwaiter();
+
+  bool await_ready() const { return false; }
+  template <typename Promise>
+  void await_suspend(std::coroutine_handle<Promise> handle) {
+    Suspend(GetCoTaskPromise(handle));
+  }
+  void await_resume() const {}
+
+ private:
+  void Suspend(CoTaskPromiseBase* promise);
+
+  scoped_refptr<TaskRunner> task_runner_;
+  const Location from_here_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResumeOnAwaiter);
+};
+
+// Awaiter returned by SleepFor().
+class BRICK_EXPORT SleepAwaiter {
+ public:
+  SleepAwaiter(TimeDelta delay, const Location& from_here);
+  ~SleepAwaiter();
+
+  bool await_ready() const { return false; }
+  template <typename Promise>
+  void await_suspend(std::coroutine_handle<Promise> handle) {
+    Suspend(GetCoTaskPromise(handle));
+  }
+  void await_resume() const {}
+
+ private:
+  void Suspend(CoTaskPromiseBase* promise);
+
+  const TimeDelta delay_;
+  const Location from_here_;
+
+  DISALLOW_COPY_AND_ASSIGN(SleepAwaiter);
+};
+
+// Awaiter returned by AwaitEvent().
+class BRICK_EXPORT WaitableEventAwaiter {
+ public:
+  explicit WaitableEventAwaiter(WaitableEvent* event);
+  ~WaitableEventAwaiter();
+
+  // Consumes the signal of an auto-reset |event_| if it is already signaled.
+  bool await_ready();
+  template <typename Promise>
+  void await_suspend(std::coroutine_handle<Promise> handle) {
+    Suspend(GetCoTaskPromise(handle));
+  }
+  void await_resume() const {}
+
+ private:
+  void Suspend(CoTaskPromiseBase* promise);
+
+  WaitableEvent* const event_;
+
+  // Destroyed with the coroutine frame, which stops the watch if the chain is
+  // destroyed while waiting.
+  WaitableEventWatcher watcher_;
+
+  DISALLOW_COPY_AND_ASSIGN(WaitableEventAwaiter);
+};
+
+template <typename T>
+struct CoTaskReplyType {
+  using Type = OnceCallback<void(T)>;
+};
+
+template <>
+struct CoTaskReplyType<void> {
+  using Type = OnceClosure;
+};
+
+}  // namespace internal
+
+// Callback type used to deliver the result of a CoTask<T>.
+template <typename T>
+using CoTaskReply = typename internal::CoTaskReplyType<T>::Type;
+
+template <typename T>
+class CoTask {
+ public:
+  using promise_type = internal::CoTaskPromise<T>;
+
+  CoTask() = default;
+  CoTask(CoTask&& other) : handle_(std::exchange(other.handle_, nullptr)) {}
+  CoTask& operator=(CoTask&& other) {
+    if (this != &other) {
+      Reset();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  // Destroying a CoTask that has not been started or has finished is always
+  // safe; it may also be done while its body is suspended, which cancels it.
+  ~CoTask() { Reset(); }
+
+  explicit operator bool() const { return !!handle_; }
+
+  // Awaiting a CoTask runs its body until its first suspension point and
+  // resumes the awaiting coroutine, with the co_return'ed value, once the body
+  // completes. A CoTask can be awaited at most once.
+  bool await_ready() const noexcept { return false; }
+  template <typename Promise>
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<Promise> awaiting) noexcept {
+    DCHECK(handle_);
+    handle_.promise().set_parent(internal::GetCoTaskPromise(awaiting));
+    return handle_;
+  }
+  T await_resume() { return handle_.promise().TakeResult(); }
+
+ private:
+  friend class internal::CoTaskPromise<T>;
+  template <typename U>
+  friend void StartCoTask(CoTask<U> task, CoTaskReply<U> reply);
+  template <typename U>
+  friend bool PostCoTask(TaskRunner* task_runner,
+                         const Location& from_here,
+                         CoTask<U> task,
+                         CoTaskReply<U> reply);
+
+  explicit CoTask(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  // Gives up ownership of the frame, which must then be detached.
+  std::coroutine_handle<promise_type> Release() {
+    return std::exchange(handle_, nullptr);
+  }
+
+  void Reset() {
+    if (handle_)
+      std::exchange(handle_, nullptr).destroy();
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(CoTask);
+};
+
+namespace internal {
+
+template <typename T>
+CoTask<T> CoTaskPromise<T>::get_return_object() {
+  auto handle = std::coroutine_handle<CoTaskPromise<T>>::from_promise(*this);
+  set_handle(handle);
+  return CoTask<T>(handle);
+}
+
+inline CoTask<void> CoTaskPromise<void>::get_return_object() {
+  auto handle = std::coroutine_handle<CoTaskPromise<void>>::from_promise(*this);
+  set_handle(handle);
+  return CoTask<void>(handle);
+}
+
+template <typename T>
+CoTask<void> RunCoTaskAndReply(CoTask<T> task, CoTaskReply<T> reply) {
+  if constexpr (std::is_void<T>::value) {
+    co_await std::move(task);
+    std::move(reply).Run();
+  } else {
+    T result = co_await std::move(task);
+    std::move(reply).Run(std::move(result));
+  }
+}
+
+template <typename T>
+CoTask<void> RunCoTaskAndReplyOn(
+    CoTask<T> task,
+    scoped_refptr<SequencedTaskRunner> reply_task_runner,
+    Location from_here,
+    CoTaskReply<T> reply) {
+  if constexpr (std::is_void<T>::value) {
+    co_await std::move(task);
+    co_await ResumeOnAwaiter(std::move(reply_task_runner), from_here);
+    std::move(reply).Run();
+  } else {
+    T result = co_await std::move(task);
+    co_await ResumeOnAwaiter(std::move(reply_task_runner), from_here);
+    std::move(reply).Run(std::move(result));
+  }
+}
+
+}  // namespace internal
+
+// Returns an awaitable that resumes the awaiting CoTask in a task posted to
+// |task_runner|.
+inline internal::ResumeOnAwaiter ResumeOn(scoped_refptr<TaskRunner> task_runner,
+                                          const Location& from_here) {
+  return internal::ResumeOnAwaiter(std::move(task_runner), from_here);
+}
+
+// Returns an awaitable that resumes the awaiting CoTask on the current
+// sequence after |delay|. Must be awaited on a sequence with a
+// SequencedTaskRunnerHandle.
+inline internal::SleepAwaiter SleepFor(TimeDelta delay,
+                                       const Location& from_here = FROM_HERE) {
+  return internal::SleepAwaiter(delay, from_here);
+}
+
+// Returns an awaitable that resumes the awaiting CoTask on the current
+// sequence once |event| is signaled. Unlike WaitableEvent::Wait(), this does
+// not block the thread. Must be awaited on a sequence with a
+// SequencedTaskRunnerHandle, and |event| must outlive the wait. If the
+// sequence discards the pending wake-up at shutdown, the awaiting chain is
+// leaked rather than destroyed.
+inline internal::WaitableEventAwaiter AwaitEvent(WaitableEvent* event) {
+  return internal::WaitableEventAwaiter(event);
+}
+
+// Runs |task| on the current thread until its first suspension point. |reply|
+// is run with the result wherever the task completes; co_await ResumeOn() at
+// the end of |task| to control where that is.
+template <typename T>
+void StartCoTask(CoTask<T> task, CoTaskReply<T> reply) {
+  DCHECK(task);
+  DCHECK(reply);
+  CoTask<void> root =
+      internal::RunCoTaskAndReply<T>(std::move(task), std::move(reply));
+  root.Release().promise().StartDetached();
+}
+
+// Coroutine counterpart of PostTaskAndReplyWithResult(): starts |task| in a
+// task posted to |task_runner| and runs |reply| with its result on the
+// sequence that called PostCoTask(). Returns false if the task could not be
+// posted, in which case |task| and |reply| are destroyed.
+template <typename T>
+bool PostCoTask(TaskRunner* task_runner,
+                const Location& from_here,
+                CoTask<T> task,
+                CoTaskReply<T> reply) {
+  DCHECK(task);
+  DCHECK(reply);
+  CoTask<void> root = internal::RunCoTaskAndReplyOn<T>(
+      std::move(task), SequencedTaskRunnerHandle::Get(), from_here,
+      std::move(reply));
+  internal::CoTaskPromiseBase* promise = &root.Release().promise();
+  promise->Detach();
+  return task_runner->PostTask(
+      from_here, BindOnce(&internal::ResumeCoroutine,
+                          internal::CoroutineResumer(promise)));
+}
+
+}  // namespace base
+
+#endif  // BRICK_TASK_CO_TASK_H_
@@ -0,0 +1,191 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/task/co_task.h"
+
+#include <utility>
+
+#include "brick/bind.h"
+#include "brick/message_loop/message_loop.h"
+#include "brick/run_loop.h"
+#include "brick/synchronization/waitable_event.h"
+#include "brick/task/coroutine_frame_allocator.h"
+#include "brick/threading/platform_thread.h"
+#include "brick/threading/thread.h"
+#include "brick/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+void StoreValue(int* destination, int value) {
+  *destination = value;
+}
+
+void StoreThreadIdAndQuit(PlatformThreadId* destination,
+                          OnceClosure quit_closure,
+                          PlatformThreadId value) {
+  *destination = value;
+  std::move(quit_closure).Run();
+}
+
+CoTask<int> ReturnFourtyTwo() {
+  co_return 42;
+}
+
+CoTask<int> AddOne(CoTask<int> task) {
+  int value = co_await std::move(task);
+  co_return value + 1;
+}
+
+CoTask<PlatformThreadId> GetThreadIdOn(scoped_refptr<TaskRunner> task_runner) {
+  co_await ResumeOn(task_runner, FROM_HERE);
+  co_return PlatformThread::CurrentId();
+}
+
+CoTask<void> Sleep(TimeDelta delay) {
+  co_await SleepFor(delay);
+}
+
+CoTask<void> WaitForEvent(WaitableEvent* event) {
+  co_await AwaitEvent(event);
+}
+
+// Increments |*destroyed_count| when destroyed.
+class DestructionCounter {
+ public:
+  explicit DestructionCounter(int* destroyed_count)
+      : destroyed_count_(destroyed_count) {}
+  ~DestructionCounter() { ++*destroyed_count_; }
+
+ private:
+  int* const destroyed_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(DestructionCounter);
+};
+
+CoTask<int> HopWithLocal(scoped_refptr<TaskRunner> task_runner,
+                         int* destroyed_count) {
+  DestructionCounter counter(destroyed_count);
+  co_await ResumeOn(task_runner, FROM_HERE);
+  co_return 1;
+}
+
+}  // namespace
+
+TEST(CoTaskTest, StartRunsUntilFirstSuspension) {
+  int result = 0;
+  StartCoTask(ReturnFourtyTwo(), BindOnce(&StoreValue, &result));
+  EXPECT_EQ(42, result);
+}
+
+TEST(CoTaskTest, AwaitChild) {
+  int result = 0;
+  StartCoTask(AddOne(AddOne(ReturnFourtyTwo())),
+              BindOnce(&StoreValue, &result));
+  EXPECT_EQ(44, result);
+}
+
+TEST(CoTaskTest, UnstartedTaskIsDestroyed) {
+  int destroyed_count = 0;
+  MessageLoop message_loop;
+  {
+    CoTask<int> task =
+        HopWithLocal(message_loop.task_runner(), &destroyed_count);
+  }
+  // The body never ran, so the local was never constructed.
+  EXPECT_EQ(0, destroyed_count);
+}
+
+TEST(CoTaskTest, PostCoTaskRepliesOnOriginSequence) {
+  MessageLoop message_loop;
+  Thread thread("CoTaskTest");
+  ASSERT_TRUE(thread.Start());
+
+  PlatformThreadId task_thread_id = kInvalidThreadId;
+  RunLoop run_loop;
+  EXPECT_TRUE(PostCoTask(
+      message_loop.task_runner().get(), FROM_HERE,
+      GetThreadIdOn(thread.task_runner()),
+      BindOnce(&StoreThreadIdAndQuit, &task_thread_id,
+               run_loop.QuitClosure())));
+  run_loop.Run();
+
+  EXPECT_EQ(thread.GetThreadId(), task_thread_id);
+}
+
+TEST(CoTaskTest, SleepFor) {
+  MessageLoop message_loop;
+  const TimeDelta kDelay = TimeDelta::FromMilliseconds(20);
+
+  RunLoop run_loop;
+  const TimeTicks start = TimeTicks::Now();
+  StartCoTask(Sleep(kDelay), run_loop.QuitClosure());
+  run_loop.Run();
+
+  EXPECT_GE(TimeTicks::Now() - start, kDelay);
+}
+
+TEST(CoTaskTest, AwaitEvent) {
+  MessageLoop message_loop;
+  Thread thread("CoTaskTest");
+  ASSERT_TRUE(thread.Start());
+
+  WaitableEvent event(WaitableEvent::ResetPolicy::AUTOMATIC,
+                      WaitableEvent::InitialState::NOT_SIGNALED);
+  RunLoop run_loop;
+  StartCoTask(WaitForEvent(&event), run_loop.QuitClosure());
+  thread.task_runner()->PostTask(
+      FROM_HERE, BindOnce(&WaitableEvent::Signal, Unretained(&event)));
+  run_loop.Run();
+
+  // The wait consumed the signal.
+  EXPECT_FALSE(event.IsSignaled());
+}
+
+TEST(CoTaskTest, AwaitSignaledEventDoesNotSuspend) {
+  WaitableEvent event(WaitableEvent::ResetPolicy::MANUAL,
+                      WaitableEvent::InitialState::SIGNALED);
+  bool done = false;
+  StartCoTask(WaitForEvent(&event),
+              BindOnce([](bool* done) { *done = true; }, &done));
+  EXPECT_TRUE(done);
+}
+
+TEST(CoTaskTest, DroppedResumptionDestroysChain) {
+  Thread thread("CoTaskTest");
+  ASSERT_TRUE(thread.Start());
+  scoped_refptr<SingleThreadTaskRunner> task_runner = thread.task_runner();
+  thread.Stop();
+
+  // Posting to a stopped thread fails, which must destroy the whole chain,
+  // including the frame of the parent AddOne().
+  int destroyed_count = 0;
+  int result = 0;
+  StartCoTask(AddOne(HopWithLocal(task_runner, &destroyed_count)),
+              BindOnce(&StoreValue, &result));
+  EXPECT_EQ(1, destroyed_count);
+  EXPECT_EQ(0, result);
+}
+
+TEST(CoTaskTest, FramesAreRecycled) {
+  internal::CoroutineFrameAllocator::PurgeThreadCacheForTesting();
+
+  int result = 0;
+  StartCoTask(AddOne(ReturnFourtyTwo()), BindOnce(&StoreValue, &result));
+  EXPECT_EQ(43, result);
+  const size_t cached_frames =
+      internal::CoroutineFrameAllocator::GetCachedFrameCountForTesting();
+  EXPECT_GT(cached_frames, 0u);
+
+  // Running the same pipeline again is served entirely from the cache.
+  for (int i = 0; i < 10; ++i) {
+    StartCoTask(AddOne(ReturnFourtyTwo()), BindOnce(&StoreValue, &result));
+    EXPECT_EQ(cached_frames,
+              internal::CoroutineFrameAllocator::GetCachedFrameCountForTesting());
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,137 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/task/coroutine_frame_allocator.h"
+
+#include <new>
+
+#include "brick/bits.h"
+#include "brick/logging.h"
+#include "brick/no_destructor.h"
+#include "brick/threading/thread_local_storage.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+constexpr size_t kMinSizeClassShift = 7;  // 128 bytes.
+constexpr size_t kNumSizeClasses = 5;     // 128, 256, 512, 1024, 2048.
+
+static_assert((size_t{1} << (kMinSizeClassShift + kNumSizeClasses - 1)) ==
+                  CoroutineFrameAllocator::kMaxCachedFrameSize,
+              "size classes must end at kMaxCachedFrameSize");
+
+struct FreeFrame {
+  FreeFrame* next;
+};
+
+struct ThreadFrameCache {
+  FreeFrame* free_lists[kNumSizeClasses] = {};
+  size_t counts[kNumSizeClasses] = {};
+};
+
+size_t SizeClassIndex(size_t size) {
+  DCHECK_LE(size, CoroutineFrameAllocator::kMaxCachedFrameSize);
+  if (size <= (size_t{1} << kMinSizeClassShift))
+    return 0;
+  return bits::Log2Ceiling(static_cast<uint32_t>(size)) - kMinSizeClassShift;
+}
+
+size_t SizeClassBytes(size_t index) {
+  return size_t{1} << (kMinSizeClassShift + index);
+}
+
+void PurgeCache(ThreadFrameCache* cache) {
+  for (size_t i = 0; i < kNumSizeClasses; ++i) {
+    while (FreeFrame* frame = cache->free_lists[i]) {
+      cache->free_lists[i] = frame->next;
+      ::operator delete(frame);
+    }
+    cache->counts[i] = 0;
+  }
+}
+
+void DestructThreadFrameCache(void* cache) {
+  ThreadFrameCache* frame_cache = static_cast<ThreadFrameCache*>(cache);
+  PurgeCache(frame_cache);
+  delete frame_cache;
+}
+
+ThreadLocalStorage::Slot& ThreadFrameCacheTLS() {
+  static NoDestructor<ThreadLocalStorage::Slot> tls_frame_cache(
+      &DestructThreadFrameCache);
+  return *tls_frame_cache;
+}
+
+ThreadFrameCache* GetThreadFrameCache() {
+  return static_cast<ThreadFrameCache*>(ThreadFrameCacheTLS().Get());
+}
+
+}  // namespace
+
+// static
+void* CoroutineFrameAllocator::Allocate(size_t size) {
+  if (size > kMaxCachedFrameSize)
+    return ::operator new(size);
+
+  const size_t index = SizeClassIndex(size);
+  ThreadFrameCache* cache = GetThreadFrameCache();
+  if (!cache) {
+    cache = new ThreadFrameCache;
+    ThreadFrameCacheTLS().Set(cache);
+  }
+
+  if (FreeFrame* frame = cache->free_lists[index]) {
+    cache->free_lists[index] = frame->next;
+    --cache->counts[index];
+    return frame;
+  }
+  return ::operator new(SizeClassBytes(index));
+}
+
+// static
+void CoroutineFrameAllocator::Free(void* frame, size_t size) {
+  if (!frame)
+    return;
+  if (size > kMaxCachedFrameSize) {
+    ::operator delete(frame);
+    return;
+  }
+
+  // Threads that never allocated a frame don't get a cache on their behalf;
+  // this also keeps frames destroyed during TLS teardown from resurrecting it.
+  const size_t index = SizeClassIndex(size);
+  ThreadFrameCache* cache = GetThreadFrameCache();
+  if (!cache || cache->counts[index] >= kMaxCachedFramesPerSizeClass) {
+    ::operator delete(frame);
+    return;
+  }
+
+  FreeFrame* free_frame = static_cast<FreeFrame*>(frame);
+  free_frame->next = cache->free_lists[index];
+  cache->free_lists[index] = free_frame;
+  ++cache->counts[index];
+}
+
+// static
+size_t CoroutineFrameAllocator::GetCachedFrameCountForTesting() {
+  ThreadFrameCache* cache = GetThreadFrameCache();
+  if (!cache)
+    return 0;
+  size_t count = 0;
+  for (size_t i = 0; i < kNumSizeClasses; ++i)
+    count += cache->counts[i];
+  return count;
+}
+
+// static
+void CoroutineFrameAllocator::PurgeThreadCacheForTesting() {
+  ThreadFrameCache* cache = GetThreadFrameCache();
+  if (cache)
+    PurgeCache(cache);
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,51 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TASK_COROUTINE_FRAME_ALLOCATOR_H_
+#define BRICK_TASK_COROUTINE_FRAME_ALLOCATOR_H_
+
+#include <stddef.h>
+
+#include "brick/base_export.h"
+#include "brick/macros.h"
+
+namespace base {
+namespace internal {
+
+// Allocates coroutine frames for CoTask. Frames are rounded up to a small set
+// of size classes and recycled through bounded per-thread free lists, so that
+// a pipeline which repeatedly awaits short-lived child CoTasks reuses the same
+// few blocks instead of hitting malloc for every hop. Frames larger than the
+// biggest size class go straight to the general heap.
+//
+// A frame may be freed on a different thread than the one that allocated it
+// (e.g. after co_await ResumeOn() to another sequence); it is then cached by
+// the freeing thread.
+class BRICK_EXPORT CoroutineFrameAllocator {
+ public:
+  // Frames of at most this many bytes are served from the per-thread caches.
+  static constexpr size_t kMaxCachedFrameSize = 2048;
+
+  // Maximum number of free frames retained per size class per thread.
+  static constexpr size_t kMaxCachedFramesPerSizeClass = 16;
+
+  static void* Allocate(size_t size);
+
+  // |size| must be the value that was passed to Allocate().
+  static void Free(void* frame, size_t size);
+
+  // Returns the number of free frames cached by the calling thread.
+  static size_t GetCachedFrameCountForTesting();
+
+  // Releases all free frames cached by the calling thread.
+  static void PurgeThreadCacheForTesting();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(CoroutineFrameAllocator);
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BRICK_TASK_COROUTINE_FRAME_ALLOCATOR_H_
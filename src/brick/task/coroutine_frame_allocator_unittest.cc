@@ -0,0 +1,66 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/task/coroutine_frame_allocator.h"
+
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+
+class CoroutineFrameAllocatorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    CoroutineFrameAllocator::PurgeThreadCacheForTesting();
+  }
+  void TearDown() override {
+    CoroutineFrameAllocator::PurgeThreadCacheForTesting();
+  }
+};
+
+TEST_F(CoroutineFrameAllocatorTest, ReusesFreedFrame) {
+  void* frame = CoroutineFrameAllocator::Allocate(200);
+  CoroutineFrameAllocator::Free(frame, 200);
+  EXPECT_EQ(1u, CoroutineFrameAllocator::GetCachedFrameCountForTesting());
+
+  // Any size in the same size class gets the cached frame back.
+  void* reused = CoroutineFrameAllocator::Allocate(250);
+  EXPECT_EQ(frame, reused);
+  EXPECT_EQ(0u, CoroutineFrameAllocator::GetCachedFrameCountForTesting());
+  CoroutineFrameAllocator::Free(reused, 250);
+}
+
+TEST_F(CoroutineFrameAllocatorTest, SizeClassesAreSeparate) {
+  void* small_frame = CoroutineFrameAllocator::Allocate(64);
+  CoroutineFrameAllocator::Free(small_frame, 64);
+
+  void* large_frame = CoroutineFrameAllocator::Allocate(1000);
+  EXPECT_NE(small_frame, large_frame);
+  CoroutineFrameAllocator::Free(large_frame, 1000);
+  EXPECT_EQ(2u, CoroutineFrameAllocator::GetCachedFrameCountForTesting());
+}
+
+TEST_F(CoroutineFrameAllocatorTest, LargeFramesAreNotCached) {
+  const size_t kLargeSize = CoroutineFrameAllocator::kMaxCachedFrameSize + 1;
+  void* frame = CoroutineFrameAllocator::Allocate(kLargeSize);
+  CoroutineFrameAllocator::Free(frame, kLargeSize);
+  EXPECT_EQ(0u, CoroutineFrameAllocator::GetCachedFrameCountForTesting());
+}
+
+TEST_F(CoroutineFrameAllocatorTest, CacheIsBounded) {
+  const size_t kCount =
+      CoroutineFrameAllocator::kMaxCachedFramesPerSizeClass * 2;
+  std::vector<void*> frames;
+  for (size_t i = 0; i < kCount; ++i)
+    frames.push_back(CoroutineFrameAllocator::Allocate(128));
+  for (void* frame : frames)
+    CoroutineFrameAllocator::Free(frame, 128);
+  EXPECT_EQ(CoroutineFrameAllocator::kMaxCachedFramesPerSizeClass,
+            CoroutineFrameAllocator::GetCachedFrameCountForTesting());
+}
+
+}  // namespace internal
+}  // namespace base
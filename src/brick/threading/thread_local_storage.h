@@ -32,6 +32,8 @@ class MallocDumpProvider;
 
 namespace internal {
 
+class BindStateAllocator;
+class PartitionThreadCache;
 class ThreadLocalStorageTestInternal;
 
 // WARNING: You should *NOT* use this class directly.
@@ -154,6 +156,8 @@ class BRICK_EXPORT ThreadLocalStorage {
   // disallowed and will hit a DCHECK. Any code that relies on TLS during thread
   // destruction must first check this method before calling Slot::Get().
   friend class base::SamplingHeapProfiler;
+  friend class base::internal::BindStateAllocator;
+  friend class base::internal::PartitionThreadCache;
   friend class base::internal::ThreadLocalStorageTestInternal;
   friend class base::trace_event::MallocDumpProvider;
   friend class heap_profiling::ScopedAllowAlloc;
@@ -313,6 +313,76 @@ TEST_F(PthreadEventPerfTest, EventPingPong) {
 
 #endif
 
+// Measures how fast a lock changes hands between threads that all hammer it.
+// With a short critical section this is dominated by the cost of the
+// contended acquisition path, i.e. spinning versus parking in the kernel.
+template <typename LockType>
+class LockPerfTest : public ThreadPerfTest {
+ public:
+  void Init() override {
+    ThreadPerfTest::Init();
+    remaining_threads_ = static_cast<int>(threads_.size());
+  }
+
+  void IncrementOnThread() {
+    bool done = false;
+    while (!done) {
+      lock_.Acquire();
+      if (remaining_hops_ > 0)
+        --remaining_hops_;
+      done = remaining_hops_ == 0;
+      lock_.Release();
+    }
+    lock_.Acquire();
+    const bool last_thread = --remaining_threads_ == 0;
+    lock_.Release();
+    if (last_thread)
+      FinishMeasurement();
+  }
+
+  void PingPong(int hops) override {
+    remaining_hops_ = hops;
+    for (size_t i = 0; i < threads_.size(); i++) {
+      threads_[i]->task_runner()->PostTask(
+          FROM_HERE, base::BindOnce(&LockPerfTest::IncrementOnThread,
+                                    base::Unretained(this)));
+    }
+  }
+
+ private:
+  LockType lock_;
+  int remaining_hops_;
+  int remaining_threads_;
+};
+
+typedef LockPerfTest<base::Lock> BaseLockPerfTest;
+TEST_F(BaseLockPerfTest, Contention) {
+  RunPingPongTest("4_Lock_Threads", 4);
+}
+
+#if defined(OS_POSIX)
+
+// Adapts a default pthread mutex to the Acquire()/Release() interface, as a
+// baseline for base::Lock.
+class PthreadMutex {
+ public:
+  PthreadMutex() { pthread_mutex_init(&mutex_, nullptr); }
+  ~PthreadMutex() { pthread_mutex_destroy(&mutex_); }
+
+  void Acquire() { pthread_mutex_lock(&mutex_); }
+  void Release() { pthread_mutex_unlock(&mutex_); }
+
+ private:
+  pthread_mutex_t mutex_;
+};
+
+typedef LockPerfTest<PthreadMutex> PthreadMutexPerfTest;
+TEST_F(PthreadMutexPerfTest, Contention) {
+  RunPingPongTest("4_PthreadMutex_Threads", 4);
+}
+
+#endif
+
 }  // namespace
 
 }  // namespace base
@@ -0,0 +1,163 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TRACE_EVENT_BINARY_TRACE_FORMAT_H_
+#define BRICK_TRACE_EVENT_BINARY_TRACE_FORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace base {
+namespace trace_event {
+namespace binary_trace {
+
+// The binary trace format is a stream of protobuf wire format messages, so it
+// can be decoded by any protobuf library and concatenated like a repeated
+// field. In .proto syntax:
+//
+//   message Trace {
+//     repeated Packet packet = 1;
+//   }
+//
+//   message Packet {
+//     oneof data {
+//       InternedString interned_string = 1;
+//       Event event = 2;
+//     }
+//   }
+//
+//   // Defines |iid| for the strings of the packets that follow. Ids start
+//   // at 1 and are assigned in order.
+//   message InternedString {
+//     uint64 iid = 1;
+//     bytes value = 2;
+//   }
+//
+//   // The fields of a TraceEvent, see TraceEvent::AppendAsJSON().
+//   message Event {
+//     // In microseconds, relative to the previous event of the stream.
+//     sint64 timestamp_delta = 1;
+//     uint32 pid = 2;
+//     sint32 tid = 3;
+//     uint32 phase = 4;
+//     uint64 category_iid = 5;
+//     uint64 name_iid = 6;
+//     repeated Arg arg = 7;
+//     // Set instead of |arg| when the ArgumentFilterPredicate stripped all of
+//     // them.
+//     bool args_stripped = 8;
+//     // Complete events only; omitted when unknown.
+//     int64 duration = 9;
+//     int64 thread_duration = 10;
+//     // Omitted when the thread timestamp is null.
+//     int64 thread_timestamp = 11;
+//     uint32 flags = 12;
+//     fixed64 id = 13;
+//     // Omitted for the global scope.
+//     uint64 scope_iid = 14;
+//     fixed64 bind_id = 15;
+//   }
+//
+//   message Arg {
+//     uint64 name_iid = 1;
+//     // One of the TRACE_VALUE_TYPE_* constants.
+//     uint32 type = 2;
+//     oneof value {
+//       // TRACE_VALUE_TYPE_BOOL, _UINT and _POINTER.
+//       uint64 uint_value = 3;
+//       // TRACE_VALUE_TYPE_INT.
+//       sint64 int_value = 4;
+//       // TRACE_VALUE_TYPE_DOUBLE.
+//       double double_value = 5;
+//       // TRACE_VALUE_TYPE_STRING and _COPY_STRING, or the JSON produced by
+//       // a TRACE_VALUE_TYPE_CONVERTABLE.
+//       bytes string_value = 6;
+//       // Set when the ArgumentNameFilterPredicate stripped this argument.
+//       bool stripped = 7;
+//     }
+//   }
+//
+// Names, categories and scopes are interned, so each distinct string is only
+// written once per stream. Fields that don't apply to an event are omitted.
+
+enum PacketField : uint32_t {
+  kPacketInternedString = 1,
+  kPacketEvent = 2,
+};
+
+enum InternedStringField : uint32_t {
+  kInternedStringIid = 1,
+  kInternedStringValue = 2,
+};
+
+enum EventField : uint32_t {
+  kEventTimestampDelta = 1,
+  kEventPid = 2,
+  kEventTid = 3,
+  kEventPhase = 4,
+  kEventCategoryIid = 5,
+  kEventNameIid = 6,
+  kEventArg = 7,
+  kEventArgsStripped = 8,
+  kEventDuration = 9,
+  kEventThreadDuration = 10,
+  kEventThreadTimestamp = 11,
+  kEventFlags = 12,
+  kEventId = 13,
+  kEventScopeIid = 14,
+  kEventBindId = 15,
+};
+
+enum ArgField : uint32_t {
+  kArgNameIid = 1,
+  kArgType = 2,
+  kArgUintValue = 3,
+  kArgIntValue = 4,
+  kArgDoubleValue = 5,
+  kArgStringValue = 6,
+  kArgStripped = 7,
+};
+
+// Protobuf wire types.
+enum WireType : uint32_t {
+  kWireTypeVarint = 0,
+  kWireTypeFixed64 = 1,
+  kWireTypeLengthDelimited = 2,
+  kWireTypeFixed32 = 5,
+};
+
+// The longest encoding of a 64-bit varint.
+constexpr size_t kMaxVarintSize = 10;
+
+inline uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline void AppendVarint(uint64_t value, std::string* out) {
+  char buffer[kMaxVarintSize];
+  size_t size = 0;
+  while (value >= 0x80) {
+    buffer[size++] = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  buffer[size++] = static_cast<char>(value);
+  out->append(buffer, size);
+}
+
+inline void AppendTag(uint32_t field, WireType wire_type, std::string* out) {
+  AppendVarint((field << 3) | wire_type, out);
+}
+
+}  // namespace binary_trace
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BRICK_TRACE_EVENT_BINARY_TRACE_FORMAT_H_
@@ -0,0 +1,457 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/binary_trace_reader.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <vector>
+
+#include "brick/json/string_escape.h"
+#include "brick/logging.h"
+#include "brick/strings/stringprintf.h"
+#include "brick/trace_event/binary_trace_format.h"
+#include "brick/trace_event/trace_event.h"
+#include "brick/trace_event/trace_event_impl.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+// Reads a varint from the front of |in|. Returns false if |in| doesn't start
+// with a complete one.
+bool ReadVarint(StringPiece* in, uint64_t* value) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < in->size() && i < binary_trace::kMaxVarintSize; ++i) {
+    const uint8_t byte = static_cast<uint8_t>((*in)[i]);
+    result |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80)) {
+      in->remove_prefix(i + 1);
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// One field of a message. Length-delimited fields are in |bytes|, all the
+// others in |value|.
+struct Field {
+  uint32_t number;
+  uint32_t wire_type;
+  uint64_t value;
+  StringPiece bytes;
+};
+
+// Iterates over the fields of a message.
+class FieldReader {
+ public:
+  explicit FieldReader(StringPiece message) : remaining_(message) {}
+
+  // Returns false at the end of the message, or if the rest of it is
+  // malformed or truncated.
+  bool Next(Field* field) {
+    uint64_t tag;
+    if (!ReadVarint(&remaining_, &tag))
+      return false;
+    field->number = static_cast<uint32_t>(tag >> 3);
+    field->wire_type = static_cast<uint32_t>(tag & 7);
+    switch (field->wire_type) {
+      case binary_trace::kWireTypeVarint:
+        return ReadVarint(&remaining_, &field->value);
+      case binary_trace::kWireTypeFixed64:
+        return ReadFixed(8, field);
+      case binary_trace::kWireTypeFixed32:
+        return ReadFixed(4, field);
+      case binary_trace::kWireTypeLengthDelimited: {
+        uint64_t size;
+        if (!ReadVarint(&remaining_, &size) || size > remaining_.size())
+          return false;
+        field->bytes = remaining_.substr(0, static_cast<size_t>(size));
+        remaining_.remove_prefix(static_cast<size_t>(size));
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+  // True once every field has been read.
+  bool done() const { return remaining_.empty(); }
+
+ private:
+  bool ReadFixed(size_t size, Field* field) {
+    if (remaining_.size() < size)
+      return false;
+    field->value = 0;
+    for (size_t i = 0; i < size; ++i) {
+      field->value |= static_cast<uint64_t>(static_cast<uint8_t>(remaining_[i]))
+                      << (8 * i);
+    }
+    remaining_.remove_prefix(size);
+    return true;
+  }
+
+  StringPiece remaining_;
+};
+
+}  // namespace
+
+BinaryTraceReader::BinaryTraceReader() = default;
+
+BinaryTraceReader::~BinaryTraceReader() = default;
+
+bool BinaryTraceReader::Append(StringPiece data, std::string* json) {
+  if (malformed_)
+    return false;
+
+  StringPiece input = data;
+  if (!pending_.empty()) {
+    data.AppendToString(&pending_);
+    input = pending_;
+  }
+
+  // Packets are fields of the Trace message.
+  while (!input.empty()) {
+    StringPiece packet_start = input;
+    uint64_t tag;
+    uint64_t size;
+    if (!ReadVarint(&input, &tag) || !ReadVarint(&input, &size)) {
+      // A tag and a size take at most 2 * kMaxVarintSize bytes, so anything
+      // longer that doesn't parse is corrupt rather than incomplete.
+      if (packet_start.size() >= 2 * binary_trace::kMaxVarintSize) {
+        malformed_ = true;
+        return false;
+      }
+      input = packet_start;
+      break;
+    }
+    if ((tag & 7) != binary_trace::kWireTypeLengthDelimited) {
+      malformed_ = true;
+      return false;
+    }
+    if (size > input.size()) {
+      // Wait for the rest of the packet.
+      input = packet_start;
+      break;
+    }
+    if (!DecodePacket(input.substr(0, static_cast<size_t>(size)), json)) {
+      malformed_ = true;
+      return false;
+    }
+    input.remove_prefix(static_cast<size_t>(size));
+  }
+
+  // Keep the incomplete packet, if any. |input| may point into |pending_|.
+  pending_ = input.as_string();
+  return true;
+}
+
+bool BinaryTraceReader::IsComplete() const {
+  return !malformed_ && pending_.empty();
+}
+
+bool BinaryTraceReader::DecodePacket(StringPiece packet, std::string* json) {
+  FieldReader reader(packet);
+  Field field;
+  while (reader.Next(&field)) {
+    if (field.wire_type != binary_trace::kWireTypeLengthDelimited)
+      continue;
+    switch (field.number) {
+      case binary_trace::kPacketInternedString:
+        if (!DecodeInternedString(field.bytes))
+          return false;
+        break;
+      case binary_trace::kPacketEvent:
+        if (!DecodeEvent(field.bytes, json))
+          return false;
+        break;
+      default:
+        // Ignore fields added by newer writers.
+        break;
+    }
+  }
+  return reader.done();
+}
+
+bool BinaryTraceReader::DecodeInternedString(StringPiece message) {
+  FieldReader reader(message);
+  Field field;
+  uint64_t iid = 0;
+  StringPiece value;
+  while (reader.Next(&field)) {
+    if (field.number == binary_trace::kInternedStringIid)
+      iid = field.value;
+    else if (field.number == binary_trace::kInternedStringValue)
+      value = field.bytes;
+  }
+  if (!reader.done() || !iid)
+    return false;
+  strings_[iid] = value.as_string();
+  return true;
+}
+
+bool BinaryTraceReader::DecodeEvent(StringPiece message, std::string* json) {
+  int64_t timestamp_delta = 0;
+  int process_id = 0;
+  int thread_id = 0;
+  char phase = 0;
+  const std::string* category = nullptr;
+  const std::string* name = nullptr;
+  std::vector<StringPiece> args;
+  bool args_stripped = false;
+  int64_t duration = -1;
+  int64_t thread_duration = -1;
+  int64_t thread_timestamp = 0;
+  unsigned int flags = 0;
+  uint64_t id = 0;
+  const std::string* scope = nullptr;
+  uint64_t bind_id = 0;
+
+  FieldReader reader(message);
+  Field field;
+  while (reader.Next(&field)) {
+    switch (field.number) {
+      case binary_trace::kEventTimestampDelta:
+        timestamp_delta = binary_trace::ZigZagDecode(field.value);
+        break;
+      case binary_trace::kEventPid:
+        process_id = static_cast<int>(field.value);
+        break;
+      case binary_trace::kEventTid:
+        thread_id = static_cast<int>(binary_trace::ZigZagDecode(field.value));
+        break;
+      case binary_trace::kEventPhase:
+        phase = static_cast<char>(field.value);
+        break;
+      case binary_trace::kEventCategoryIid:
+        category = GetString(field.value);
+        break;
+      case binary_trace::kEventNameIid:
+        name = GetString(field.value);
+        break;
+      case binary_trace::kEventArg:
+        args.push_back(field.bytes);
+        break;
+      case binary_trace::kEventArgsStripped:
+        args_stripped = !!field.value;
+        break;
+      case binary_trace::kEventDuration:
+        duration = static_cast<int64_t>(field.value);
+        break;
+      case binary_trace::kEventThreadDuration:
+        thread_duration = static_cast<int64_t>(field.value);
+        break;
+      case binary_trace::kEventThreadTimestamp:
+        thread_timestamp = static_cast<int64_t>(field.value);
+        break;
+      case binary_trace::kEventFlags:
+        flags = static_cast<unsigned int>(field.value);
+        break;
+      case binary_trace::kEventId:
+        id = field.value;
+        break;
+      case binary_trace::kEventScopeIid:
+        scope = GetString(field.value);
+        break;
+      case binary_trace::kEventBindId:
+        bind_id = field.value;
+        break;
+      default:
+        break;
+    }
+  }
+  if (!reader.done() || !category || !name)
+    return false;
+
+  const int64_t timestamp = last_timestamp_ + timestamp_delta;
+  last_timestamp_ = timestamp;
+
+  // The rest mirrors TraceEvent::AppendAsJSON().
+  if (events_decoded_++)
+    json->append(",\n");
+  StringAppendF(json,
+                "{\"pid\":%i,\"tid\":%i,\"ts\":%" PRId64
+                ",\"ph\":\"%c\",\"cat\":\"%s\",\"name\":",
+                process_id, thread_id, timestamp, phase, category->c_str());
+  EscapeJSONString(*name, true, json);
+  *json += ",\"args\":";
+
+  if (args_stripped) {
+    *json += "\"__stripped__\"";
+  } else {
+    *json += "{";
+    for (size_t i = 0; i < args.size(); ++i) {
+      if (i > 0)
+        *json += ",";
+      if (!DecodeArg(args[i], json))
+        return false;
+    }
+    *json += "}";
+  }
+
+  if (phase == TRACE_EVENT_PHASE_COMPLETE) {
+    if (duration != -1)
+      StringAppendF(json, ",\"dur\":%" PRId64, duration);
+    if (thread_timestamp && thread_duration != -1)
+      StringAppendF(json, ",\"tdur\":%" PRId64, thread_duration);
+  }
+
+  if (thread_timestamp)
+    StringAppendF(json, ",\"tts\":%" PRId64, thread_timestamp);
+
+  if (flags & TRACE_EVENT_FLAG_ASYNC_TTS)
+    StringAppendF(json, ", \"use_async_tts\":1");
+
+  const unsigned int id_flags =
+      flags & (TRACE_EVENT_FLAG_HAS_ID | TRACE_EVENT_FLAG_HAS_LOCAL_ID |
+               TRACE_EVENT_FLAG_HAS_GLOBAL_ID);
+  if (id_flags) {
+    if (scope)
+      StringAppendF(json, ",\"scope\":\"%s\"", scope->c_str());
+
+    switch (id_flags) {
+      case TRACE_EVENT_FLAG_HAS_ID:
+        StringAppendF(json, ",\"id\":\"0x%" PRIx64 "\"", id);
+        break;
+
+      case TRACE_EVENT_FLAG_HAS_LOCAL_ID:
+        StringAppendF(json, ",\"id2\":{\"local\":\"0x%" PRIx64 "\"}", id);
+        break;
+
+      case TRACE_EVENT_FLAG_HAS_GLOBAL_ID:
+        StringAppendF(json, ",\"id2\":{\"global\":\"0x%" PRIx64 "\"}", id);
+        break;
+
+      default:
+        return false;
+    }
+  }
+
+  if (flags & TRACE_EVENT_FLAG_BIND_TO_ENCLOSING)
+    StringAppendF(json, ",\"bp\":\"e\"");
+
+  if (flags & (TRACE_EVENT_FLAG_FLOW_OUT | TRACE_EVENT_FLAG_FLOW_IN))
+    StringAppendF(json, ",\"bind_id\":\"0x%" PRIx64 "\"", bind_id);
+  if (flags & TRACE_EVENT_FLAG_FLOW_IN)
+    StringAppendF(json, ",\"flow_in\":true");
+  if (flags & TRACE_EVENT_FLAG_FLOW_OUT)
+    StringAppendF(json, ",\"flow_out\":true");
+
+  if (phase == TRACE_EVENT_PHASE_INSTANT) {
+    char scope_name = '?';
+    switch (flags & TRACE_EVENT_FLAG_SCOPE_MASK) {
+      case TRACE_EVENT_SCOPE_GLOBAL:
+        scope_name = TRACE_EVENT_SCOPE_NAME_GLOBAL;
+        break;
+
+      case TRACE_EVENT_SCOPE_PROCESS:
+        scope_name = TRACE_EVENT_SCOPE_NAME_PROCESS;
+        break;
+
+      case TRACE_EVENT_SCOPE_THREAD:
+        scope_name = TRACE_EVENT_SCOPE_NAME_THREAD;
+        break;
+    }
+    StringAppendF(json, ",\"s\":\"%c\"", scope_name);
+  }
+
+  *json += "}";
+  return true;
+}
+
+bool BinaryTraceReader::DecodeArg(StringPiece message, std::string* json) {
+  const std::string* name = nullptr;
+  unsigned char type = TRACE_VALUE_TYPE_UINT;
+  uint64_t value = 0;
+  std::string string_value;
+  bool stripped = false;
+
+  FieldReader reader(message);
+  Field field;
+  while (reader.Next(&field)) {
+    switch (field.number) {
+      case binary_trace::kArgNameIid:
+        name = GetString(field.value);
+        break;
+      case binary_trace::kArgType:
+        type = static_cast<unsigned char>(field.value);
+        break;
+      case binary_trace::kArgUintValue:
+      case binary_trace::kArgDoubleValue:
+        value = field.value;
+        break;
+      case binary_trace::kArgIntValue:
+        value = static_cast<uint64_t>(binary_trace::ZigZagDecode(field.value));
+        break;
+      case binary_trace::kArgStringValue:
+        string_value = field.bytes.as_string();
+        break;
+      case binary_trace::kArgStripped:
+        stripped = !!field.value;
+        break;
+      default:
+        break;
+    }
+  }
+  if (!reader.done() || !name)
+    return false;
+
+  *json += "\"";
+  *json += *name;
+  *json += "\":";
+
+  if (stripped) {
+    *json += "\"__stripped__\"";
+    return true;
+  }
+
+  TraceEvent::TraceValue trace_value;
+  switch (type) {
+    case TRACE_VALUE_TYPE_BOOL:
+      trace_value.as_bool = !!value;
+      break;
+    case TRACE_VALUE_TYPE_UINT:
+    case TRACE_VALUE_TYPE_INT:
+      trace_value.as_uint = value;
+      break;
+    case TRACE_VALUE_TYPE_DOUBLE:
+      memcpy(&trace_value.as_double, &value, sizeof(trace_value.as_double));
+      break;
+    case TRACE_VALUE_TYPE_POINTER:
+      trace_value.as_pointer =
+          reinterpret_cast<const void*>(static_cast<uintptr_t>(value));
+      break;
+    case TRACE_VALUE_TYPE_STRING:
+    case TRACE_VALUE_TYPE_COPY_STRING:
+      trace_value.as_string = string_value.c_str();
+      break;
+    case TRACE_VALUE_TYPE_CONVERTABLE:
+      // Already JSON.
+      *json += string_value;
+      return true;
+    default:
+      return false;
+  }
+  TraceEvent::AppendValueAsJSON(type, trace_value, json);
+  return true;
+}
+
+const std::string* BinaryTraceReader::GetString(uint64_t iid) const {
+  auto it = strings_.find(iid);
+  return it == strings_.end() ? nullptr : &it->second;
+}
+
+bool ConvertBinaryTraceToJSON(StringPiece binary_trace, std::string* json) {
+  BinaryTraceReader reader;
+  json->append("{\"traceEvents\":[");
+  const bool success = reader.Append(binary_trace, json);
+  json->append("]}");
+  return success && reader.IsComplete();
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,71 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TRACE_EVENT_BINARY_TRACE_READER_H_
+#define BRICK_TRACE_EVENT_BINARY_TRACE_READER_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "brick/base_export.h"
+#include "brick/macros.h"
+#include "brick/strings/string_piece.h"
+
+namespace base {
+namespace trace_event {
+
+// Converts traces written by BinaryTraceWriter back to JSON. Each event is
+// formatted exactly like TraceEvent::AppendAsJSON() would have.
+//
+// The input can be fed in pieces of any size, e.g. while the trace is still
+// being written.
+class BRICK_EXPORT BinaryTraceReader {
+ public:
+  BinaryTraceReader();
+  ~BinaryTraceReader();
+
+  // Decodes the complete packets of |data|, following whatever was passed
+  // before, and appends their events to |json|, separated by ",\n" like the
+  // fragments of TraceLog::Flush(). A packet cut at the end of |data| is kept
+  // until the next call. Returns false if the input is malformed, after which
+  // the reader stops decoding.
+  bool Append(StringPiece data, std::string* json);
+
+  // Returns true if the input so far is well formed and ends with a complete
+  // packet.
+  bool IsComplete() const;
+
+  size_t events_decoded() const { return events_decoded_; }
+
+ private:
+  // Decodes one packet. Returns false if it is malformed.
+  bool DecodePacket(StringPiece packet, std::string* json);
+  bool DecodeInternedString(StringPiece message);
+  bool DecodeEvent(StringPiece message, std::string* json);
+  bool DecodeArg(StringPiece message, std::string* json);
+
+  // Returns the string interned as |iid|, or null if there is none.
+  const std::string* GetString(uint64_t iid) const;
+
+  std::unordered_map<uint64_t, std::string> strings_;
+  // Bytes of a packet that wasn't complete at the end of the last Append().
+  std::string pending_;
+  int64_t last_timestamp_ = 0;
+  size_t events_decoded_ = 0;
+  bool malformed_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryTraceReader);
+};
+
+// Converts the whole |binary_trace| to a JSON trace, i.e.
+// {"traceEvents":[...]}. Returns false if it is malformed or truncated.
+BRICK_EXPORT bool ConvertBinaryTraceToJSON(StringPiece binary_trace,
+                                           std::string* json);
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BRICK_TRACE_EVENT_BINARY_TRACE_READER_H_
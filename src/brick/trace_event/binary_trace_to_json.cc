@@ -0,0 +1,88 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Converts a binary trace, as written by BinaryTraceWriter, to a JSON trace
+// that chrome://tracing and other Trace Event Format tools can load:
+//
+//   binary_trace_to_json <input> <output>
+//
+// The input is converted in pieces, so traces of any size can be converted.
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#include "brick/command_line.h"
+#include "brick/files/file.h"
+#include "brick/files/file_path.h"
+#include "brick/trace_event/binary_trace_reader.h"
+
+namespace {
+
+constexpr int kReadSize = 1 << 20;
+
+bool WriteAll(base::File* file, const std::string& data) {
+  return file->WriteAtCurrentPos(data.data(), static_cast<int>(data.size())) ==
+         static_cast<int>(data.size());
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  base::CommandLine::Init(argc, argv);
+  const base::CommandLine::StringVector args =
+      base::CommandLine::ForCurrentProcess()->GetArgs();
+  if (args.size() != 2) {
+    fprintf(stderr, "Usage: %s <binary trace> <JSON output>\n", argv[0]);
+    return 1;
+  }
+
+  base::File input(base::FilePath(args[0]),
+                   base::File::FLAG_OPEN | base::File::FLAG_READ);
+  if (!input.IsValid()) {
+    fprintf(stderr, "Can't open the input: %s\n",
+            base::File::ErrorToString(input.error_details()).c_str());
+    return 1;
+  }
+  base::File output(base::FilePath(args[1]),
+                    base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  if (!output.IsValid()) {
+    fprintf(stderr, "Can't create the output: %s\n",
+            base::File::ErrorToString(output.error_details()).c_str());
+    return 1;
+  }
+
+  base::trace_event::BinaryTraceReader reader;
+  std::unique_ptr<char[]> buffer(new char[kReadSize]);
+  std::string json = "{\"traceEvents\":[";
+  for (;;) {
+    const int bytes_read = input.ReadAtCurrentPos(buffer.get(), kReadSize);
+    if (bytes_read < 0) {
+      fprintf(stderr, "Failed to read the input\n");
+      return 1;
+    }
+    if (bytes_read == 0)
+      break;
+    if (!reader.Append(base::StringPiece(buffer.get(), bytes_read), &json)) {
+      fprintf(stderr, "The input is corrupt\n");
+      return 1;
+    }
+    if (!WriteAll(&output, json)) {
+      fprintf(stderr, "Failed to write the output\n");
+      return 1;
+    }
+    json.clear();
+  }
+  json += "]}\n";
+  if (!WriteAll(&output, json)) {
+    fprintf(stderr, "Failed to write the output\n");
+    return 1;
+  }
+
+  if (!reader.IsComplete())
+    fprintf(stderr, "The input is truncated; the last event was dropped\n");
+  fprintf(stderr, "Converted %zu events\n", reader.events_decoded());
+  return 0;
+}
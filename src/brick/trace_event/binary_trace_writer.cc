@@ -0,0 +1,290 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/binary_trace_writer.h"
+
+#include <string.h>
+
+#include <utility>
+
+#include "brick/logging.h"
+#include "brick/process/process_handle.h"
+#include "brick/trace_event/binary_trace_format.h"
+#include "brick/trace_event/trace_buffer.h"
+#include "brick/trace_event/trace_event.h"
+#include "brick/trace_event/trace_log.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+void AppendVarintField(uint32_t field, uint64_t value, std::string* out) {
+  binary_trace::AppendTag(field, binary_trace::kWireTypeVarint, out);
+  binary_trace::AppendVarint(value, out);
+}
+
+void AppendSignedField(uint32_t field, int64_t value, std::string* out) {
+  AppendVarintField(field, binary_trace::ZigZagEncode(value), out);
+}
+
+void AppendFixed64Field(uint32_t field, uint64_t value, std::string* out) {
+  binary_trace::AppendTag(field, binary_trace::kWireTypeFixed64, out);
+  char bytes[8];
+  for (int i = 0; i < 8; ++i)
+    bytes[i] = static_cast<char>(value >> (8 * i));
+  out->append(bytes, sizeof(bytes));
+}
+
+void AppendBytesField(uint32_t field,
+                      const char* data,
+                      size_t size,
+                      std::string* out) {
+  binary_trace::AppendTag(field, binary_trace::kWireTypeLengthDelimited, out);
+  binary_trace::AppendVarint(size, out);
+  out->append(data, size);
+}
+
+}  // namespace
+
+constexpr size_t BinaryTraceWriter::kFlushThreshold;
+
+BinaryTraceWriter::BinaryTraceWriter(File file)
+    : file_(std::move(file)),
+      process_id_(TraceLog::GetInstance()->process_id()) {
+  DCHECK(file_.IsValid());
+  buffer_.reserve(kFlushThreshold * 5 / 4);
+}
+
+BinaryTraceWriter::BinaryTraceWriter(std::string* output)
+    : output_(output), process_id_(TraceLog::GetInstance()->process_id()) {
+  DCHECK(output_);
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+  Flush();
+}
+
+void BinaryTraceWriter::AddEvent(
+    const TraceEvent& event,
+    const ArgumentFilterPredicate& argument_filter_predicate) {
+  const unsigned int flags = event.flags();
+  // Names and arguments of TRACE_EVENT_COPY_XXX events live in the event.
+  const bool is_static = !(flags & TRACE_EVENT_FLAG_COPY);
+  const char* category_group_name =
+      TraceLog::GetCategoryGroupName(event.category_group_enabled());
+
+  // Interning may emit packets, which must come before the event itself.
+  const uint64_t category_iid = Intern(category_group_name, true);
+  const uint64_t name_iid = Intern(event.name(), is_static);
+  const unsigned int id_flags =
+      flags & (TRACE_EVENT_FLAG_HAS_ID | TRACE_EVENT_FLAG_HAS_LOCAL_ID |
+               TRACE_EVENT_FLAG_HAS_GLOBAL_ID);
+  const uint64_t scope_iid =
+      (id_flags && event.scope() != trace_event_internal::kGlobalScope)
+          ? Intern(event.scope(), is_static)
+          : 0;
+
+  std::string* out = &event_message_;
+  out->clear();
+  AppendSignedField(binary_trace::kEventTimestampDelta,
+                    (event.timestamp() - last_timestamp_).InMicroseconds(),
+                    out);
+  last_timestamp_ = event.timestamp();
+
+  // See TraceEvent::AppendAsJSON().
+  int process_id = process_id_;
+  int thread_id = event.thread_id();
+  if ((flags & TRACE_EVENT_FLAG_HAS_PROCESS_ID) &&
+      event.thread_id() != kNullProcessId) {
+    process_id = event.thread_id();
+    thread_id = -1;
+  }
+  AppendVarintField(binary_trace::kEventPid, static_cast<uint32_t>(process_id),
+                    out);
+  AppendSignedField(binary_trace::kEventTid, thread_id, out);
+  char phase = event.phase();
+  if (phase == TRACE_EVENT_PHASE_COMPLETE &&
+      write_unfinished_complete_events_as_begin_ &&
+      event.duration().ToInternalValue() == -1) {
+    phase = TRACE_EVENT_PHASE_BEGIN;
+  }
+  AppendVarintField(binary_trace::kEventPhase,
+                    static_cast<unsigned char>(phase), out);
+  AppendVarintField(binary_trace::kEventCategoryIid, category_iid, out);
+  AppendVarintField(binary_trace::kEventNameIid, name_iid, out);
+
+  EncodeArgs(event, category_group_name, is_static, argument_filter_predicate,
+             out);
+
+  if (phase == TRACE_EVENT_PHASE_COMPLETE) {
+    const int64_t duration = event.duration().ToInternalValue();
+    if (duration != -1)
+      AppendVarintField(binary_trace::kEventDuration, duration, out);
+    if (!event.thread_timestamp().is_null()) {
+      const int64_t thread_duration =
+          event.thread_duration().ToInternalValue();
+      if (thread_duration != -1) {
+        AppendVarintField(binary_trace::kEventThreadDuration, thread_duration,
+                          out);
+      }
+    }
+  }
+  if (!event.thread_timestamp().is_null()) {
+    AppendVarintField(binary_trace::kEventThreadTimestamp,
+                      event.thread_timestamp().ToInternalValue(), out);
+  }
+  if (flags)
+    AppendVarintField(binary_trace::kEventFlags, flags, out);
+  if (id_flags)
+    AppendFixed64Field(binary_trace::kEventId, event.id(), out);
+  if (scope_iid)
+    AppendVarintField(binary_trace::kEventScopeIid, scope_iid, out);
+  if (flags & (TRACE_EVENT_FLAG_FLOW_OUT | TRACE_EVENT_FLAG_FLOW_IN))
+    AppendFixed64Field(binary_trace::kEventBindId, event.bind_id(), out);
+
+  AppendPacket(binary_trace::kPacketEvent, *out);
+  ++events_encoded_;
+}
+
+void BinaryTraceWriter::AddChunk(
+    const TraceBufferChunk& chunk,
+    const ArgumentFilterPredicate& argument_filter_predicate) {
+  for (size_t i = 0; i < chunk.size(); ++i)
+    AddEvent(*chunk.GetEventAt(i), argument_filter_predicate);
+}
+
+bool BinaryTraceWriter::Flush() {
+  if (buffer_.empty() || has_error_) {
+    buffer_.clear();
+    return !has_error_;
+  }
+  if (output_) {
+    output_->append(buffer_);
+  } else if (file_.WriteAtCurrentPos(buffer_.data(),
+                                     static_cast<int>(buffer_.size())) !=
+             static_cast<int>(buffer_.size())) {
+    DPLOG(ERROR) << "Failed to write the binary trace";
+    has_error_ = true;
+  }
+  buffer_.clear();
+  return !has_error_;
+}
+
+uint64_t BinaryTraceWriter::Intern(const char* str, bool is_static) {
+  if (is_static) {
+    auto it = static_string_iids_.find(str);
+    if (it != static_string_iids_.end())
+      return it->second;
+  }
+
+  const size_t length = strlen(str);
+  auto inserted = string_iids_.emplace(std::string(str, length), next_iid_);
+  const uint64_t iid = inserted.first->second;
+  if (inserted.second) {
+    ++next_iid_;
+    std::string message;
+    AppendVarintField(binary_trace::kInternedStringIid, iid, &message);
+    AppendBytesField(binary_trace::kInternedStringValue, str, length,
+                     &message);
+    AppendPacket(binary_trace::kPacketInternedString, message);
+  }
+  if (is_static)
+    static_string_iids_.emplace(str, iid);
+  return iid;
+}
+
+void BinaryTraceWriter::EncodeArgs(
+    const TraceEvent& event,
+    const char* category_group_name,
+    bool is_static,
+    const ArgumentFilterPredicate& argument_filter_predicate,
+    std::string* out) {
+  if (!event.arg_name(0))
+    return;
+
+  ArgumentNameFilterPredicate argument_name_filter_predicate;
+  if (!argument_filter_predicate.is_null() &&
+      !argument_filter_predicate.Run(category_group_name, event.name(),
+                                     &argument_name_filter_predicate)) {
+    AppendVarintField(binary_trace::kEventArgsStripped, 1, out);
+    return;
+  }
+
+  std::string* arg = &arg_message_;
+  for (int i = 0; i < kTraceMaxNumArgs && event.arg_name(i); ++i) {
+    arg->clear();
+    AppendVarintField(binary_trace::kArgNameIid,
+                      Intern(event.arg_name(i), is_static), arg);
+    // Encoded arguments are written as JSON, like the convertable ones.
+    const unsigned char type = event.arg_type(i) == TRACE_VALUE_TYPE_ENCODED
+                                   ? TRACE_VALUE_TYPE_CONVERTABLE
+                                   : event.arg_type(i);
+    AppendVarintField(binary_trace::kArgType, type, arg);
+
+    if (!argument_name_filter_predicate.is_null() &&
+        !argument_name_filter_predicate.Run(event.arg_name(i))) {
+      AppendVarintField(binary_trace::kArgStripped, 1, arg);
+    } else {
+      const TraceEvent::TraceValue& value = event.arg_value(i);
+      switch (type) {
+        case TRACE_VALUE_TYPE_BOOL:
+          AppendVarintField(binary_trace::kArgUintValue, value.as_bool, arg);
+          break;
+        case TRACE_VALUE_TYPE_UINT:
+          AppendVarintField(binary_trace::kArgUintValue, value.as_uint, arg);
+          break;
+        case TRACE_VALUE_TYPE_POINTER:
+          AppendVarintField(binary_trace::kArgUintValue,
+                            reinterpret_cast<uintptr_t>(value.as_pointer),
+                            arg);
+          break;
+        case TRACE_VALUE_TYPE_INT:
+          AppendSignedField(binary_trace::kArgIntValue, value.as_int, arg);
+          break;
+        case TRACE_VALUE_TYPE_DOUBLE: {
+          uint64_t bits;
+          memcpy(&bits, &value.as_double, sizeof(bits));
+          AppendFixed64Field(binary_trace::kArgDoubleValue, bits, arg);
+          break;
+        }
+        case TRACE_VALUE_TYPE_STRING:
+        case TRACE_VALUE_TYPE_COPY_STRING: {
+          const char* str = value.as_string ? value.as_string : "NULL";
+          AppendBytesField(binary_trace::kArgStringValue, str, strlen(str),
+                           arg);
+          break;
+        }
+        case TRACE_VALUE_TYPE_CONVERTABLE: {
+          std::string json;
+          if (event.arg_type(i) == TRACE_VALUE_TYPE_ENCODED) {
+            TraceEvent::AppendValueAsJSON(TRACE_VALUE_TYPE_ENCODED, value,
+                                          &json);
+          } else {
+            event.arg_convertible_value(i)->AppendAsTraceFormat(&json);
+          }
+          AppendBytesField(binary_trace::kArgStringValue, json.data(),
+                           json.size(), arg);
+          break;
+        }
+        default:
+          NOTREACHED() << "Don't know how to encode this value";
+          break;
+      }
+    }
+    AppendBytesField(binary_trace::kEventArg, arg->data(), arg->size(), out);
+  }
+}
+
+void BinaryTraceWriter::AppendPacket(uint32_t field,
+                                     const std::string& message) {
+  const size_t old_size = buffer_.size();
+  AppendBytesField(field, message.data(), message.size(), &buffer_);
+  bytes_encoded_ += buffer_.size() - old_size;
+  if (buffer_.size() >= kFlushThreshold)
+    Flush();
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,117 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TRACE_EVENT_BINARY_TRACE_WRITER_H_
+#define BRICK_TRACE_EVENT_BINARY_TRACE_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "brick/base_export.h"
+#include "brick/files/file.h"
+#include "brick/macros.h"
+#include "brick/time/time.h"
+#include "brick/trace_event/trace_event_impl.h"
+
+namespace base {
+namespace trace_event {
+
+class TraceBufferChunk;
+
+// Serializes TraceEvents into the binary trace format described in
+// binary_trace_format.h. Compared to TraceEvent::AppendAsJSON() it doesn't
+// format numbers, interns every name and category, and delta-encodes
+// timestamps, which makes it several times faster and the output several times
+// smaller. Use ConvertBinaryTraceToJSON() (binary_trace_reader.h) or the
+// binary_trace_to_json tool to load the result in JSON-based tools.
+//
+// The output is written incrementally: the writer only buffers
+// kFlushThreshold bytes before writing them out, so traces of any size can be
+// streamed to a file or pipe.
+//
+// Not thread safe; use from one sequence at a time.
+class BRICK_EXPORT BinaryTraceWriter {
+ public:
+  // Encoded bytes are written once this many are buffered.
+  static constexpr size_t kFlushThreshold = 64 * 1024;
+
+  // Writes to |file|, which must be valid and open for writing.
+  explicit BinaryTraceWriter(File file);
+  // Appends to |output|, which must outlive the writer.
+  explicit BinaryTraceWriter(std::string* output);
+  // Implicitly calls Flush().
+  ~BinaryTraceWriter();
+
+  // Encodes |event|. Its arguments are filtered like in
+  // TraceEvent::AppendAsJSON().
+  void AddEvent(const TraceEvent& event,
+                const ArgumentFilterPredicate& argument_filter_predicate);
+
+  // Encodes all the events of |chunk|.
+  void AddChunk(const TraceBufferChunk& chunk,
+                const ArgumentFilterPredicate& argument_filter_predicate);
+
+  // Writes out whatever is buffered. Returns false if this or a previous
+  // write failed, after which the rest of the trace is dropped.
+  bool Flush();
+
+  // Number of bytes encoded so far, including the buffered ones.
+  uint64_t bytes_encoded() const { return bytes_encoded_; }
+  size_t events_encoded() const { return events_encoded_; }
+
+  bool has_error() const { return has_error_; }
+
+  // When set, complete events whose duration isn't known yet are written as
+  // begin events. For streams that record the end of such events separately,
+  // see TraceLog::StartStreaming().
+  void set_write_unfinished_complete_events_as_begin(bool value) {
+    write_unfinished_complete_events_as_begin_ = value;
+  }
+
+ private:
+  // Returns the interned id of |str|, writing an InternedString packet if it
+  // is seen for the first time. |is_static| tells that |str| lives for the
+  // rest of the process, so that it can be looked up by address.
+  uint64_t Intern(const char* str, bool is_static);
+
+  void EncodeArgs(const TraceEvent& event,
+                  const char* category_group_name,
+                  bool is_static,
+                  const ArgumentFilterPredicate& argument_filter_predicate,
+                  std::string* out);
+
+  void AppendPacket(uint32_t field, const std::string& message);
+
+  File file_;
+  std::string* output_ = nullptr;
+
+  // Encoded bytes not written to |file_| yet.
+  std::string buffer_;
+  // Scratch space for the message being encoded; kept to reuse its capacity.
+  std::string event_message_;
+  std::string arg_message_;
+
+  std::unordered_map<const char*, uint64_t> static_string_iids_;
+  std::unordered_map<std::string, uint64_t> string_iids_;
+  uint64_t next_iid_ = 1;
+
+  // Timestamp of the previous event, the base of |timestamp_delta|.
+  TimeTicks last_timestamp_;
+
+  int process_id_;
+  uint64_t bytes_encoded_ = 0;
+  size_t events_encoded_ = 0;
+  bool has_error_ = false;
+  bool write_unfinished_complete_events_as_begin_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryTraceWriter);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BRICK_TRACE_EVENT_BINARY_TRACE_WRITER_H_
@@ -0,0 +1,332 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/binary_trace_writer.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "brick/bind.h"
+#include "brick/files/file.h"
+#include "brick/files/file_util.h"
+#include "brick/files/scoped_temp_dir.h"
+#include "brick/macros.h"
+#include "brick/trace_event/binary_trace_reader.h"
+#include "brick/trace_event/trace_event.h"
+#include "brick/trace_event/trace_log.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+class JSONConvertable : public ConvertableToTraceFormat {
+ public:
+  JSONConvertable() = default;
+  ~JSONConvertable() override = default;
+
+  void AppendAsTraceFormat(std::string* out) const override {
+    out->append("{\"foo\":[1,2]}");
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(JSONConvertable);
+};
+
+bool IsArgNameWhitelisted(const char* arg_name) {
+  return strcmp(arg_name, "granted") == 0;
+}
+
+bool ArgumentFilter(const char* category_group_name,
+                    const char* event_name,
+                    ArgumentNameFilterPredicate* arg_name_filter) {
+  if (strcmp(event_name, "partial") == 0) {
+    *arg_name_filter = BindRepeating(&IsArgNameWhitelisted);
+    return true;
+  }
+  return strcmp(event_name, "stripped") != 0;
+}
+
+class BinaryTraceWriterTest : public testing::Test {
+ public:
+  BinaryTraceWriterTest() = default;
+
+ protected:
+  // Appends an event with the given arguments to |events_|.
+  TraceEvent* AddEvent(char phase,
+                       const char* name,
+                       unsigned int flags,
+                       int num_args = 0,
+                       const char* const* arg_names = nullptr,
+                       const unsigned char* arg_types = nullptr,
+                       const unsigned long long* arg_values = nullptr,
+                       std::unique_ptr<ConvertableToTraceFormat>*
+                           convertable_values = nullptr) {
+    events_[num_events_].Initialize(
+        42, TimeTicks() + TimeDelta::FromMicroseconds(1000 - 10 * num_events_),
+        ThreadTicks(), phase, TraceLog::GetCategoryGroupEnabled("cat,other"),
+        name, trace_event_internal::kGlobalScope, 0x1234, 0x5678, num_args,
+        arg_names, arg_types, arg_values, convertable_values, flags);
+    return &events_[num_events_++];
+  }
+
+  // Checks that the binary encoding of |events_| converts back to the JSON
+  // that TraceEvent::AppendAsJSON() produces.
+  void ExpectRoundTrip(const ArgumentFilterPredicate& predicate) {
+    std::string expected;
+    std::string binary;
+    {
+      BinaryTraceWriter writer(&binary);
+      for (size_t i = 0; i < num_events_; ++i) {
+        if (i)
+          expected += ",\n";
+        events_[i].AppendAsJSON(&expected, predicate);
+        writer.AddEvent(events_[i], predicate);
+      }
+      EXPECT_TRUE(writer.Flush());
+      EXPECT_EQ(num_events_, writer.events_encoded());
+      EXPECT_EQ(binary.size(), writer.bytes_encoded());
+    }
+
+    BinaryTraceReader reader;
+    std::string json;
+    EXPECT_TRUE(reader.Append(binary, &json));
+    EXPECT_TRUE(reader.IsComplete());
+    EXPECT_EQ(num_events_, reader.events_decoded());
+    EXPECT_EQ(expected, json);
+  }
+
+  TraceEvent events_[16];
+  size_t num_events_ = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BinaryTraceWriterTest);
+};
+
+}  // namespace
+
+TEST_F(BinaryTraceWriterTest, RoundTripPhasesAndFlags) {
+  AddEvent(TRACE_EVENT_PHASE_BEGIN, "begin", TRACE_EVENT_FLAG_NONE);
+  AddEvent(TRACE_EVENT_PHASE_END, "end", TRACE_EVENT_FLAG_NONE);
+  TraceEvent* complete =
+      AddEvent(TRACE_EVENT_PHASE_COMPLETE, "complete", TRACE_EVENT_FLAG_NONE);
+  complete->UpdateDuration(
+      complete->timestamp() + TimeDelta::FromMicroseconds(7), ThreadTicks());
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "instant", TRACE_EVENT_SCOPE_PROCESS);
+  AddEvent(TRACE_EVENT_PHASE_ASYNC_BEGIN, "async",
+           TRACE_EVENT_FLAG_HAS_ID | TRACE_EVENT_FLAG_ASYNC_TTS);
+  AddEvent(TRACE_EVENT_PHASE_NESTABLE_ASYNC_BEGIN, "local",
+           TRACE_EVENT_FLAG_HAS_LOCAL_ID | TRACE_EVENT_FLAG_BIND_TO_ENCLOSING);
+  AddEvent(TRACE_EVENT_PHASE_NESTABLE_ASYNC_END, "global",
+           TRACE_EVENT_FLAG_HAS_GLOBAL_ID);
+  AddEvent(TRACE_EVENT_PHASE_COMPLETE, "flow",
+           TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT);
+  AddEvent(TRACE_EVENT_PHASE_COUNTER, "process",
+           TRACE_EVENT_FLAG_HAS_PROCESS_ID);
+  AddEvent(TRACE_EVENT_PHASE_BEGIN, "back\\slashed\tname", TRACE_EVENT_FLAG_COPY);
+
+  ExpectRoundTrip(ArgumentFilterPredicate());
+}
+
+TEST_F(BinaryTraceWriterTest, RoundTripArguments) {
+  const char* const kNames[] = {"first", "second"};
+  const unsigned char kBoolAndUint[] = {TRACE_VALUE_TYPE_BOOL,
+                                        TRACE_VALUE_TYPE_UINT};
+  const unsigned long long kBoolAndUintValues[] = {
+      1, std::numeric_limits<unsigned long long>::max()};
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "bool_uint", TRACE_EVENT_FLAG_NONE, 2,
+           kNames, kBoolAndUint, kBoolAndUintValues);
+
+  TraceEvent::TraceValue int_value;
+  int_value.as_int = -123456789012LL;
+  TraceEvent::TraceValue double_value;
+  double_value.as_double = -0.25;
+  const unsigned char kIntAndDouble[] = {TRACE_VALUE_TYPE_INT,
+                                         TRACE_VALUE_TYPE_DOUBLE};
+  const unsigned long long kIntAndDoubleValues[] = {int_value.as_uint,
+                                                    double_value.as_uint};
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "int_double", TRACE_EVENT_FLAG_NONE, 2,
+           kNames, kIntAndDouble, kIntAndDoubleValues);
+
+  TraceEvent::TraceValue string_value;
+  string_value.as_string = "needs \"escaping\"";
+  TraceEvent::TraceValue pointer_value;
+  pointer_value.as_pointer = &int_value;
+  const unsigned char kStringAndPointer[] = {TRACE_VALUE_TYPE_STRING,
+                                             TRACE_VALUE_TYPE_POINTER};
+  const unsigned long long kStringAndPointerValues[] = {
+      string_value.as_uint, pointer_value.as_uint};
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "string_pointer", TRACE_EVENT_FLAG_NONE,
+           2, kNames, kStringAndPointer, kStringAndPointerValues);
+  // Copied strings and names.
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "copy", TRACE_EVENT_FLAG_COPY, 2, kNames,
+           kStringAndPointer, kStringAndPointerValues);
+
+  TraceEvent::TraceValue double_nan;
+  double_nan.as_double = std::numeric_limits<double>::quiet_NaN();
+  const unsigned char kConvertableAndDouble[] = {TRACE_VALUE_TYPE_CONVERTABLE,
+                                                 TRACE_VALUE_TYPE_DOUBLE};
+  const unsigned long long kConvertableAndDoubleValues[] = {0,
+                                                            double_nan.as_uint};
+  std::unique_ptr<ConvertableToTraceFormat> convertables[2];
+  convertables[0] = std::make_unique<JSONConvertable>();
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "convertable", TRACE_EVENT_FLAG_NONE, 2,
+           kNames, kConvertableAndDouble, kConvertableAndDoubleValues,
+           convertables);
+
+  ExpectRoundTrip(ArgumentFilterPredicate());
+}
+
+TEST_F(BinaryTraceWriterTest, RoundTripFilteredArguments) {
+  const char* const kNames[] = {"granted", "denied"};
+  const unsigned char kTypes[] = {TRACE_VALUE_TYPE_UINT, TRACE_VALUE_TYPE_UINT};
+  const unsigned long long kValues[] = {1, 2};
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "kept", TRACE_EVENT_FLAG_NONE, 2, kNames,
+           kTypes, kValues);
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "stripped", TRACE_EVENT_FLAG_NONE, 2,
+           kNames, kTypes, kValues);
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "partial", TRACE_EVENT_FLAG_NONE, 2,
+           kNames, kTypes, kValues);
+
+  ExpectRoundTrip(BindRepeating(&ArgumentFilter));
+}
+
+TEST_F(BinaryTraceWriterTest, InternsStrings) {
+  std::string binary;
+  {
+    BinaryTraceWriter writer(&binary);
+    AddEvent(TRACE_EVENT_PHASE_BEGIN, "a_rather_long_event_name",
+             TRACE_EVENT_FLAG_NONE);
+    writer.AddEvent(events_[0], ArgumentFilterPredicate());
+    const uint64_t first_event_size = writer.bytes_encoded();
+    for (int i = 0; i < 100; ++i)
+      writer.AddEvent(events_[0], ArgumentFilterPredicate());
+    // Only the first event carries the strings.
+    const uint64_t repeated_event_size =
+        (writer.bytes_encoded() - first_event_size) / 100;
+    EXPECT_LT(repeated_event_size, 16u);
+    EXPECT_GT(first_event_size, repeated_event_size + 30);
+  }
+  size_t occurrences = 0;
+  for (size_t pos = binary.find("a_rather_long_event_name");
+       pos != std::string::npos;
+       pos = binary.find("a_rather_long_event_name", pos + 1)) {
+    ++occurrences;
+  }
+  EXPECT_EQ(1u, occurrences);
+}
+
+TEST_F(BinaryTraceWriterTest, ReaderAcceptsAnySplit) {
+  const char* const kNames[] = {"arg"};
+  const unsigned char kTypes[] = {TRACE_VALUE_TYPE_INT};
+  const unsigned long long kValues[] = {static_cast<unsigned long long>(-1)};
+  for (int i = 0; i < 8; ++i) {
+    AddEvent(TRACE_EVENT_PHASE_INSTANT, "split", TRACE_EVENT_FLAG_NONE, 1,
+             kNames, kTypes, kValues);
+  }
+  std::string binary;
+  {
+    BinaryTraceWriter writer(&binary);
+    for (size_t i = 0; i < num_events_; ++i)
+      writer.AddEvent(events_[i], ArgumentFilterPredicate());
+  }
+
+  std::string expected;
+  BinaryTraceReader whole_reader;
+  ASSERT_TRUE(whole_reader.Append(binary, &expected));
+
+  // Feed the reader one byte at a time.
+  BinaryTraceReader reader;
+  std::string json;
+  for (size_t i = 0; i < binary.size(); ++i) {
+    ASSERT_TRUE(reader.Append(StringPiece(&binary[i], 1), &json));
+    EXPECT_EQ(i + 1 == binary.size(), reader.IsComplete());
+  }
+  EXPECT_EQ(expected, json);
+  EXPECT_EQ(num_events_, reader.events_decoded());
+}
+
+TEST_F(BinaryTraceWriterTest, ReaderRejectsCorruptInput) {
+  std::string json;
+  EXPECT_FALSE(ConvertBinaryTraceToJSON(StringPiece("\x08\x01", 2), &json));
+
+  // An event whose category and name were never interned.
+  json.clear();
+  EXPECT_FALSE(ConvertBinaryTraceToJSON(
+      StringPiece("\x12\x04\x28\x05\x30\x01", 6), &json));
+
+  // Truncated input.
+  AddEvent(TRACE_EVENT_PHASE_BEGIN, "name", TRACE_EVENT_FLAG_NONE);
+  std::string binary;
+  {
+    BinaryTraceWriter writer(&binary);
+    writer.AddEvent(events_[0], ArgumentFilterPredicate());
+  }
+  json.clear();
+  EXPECT_TRUE(ConvertBinaryTraceToJSON(binary, &json));
+  json.clear();
+  EXPECT_FALSE(ConvertBinaryTraceToJSON(
+      StringPiece(binary.data(), binary.size() - 1), &json));
+}
+
+TEST_F(BinaryTraceWriterTest, WritesToFile) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const FilePath path = temp_dir.GetPath().AppendASCII("trace.bin");
+
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "to_file", TRACE_EVENT_FLAG_NONE);
+  std::string expected;
+  {
+    BinaryTraceWriter string_writer(&expected);
+    BinaryTraceWriter file_writer(
+        File(path, File::FLAG_CREATE_ALWAYS | File::FLAG_WRITE));
+    // Enough events to go over kFlushThreshold.
+    for (int i = 0; i < 20000; ++i) {
+      string_writer.AddEvent(events_[0], ArgumentFilterPredicate());
+      file_writer.AddEvent(events_[0], ArgumentFilterPredicate());
+    }
+    EXPECT_GT(file_writer.bytes_encoded(), BinaryTraceWriter::kFlushThreshold);
+    EXPECT_TRUE(file_writer.Flush());
+  }
+
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(path, &contents));
+  EXPECT_EQ(expected, contents);
+}
+
+TEST_F(BinaryTraceWriterTest, FlushTraceLog) {
+  TraceLog::GetInstance()->SetEnabled(TraceConfig("binary", ""),
+                                      TraceLog::RECORDING_MODE);
+  TRACE_EVENT_INSTANT1("binary", "binary_flush", TRACE_EVENT_SCOPE_THREAD,
+                       "value", 17);
+  TraceLog::GetInstance()->SetDisabled();
+
+  std::string binary;
+  std::unique_ptr<BinaryTraceWriter> flushed_writer;
+  TraceLog::GetInstance()->FlushToBinaryWriter(
+      std::make_unique<BinaryTraceWriter>(&binary),
+      BindOnce(
+          [](std::unique_ptr<BinaryTraceWriter>* out,
+             std::unique_ptr<BinaryTraceWriter> writer) {
+            *out = std::move(writer);
+          },
+          &flushed_writer));
+  ASSERT_TRUE(flushed_writer);
+  EXPECT_FALSE(flushed_writer->has_error());
+
+  std::string json;
+  ASSERT_TRUE(ConvertBinaryTraceToJSON(binary, &json));
+  EXPECT_NE(std::string::npos,
+            json.find("\"cat\":\"binary\",\"name\":\"binary_flush\","
+                      "\"args\":{\"value\":17}"));
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -19,7 +19,7 @@ namespace trace_event {
 
 namespace {
 
-constexpr size_t kMaxCategories = 200;
+constexpr size_t kMaxCategories = CategoryRegistry::kMaxCategories;
 const int kNumBuiltinCategories = 4;
 
 // |g_categories| might end up causing creating dynamic initializers if not POD.
@@ -142,6 +142,12 @@ bool CategoryRegistry::IsBuiltinCategory(const TraceCategory* category) {
   return category < &g_categories[kNumBuiltinCategories];
 }
 
+// static
+size_t CategoryRegistry::GetCategoryIndex(const TraceCategory* category) {
+  DCHECK(IsValidCategoryPtr(category));
+  return static_cast<size_t>(category - &g_categories[0]);
+}
+
 // static
 CategoryRegistry::Range CategoryRegistry::GetAllCategories() {
   // The |g_categories| array is append only. We have to only guarantee to
@@ -40,6 +40,10 @@ class BRICK_EXPORT CategoryRegistry {
     TraceCategory* const end_;
   };
 
+  // The registry can't hold more categories; the extra ones are reported as
+  // kCategoryExhausted.
+  static constexpr size_t kMaxCategories = 200;
+
   // Known categories.
   static TraceCategory* const kCategoryExhausted;
   static TraceCategory* const kCategoryMetadata;
@@ -62,6 +66,10 @@ class BRICK_EXPORT CategoryRegistry {
 
   static bool IsBuiltinCategory(const TraceCategory*);
 
+  // Returns the position of |category| in the registry, which is stable and
+  // less than kMaxCategories.
+  static size_t GetCategoryIndex(const TraceCategory* category);
+
  private:
   friend class TraceCategoryTest;
   friend class TraceLog;
@@ -12,6 +12,7 @@
 #include "brick/debug/leak_annotations.h"
 #include "brick/debug/stack_trace.h"
 #include "brick/no_destructor.h"
+#include "brick/profiler/frame_pointer_unwinder.h"
 #include "brick/threading/platform_thread.h"
 #include "brick/threading/thread_local_storage.h"
 #include "brick/trace_event/heap_profiler_allocation_context.h"
@@ -230,7 +231,7 @@ bool AllocationContextTracker::GetContextSnapshot(AllocationContext* ctx) {
         const void* frames[Backtrace::kMaxFrameCount + 1];
         static_assert(arraysize(frames) >= Backtrace::kMaxFrameCount,
                       "not requesting enough frames to fill Backtrace");
-        size_t frame_count = debug::TraceStackFramePointers(
+        size_t frame_count = UnwindFramePointers(
             frames, arraysize(frames),
             1 /* exclude this function from the trace */);
 #else
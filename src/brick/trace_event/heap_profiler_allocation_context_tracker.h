@@ -108,6 +108,13 @@ class BRICK_EXPORT AllocationContextTracker {
   void PushCurrentTaskContext(const char* context);
   void PopCurrentTaskContext(const char* context);
 
+  // Returns the context of the current task, which GetContextSnapshot()
+  // reports as the type name, or nullptr if there is none. Cheaper than a
+  // snapshot for profilers which capture their own stacks.
+  const char* current_task_context() const {
+    return task_contexts_.empty() ? nullptr : task_contexts_.back();
+  }
+
   // Fills a snapshot of the current thread-local context. Doesn't fill and
   // returns false if allocations are being ignored.
   bool GetContextSnapshot(AllocationContext* snapshot);
@@ -0,0 +1,158 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/heap_profiler_heap_dump.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <utility>
+
+#include "brick/strings/stringprintf.h"
+#include "brick/trace_event/trace_event_argument.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+const char kUnknownTypeName[] = "[unknown]";
+
+std::string GetFrameName(const StackFrame& frame) {
+  switch (frame.type) {
+    case StackFrame::Type::TRACE_EVENT_NAME:
+      return static_cast<const char*>(frame.value);
+    case StackFrame::Type::THREAD_NAME:
+      return StringPrintf("[Thread: %s]",
+                          static_cast<const char*>(frame.value));
+    case StackFrame::Type::PROGRAM_COUNTER:
+      return StringPrintf("pc:%" PRIxPTR,
+                          reinterpret_cast<uintptr_t>(frame.value));
+  }
+  return std::string();
+}
+
+void AppendSize(TracedValue* value, size_t size) {
+  // Sizes don't fit in the integers of TracedValue, so they are written in
+  // hexadecimal like the scalars of MemoryAllocatorDump.
+  value->AppendString(StringPrintf("%" PRIx64, static_cast<uint64_t>(size)));
+}
+
+}  // namespace
+
+// Deduplicates the strings, stack frames and types while the dump is built.
+class HeapDump::Builder {
+ public:
+  explicit Builder(HeapDump* dump) : dump_(dump) {
+    // Type 0 is the unknown type.
+    InsertType(nullptr);
+  }
+
+  int InsertString(const std::string& string) {
+    auto it = string_ids_.emplace(string, dump_->strings_.size());
+    if (it.second)
+      dump_->strings_.push_back(string);
+    return it.first->second;
+  }
+
+  int InsertBacktrace(const Backtrace& backtrace) {
+    int node_id = -1;
+    for (size_t i = 0; i < backtrace.frame_count; ++i) {
+      const StackFrame& frame = backtrace.frames[i];
+      auto it = node_ids_.emplace(std::make_pair(node_id, frame),
+                                  dump_->nodes_.size());
+      if (it.second)
+        dump_->nodes_.push_back({node_id, InsertString(GetFrameName(frame))});
+      node_id = it.first->second;
+    }
+    return node_id;
+  }
+
+  int InsertType(const char* type_name) {
+    // Types are grouped by pointer, like AllocationContext does.
+    auto it = type_ids_.emplace(type_name, dump_->types_.size());
+    if (it.second) {
+      dump_->types_.push_back(
+          InsertString(type_name ? type_name : kUnknownTypeName));
+    }
+    return it.first->second;
+  }
+
+ private:
+  HeapDump* const dump_;
+  std::unordered_map<std::string, int> string_ids_;
+  std::map<std::pair<int, StackFrame>, int> node_ids_;
+  std::unordered_map<const char*, int> type_ids_;
+
+  DISALLOW_COPY_AND_ASSIGN(Builder);
+};
+
+HeapDump::HeapDump(
+    const std::unordered_map<AllocationContext, AllocationMetrics>&
+        metrics_by_context) {
+  Builder builder(this);
+  entries_.reserve(metrics_by_context.size());
+  for (const auto& context_and_metrics : metrics_by_context) {
+    const AllocationContext& context = context_and_metrics.first;
+    const AllocationMetrics& metrics = context_and_metrics.second;
+    entries_.push_back({builder.InsertBacktrace(context.backtrace),
+                        builder.InsertType(context.type_name), metrics.count,
+                        metrics.size});
+  }
+  std::sort(entries_.begin(), entries_.end(),
+            [](const Entry& lhs, const Entry& rhs) {
+              return std::tie(rhs.size, lhs.node_id, lhs.type_id) <
+                     std::tie(lhs.size, rhs.node_id, rhs.type_id);
+            });
+}
+
+HeapDump::~HeapDump() = default;
+
+void HeapDump::AsValueInto(TracedValue* value) const {
+  value->BeginArray("strings");
+  for (const std::string& string : strings_)
+    value->AppendString(string);
+  value->EndArray();
+
+  value->BeginDictionary("nodes");
+  value->BeginArray("parents");
+  for (const Node& node : nodes_)
+    value->AppendInteger(node.parent_id);
+  value->EndArray();
+  value->BeginArray("names");
+  for (const Node& node : nodes_)
+    value->AppendInteger(node.name_id);
+  value->EndArray();
+  value->EndDictionary();  // "nodes": { ... }
+
+  value->BeginArray("types");
+  for (int name_id : types_)
+    value->AppendInteger(name_id);
+  value->EndArray();
+
+  value->BeginDictionary("entries");
+  value->BeginArray("nodes");
+  for (const Entry& entry : entries_)
+    value->AppendInteger(entry.node_id);
+  value->EndArray();
+  value->BeginArray("types");
+  for (const Entry& entry : entries_)
+    value->AppendInteger(entry.type_id);
+  value->EndArray();
+  value->BeginArray("counts");
+  for (const Entry& entry : entries_)
+    AppendSize(value, entry.count);
+  value->EndArray();
+  value->BeginArray("sizes");
+  for (const Entry& entry : entries_)
+    AppendSize(value, entry.size);
+  value->EndArray();
+  value->EndDictionary();  // "entries": { ... }
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,77 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TRACE_EVENT_HEAP_PROFILER_HEAP_DUMP_H_
+#define BRICK_TRACE_EVENT_HEAP_PROFILER_HEAP_DUMP_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "brick/base_export.h"
+#include "brick/macros.h"
+#include "brick/trace_event/heap_profiler_allocation_context.h"
+
+namespace base {
+namespace trace_event {
+
+class TracedValue;
+
+// An allocation-site heap profile in a compact, deduplicated form. The
+// backtraces of the allocation sites are merged into a tree of stack frame
+// nodes, and the frame and type names are stored once in a string table, so
+// that an allocation site takes four integers: the id of the node of its
+// innermost frame, the id of its type, and its count and size.
+class BRICK_EXPORT HeapDump {
+ public:
+  // A stack frame, called from the frame of |parent_id|, or -1 for the
+  // outermost frames.
+  struct Node {
+    int parent_id;
+    int name_id;
+  };
+
+  struct Entry {
+    int node_id;
+    int type_id;
+    size_t count;
+    size_t size;
+  };
+
+  // Builds the dump of the allocations of |metrics_by_context|. The entries
+  // are sorted by decreasing size.
+  explicit HeapDump(
+      const std::unordered_map<AllocationContext, AllocationMetrics>&
+          metrics_by_context);
+  ~HeapDump();
+
+  // Indexed by string id.
+  const std::vector<std::string>& strings() const { return strings_; }
+  // Indexed by node id. Node 0, if any, is an outermost frame.
+  const std::vector<Node>& nodes() const { return nodes_; }
+  // The name ids of the types, indexed by type id. Type 0 is the unknown type.
+  const std::vector<int>& types() const { return types_; }
+  const std::vector<Entry>& entries() const { return entries_; }
+
+  // Writes the tables, and the entries as parallel arrays, into the
+  // dictionary being built in |value|.
+  void AsValueInto(TracedValue* value) const;
+
+ private:
+  class Builder;
+
+  std::vector<std::string> strings_;
+  std::vector<Node> nodes_;
+  std::vector<int> types_;
+  std::vector<Entry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapDump);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BRICK_TRACE_EVENT_HEAP_PROFILER_HEAP_DUMP_H_
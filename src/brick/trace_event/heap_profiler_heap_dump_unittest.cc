@@ -0,0 +1,112 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/heap_profiler_heap_dump.h"
+
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "brick/trace_event/heap_profiler_allocation_context.h"
+#include "brick/trace_event/trace_event_argument.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+const char kBrowserMain[] = "BrowserMain";
+const char kRendererMain[] = "RendererMain";
+const char kCreateWidget[] = "CreateWidget";
+const char kInt[] = "int";
+
+AllocationContext MakeContext(std::initializer_list<const char*> frames,
+                              const char* type_name) {
+  AllocationContext context;
+  for (const char* frame : frames) {
+    context.backtrace.frames[context.backtrace.frame_count++] =
+        StackFrame::FromTraceEventName(frame);
+  }
+  context.type_name = type_name;
+  return context;
+}
+
+}  // namespace
+
+TEST(HeapDumpTest, Deduplicates) {
+  std::unordered_map<AllocationContext, AllocationMetrics> metrics_by_context;
+  metrics_by_context[MakeContext({kBrowserMain, kCreateWidget}, kInt)] = {
+      300, 3};
+  metrics_by_context[MakeContext({kBrowserMain, kCreateWidget}, nullptr)] = {
+      200, 1};
+  metrics_by_context[MakeContext({kRendererMain, kCreateWidget}, kInt)] = {
+      100, 2};
+  HeapDump dump(metrics_by_context);
+
+  // The first frame of both BrowserMain stacks is the same node, but the
+  // CreateWidget frames called by different frames aren't.
+  ASSERT_EQ(4u, dump.nodes().size());
+  ASSERT_EQ(3u, dump.entries().size());
+  // Sorted by decreasing size.
+  const HeapDump::Entry& first = dump.entries()[0];
+  const HeapDump::Entry& second = dump.entries()[1];
+  const HeapDump::Entry& third = dump.entries()[2];
+  EXPECT_EQ(300u, first.size);
+  EXPECT_EQ(3u, first.count);
+  EXPECT_EQ(200u, second.size);
+  EXPECT_EQ(100u, third.size);
+
+  EXPECT_EQ(first.node_id, second.node_id);
+  EXPECT_NE(first.node_id, third.node_id);
+  const HeapDump::Node& leaf = dump.nodes()[first.node_id];
+  EXPECT_EQ(kCreateWidget, dump.strings()[leaf.name_id]);
+  EXPECT_EQ(dump.nodes()[third.node_id].name_id, leaf.name_id);
+  const HeapDump::Node& root = dump.nodes()[leaf.parent_id];
+  EXPECT_EQ(kBrowserMain, dump.strings()[root.name_id]);
+  EXPECT_EQ(-1, root.parent_id);
+
+  EXPECT_EQ(first.type_id, third.type_id);
+  EXPECT_EQ(kInt, dump.strings()[dump.types()[first.type_id]]);
+  EXPECT_EQ(0, second.type_id);
+  EXPECT_EQ("[unknown]", dump.strings()[dump.types()[0]]);
+
+  // "BrowserMain", "CreateWidget", "RendererMain", "int" and "[unknown]".
+  EXPECT_EQ(5u, dump.strings().size());
+}
+
+TEST(HeapDumpTest, ProgramCounterFrames) {
+  AllocationContext context;
+  context.backtrace.frames[0] = StackFrame::FromThreadName("CrBrowserMain");
+  context.backtrace.frames[1] =
+      StackFrame::FromProgramCounter(reinterpret_cast<const void*>(0x1234));
+  context.backtrace.frame_count = 2;
+  std::unordered_map<AllocationContext, AllocationMetrics> metrics_by_context;
+  metrics_by_context[context] = {16, 1};
+  HeapDump dump(metrics_by_context);
+
+  ASSERT_EQ(2u, dump.nodes().size());
+  EXPECT_EQ("[Thread: CrBrowserMain]",
+            dump.strings()[dump.nodes()[0].name_id]);
+  EXPECT_EQ("pc:1234", dump.strings()[dump.nodes()[1].name_id]);
+}
+
+TEST(HeapDumpTest, AsValueInto) {
+  std::unordered_map<AllocationContext, AllocationMetrics> metrics_by_context;
+  metrics_by_context[MakeContext({kBrowserMain}, kInt)] = {0x80000000, 2};
+  HeapDump dump(metrics_by_context);
+
+  auto traced_value = std::make_unique<TracedValue>();
+  dump.AsValueInto(traced_value.get());
+  std::string json;
+  traced_value->AppendAsTraceFormat(&json);
+  EXPECT_NE(std::string::npos, json.find("\"strings\":[\"[unknown]\","));
+  EXPECT_NE(std::string::npos,
+            json.find("\"nodes\":{\"parents\":[-1],\"names\":[1]}"));
+  EXPECT_NE(std::string::npos, json.find("\"sizes\":[\"80000000\"]"));
+}
+
+}  // namespace trace_event
+}  // namespace base
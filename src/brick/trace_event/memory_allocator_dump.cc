@@ -6,9 +6,14 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <unordered_set>
+
 #include "brick/format_macros.h"
 #include "brick/memory/ptr_util.h"
+#include "brick/no_destructor.h"
 #include "brick/strings/stringprintf.h"
+#include "brick/synchronization/lock.h"
 #include "brick/trace_event/memory_dump_manager.h"
 #include "brick/trace_event/memory_dump_provider.h"
 #include "brick/trace_event/process_memory_dump.h"
@@ -18,6 +23,19 @@
 namespace base {
 namespace trace_event {
 
+namespace {
+
+// Returns a copy of |string| which lives as long as the process. Equal strings
+// share the same copy.
+const char* InternString(const std::string& string) {
+  static NoDestructor<Lock> lock;
+  static NoDestructor<std::unordered_set<std::string>> strings;
+  AutoLock auto_lock(*lock);
+  return strings->insert(string).first->c_str();
+}
+
+}  // namespace
+
 const char MemoryAllocatorDump::kNameSize[] = "size";
 const char MemoryAllocatorDump::kNameObjectCount[] = "object_count";
 const char MemoryAllocatorDump::kTypeScalar[] = "scalar";
@@ -94,8 +112,9 @@ uint64_t MemoryAllocatorDump::GetSizeInternal() const {
   if (cached_size_.has_value())
     return *cached_size_;
   for (const auto& entry : entries_) {
-    if (entry.entry_type == Entry::kUint64 && entry.units == kUnitsBytes &&
-        strcmp(entry.name.c_str(), kNameSize) == 0) {
+    if (entry.entry_type == Entry::kUint64 &&
+        strcmp(entry.units, kUnitsBytes) == 0 &&
+        strcmp(entry.name, kNameSize) == 0) {
       cached_size_ = entry.value_uint64;
       return entry.value_uint64;
     }
@@ -103,23 +122,83 @@ uint64_t MemoryAllocatorDump::GetSizeInternal() const {
   return 0;
 };
 
-MemoryAllocatorDump::Entry::Entry() : entry_type(kString), value_uint64() {}
+void MemoryAllocatorDump::RemoveUnchangedScalars(const Scalars& scalars) {
+  auto is_unchanged = [&scalars](const Entry& entry) {
+    if (entry.entry_type != Entry::kUint64)
+      return false;
+    for (const auto& scalar : scalars) {
+      if (scalar.second == entry.value_uint64 &&
+          strcmp(scalar.first, entry.name) == 0) {
+        return true;
+      }
+    }
+    return false;
+  };
+  entries_.erase(std::remove_if(entries_.begin(), entries_.end(), is_unchanged),
+                 entries_.end());
+  cached_size_.reset();
+}
+
+void MemoryAllocatorDump::MergeSharedGlobalDump(MemoryAllocatorDump* other) {
+  DCHECK_EQ(absolute_name_, other->absolute_name_);
+  for (Entry& entry : other->entries_) {
+    auto existing = std::find_if(
+        entries_.begin(), entries_.end(), [&entry](const Entry& own_entry) {
+          return strcmp(own_entry.name, entry.name) == 0;
+        });
+    if (existing == entries_.end()) {
+      entries_.push_back(std::move(entry));
+      continue;
+    }
+    // The providers describe the same allocation, like a shared memory
+    // segment mapped by each of them, so keep the largest value.
+    if (existing->entry_type == Entry::kUint64 &&
+        entry.entry_type == Entry::kUint64) {
+      existing->value_uint64 =
+          std::max(existing->value_uint64, entry.value_uint64);
+    }
+  }
+  other->entries_.clear();
+  other->cached_size_.reset();
+  cached_size_.reset();
+
+  // The dump is only weak, or removed from an incremental dump, if it is for
+  // every provider.
+  flags_ &= other->flags_;
+}
+
+MemoryAllocatorDump::Entry::Entry()
+    : name(""), units(""), entry_type(kString), value_uint64() {}
 MemoryAllocatorDump::Entry::Entry(MemoryAllocatorDump::Entry&&) noexcept =
     default;
 MemoryAllocatorDump::Entry& MemoryAllocatorDump::Entry::operator=(
     MemoryAllocatorDump::Entry&&) = default;
-MemoryAllocatorDump::Entry::Entry(std::string name,
-                                  std::string units,
+MemoryAllocatorDump::Entry::Entry(const char* name,
+                                  const char* units,
                                   uint64_t value)
     : name(name), units(units), entry_type(kUint64), value_uint64(value) {}
-MemoryAllocatorDump::Entry::Entry(std::string name,
-                                  std::string units,
+MemoryAllocatorDump::Entry::Entry(const char* name,
+                                  const char* units,
+                                  std::string value)
+    : name(name),
+      units(units),
+      entry_type(kString),
+      value_uint64(),
+      value_string(std::move(value)) {}
+MemoryAllocatorDump::Entry::Entry(const std::string& name,
+                                  const std::string& units,
+                                  uint64_t value)
+    : Entry(InternString(name), InternString(units), value) {}
+MemoryAllocatorDump::Entry::Entry(const std::string& name,
+                                  const std::string& units,
                                   std::string value)
-    : name(name), units(units), entry_type(kString), value_string(value) {}
+    : Entry(InternString(name), InternString(units), std::move(value)) {}
 
 bool MemoryAllocatorDump::Entry::operator==(const Entry& rhs) const {
-  if (!(name == rhs.name && units == rhs.units && entry_type == rhs.entry_type))
+  if (!(strcmp(name, rhs.name) == 0 && strcmp(units, rhs.units) == 0 &&
+        entry_type == rhs.entry_type)) {
     return false;
+  }
   switch (entry_type) {
     case EntryType::kUint64:
       return value_uint64 == rhs.value_uint64;
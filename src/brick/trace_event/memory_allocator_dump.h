@@ -10,6 +10,8 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "brick/base_export.h"
 #include "brick/gtest_prod_util.h"
@@ -36,6 +38,10 @@ class BRICK_EXPORT MemoryAllocatorDump {
 
     // A dump marked weak will be discarded by TraceViewer.
     WEAK = 1 << 0,
+
+    // In incremental dumps, marks a dump which the previous incremental dump
+    // of the provider had, but which it didn't report this time.
+    REMOVED = 1 << 1,
   };
 
   // In the TraceViewer UI table each MemoryAllocatorDump becomes
@@ -47,19 +53,23 @@ class BRICK_EXPORT MemoryAllocatorDump {
       kString,
     };
 
-    // By design name, units and value_string are  always coming from
-    // indefinitely lived const char* strings, the only reason we copy
-    // them into a std::string is to handle Mojo (de)serialization.
-    // TODO(hjd): Investigate optimization (e.g. using StringPiece).
+    // By design name and units are always coming from indefinitely lived
+    // const char* strings, which are kept as they are. The std::string
+    // constructors, used by Mojo deserialization, intern them in a process
+    // wide table instead, so that each distinct name is stored only once.
     Entry();  // Only for deserialization.
-    Entry(std::string name, std::string units, uint64_t value);
-    Entry(std::string name, std::string units, std::string value);
+    Entry(const char* name, const char* units, uint64_t value);
+    Entry(const char* name, const char* units, std::string value);
+    Entry(const std::string& name, const std::string& units, uint64_t value);
+    Entry(const std::string& name,
+          const std::string& units,
+          std::string value);
     Entry(Entry&& other) noexcept;
     Entry& operator=(Entry&& other);
     bool operator==(const Entry& rhs) const;
 
-    std::string name;
-    std::string units;
+    const char* name;
+    const char* units;
 
     EntryType entry_type;
 
@@ -124,6 +134,9 @@ class BRICK_EXPORT MemoryAllocatorDump {
 
   const std::vector<Entry>& entries() const { return entries_; }
 
+  // The scalar attributes of a dump, as (name, value) pairs.
+  using Scalars = std::vector<std::pair<const char*, uint64_t>>;
+
   // Only for mojo serialization, which can mutate the collection.
   std::vector<Entry>* mutable_entries_for_serialization() const {
     cached_size_.reset();  // The caller can mutate the collection.
@@ -134,6 +147,17 @@ class BRICK_EXPORT MemoryAllocatorDump {
   }
 
  private:
+  friend class ProcessMemoryDump;
+
+  // Removes the scalar attributes which have the same value in |scalars|.
+  // Used by ProcessMemoryDump::MakeIncremental().
+  void RemoveUnchangedScalars(const Scalars& scalars);
+
+  // Moves the attributes of |other|, the dump of the same shared global
+  // allocator made by another provider, into this dump. Used by
+  // ProcessMemoryDump::TakeAllDumpsFrom().
+  void MergeSharedGlobalDump(MemoryAllocatorDump* other);
+
   const std::string absolute_name_;
   MemoryAllocatorDumpGuid guid_;
   MemoryDumpLevelOfDetail level_of_detail_;
@@ -151,6 +151,20 @@ TEST(MemoryAllocatorDumpTest, MovingAnEntry) {
   EXPECT_EQ(expected_entry, to_entry);
 }
 
+TEST(MemoryAllocatorDumpTest, InternedEntryNames) {
+  // The names of the entries built from string literals aren't copied, the
+  // ones built from std::string (when deserialized) are interned.
+  MemoryAllocatorDump::Entry literal_entry("one", "byte", 1);
+  MemoryAllocatorDump::Entry entry(std::string("one"), std::string("byte"), 1);
+  MemoryAllocatorDump::Entry other_entry(std::string("one"),
+                                         std::string("byte"), 2);
+  EXPECT_STREQ("one", entry.name);
+  EXPECT_STREQ("byte", entry.units);
+  EXPECT_EQ(entry.name, other_entry.name);
+  EXPECT_EQ(entry.units, other_entry.units);
+  EXPECT_EQ(literal_entry, entry);
+}
+
 // DEATH tests are not supported in Android/iOS/Fuchsia.
 #if !defined(NDEBUG) && !defined(OS_ANDROID) && !defined(OS_IOS) && \
     !defined(OS_FUCHSIA)
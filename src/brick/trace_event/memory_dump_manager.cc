@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <set>
 #include <utility>
 
 #include "brick/allocator/buildflags.h"
@@ -18,8 +19,11 @@
 #include "brick/debug/stack_trace.h"
 #include "brick/debug/thread_heap_usage_tracker.h"
 #include "brick/memory/ptr_util.h"
+#include "brick/partition_alloc_buildflags.h"
 #include "brick/sequenced_task_runner.h"
 #include "brick/strings/string_util.h"
+#include "brick/task_scheduler/post_task.h"
+#include "brick/task_scheduler/task_scheduler.h"
 #include "brick/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "brick/threading/thread.h"
 #include "brick/threading/thread_task_runner_handle.h"
@@ -35,6 +39,14 @@
 #include "brick/trace_event/trace_event_argument.h"
 #include "build/build_config.h"
 
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+#include "brick/trace_event/partition_alloc_dump_provider.h"
+#endif
+
+#if BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+#include "brick/allocator/allocator_shim_default_dispatch_to_partition_alloc.h"
+#endif
+
 #if defined(OS_ANDROID)
 #include "brick/trace_event/java_heap_dump_provider_android.h"
 
@@ -62,6 +74,16 @@ void DoGlobalDumpWithoutCallback(
   global_dump_fn.Run(dump_type, level_of_detail);
 }
 
+void RunIncrementalDumpCallback(const ProcessMemoryDumpCallback& callback,
+                                uint64_t dump_guid,
+                                std::unique_ptr<ProcessMemoryDump> pmd) {
+  if (!callback.is_null())
+    callback.Run(true /* success */, dump_guid, std::move(pmd));
+  TRACE_EVENT_NESTABLE_ASYNC_END0(MemoryDumpManager::kTraceCategory,
+                                  "ProcessMemoryDump",
+                                  TRACE_ID_LOCAL(dump_guid));
+}
+
 }  // namespace
 
 // static
@@ -137,6 +159,15 @@ void MemoryDumpManager::Initialize(
   RegisterDumpProvider(MallocDumpProvider::GetInstance(), "Malloc", nullptr);
 #endif
 
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+#if BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+  PartitionAllocDumpProvider::GetInstance()->RegisterPartition(
+      "malloc", allocator::PartitionAllocMalloc::Allocator());
+#endif
+  RegisterDumpProvider(PartitionAllocDumpProvider::GetInstance(),
+                       "PartitionAlloc", nullptr);
+#endif
+
 #if defined(OS_ANDROID)
   RegisterDumpProvider(JavaHeapDumpProvider::GetInstance(), "JavaHeap",
                        nullptr);
@@ -306,6 +337,11 @@ void MemoryDumpManager::CreateProcessDump(
     CHECK_EQ(MemoryDumpLevelOfDetail::BACKGROUND, args.level_of_detail);
   }
 
+  if (args.incremental) {
+    StartIncrementalProcessDump(args, callback);
+    return;
+  }
+
   std::unique_ptr<ProcessMemoryDumpAsyncState> pmd_async_state;
   {
     AutoLock lock(lock_);
@@ -406,7 +442,7 @@ void MemoryDumpManager::ContinueAsyncProcessDump(
 // either the task runner specified by MDP or |dump_thread_task_runner| if the
 // MDP did not specify task runner. Invokes the dump provider's OnMemoryDump()
 // (unless disabled).
-void MemoryDumpManager::InvokeOnMemoryDump(MemoryDumpProviderInfo* mdpinfo,
+bool MemoryDumpManager::InvokeOnMemoryDump(MemoryDumpProviderInfo* mdpinfo,
                                            ProcessMemoryDump* pmd) {
   HEAP_PROFILER_SCOPED_IGNORE;
   DCHECK(!mdpinfo->task_runner ||
@@ -435,7 +471,7 @@ void MemoryDumpManager::InvokeOnMemoryDump(MemoryDumpProviderInfo* mdpinfo,
                   << "\". Dump failed multiple times consecutively.";
     }
     if (mdpinfo->disabled)
-      return;
+      return false;
 
     is_thread_bound = mdpinfo->task_runner != nullptr;
   }  // AutoLock lock(lock_);
@@ -456,8 +492,14 @@ void MemoryDumpManager::InvokeOnMemoryDump(MemoryDumpProviderInfo* mdpinfo,
         !*(static_cast<volatile bool*>(&mdpinfo->disabled)));
   bool dump_successful =
       mdpinfo->dump_provider->OnMemoryDump(pmd->dump_args(), pmd);
+  // The dumps of incremental dumps can still miss their deadline, so their
+  // outcome is counted by OnIncrementalDumpProviderDone().
+  if (pmd->dump_args().incremental)
+    return dump_successful;
+  AutoLock lock(lock_);
   mdpinfo->consecutive_failures =
       dump_successful ? 0 : mdpinfo->consecutive_failures + 1;
+  return dump_successful;
 }
 
 void MemoryDumpManager::FinishAsyncProcessDump(
@@ -487,6 +529,190 @@ void MemoryDumpManager::FinishAsyncProcessDump(
                                   TRACE_ID_LOCAL(dump_guid));
 }
 
+void MemoryDumpManager::StartIncrementalProcessDump(
+    const MemoryDumpRequestArgs& args,
+    const ProcessMemoryDumpCallback& callback) {
+  HEAP_PROFILER_SCOPED_IGNORE;
+  TraceLog::GetInstance()->InitializeThreadLocalEventBufferIfSupported();
+
+  scoped_refptr<IncrementalDumpState> state =
+      new IncrementalDumpState(args, callback);
+  MemoryDumpProviderInfo::OrderedSet dump_providers;
+  scoped_refptr<SequencedTaskRunner> dump_thread_task_runner;
+  {
+    AutoLock lock(lock_);
+    dump_providers = dump_providers_;
+    dump_thread_task_runner = GetOrCreateBgTaskRunnerLocked();
+  }
+
+  // All the providers are pending before any is invoked, so that the first
+  // one to return doesn't finish the dump.
+  std::vector<scoped_refptr<MemoryDumpProviderInfo>> providers_to_invoke;
+  std::set<TimeDelta> deadlines;
+  {
+    AutoLock lock(state->lock);
+    for (const auto& mdpinfo : dump_providers) {
+      // In background mode only the whitelisted providers are invoked.
+      if (args.level_of_detail == MemoryDumpLevelOfDetail::BACKGROUND &&
+          !mdpinfo->whitelisted_for_background_mode) {
+        continue;
+      }
+      const TimeDelta deadline = mdpinfo->options.incremental_dump_deadline;
+      state->pending_dump_providers[mdpinfo.get()] =
+          state->start_time + deadline;
+      providers_to_invoke.push_back(mdpinfo);
+      deadlines.insert(deadline);
+    }
+  }
+
+  // Without any provider to invoke, the dump finishes right away.
+  if (providers_to_invoke.empty()) {
+    {
+      AutoLock lock(state->lock);
+      state->finished = true;
+    }
+    FinishIncrementalProcessDump(std::move(state));
+    return;
+  }
+
+  for (const auto& mdpinfo : providers_to_invoke) {
+    // Unbound providers run on the TaskScheduler, each on a sequence of its
+    // own which is kept across dumps, or on |dump_thread_| in the processes
+    // which don't have one.
+    scoped_refptr<SequencedTaskRunner> task_runner = mdpinfo->task_runner;
+    if (!task_runner) {
+      AutoLock lock(lock_);
+      if (!mdpinfo->incremental_dump_task_runner) {
+        mdpinfo->incremental_dump_task_runner =
+            TaskScheduler::GetInstance()
+                ? CreateSequencedTaskRunnerWithTraits({MayBlock()})
+                : dump_thread_task_runner;
+      }
+      task_runner = mdpinfo->incremental_dump_task_runner;
+    }
+    bool did_post_task = task_runner->PostTask(
+        FROM_HERE, BindOnce(&MemoryDumpManager::InvokeOnIncrementalDump,
+                            Unretained(this), state, mdpinfo));
+    if (did_post_task)
+      continue;
+
+    // Like in ContinueAsyncProcessDump(), a provider whose task runner is
+    // gone is disabled.
+    if (mdpinfo->task_runner) {
+      AutoLock lock(lock_);
+      mdpinfo->disabled = true;
+    }
+    OnIncrementalDumpProviderDone(state, mdpinfo.get(), nullptr);
+  }
+
+  for (const TimeDelta& deadline : deadlines) {
+    dump_thread_task_runner->PostDelayedTask(
+        FROM_HERE,
+        BindOnce(&MemoryDumpManager::CheckIncrementalDumpDeadlines,
+                 Unretained(this), state),
+        deadline);
+  }
+}
+
+void MemoryDumpManager::InvokeOnIncrementalDump(
+    scoped_refptr<IncrementalDumpState> state,
+    scoped_refptr<MemoryDumpProviderInfo> mdpinfo) {
+  HEAP_PROFILER_SCOPED_IGNORE;
+  MemoryDumpArgs args = {state->req_args.level_of_detail,
+                         state->req_args.dump_guid, true /* incremental */};
+  auto pmd = std::make_unique<ProcessMemoryDump>(args);
+  if (!InvokeOnMemoryDump(mdpinfo.get(), pmd.get()))
+    pmd.reset();
+  OnIncrementalDumpProviderDone(std::move(state), mdpinfo.get(),
+                                std::move(pmd));
+}
+
+void MemoryDumpManager::OnIncrementalDumpProviderDone(
+    scoped_refptr<IncrementalDumpState> state,
+    MemoryDumpProviderInfo* mdpinfo,
+    std::unique_ptr<ProcessMemoryDump> pmd) {
+  bool missed_deadline;
+  bool dump_successful;
+  bool finish;
+  {
+    AutoLock lock(state->lock);
+    auto it = state->pending_dump_providers.find(mdpinfo);
+    DCHECK(it != state->pending_dump_providers.end());
+    missed_deadline = state->finished || TimeTicks::Now() > it->second;
+    state->pending_dump_providers.erase(it);
+    dump_successful = pmd && !missed_deadline;
+    if (dump_successful) {
+      // The baseline is updated here, on the sequence of the MDP, so that the
+      // dumps of the MDP are diffed in the order it made them, even when the
+      // incremental dumps they belong to finish out of order.
+      {
+        AutoLock mdm_lock(lock_);
+        pmd->MakeIncremental(
+            &mdpinfo->incremental_baselines[state->req_args.level_of_detail]);
+      }
+      state->provider_dumps.emplace_back(mdpinfo, std::move(pmd));
+    }
+    finish = !state->finished && state->pending_dump_providers.empty();
+    if (finish)
+      state->finished = true;
+  }
+
+  {
+    // A missed deadline counts as a failure of the provider. Its dump is
+    // dropped, so that it doesn't become the baseline of the next incremental
+    // dump without having been reported.
+    AutoLock lock(lock_);
+    mdpinfo->consecutive_failures =
+        dump_successful ? 0 : mdpinfo->consecutive_failures + 1;
+  }
+  if (missed_deadline) {
+    DLOG(WARNING) << "MemoryDumpProvider \"" << mdpinfo->name
+                  << "\" missed the deadline of an incremental dump.";
+  }
+  if (finish)
+    FinishIncrementalProcessDump(std::move(state));
+}
+
+void MemoryDumpManager::CheckIncrementalDumpDeadlines(
+    scoped_refptr<IncrementalDumpState> state) {
+  {
+    AutoLock lock(state->lock);
+    if (state->finished)
+      return;
+    const TimeTicks now = TimeTicks::Now();
+    for (const auto& it : state->pending_dump_providers) {
+      if (it.second > now)
+        return;
+    }
+    state->finished = true;
+  }
+  FinishIncrementalProcessDump(std::move(state));
+}
+
+void MemoryDumpManager::FinishIncrementalProcessDump(
+    scoped_refptr<IncrementalDumpState> state) {
+  HEAP_PROFILER_SCOPED_IGNORE;
+  TRACE_EVENT0(kTraceCategory,
+               "MemoryDumpManager::FinishIncrementalProcessDump");
+  decltype(state->provider_dumps) provider_dumps;
+  {
+    AutoLock lock(state->lock);
+    DCHECK(state->finished);
+    provider_dumps.swap(state->provider_dumps);
+  }
+
+  const MemoryDumpRequestArgs& req_args = state->req_args;
+  MemoryDumpArgs args = {req_args.level_of_detail, req_args.dump_guid,
+                         true /* incremental */};
+  auto pmd = std::make_unique<ProcessMemoryDump>(args);
+  for (auto& it : provider_dumps)
+    pmd->TakeAllDumpsFrom(it.second.get());
+
+  state->callback_task_runner->PostTask(
+      FROM_HERE, BindOnce(&RunIncrementalDumpCallback, state->callback,
+                          req_args.dump_guid, std::move(pmd)));
+}
+
 void MemoryDumpManager::SetupForTracing(
     const TraceConfig::MemoryDumpConfig& memory_dump_config) {
   AutoLock lock(lock_);
@@ -534,12 +760,23 @@ MemoryDumpManager::ProcessMemoryDumpAsyncState::ProcessMemoryDumpAsyncState(
       dump_thread_task_runner(std::move(dump_thread_task_runner)) {
   pending_dump_providers.reserve(dump_providers.size());
   pending_dump_providers.assign(dump_providers.rbegin(), dump_providers.rend());
-  MemoryDumpArgs args = {req_args.level_of_detail, req_args.dump_guid};
+  MemoryDumpArgs args = {req_args.level_of_detail, req_args.dump_guid,
+                         req_args.incremental};
   process_memory_dump = std::make_unique<ProcessMemoryDump>(args);
 }
 
 MemoryDumpManager::ProcessMemoryDumpAsyncState::~ProcessMemoryDumpAsyncState() =
     default;
 
+MemoryDumpManager::IncrementalDumpState::IncrementalDumpState(
+    MemoryDumpRequestArgs req_args,
+    ProcessMemoryDumpCallback callback)
+    : req_args(req_args),
+      callback(callback),
+      callback_task_runner(ThreadTaskRunnerHandle::Get()),
+      start_time(TimeTicks::Now()) {}
+
+MemoryDumpManager::IncrementalDumpState::~IncrementalDumpState() = default;
+
 }  // namespace trace_event
 }  // namespace base
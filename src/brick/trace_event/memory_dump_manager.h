@@ -10,6 +10,7 @@
 #include <map>
 #include <memory>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "brick/atomicops.h"
@@ -18,6 +19,7 @@
 #include "brick/memory/ref_counted.h"
 #include "brick/memory/singleton.h"
 #include "brick/synchronization/lock.h"
+#include "brick/time/time.h"
 #include "brick/trace_event/memory_allocator_dump.h"
 #include "brick/trace_event/memory_dump_provider_info.h"
 #include "brick/trace_event/memory_dump_request_args.h"
@@ -115,6 +117,11 @@ class BRICK_EXPORT MemoryDumpManager {
   // |callback| will be invoked asynchronously upon completion on the same
   // thread on which CreateProcessDump() was called. This method should only be
   // used by the memory-infra service while creating a global memory dump.
+  // Dumps with |args.incremental| invoke all the providers at once instead of
+  // one after the other, so that the pause they cause is bounded by the
+  // deadlines of the providers. Unbound providers then run on the
+  // TaskScheduler, each on a sequence of its own, so that a provider is never
+  // invoked concurrently by overlapping dumps.
   void CreateProcessDump(const MemoryDumpRequestArgs& args,
                          const ProcessMemoryDumpCallback& callback);
 
@@ -192,6 +199,51 @@ class BRICK_EXPORT MemoryDumpManager {
     DISALLOW_COPY_AND_ASSIGN(ProcessMemoryDumpAsyncState);
   };
 
+  // Holds the state of an incremental process dump, whose providers run in
+  // parallel on their task runners and dump into their own
+  // ProcessMemoryDump. The dump finishes either when all the providers did,
+  // or when the deadlines of all the pending ones have passed.
+  struct IncrementalDumpState
+      : public RefCountedThreadSafe<IncrementalDumpState> {
+    IncrementalDumpState(MemoryDumpRequestArgs req_args,
+                         ProcessMemoryDumpCallback callback);
+
+    // The arguments passed to the initial CreateProcessDump() request.
+    const MemoryDumpRequestArgs req_args;
+
+    // Callback passed to the initial call to CreateProcessDump().
+    const ProcessMemoryDumpCallback callback;
+
+    // The thread on which |callback| should be invoked.
+    const scoped_refptr<SingleThreadTaskRunner> callback_task_runner;
+
+    // The time the providers are invoked at, which their deadlines are
+    // relative to.
+    const TimeTicks start_time;
+
+    Lock lock;
+
+    // The providers which were invoked but didn't return yet, with their
+    // deadline. Guarded by |lock|.
+    std::map<MemoryDumpProviderInfo*, TimeTicks> pending_dump_providers;
+
+    // The dumps of the providers which returned before their deadline.
+    // Guarded by |lock|.
+    std::vector<std::pair<scoped_refptr<MemoryDumpProviderInfo>,
+                          std::unique_ptr<ProcessMemoryDump>>>
+        provider_dumps;
+
+    // Whether the dump was finished. The providers which return after that
+    // are left out. Guarded by |lock|.
+    bool finished = false;
+
+   private:
+    friend class RefCountedThreadSafe<IncrementalDumpState>;
+    ~IncrementalDumpState();
+
+    DISALLOW_COPY_AND_ASSIGN(IncrementalDumpState);
+  };
+
   static const int kMaxConsecutiveFailuresCount;
   static const char* const kSystemAllocatorPoolName;
 
@@ -211,13 +263,40 @@ class BRICK_EXPORT MemoryDumpManager {
       ProcessMemoryDumpAsyncState* owned_pmd_async_state);
 
   // Invokes OnMemoryDump() of the given MDP. Should be called on the MDP task
-  // runner.
-  void InvokeOnMemoryDump(MemoryDumpProviderInfo* mdpinfo,
+  // runner. Returns false if the MDP is disabled or failed. Counts the failures
+  // of the MDP, except in incremental dumps, where a successful dump can still
+  // miss the deadline; see OnIncrementalDumpProviderDone().
+  bool InvokeOnMemoryDump(MemoryDumpProviderInfo* mdpinfo,
                           ProcessMemoryDump* pmd);
 
   void FinishAsyncProcessDump(
       std::unique_ptr<ProcessMemoryDumpAsyncState> pmd_async_state);
 
+  // Posts the invocation of all the MDPs of an incremental dump at once, and
+  // the checks of their deadlines to |dump_thread_|.
+  void StartIncrementalProcessDump(const MemoryDumpRequestArgs& args,
+                                   const ProcessMemoryDumpCallback& callback);
+
+  // Invokes OnMemoryDump() of the given MDP for an incremental dump, on the
+  // MDP task runner, and finishes the dump if it was the last pending MDP.
+  void InvokeOnIncrementalDump(scoped_refptr<IncrementalDumpState> state,
+                               scoped_refptr<MemoryDumpProviderInfo> mdpinfo);
+
+  // Removes |mdpinfo| from the pending MDPs of |state|, keeping |pmd| as a
+  // difference from the previous incremental dump of the MDP if it returned
+  // in time, and finishes the dump if it was the last one. A missing or late
+  // dump counts as a failure of the MDP.
+  void OnIncrementalDumpProviderDone(
+      scoped_refptr<IncrementalDumpState> state,
+      MemoryDumpProviderInfo* mdpinfo,
+      std::unique_ptr<ProcessMemoryDump> pmd);
+
+  // Finishes the dump if the deadlines of all its pending MDPs have passed.
+  void CheckIncrementalDumpDeadlines(scoped_refptr<IncrementalDumpState> state);
+
+  // Merges the dumps of the MDPs and posts them to the callback.
+  void FinishIncrementalProcessDump(scoped_refptr<IncrementalDumpState> state);
+
   // Helper for RegierDumpProvider* functions.
   void RegisterDumpProviderInternal(
       MemoryDumpProvider* mdp,
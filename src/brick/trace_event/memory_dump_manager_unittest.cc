@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "brick/allocator/buildflags.h"
+#include "brick/barrier_closure.h"
 #include "brick/base_switches.h"
 #include "brick/callback.h"
 #include "brick/command_line.h"
@@ -23,6 +24,7 @@
 #include "brick/task_scheduler/post_task.h"
 #include "brick/test/scoped_task_environment.h"
 #include "brick/test/test_io_thread.h"
+#include "brick/test/test_timeouts.h"
 #include "brick/threading/platform_thread.h"
 #include "brick/threading/sequenced_task_runner_handle.h"
 #include "brick/threading/thread.h"
@@ -161,6 +163,29 @@ class TestSequencedTaskRunner : public SequencedTaskRunner {
   unsigned num_of_post_tasks_ = 0;
 };
 
+// Reports a "foo" dump whose object count can change, and a "bar" dump which
+// can be left out.
+class IncrementalDumpProvider : public MemoryDumpProvider {
+ public:
+  bool OnMemoryDump(const MemoryDumpArgs& args,
+                    ProcessMemoryDump* pmd) override {
+    EXPECT_TRUE(args.incremental);
+    MemoryAllocatorDump* foo = pmd->CreateAllocatorDump("foo");
+    foo->AddScalar(MemoryAllocatorDump::kNameSize,
+                   MemoryAllocatorDump::kUnitsBytes, 1);
+    foo->AddScalar(MemoryAllocatorDump::kNameObjectCount,
+                   MemoryAllocatorDump::kUnitsObjects, object_count);
+    if (dumps_bar) {
+      pmd->CreateAllocatorDump("bar")->AddScalar(
+          MemoryAllocatorDump::kNameSize, MemoryAllocatorDump::kUnitsBytes, 2);
+    }
+    return true;
+  }
+
+  uint64_t object_count = 1;
+  bool dumps_bar = true;
+};
+
 class TestingThreadHeapUsageTracker : public debug::ThreadHeapUsageTracker {
  public:
   using ThreadHeapUsageTracker::DisableHeapTrackingForTesting;
@@ -230,6 +255,33 @@ class MemoryDumpManagerTest : public testing::Test {
     return success;
   }
 
+  // Like RequestProcessDumpAndWait(), for an incremental dump. Returns the
+  // ProcessMemoryDump passed to the callback.
+  std::unique_ptr<ProcessMemoryDump> RequestIncrementalDumpAndWait(
+      MemoryDumpLevelOfDetail level_of_detail) {
+    RunLoop run_loop;
+    std::unique_ptr<ProcessMemoryDump> result;
+    static uint64_t test_guid = 1;
+    test_guid++;
+    MemoryDumpRequestArgs request_args{
+        test_guid, MemoryDumpType::PERIODIC_INTERVAL, level_of_detail,
+        true /* incremental */};
+    ProcessMemoryDumpCallback callback = Bind(
+        [](std::unique_ptr<ProcessMemoryDump>* curried_result,
+           Closure curried_quit_closure, bool success, uint64_t dump_guid,
+           std::unique_ptr<ProcessMemoryDump> pmd) {
+          EXPECT_TRUE(success);
+          *curried_result = std::move(pmd);
+          ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE,
+                                                  curried_quit_closure);
+        },
+        Unretained(&result), run_loop.QuitClosure());
+
+    mdm_->CreateProcessDump(request_args, callback);
+    run_loop.Run();
+    return result;
+  }
+
   void EnableForTracing() {
     mdm_->SetupForTracing(TraceConfig::MemoryDumpConfig());
   }
@@ -836,5 +888,213 @@ TEST_F(MemoryDumpManagerTest, NoStackOverflowWithTooManyMDPs) {
                                         MemoryDumpLevelOfDetail::BACKGROUND));
 }
 
+// Checks that incremental dumps invoke the providers in parallel: each of the
+// two providers waits for the other one to be invoked.
+TEST_F(MemoryDumpManagerTest, IncrementalDumpRunsProvidersInParallel) {
+  MemoryDumpProvider::Options options;
+  options.incremental_dump_deadline = TestTimeouts::action_max_timeout();
+  Thread thread1("thread1");
+  Thread thread2("thread2");
+  ASSERT_TRUE(thread1.Start());
+  ASSERT_TRUE(thread2.Start());
+  MockMemoryDumpProvider mdp1;
+  MockMemoryDumpProvider mdp2;
+  RegisterDumpProvider(&mdp1, thread1.task_runner(), options);
+  RegisterDumpProvider(&mdp2, thread2.task_runner(), options);
+
+  WaitableEvent invoked1(WaitableEvent::ResetPolicy::MANUAL,
+                         WaitableEvent::InitialState::NOT_SIGNALED);
+  WaitableEvent invoked2(WaitableEvent::ResetPolicy::MANUAL,
+                         WaitableEvent::InitialState::NOT_SIGNALED);
+  auto wait_for_other = [](WaitableEvent* invoked, WaitableEvent* other,
+                           const char* name, ProcessMemoryDump* pmd) {
+    invoked->Signal();
+    EXPECT_TRUE(other->TimedWait(TestTimeouts::action_timeout()));
+    pmd->CreateAllocatorDump(name);
+    return true;
+  };
+  EXPECT_CALL(mdp1, OnMemoryDump(_, _))
+      .WillOnce(Invoke([&](const MemoryDumpArgs&, ProcessMemoryDump* pmd) {
+        return wait_for_other(&invoked1, &invoked2, "mdp1", pmd);
+      }));
+  EXPECT_CALL(mdp2, OnMemoryDump(_, _))
+      .WillOnce(Invoke([&](const MemoryDumpArgs&, ProcessMemoryDump* pmd) {
+        return wait_for_other(&invoked2, &invoked1, "mdp2", pmd);
+      }));
+
+  std::unique_ptr<ProcessMemoryDump> pmd =
+      RequestIncrementalDumpAndWait(MemoryDumpLevelOfDetail::LIGHT);
+  ASSERT_TRUE(pmd);
+  EXPECT_TRUE(pmd->dump_args().incremental);
+  EXPECT_TRUE(pmd->GetAllocatorDump("mdp1"));
+  EXPECT_TRUE(pmd->GetAllocatorDump("mdp2"));
+
+  PostTaskAndWait(FROM_HERE, thread1.task_runner().get(),
+                  BindOnce(&MemoryDumpManager::UnregisterDumpProvider,
+                           Unretained(mdm_.get()), &mdp1));
+  PostTaskAndWait(FROM_HERE, thread2.task_runner().get(),
+                  BindOnce(&MemoryDumpManager::UnregisterDumpProvider,
+                           Unretained(mdm_.get()), &mdp2));
+}
+
+// Checks that an incremental dump doesn't wait for a provider past its
+// deadline, and leaves its dump out.
+TEST_F(MemoryDumpManagerTest, IncrementalDumpDeadline) {
+  MemoryDumpProvider::Options slow_options;
+  slow_options.incremental_dump_deadline = TimeDelta::FromMilliseconds(10);
+  Thread slow_thread("slow thread");
+  ASSERT_TRUE(slow_thread.Start());
+  MockMemoryDumpProvider slow_mdp;
+  MockMemoryDumpProvider fast_mdp;
+  RegisterDumpProvider(&slow_mdp, slow_thread.task_runner(), slow_options);
+  RegisterDumpProvider(&fast_mdp, ThreadTaskRunnerHandle::Get());
+
+  WaitableEvent dump_done(WaitableEvent::ResetPolicy::MANUAL,
+                          WaitableEvent::InitialState::NOT_SIGNALED);
+  EXPECT_CALL(slow_mdp, OnMemoryDump(_, _))
+      .WillOnce(Invoke([&](const MemoryDumpArgs&, ProcessMemoryDump* pmd) {
+        EXPECT_TRUE(dump_done.TimedWait(TestTimeouts::action_timeout()));
+        pmd->CreateAllocatorDump("slow");
+        return true;
+      }));
+  EXPECT_CALL(fast_mdp, OnMemoryDump(_, _))
+      .WillOnce(Invoke([](const MemoryDumpArgs&, ProcessMemoryDump* pmd) {
+        pmd->CreateAllocatorDump("fast");
+        return true;
+      }));
+
+  std::unique_ptr<ProcessMemoryDump> pmd =
+      RequestIncrementalDumpAndWait(MemoryDumpLevelOfDetail::LIGHT);
+  dump_done.Signal();
+  ASSERT_TRUE(pmd);
+  EXPECT_TRUE(pmd->GetAllocatorDump("fast"));
+  EXPECT_FALSE(pmd->GetAllocatorDump("slow"));
+
+  PostTaskAndWait(FROM_HERE, slow_thread.task_runner().get(),
+                  BindOnce(&MemoryDumpManager::UnregisterDumpProvider,
+                           Unretained(mdm_.get()), &slow_mdp));
+  mdm_->UnregisterDumpProvider(&fast_mdp);
+}
+
+// Checks that a provider which keeps missing the deadline of incremental dumps
+// is disabled, even though its OnMemoryDump() succeeds.
+TEST_F(MemoryDumpManagerTest, DisableProvidersMissingIncrementalDeadlines) {
+  MemoryDumpProvider::Options slow_options;
+  slow_options.incremental_dump_deadline = TimeDelta::FromMilliseconds(10);
+  Thread slow_thread("slow thread");
+  ASSERT_TRUE(slow_thread.Start());
+  MockMemoryDumpProvider slow_mdp;
+  RegisterDumpProvider(&slow_mdp, slow_thread.task_runner(), slow_options);
+
+  WaitableEvent dump_done(WaitableEvent::ResetPolicy::AUTOMATIC,
+                          WaitableEvent::InitialState::NOT_SIGNALED);
+  EXPECT_CALL(slow_mdp, OnMemoryDump(_, _))
+      .Times(GetMaxConsecutiveFailuresCount())
+      .WillRepeatedly(Invoke([&](const MemoryDumpArgs&, ProcessMemoryDump*) {
+        EXPECT_TRUE(dump_done.TimedWait(TestTimeouts::action_timeout()));
+        return true;
+      }));
+
+  for (int i = 0; i < GetMaxConsecutiveFailuresCount() + 1; i++) {
+    EXPECT_TRUE(RequestIncrementalDumpAndWait(MemoryDumpLevelOfDetail::LIGHT));
+    dump_done.Signal();
+  }
+
+  PostTaskAndWait(FROM_HERE, slow_thread.task_runner().get(),
+                  BindOnce(&MemoryDumpManager::UnregisterDumpProvider,
+                           Unretained(mdm_.get()), &slow_mdp));
+}
+
+// Checks that overlapping incremental dumps invoke an unbound provider on the
+// same sequence, one after the other.
+TEST_F(MemoryDumpManagerTest, IncrementalDumpsSequenceUnboundProvider) {
+  MemoryDumpProvider::Options options;
+  options.incremental_dump_deadline = TestTimeouts::action_max_timeout();
+  auto mdp = std::make_unique<MockMemoryDumpProvider>();
+  RegisterDumpProvider(mdp.get(), nullptr, options);
+
+  scoped_refptr<SequencedTaskRunner> first_task_runner;
+  bool in_dump = false;
+  EXPECT_CALL(*mdp, OnMemoryDump(_, _))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](const MemoryDumpArgs&, ProcessMemoryDump*) {
+        // The invocations are sequenced, so they don't race on the fields.
+        EXPECT_FALSE(in_dump);
+        in_dump = true;
+        if (!first_task_runner)
+          first_task_runner = SequencedTaskRunnerHandle::Get();
+        EXPECT_EQ(first_task_runner, SequencedTaskRunnerHandle::Get());
+        PlatformThread::Sleep(TestTimeouts::tiny_timeout());
+        in_dump = false;
+        return true;
+      }));
+
+  RunLoop run_loop;
+  RepeatingClosure barrier = BarrierClosure(2, run_loop.QuitClosure());
+  ProcessMemoryDumpCallback callback = Bind(
+      [](RepeatingClosure curried_barrier, bool success, uint64_t dump_guid,
+         std::unique_ptr<ProcessMemoryDump> pmd) {
+        EXPECT_TRUE(success);
+        curried_barrier.Run();
+      },
+      barrier);
+  mdm_->CreateProcessDump(
+      {1, MemoryDumpType::PERIODIC_INTERVAL, MemoryDumpLevelOfDetail::LIGHT,
+       true /* incremental */},
+      callback);
+  mdm_->CreateProcessDump(
+      {2, MemoryDumpType::PERIODIC_INTERVAL, MemoryDumpLevelOfDetail::LIGHT,
+       true /* incremental */},
+      callback);
+  run_loop.Run();
+
+  mdm_->UnregisterAndDeleteDumpProviderSoon(std::move(mdp));
+}
+
+// Checks that incremental dumps only have the scalars which changed since the
+// previous incremental dump of the same level of detail.
+TEST_F(MemoryDumpManagerTest, IncrementalDumpReportsChanges) {
+  IncrementalDumpProvider mdp;
+  RegisterDumpProvider(&mdp, ThreadTaskRunnerHandle::Get());
+
+  // The first dump has everything.
+  std::unique_ptr<ProcessMemoryDump> pmd =
+      RequestIncrementalDumpAndWait(MemoryDumpLevelOfDetail::LIGHT);
+  ASSERT_TRUE(pmd);
+  ASSERT_TRUE(pmd->GetAllocatorDump("foo"));
+  EXPECT_EQ(2u, pmd->GetAllocatorDump("foo")->entries().size());
+  ASSERT_TRUE(pmd->GetAllocatorDump("bar"));
+  EXPECT_EQ(MemoryAllocatorDump::Flags::DEFAULT,
+            pmd->GetAllocatorDump("bar")->flags());
+
+  // Only the object count of "foo" changed, and "bar" is gone.
+  mdp.object_count = 2;
+  mdp.dumps_bar = false;
+  pmd = RequestIncrementalDumpAndWait(MemoryDumpLevelOfDetail::LIGHT);
+  ASSERT_TRUE(pmd);
+  MemoryAllocatorDump* foo = pmd->GetAllocatorDump("foo");
+  ASSERT_TRUE(foo);
+  ASSERT_EQ(1u, foo->entries().size());
+  EXPECT_STREQ(MemoryAllocatorDump::kNameObjectCount, foo->entries()[0].name);
+  EXPECT_EQ(2u, foo->entries()[0].value_uint64);
+  ASSERT_TRUE(pmd->GetAllocatorDump("bar"));
+  EXPECT_EQ(MemoryAllocatorDump::Flags::REMOVED,
+            pmd->GetAllocatorDump("bar")->flags());
+  EXPECT_TRUE(pmd->GetAllocatorDump("bar")->entries().empty());
+
+  // Nothing changed.
+  pmd = RequestIncrementalDumpAndWait(MemoryDumpLevelOfDetail::LIGHT);
+  ASSERT_TRUE(pmd);
+  EXPECT_TRUE(pmd->allocator_dumps().empty());
+
+  // Detailed dumps don't share the previous dump of light ones.
+  pmd = RequestIncrementalDumpAndWait(MemoryDumpLevelOfDetail::DETAILED);
+  ASSERT_TRUE(pmd);
+  ASSERT_TRUE(pmd->GetAllocatorDump("foo"));
+  EXPECT_EQ(2u, pmd->GetAllocatorDump("foo")->entries().size());
+
+  mdm_->UnregisterDumpProvider(&mdp);
+}
+
 }  // namespace trace_event
 }  // namespace base
@@ -8,6 +8,7 @@
 #include "brick/base_export.h"
 #include "brick/macros.h"
 #include "brick/process/process_handle.h"
+#include "brick/time/time.h"
 #include "brick/trace_event/memory_dump_request_args.h"
 
 namespace base {
@@ -20,12 +21,19 @@ class BRICK_EXPORT MemoryDumpProvider {
  public:
   // Optional arguments for MemoryDumpManager::RegisterDumpProvider().
   struct Options {
-    Options() : dumps_on_single_thread_task_runner(false) {}
+    Options()
+        : dumps_on_single_thread_task_runner(false),
+          incremental_dump_deadline(TimeDelta::FromMilliseconds(100)) {}
 
     // |dumps_on_single_thread_task_runner| is true if the dump provider runs on
     // a SingleThreadTaskRunner, which is usually the case. It is faster to run
     // all providers that run on the same thread together without thread hops.
     bool dumps_on_single_thread_task_runner;
+
+    // How long incremental dumps wait for the provider, from the start of the
+    // dump. A provider which misses its deadline is left out of the dump, and
+    // this counts as a failure of the provider.
+    TimeDelta incremental_dump_deadline;
   };
 
   virtual ~MemoryDumpProvider() = default;
@@ -5,12 +5,15 @@
 #ifndef BRICK_TRACE_EVENT_MEMORY_DUMP_PROVIDER_INFO_H_
 #define BRICK_TRACE_EVENT_MEMORY_DUMP_PROVIDER_INFO_H_
 
+#include <map>
 #include <memory>
 #include <set>
 
 #include "brick/base_export.h"
 #include "brick/memory/ref_counted.h"
 #include "brick/trace_event/memory_dump_provider.h"
+#include "brick/trace_event/memory_dump_request_args.h"
+#include "brick/trace_event/process_memory_dump.h"
 
 namespace base {
 
@@ -89,12 +92,24 @@ struct BRICK_EXPORT MemoryDumpProviderInfo
   // nullptr in all other cases.
   std::unique_ptr<MemoryDumpProvider> owned_dump_provider;
 
-  // For fail-safe logic (auto-disable failing MDPs).
+  // For fail-safe logic (auto-disable failing MDPs). Requires a locked access
+  // too, as incremental dumps can invoke unbound MDPs from several threads.
   int consecutive_failures;
 
   // Flagged either by the auto-disable logic or during unregistration.
   bool disabled;
 
+  // The scalars of the last incremental dump of the MDP, for each level of
+  // detail. Guarded by the MemoryDumpManager lock.
+  std::map<MemoryDumpLevelOfDetail, ProcessMemoryDump::IncrementalBaseline>
+      incremental_baselines;
+
+  // The sequence on which an unbound MDP is invoked for incremental dumps, so
+  // that the invocations of overlapping dumps don't run concurrently and
+  // update |incremental_baselines| in order. Created with the first
+  // incremental dump, and guarded by the MemoryDumpManager lock.
+  scoped_refptr<SequencedTaskRunner> incremental_dump_task_runner;
+
  private:
   friend class base::RefCountedThreadSafe<MemoryDumpProviderInfo>;
   ~MemoryDumpProviderInfo();
@@ -68,6 +68,10 @@ struct BRICK_EXPORT MemoryDumpRequestArgs {
 
   MemoryDumpType dump_type;
   MemoryDumpLevelOfDetail level_of_detail;
+
+  // Whether the dump only has what changed since the previous incremental
+  // dump of each provider. See MemoryDumpArgs::incremental.
+  bool incremental = false;
 };
 
 // Args for ProcessMemoryDump and passed to OnMemoryDump calls for memory dump
@@ -80,6 +84,14 @@ struct MemoryDumpArgs {
   // local dump with the same guid. This allows the trace importers to
   // reconstruct the global dump.
   uint64_t dump_guid;
+
+  // Incremental dumps run the providers in parallel, each with its own
+  // deadline (see MemoryDumpProvider::Options), and only keep the scalars
+  // which changed since the previous incremental dump of the same level of
+  // detail. Allocator dumps which are left out didn't change, and dumps which
+  // the provider stopped reporting have the REMOVED flag. Providers can
+  // ignore it, as the MemoryDumpManager computes the difference.
+  bool incremental = false;
 };
 
 using ProcessMemoryDumpCallback = Callback<
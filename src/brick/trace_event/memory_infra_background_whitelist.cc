@@ -245,6 +245,7 @@ const char* const kAllocatorDumpNameWhitelist[] = {
     "partition_alloc/partitions/buffer",
     "partition_alloc/partitions/fast_malloc",
     "partition_alloc/partitions/layout",
+    "partition_alloc/partitions/malloc",
     "skia/sk_glyph_cache",
     "skia/sk_resource_cache",
     "sqlite",
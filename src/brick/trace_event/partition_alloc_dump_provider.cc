@@ -0,0 +1,193 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/partition_alloc_dump_provider.h"
+
+#include <limits.h>
+
+#include <algorithm>
+#include <string>
+
+#include "brick/logging.h"
+#include "brick/metrics/histogram_functions.h"
+#include "brick/strings/stringprintf.h"
+#include "brick/trace_event/memory_allocator_dump.h"
+#include "brick/trace_event/process_memory_dump.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+constexpr char kPartitionsDumpName[] = "partition_alloc/partitions";
+constexpr char kUnitsMicroseconds[] = "us";
+
+std::string PartitionDumpName(const char* partition_name) {
+  return std::string(kPartitionsDumpName) + "/" + partition_name;
+}
+
+// Turns the statistics of a partition into allocator dumps.
+class AllocatorDumpStatsDumper : public PartitionStatsDumper {
+ public:
+  explicit AllocatorDumpStatsDumper(ProcessMemoryDump* pmd) : pmd_(pmd) {}
+
+  const PartitionMemoryStats& totals() const { return totals_; }
+
+  // PartitionStatsDumper implementation.
+  void PartitionDumpTotals(const char* partition_name,
+                           const PartitionMemoryStats* stats) override {
+    totals_ = *stats;
+    MemoryAllocatorDump* dump =
+        pmd_->CreateAllocatorDump(PartitionDumpName(partition_name));
+    dump->AddScalar(MemoryAllocatorDump::kNameSize,
+                    MemoryAllocatorDump::kUnitsBytes,
+                    stats->total_resident_bytes);
+    dump->AddScalar("allocated_objects_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->total_active_bytes);
+    dump->AddScalar("virtual_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->total_mmapped_bytes);
+    dump->AddScalar("virtual_committed_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->total_committed_bytes);
+    dump->AddScalar("decommittable_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->total_decommittable_bytes);
+    dump->AddScalar("discardable_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->total_discardable_bytes);
+    dump->AddScalar("slow_path_allocs", MemoryAllocatorDump::kUnitsObjects,
+                    stats->num_slow_path_allocs);
+    dump->AddScalar("slow_path_time", kUnitsMicroseconds,
+                    stats->slow_path_time.InMicroseconds());
+    dump->AddScalar("direct_map_allocs", MemoryAllocatorDump::kUnitsObjects,
+                    stats->num_direct_map_allocs);
+    dump->AddScalar("direct_map_time", kUnitsMicroseconds,
+                    stats->direct_map_time.InMicroseconds());
+
+    if (num_direct_maps_) {
+      MemoryAllocatorDump* direct_map_dump = pmd_->CreateAllocatorDump(
+          PartitionDumpName(partition_name) + "/direct_map");
+      direct_map_dump->AddScalar(MemoryAllocatorDump::kNameSize,
+                                 MemoryAllocatorDump::kUnitsBytes,
+                                 direct_map_bytes_);
+      direct_map_dump->AddScalar(MemoryAllocatorDump::kNameObjectCount,
+                                 MemoryAllocatorDump::kUnitsObjects,
+                                 num_direct_maps_);
+    }
+  }
+
+  // Only called for detailed dumps.
+  void PartitionsDumpBucketStats(
+      const char* partition_name,
+      const PartitionBucketMemoryStats* stats) override {
+    DCHECK(stats->is_valid);
+    if (stats->is_direct_map) {
+      // Summed up in PartitionDumpTotals(), since they all have their own
+      // size.
+      ++num_direct_maps_;
+      direct_map_bytes_ += stats->active_bytes;
+      return;
+    }
+    MemoryAllocatorDump* dump = pmd_->CreateAllocatorDump(
+        StringPrintf("%s/buckets/bucket_%u",
+                     PartitionDumpName(partition_name).c_str(),
+                     stats->bucket_slot_size));
+    dump->AddScalar(MemoryAllocatorDump::kNameSize,
+                    MemoryAllocatorDump::kUnitsBytes, stats->resident_bytes);
+    dump->AddScalar("allocated_objects_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->active_bytes);
+    dump->AddScalar("slot_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->bucket_slot_size);
+    dump->AddScalar("decommittable_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->decommittable_bytes);
+    dump->AddScalar("discardable_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->discardable_bytes);
+    dump->AddScalar("total_pages_size", MemoryAllocatorDump::kUnitsBytes,
+                    stats->allocated_page_size);
+    dump->AddScalar("active_pages", MemoryAllocatorDump::kUnitsObjects,
+                    stats->num_active_pages);
+    dump->AddScalar("full_pages", MemoryAllocatorDump::kUnitsObjects,
+                    stats->num_full_pages);
+    dump->AddScalar("empty_pages", MemoryAllocatorDump::kUnitsObjects,
+                    stats->num_empty_pages);
+    dump->AddScalar("decommitted_pages", MemoryAllocatorDump::kUnitsObjects,
+                    stats->num_decommitted_pages);
+    dump->AddScalar("allocs", MemoryAllocatorDump::kUnitsObjects,
+                    stats->num_allocs);
+  }
+
+ private:
+  ProcessMemoryDump* const pmd_;
+  PartitionMemoryStats totals_ = {};
+  size_t num_direct_maps_ = 0;
+  size_t direct_map_bytes_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocatorDumpStatsDumper);
+};
+
+}  // namespace
+
+// static
+PartitionAllocDumpProvider* PartitionAllocDumpProvider::GetInstance() {
+  return Singleton<PartitionAllocDumpProvider,
+                   LeakySingletonTraits<PartitionAllocDumpProvider>>::get();
+}
+
+PartitionAllocDumpProvider::PartitionAllocDumpProvider() = default;
+PartitionAllocDumpProvider::~PartitionAllocDumpProvider() = default;
+
+void PartitionAllocDumpProvider::RegisterPartition(
+    const char* name,
+    PartitionRootGeneric* root) {
+  AutoLock lock(lock_);
+  partitions_.push_back({name, root, 0, 0, TimeDelta()});
+}
+
+void PartitionAllocDumpProvider::UnregisterPartition(
+    PartitionRootGeneric* root) {
+  AutoLock lock(lock_);
+  auto it = std::find_if(
+      partitions_.begin(), partitions_.end(),
+      [root](const Partition& partition) { return partition.root == root; });
+  DCHECK(it != partitions_.end());
+  partitions_.erase(it);
+}
+
+bool PartitionAllocDumpProvider::OnMemoryDump(const MemoryDumpArgs& args,
+                                              ProcessMemoryDump* pmd) {
+  const bool is_light_dump =
+      args.level_of_detail != MemoryDumpLevelOfDetail::DETAILED;
+  AutoLock lock(lock_);
+  for (Partition& partition : partitions_) {
+    AllocatorDumpStatsDumper dumper(pmd);
+    partition.root->DumpStats(partition.name, is_light_dump, &dumper);
+    const PartitionMemoryStats& totals = dumper.totals();
+
+    const std::string histogram_prefix =
+        std::string("Memory.PartitionAlloc.") + partition.name;
+    if (totals.total_resident_bytes) {
+      UmaHistogramPercentage(
+          histogram_prefix + ".Fragmentation",
+          static_cast<int>(
+              100 * (totals.total_resident_bytes - totals.total_active_bytes) /
+              totals.total_resident_bytes));
+    }
+    UmaHistogramCounts1M(
+        histogram_prefix + ".SlowPathAllocs",
+        static_cast<int>(std::min<size_t>(
+            totals.num_slow_path_allocs - partition.num_slow_path_allocs,
+            INT_MAX)));
+    UmaHistogramCounts10000(
+        histogram_prefix + ".DirectMapAllocs",
+        static_cast<int>(std::min<size_t>(
+            totals.num_direct_map_allocs - partition.num_direct_map_allocs,
+            INT_MAX)));
+    UmaHistogramTimes(histogram_prefix + ".SlowPathTime",
+                      totals.slow_path_time - partition.slow_path_time);
+    partition.num_slow_path_allocs = totals.num_slow_path_allocs;
+    partition.num_direct_map_allocs = totals.num_direct_map_allocs;
+    partition.slow_path_time = totals.slow_path_time;
+  }
+  return true;
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,63 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TRACE_EVENT_PARTITION_ALLOC_DUMP_PROVIDER_H_
+#define BRICK_TRACE_EVENT_PARTITION_ALLOC_DUMP_PROVIDER_H_
+
+#include <vector>
+
+#include "brick/allocator/partition_allocator/partition_alloc.h"
+#include "brick/macros.h"
+#include "brick/memory/singleton.h"
+#include "brick/synchronization/lock.h"
+#include "brick/trace_event/memory_dump_provider.h"
+
+namespace base {
+namespace trace_event {
+
+// Dump provider which reports the memory of the registered generic partitions
+// as "partition_alloc/partitions/<name>", along with their always-on counters:
+// the allocations which took the slow path or were direct mapped and the time
+// spent on them, and the allocations from each bucket in detailed dumps.
+//
+// Each dump also records UMA histograms of the fragmentation of the
+// partitions, and of the slow path allocations since the previous dump.
+class BRICK_EXPORT PartitionAllocDumpProvider : public MemoryDumpProvider {
+ public:
+  static PartitionAllocDumpProvider* GetInstance();
+
+  // Starts reporting |root| as |name|, which must be a string literal.
+  // Partitions must be unregistered before they are destroyed.
+  void RegisterPartition(const char* name, PartitionRootGeneric* root);
+  void UnregisterPartition(PartitionRootGeneric* root);
+
+  // MemoryDumpProvider implementation.
+  bool OnMemoryDump(const MemoryDumpArgs& args,
+                    ProcessMemoryDump* pmd) override;
+
+ private:
+  friend struct DefaultSingletonTraits<PartitionAllocDumpProvider>;
+
+  struct Partition {
+    const char* name;
+    PartitionRootGeneric* root;
+    // The counters at the previous dump.
+    size_t num_slow_path_allocs;
+    size_t num_direct_map_allocs;
+    TimeDelta slow_path_time;
+  };
+
+  PartitionAllocDumpProvider();
+  ~PartitionAllocDumpProvider() override;
+
+  Lock lock_;
+  std::vector<Partition> partitions_;
+
+  DISALLOW_COPY_AND_ASSIGN(PartitionAllocDumpProvider);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BRICK_TRACE_EVENT_PARTITION_ALLOC_DUMP_PROVIDER_H_
@@ -0,0 +1,137 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/partition_alloc_dump_provider.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+
+#include "brick/allocator/partition_allocator/partition_alloc.h"
+#include "brick/test/metrics/histogram_tester.h"
+#include "brick/trace_event/memory_allocator_dump.h"
+#include "brick/trace_event/process_memory_dump.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+uint64_t GetScalar(const MemoryAllocatorDump* dump, const char* name) {
+  for (const MemoryAllocatorDump::Entry& entry : dump->entries()) {
+    if (strcmp(entry.name, name) == 0 &&
+        entry.entry_type == MemoryAllocatorDump::Entry::kUint64) {
+      return entry.value_uint64;
+    }
+  }
+  ADD_FAILURE() << "No scalar " << name;
+  return 0;
+}
+
+class PartitionAllocDumpProviderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    allocator_.init();
+    PartitionAllocDumpProvider::GetInstance()->RegisterPartition("test",
+                                                                 root());
+  }
+
+  void TearDown() override {
+    PartitionAllocDumpProvider::GetInstance()->UnregisterPartition(root());
+  }
+
+  PartitionRootGeneric* root() { return allocator_.root(); }
+
+  std::unique_ptr<ProcessMemoryDump> Dump(
+      MemoryDumpLevelOfDetail level_of_detail) {
+    MemoryDumpArgs dump_args = {level_of_detail};
+    auto pmd = std::make_unique<ProcessMemoryDump>(dump_args);
+    EXPECT_TRUE(
+        PartitionAllocDumpProvider::GetInstance()->OnMemoryDump(dump_args,
+                                                                pmd.get()));
+    return pmd;
+  }
+
+ private:
+  PartitionAllocatorGeneric allocator_;
+};
+
+}  // namespace
+
+TEST_F(PartitionAllocDumpProviderTest, DumpsTotalsAndCounters) {
+  void* ptr = root()->Alloc(100, "test");
+  void* direct_mapped = root()->Alloc(kGenericMaxBucketed + 1, "test");
+
+  std::unique_ptr<ProcessMemoryDump> pmd =
+      Dump(MemoryDumpLevelOfDetail::LIGHT);
+  const MemoryAllocatorDump* dump =
+      pmd->GetAllocatorDump("partition_alloc/partitions/test");
+  ASSERT_TRUE(dump);
+  EXPECT_LE(kGenericMaxBucketed + 100,
+            GetScalar(dump, "allocated_objects_size"));
+  EXPECT_LE(GetScalar(dump, "allocated_objects_size"),
+            GetScalar(dump, MemoryAllocatorDump::kNameSize));
+  EXPECT_EQ(2u, GetScalar(dump, "slow_path_allocs"));
+  EXPECT_EQ(1u, GetScalar(dump, "direct_map_allocs"));
+  // The buckets are only in detailed dumps.
+  EXPECT_FALSE(
+      pmd->GetAllocatorDump("partition_alloc/partitions/test/direct_map"));
+
+  root()->Free(ptr);
+  root()->Free(direct_mapped);
+}
+
+TEST_F(PartitionAllocDumpProviderTest, DumpsBucketsInDetailedDumps) {
+  void* ptrs[3];
+  for (void*& ptr : ptrs)
+    ptr = root()->Alloc(100, "test");
+  const size_t slot_size = PartitionAllocGetSize(ptrs[0]);
+  void* direct_mapped = root()->Alloc(kGenericMaxBucketed + 1, "test");
+
+  std::unique_ptr<ProcessMemoryDump> pmd =
+      Dump(MemoryDumpLevelOfDetail::DETAILED);
+  const MemoryAllocatorDump* bucket_dump = nullptr;
+  for (const auto& name_and_dump : pmd->allocator_dumps()) {
+    const MemoryAllocatorDump* dump = name_and_dump.second.get();
+    if (dump->absolute_name().find(
+            "partition_alloc/partitions/test/buckets/") == 0 &&
+        GetScalar(dump, "allocs") == 3u) {
+      bucket_dump = dump;
+    }
+  }
+  ASSERT_TRUE(bucket_dump);
+  EXPECT_LE(slot_size, GetScalar(bucket_dump, "slot_size"));
+  EXPECT_EQ(3 * GetScalar(bucket_dump, "slot_size"),
+            GetScalar(bucket_dump, "allocated_objects_size"));
+
+  const MemoryAllocatorDump* direct_map_dump =
+      pmd->GetAllocatorDump("partition_alloc/partitions/test/direct_map");
+  ASSERT_TRUE(direct_map_dump);
+  EXPECT_EQ(1u, GetScalar(direct_map_dump,
+                          MemoryAllocatorDump::kNameObjectCount));
+
+  for (void* ptr : ptrs)
+    root()->Free(ptr);
+  root()->Free(direct_mapped);
+}
+
+TEST_F(PartitionAllocDumpProviderTest, RecordsHistogramsSinceLastDump) {
+  HistogramTester histograms;
+  void* ptr = root()->Alloc(kGenericMaxBucketed + 1, "test");
+  Dump(MemoryDumpLevelOfDetail::LIGHT);
+  Dump(MemoryDumpLevelOfDetail::LIGHT);
+
+  histograms.ExpectTotalCount("Memory.PartitionAlloc.test.Fragmentation", 2);
+  // The allocation is only counted by the first dump.
+  histograms.ExpectBucketCount("Memory.PartitionAlloc.test.DirectMapAllocs", 1,
+                               1);
+  histograms.ExpectBucketCount("Memory.PartitionAlloc.test.DirectMapAllocs", 0,
+                               1);
+  root()->Free(ptr);
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -6,11 +6,13 @@
 
 #include <errno.h>
 
+#include <set>
 #include <vector>
 
 #include "brick/memory/ptr_util.h"
 #include "brick/memory/shared_memory_tracker.h"
 #include "brick/process/process_metrics.h"
+#include "brick/strings/string_util.h"
 #include "brick/strings/stringprintf.h"
 #include "brick/trace_event/memory_infra_background_whitelist.h"
 #include "brick/trace_event/trace_event_argument.h"
@@ -318,6 +320,15 @@ void ProcessMemoryDump::DumpHeapUsage(
         metrics_by_context,
     base::trace_event::TraceEventMemoryOverhead& overhead,
     const char* allocator_name) {
+  // The allocation sites are only wanted in detailed dumps, which aren't
+  // periodic enough for the cost of deduplicating them to matter.
+  if (dump_args_.level_of_detail == MemoryDumpLevelOfDetail::DETAILED &&
+      !metrics_by_context.empty()) {
+    DCHECK_EQ(0u, heap_dumps_.count(allocator_name));
+    heap_dumps_[allocator_name] =
+        std::make_unique<HeapDump>(metrics_by_context);
+  }
+
   std::string base_name = base::StringPrintf("tracing/heap_profiler_%s",
                                              allocator_name);
   overhead.DumpInto(base_name.c_str(), this);
@@ -351,19 +362,80 @@ void ProcessMemoryDump::SetAllEdgesForSerialization(
 void ProcessMemoryDump::Clear() {
   allocator_dumps_.clear();
   allocator_dumps_edges_.clear();
+  heap_dumps_.clear();
 }
 
 void ProcessMemoryDump::TakeAllDumpsFrom(ProcessMemoryDump* other) {
   // Moves the ownership of all MemoryAllocatorDump(s) contained in |other|
   // into this ProcessMemoryDump, checking for duplicates.
-  for (auto& it : other->allocator_dumps_)
+  for (auto& it : other->allocator_dumps_) {
+    // Shared global dumps can be created by several providers, which might
+    // have dumped into different ProcessMemoryDumps, like the providers of
+    // incremental dumps do. Their attributes are merged, as if the providers
+    // had shared the dump through CreateSharedGlobalAllocatorDump().
+    auto existing = allocator_dumps_.find(it.first);
+    if (existing != allocator_dumps_.end() &&
+        StartsWith(it.first, "global/", CompareCase::SENSITIVE)) {
+      existing->second->MergeSharedGlobalDump(it.second.get());
+      continue;
+    }
     AddAllocatorDumpInternal(std::move(it.second));
+  }
   other->allocator_dumps_.clear();
 
   // Move all the edges.
   allocator_dumps_edges_.insert(other->allocator_dumps_edges_.begin(),
                                 other->allocator_dumps_edges_.end());
   other->allocator_dumps_edges_.clear();
+
+  for (auto& it : other->heap_dumps_) {
+    DCHECK_EQ(0u, heap_dumps_.count(it.first));
+    heap_dumps_.insert(std::make_pair(it.first, std::move(it.second)));
+  }
+  other->heap_dumps_.clear();
+}
+
+void ProcessMemoryDump::MakeIncremental(IncrementalBaseline* baseline) {
+  // The unchanged dumps which edges refer to are kept, without attributes, so
+  // that the edges don't dangle.
+  std::set<MemoryAllocatorDumpGuid> guids_with_edges;
+  for (const auto& it : allocator_dumps_edges_) {
+    guids_with_edges.insert(it.second.source);
+    guids_with_edges.insert(it.second.target);
+  }
+
+  IncrementalBaseline new_baseline;
+  for (auto it = allocator_dumps_.begin(); it != allocator_dumps_.end();) {
+    MemoryAllocatorDump* mad = it->second.get();
+    IncrementalBaselineEntry& entry = new_baseline[it->first];
+    entry.guid = mad->guid();
+    for (const MemoryAllocatorDump::Entry& mad_entry : mad->entries()) {
+      if (mad_entry.entry_type == MemoryAllocatorDump::Entry::kUint64)
+        entry.scalars.emplace_back(mad_entry.name, mad_entry.value_uint64);
+    }
+
+    auto previous = baseline->find(it->first);
+    if (previous != baseline->end()) {
+      mad->RemoveUnchangedScalars(previous->second.scalars);
+      if (mad->entries().empty() &&
+          mad->flags() == MemoryAllocatorDump::Flags::DEFAULT &&
+          !guids_with_edges.count(mad->guid())) {
+        it = allocator_dumps_.erase(it);
+        continue;
+      }
+    }
+    ++it;
+  }
+
+  for (const auto& it : *baseline) {
+    if (new_baseline.count(it.first))
+      continue;
+    // The guid of the dump isn't always derived from its name, e.g. for the
+    // shared global dumps, so the REMOVED dump gets the one it had.
+    MemoryAllocatorDump* mad = CreateAllocatorDump(it.first, it.second.guid);
+    mad->set_flags(MemoryAllocatorDump::Flags::REMOVED);
+  }
+  baseline->swap(new_baseline);
 }
 
 void ProcessMemoryDump::SerializeAllocatorDumpsInto(TracedValue* value) const {
@@ -387,6 +459,19 @@ void ProcessMemoryDump::SerializeAllocatorDumpsInto(TracedValue* value) const {
   value->EndArray();
 }
 
+void ProcessMemoryDump::SerializeHeapProfilerDumpsInto(
+    TracedValue* value) const {
+  if (heap_dumps_.empty())
+    return;
+  value->BeginDictionary("heaps");
+  for (const auto& name_and_dump : heap_dumps_) {
+    value->BeginDictionaryWithCopiedName(name_and_dump.first);
+    name_and_dump.second->AsValueInto(value);
+    value->EndDictionary();
+  }
+  value->EndDictionary();  // "heaps": { ... }
+}
+
 void ProcessMemoryDump::AddOwnershipEdge(const MemoryAllocatorDumpGuid& source,
                                          const MemoryAllocatorDumpGuid& target,
                                          int importance) {
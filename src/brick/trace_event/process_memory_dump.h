@@ -15,6 +15,7 @@
 #include "brick/macros.h"
 #include "brick/memory/ref_counted.h"
 #include "brick/trace_event/heap_profiler_allocation_context.h"
+#include "brick/trace_event/heap_profiler_heap_dump.h"
 #include "brick/trace_event/memory_allocator_dump.h"
 #include "brick/trace_event/memory_allocator_dump_guid.h"
 #include "brick/trace_event/memory_dump_request_args.h"
@@ -58,6 +59,19 @@ class BRICK_EXPORT ProcessMemoryDump {
   using AllocatorDumpEdgesMap =
       std::map<MemoryAllocatorDumpGuid, MemoryAllocatorDumpEdge>;
 
+  // Maps allocator names to the heap dumps of their allocation sites.
+  using HeapDumpsMap = std::map<std::string, std::unique_ptr<HeapDump>>;
+
+  // The guid and scalars which an incremental dump had for an allocator dump.
+  struct IncrementalBaselineEntry {
+    MemoryAllocatorDumpGuid guid;
+    MemoryAllocatorDump::Scalars scalars;
+  };
+
+  // Maps allocator dumps absolute names to what an incremental dump had for
+  // them. See MakeIncremental().
+  using IncrementalBaseline = std::map<std::string, IncrementalBaselineEntry>;
+
 #if defined(COUNT_RESIDENT_BYTES_SUPPORTED)
   // Returns the number of bytes in a kernel memory page. Some platforms may
   // have a different value for kernel page sizes from user page sizes. It is
@@ -149,7 +163,9 @@ class BRICK_EXPORT ProcessMemoryDump {
   std::vector<MemoryAllocatorDumpEdge> GetAllEdgesForSerialization() const;
   void SetAllEdgesForSerialization(const std::vector<MemoryAllocatorDumpEdge>&);
 
-  // Dumps heap usage with |allocator_name|.
+  // Dumps heap usage with |allocator_name|: the allocation sites of
+  // |metrics_by_context| go to a HeapDump, in detailed dumps only, and
+  // |overhead| to a "tracing/heap_profiler_" allocator dump.
   void DumpHeapUsage(
       const std::unordered_map<base::trace_event::AllocationContext,
                                base::trace_event::AllocationMetrics>&
@@ -202,6 +218,9 @@ class BRICK_EXPORT ProcessMemoryDump {
     return allocator_dumps_edges_;
   }
 
+  // Returns the heap dumps added by DumpHeapUsage().
+  const HeapDumpsMap& heap_dumps() const { return heap_dumps_; }
+
   // Utility method to add a suballocation relationship with the following
   // semantics: |source| is suballocated from |target_node_name|.
   // This creates a child node of |target_node_name| and adds an ownership edge
@@ -214,18 +233,31 @@ class BRICK_EXPORT ProcessMemoryDump {
   // ProcessMemoryDump can be safely reused as if it was new once this returns.
   void Clear();
 
-  // Merges all MemoryAllocatorDump(s) contained in |other| inside this
-  // ProcessMemoryDump, transferring their ownership to this instance.
+  // Merges all MemoryAllocatorDump(s) and heap dumps contained in |other|
+  // inside this ProcessMemoryDump, transferring their ownership to this
+  // instance.
   // |other| will be an empty ProcessMemoryDump after this method returns.
   // This is to allow dump providers to pre-populate ProcessMemoryDump instances
   // and later move their contents into the ProcessMemoryDump passed as argument
   // of the MemoryDumpProvider::OnMemoryDump(ProcessMemoryDump*) callback.
   void TakeAllDumpsFrom(ProcessMemoryDump* other);
 
+  // Turns this dump, filled by a single MemoryDumpProvider, into the
+  // difference from the previous incremental dump of the same provider, whose
+  // guids and scalars are in |baseline|, then replaces |baseline| with those of
+  // this dump. The scalars which didn't change are removed, as are the
+  // allocator dumps which are left with no attribute nor flag, unless an edge
+  // refers to them. The allocator dumps of |baseline| which this dump lacks
+  // are added back, with their guid and the REMOVED flag. Edges and heap dumps are kept as they are.
+  void MakeIncremental(IncrementalBaseline* baseline);
+
   // Populate the traced value with information about the memory allocator
   // dumps.
   void SerializeAllocatorDumpsInto(TracedValue* value) const;
 
+  // Populate the traced value with the heap dumps, if any.
+  void SerializeHeapProfilerDumpsInto(TracedValue* value) const;
+
   const MemoryDumpArgs& dump_args() const { return dump_args_; }
 
  private:
@@ -263,6 +295,8 @@ class BRICK_EXPORT ProcessMemoryDump {
   // Keeps track of relationships between MemoryAllocatorDump(s).
   AllocatorDumpEdgesMap allocator_dumps_edges_;
 
+  HeapDumpsMap heap_dumps_;
+
   // Level of detail of the current dump.
   MemoryDumpArgs dump_args_;
 
@@ -184,6 +184,7 @@ TEST(ProcessMemoryDumpTest, TakeAllDumpsFrom) {
   // Make sure that pmd2 is empty but still usable after it has been emptied.
   ASSERT_TRUE(pmd2->allocator_dumps().empty());
   ASSERT_TRUE(pmd2->allocator_dumps_edges().empty());
+  ASSERT_TRUE(pmd2->heap_dumps().empty());
   pmd2->CreateAllocatorDump("pmd2/this_mad_stays_with_pmd2");
   ASSERT_EQ(1u, pmd2->allocator_dumps().size());
   ASSERT_EQ(1u, pmd2->allocator_dumps().count("pmd2/this_mad_stays_with_pmd2"));
@@ -207,14 +208,152 @@ TEST(ProcessMemoryDumpTest, TakeAllDumpsFrom) {
   ASSERT_EQ(shared_mad1, pmd1->GetSharedGlobalAllocatorDump(shared_mad_guid1));
   ASSERT_EQ(shared_mad2, pmd1->GetSharedGlobalAllocatorDump(shared_mad_guid2));
   ASSERT_TRUE(MemoryAllocatorDump::Flags::WEAK & shared_mad2->flags());
+  ASSERT_EQ(4u, pmd1->heap_dumps().size());
+  ASSERT_EQ(1u, pmd1->heap_dumps().count("pmd2/heap_dump1"));
 
   // Check that calling serialization routines doesn't cause a crash.
   traced_value.reset(new TracedValue);
   pmd1->SerializeAllocatorDumpsInto(traced_value.get());
+  pmd1->SerializeHeapProfilerDumpsInto(traced_value.get());
 
   pmd1.reset();
 }
 
+TEST(ProcessMemoryDumpTest, TakeAllDumpsFromMergesSharedGlobalDumps) {
+  MemoryAllocatorDumpGuid shared_mad_guid(1);
+  ProcessMemoryDump pmd1(kDetailedDumpArgs);
+  pmd1.CreateWeakSharedGlobalAllocatorDump(shared_mad_guid)
+      ->AddScalar(MemoryAllocatorDump::kNameSize,
+                  MemoryAllocatorDump::kUnitsBytes, 100);
+  ProcessMemoryDump pmd2(kDetailedDumpArgs);
+  MemoryAllocatorDump* mad2 =
+      pmd2.CreateSharedGlobalAllocatorDump(shared_mad_guid);
+  mad2->AddScalar(MemoryAllocatorDump::kNameSize,
+                  MemoryAllocatorDump::kUnitsBytes, 300);
+  mad2->AddScalar("object_count", MemoryAllocatorDump::kUnitsObjects, 3);
+  ProcessMemoryDump pmd3(kDetailedDumpArgs);
+  pmd3.CreateWeakSharedGlobalAllocatorDump(shared_mad_guid)
+      ->AddScalar(MemoryAllocatorDump::kNameSize,
+                  MemoryAllocatorDump::kUnitsBytes, 200);
+
+  // The attributes are merged, keeping the largest size. The dump isn't weak
+  // since one of the providers didn't make it weak.
+  pmd1.TakeAllDumpsFrom(&pmd2);
+  pmd1.TakeAllDumpsFrom(&pmd3);
+  ASSERT_EQ(1u, pmd1.allocator_dumps().size());
+  const MemoryAllocatorDump* mad =
+      pmd1.GetSharedGlobalAllocatorDump(shared_mad_guid);
+  EXPECT_FALSE(MemoryAllocatorDump::Flags::WEAK & mad->flags());
+  EXPECT_EQ(300u, mad->GetSizeInternal());
+  ASSERT_EQ(2u, mad->entries().size());
+  EXPECT_STREQ("object_count", mad->entries()[1].name);
+  EXPECT_EQ(3u, mad->entries()[1].value_uint64);
+}
+
+TEST(ProcessMemoryDumpTest, MakeIncremental) {
+  ProcessMemoryDump::IncrementalBaseline baseline;
+  ProcessMemoryDump pmd1(kDetailedDumpArgs);
+  pmd1.CreateAllocatorDump("mad1")->AddScalar("attr", "units", 1);
+  pmd1.CreateAllocatorDump("mad2")->AddScalar("attr", "units", 2);
+  pmd1.MakeIncremental(&baseline);
+  EXPECT_EQ(2u, pmd1.allocator_dumps().size());
+  EXPECT_EQ(2u, baseline.size());
+
+  ProcessMemoryDump pmd2(kDetailedDumpArgs);
+  MemoryAllocatorDump* mad1 = pmd2.CreateAllocatorDump("mad1");
+  mad1->AddScalar("attr", "units", 1);
+  mad1->AddScalar("other_attr", "units", 3);
+  pmd2.CreateAllocatorDump("mad3")->AddScalar("attr", "units", 4);
+  pmd2.MakeIncremental(&baseline);
+  ASSERT_EQ(3u, pmd2.allocator_dumps().size());
+  ASSERT_EQ(1u, mad1->entries().size());
+  EXPECT_STREQ("other_attr", mad1->entries()[0].name);
+  EXPECT_EQ(MemoryAllocatorDump::Flags::REMOVED,
+            pmd2.GetAllocatorDump("mad2")->flags());
+  EXPECT_EQ(1u, pmd2.GetAllocatorDump("mad3")->entries().size());
+  EXPECT_EQ(2u, baseline.size());
+  EXPECT_EQ(2u, baseline["mad1"].scalars.size());
+
+  // Unchanged dumps are kept, without attributes, while an edge refers to
+  // them.
+  ProcessMemoryDump pmd3(kDetailedDumpArgs);
+  mad1 = pmd3.CreateAllocatorDump("mad1");
+  mad1->AddScalar("attr", "units", 1);
+  mad1->AddScalar("other_attr", "units", 3);
+  MemoryAllocatorDump* mad3 = pmd3.CreateAllocatorDump("mad3");
+  mad3->AddScalar("attr", "units", 4);
+  pmd3.AddOwnershipEdge(mad3->guid(), mad1->guid());
+  pmd3.MakeIncremental(&baseline);
+  ASSERT_EQ(2u, pmd3.allocator_dumps().size());
+  EXPECT_TRUE(mad1->entries().empty());
+  EXPECT_TRUE(mad3->entries().empty());
+  EXPECT_EQ(1u, pmd3.allocator_dumps_edges().size());
+}
+
+// The REMOVED dumps keep the guid of the dumps they retire, even when it isn't
+// derived from their name.
+TEST(ProcessMemoryDumpTest, MakeIncrementalRemovesSharedGlobalDump) {
+  ProcessMemoryDump::IncrementalBaseline baseline;
+  const MemoryAllocatorDumpGuid shared_guid(0xabcd);
+  ProcessMemoryDump pmd1(kDetailedDumpArgs);
+  MemoryAllocatorDump* shared_mad =
+      pmd1.CreateSharedGlobalAllocatorDump(shared_guid);
+  shared_mad->AddScalar("attr", "units", 1);
+  const std::string shared_name = shared_mad->absolute_name();
+  pmd1.CreateAllocatorDump("mad1", MemoryAllocatorDumpGuid(0x1234))
+      ->AddScalar("attr", "units", 2);
+  pmd1.MakeIncremental(&baseline);
+
+  ProcessMemoryDump pmd2(kDetailedDumpArgs);
+  pmd2.MakeIncremental(&baseline);
+  ASSERT_EQ(2u, pmd2.allocator_dumps().size());
+  shared_mad = pmd2.GetSharedGlobalAllocatorDump(shared_guid);
+  ASSERT_TRUE(shared_mad);
+  EXPECT_EQ(shared_name, shared_mad->absolute_name());
+  EXPECT_EQ(shared_guid, shared_mad->guid());
+  EXPECT_EQ(MemoryAllocatorDump::Flags::REMOVED, shared_mad->flags());
+  MemoryAllocatorDump* mad1 = pmd2.GetAllocatorDump("mad1");
+  ASSERT_TRUE(mad1);
+  EXPECT_EQ(MemoryAllocatorDumpGuid(0x1234), mad1->guid());
+  EXPECT_EQ(MemoryAllocatorDump::Flags::REMOVED, mad1->flags());
+  EXPECT_TRUE(baseline.empty());
+}
+
+TEST(ProcessMemoryDumpTest, DumpHeapUsage) {
+  std::unordered_map<AllocationContext, AllocationMetrics> metrics_by_context;
+  AllocationContext context;
+  context.backtrace.frames[0] = StackFrame::FromTraceEventName("MessageLoop");
+  context.backtrace.frame_count = 1;
+  metrics_by_context[context] = {4096, 4};
+  metrics_by_context[AllocationContext()] = {1024, 1};
+  TraceEventMemoryOverhead overhead;
+
+  // Light dumps don't get the allocation sites.
+  MemoryDumpArgs light_args = {MemoryDumpLevelOfDetail::LIGHT};
+  ProcessMemoryDump light_pmd(light_args);
+  light_pmd.DumpHeapUsage(metrics_by_context, overhead, "malloc");
+  EXPECT_TRUE(light_pmd.heap_dumps().empty());
+
+  ProcessMemoryDump pmd(kDetailedDumpArgs);
+  pmd.DumpHeapUsage(metrics_by_context, overhead, "malloc");
+  ASSERT_EQ(1u, pmd.heap_dumps().count("malloc"));
+  const HeapDump& heap_dump = *pmd.heap_dumps().at("malloc");
+  ASSERT_EQ(2u, heap_dump.entries().size());
+  EXPECT_EQ(4096u, heap_dump.entries()[0].size);
+  EXPECT_EQ(4u, heap_dump.entries()[0].count);
+  // The empty backtrace has no node.
+  EXPECT_EQ(-1, heap_dump.entries()[1].node_id);
+
+  std::unique_ptr<TracedValue> traced_value(new TracedValue);
+  pmd.SerializeHeapProfilerDumpsInto(traced_value.get());
+  std::string json;
+  traced_value->AppendAsTraceFormat(&json);
+  EXPECT_NE(std::string::npos, json.find("\"heaps\":{\"malloc\":{"));
+
+  pmd.Clear();
+  EXPECT_TRUE(pmd.heap_dumps().empty());
+}
+
 TEST(ProcessMemoryDumpTest, OverrideOwnershipEdge) {
   std::unique_ptr<ProcessMemoryDump> pmd(
       new ProcessMemoryDump(kDetailedDumpArgs));
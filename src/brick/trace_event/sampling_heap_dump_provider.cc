@@ -0,0 +1,82 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/sampling_heap_dump_provider.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "brick/sampling_heap_profiler/sampling_heap_profiler.h"
+#include "brick/trace_event/heap_profiler_allocation_context.h"
+#include "brick/trace_event/process_memory_dump.h"
+#include "brick/trace_event/trace_event_memory_overhead.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+// Fills |backtrace| with the frames of |stack|, which starts with the
+// innermost one. Like AllocationContextTracker does for native stacks, the
+// frames furthest from main() are kept if there are too many.
+void FillBacktrace(const std::vector<void*>& stack, Backtrace* backtrace) {
+  StackFrame* frame = backtrace->frames;
+  size_t depth = stack.size();
+  if (depth > Backtrace::kMaxFrameCount) {
+    depth = Backtrace::kMaxFrameCount - 1;
+    *frame++ = StackFrame::FromTraceEventName("<truncated>");
+  }
+  for (size_t i = depth; i > 0; --i)
+    *frame++ = StackFrame::FromProgramCounter(stack[i - 1]);
+  backtrace->frame_count = frame - backtrace->frames;
+}
+
+}  // namespace
+
+// static
+const char SamplingHeapDumpProvider::kAllocatorName[] = "sampled_heap";
+
+// static
+SamplingHeapDumpProvider* SamplingHeapDumpProvider::GetInstance() {
+  return Singleton<SamplingHeapDumpProvider,
+                   LeakySingletonTraits<SamplingHeapDumpProvider>>::get();
+}
+
+SamplingHeapDumpProvider::SamplingHeapDumpProvider() = default;
+SamplingHeapDumpProvider::~SamplingHeapDumpProvider() = default;
+
+bool SamplingHeapDumpProvider::OnMemoryDump(const MemoryDumpArgs& args,
+                                            ProcessMemoryDump* pmd) {
+  if (args.level_of_detail != MemoryDumpLevelOfDetail::DETAILED)
+    return true;
+
+  std::vector<SamplingHeapProfiler::Sample> samples =
+      SamplingHeapProfiler::GetInstance()->GetSamples(0);
+  if (samples.empty())
+    return true;
+
+  std::unordered_map<AllocationContext, AllocationMetrics> metrics_by_context;
+  for (const SamplingHeapProfiler::Sample& sample : samples) {
+    AllocationContext context;
+    FillBacktrace(sample.stack, &context.backtrace);
+    context.type_name = sample.type_name;
+    AllocationMetrics& metrics = metrics_by_context[context];
+    metrics.size += sample.total;
+    // A sample stands for |total| bytes of allocations of its size.
+    if (sample.size)
+      metrics.count += std::max<size_t>(1, sample.total / sample.size);
+    else
+      ++metrics.count;
+  }
+
+  TraceEventMemoryOverhead overhead;
+  pmd->DumpHeapUsage(metrics_by_context, overhead, kAllocatorName);
+  return true;
+}
+
+}  // namespace trace_event
+}  // namespace base
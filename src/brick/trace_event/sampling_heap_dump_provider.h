@@ -0,0 +1,47 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TRACE_EVENT_SAMPLING_HEAP_DUMP_PROVIDER_H_
+#define BRICK_TRACE_EVENT_SAMPLING_HEAP_DUMP_PROVIDER_H_
+
+#include "brick/macros.h"
+#include "brick/memory/singleton.h"
+#include "brick/trace_event/memory_dump_provider.h"
+
+namespace base {
+namespace trace_event {
+
+// Dump provider which adds the allocation sites of the live samples of the
+// SamplingHeapProfiler to detailed dumps, as a HeapDump: the sampled stacks
+// and the task contexts of the AllocationContextTracker, as type names, are
+// deduplicated, and the estimated count and size of the allocations of each
+// site are summed. Light and background dumps are left alone.
+//
+// It isn't registered by default: register it with the MemoryDumpManager
+// once the SamplingHeapProfiler is started.
+class BRICK_EXPORT SamplingHeapDumpProvider : public MemoryDumpProvider {
+ public:
+  // Name of the heap dump, and of the "tracing/heap_profiler_" allocator dump
+  // with the overhead of the heap dump.
+  static const char kAllocatorName[];
+
+  static SamplingHeapDumpProvider* GetInstance();
+
+  // MemoryDumpProvider implementation.
+  bool OnMemoryDump(const MemoryDumpArgs& args,
+                    ProcessMemoryDump* pmd) override;
+
+ private:
+  friend struct DefaultSingletonTraits<SamplingHeapDumpProvider>;
+
+  SamplingHeapDumpProvider();
+  ~SamplingHeapDumpProvider() override;
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingHeapDumpProvider);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BRICK_TRACE_EVENT_SAMPLING_HEAP_DUMP_PROVIDER_H_
@@ -0,0 +1,121 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/sampling_heap_dump_provider.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "brick/allocator/allocator_shim.h"
+#include "brick/sampling_heap_profiler/sampling_heap_profiler.h"
+#include "brick/trace_event/heap_profiler_allocation_context_tracker.h"
+#include "brick/trace_event/heap_profiler_heap_dump.h"
+#include "brick/trace_event/process_memory_dump.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+const char kTaskContext[] = "SamplingHeapDumpProviderTest";
+const size_t kSamplingInterval = 1024;
+const size_t kAllocationSize = 4099;
+const int kNumAllocations = 20;
+
+class SamplingHeapDumpProviderTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+#if defined(OS_MACOSX)
+    allocator::InitializeAllocatorShim();
+#endif
+    SamplingHeapProfiler::InitTLSSlot();
+    profiler_ = SamplingHeapProfiler::GetInstance();
+    profiler_->SuppressRandomnessForTest(true);
+    // Every allocation of at least the interval is sampled.
+    profiler_->SetSamplingInterval(kSamplingInterval);
+    profiler_->Start();
+    // Growing the vector while allocating could add a sample from another
+    // site.
+    allocations_.reserve(kNumAllocations);
+  }
+
+  void TearDown() override {
+    profiler_->Stop();
+    AllocationContextTracker::SetCaptureMode(
+        AllocationContextTracker::CaptureMode::DISABLED);
+  }
+
+  // Allocates |kNumAllocations| blocks from the same call site.
+  void Allocate() {
+    for (int i = 0; i < kNumAllocations; ++i)
+      allocations_.push_back(malloc(kAllocationSize));
+  }
+
+  void Free() {
+    for (void* allocation : allocations_)
+      free(allocation);
+    allocations_.clear();
+  }
+
+ private:
+  SamplingHeapProfiler* profiler_ = nullptr;
+  std::vector<void*> allocations_;
+};
+
+}  // namespace
+
+TEST_F(SamplingHeapDumpProviderTest, DumpsAllocationSites) {
+  AllocationContextTracker::SetCaptureMode(
+      AllocationContextTracker::CaptureMode::PSEUDO_STACK);
+  AllocationContextTracker* tracker =
+      AllocationContextTracker::GetInstanceForCurrentThread();
+  tracker->PushCurrentTaskContext(kTaskContext);
+  Allocate();
+  tracker->PopCurrentTaskContext(kTaskContext);
+
+  MemoryDumpArgs light_args = {MemoryDumpLevelOfDetail::LIGHT};
+  ProcessMemoryDump light_pmd(light_args);
+  ASSERT_TRUE(SamplingHeapDumpProvider::GetInstance()->OnMemoryDump(
+      light_args, &light_pmd));
+  EXPECT_TRUE(light_pmd.heap_dumps().empty());
+
+  MemoryDumpArgs detailed_args = {MemoryDumpLevelOfDetail::DETAILED};
+  ProcessMemoryDump pmd(detailed_args);
+  ASSERT_TRUE(SamplingHeapDumpProvider::GetInstance()->OnMemoryDump(
+      detailed_args, &pmd));
+  Free();
+  ASSERT_EQ(1u,
+            pmd.heap_dumps().count(SamplingHeapDumpProvider::kAllocatorName));
+  const HeapDump& heap_dump =
+      *pmd.heap_dumps().at(SamplingHeapDumpProvider::kAllocatorName);
+
+  // All the allocations come from the same site, which has the task context
+  // as type. Each sample stands for the size of its allocation, rounded to a
+  // multiple of the interval.
+  const std::vector<std::string>& strings = heap_dump.strings();
+  auto type_it = std::find(strings.begin(), strings.end(), kTaskContext);
+  ASSERT_NE(strings.end(), type_it);
+  const int type_name_id = static_cast<int>(type_it - strings.begin());
+  size_t count = 0;
+  size_t size = 0;
+  for (const HeapDump::Entry& entry : heap_dump.entries()) {
+    if (heap_dump.types()[entry.type_id] != type_name_id)
+      continue;
+    EXPECT_EQ(0u, count);
+    EXPECT_NE(-1, entry.node_id);
+    count = entry.count;
+    size = entry.size;
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumAllocations), count);
+  EXPECT_GE(size, kNumAllocations * (kAllocationSize - kSamplingInterval));
+  EXPECT_LE(size, kNumAllocations * (kAllocationSize + kSamplingInterval));
+}
+
+}  // namespace trace_event
+}  // namespace base
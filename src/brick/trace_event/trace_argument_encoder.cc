@@ -0,0 +1,278 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/trace_argument_encoder.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "brick/json/string_escape.h"
+#include "brick/logging.h"
+#include "brick/trace_event/trace_event.h"
+#include "brick/trace_event/trace_event_impl.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+// The block starts with its total size, as a uint32_t. It is followed by the
+// items of the outermost dictionary. Each item is a type tag, then the name
+// pointer if it's in a dictionary, then the value:
+// - kTypeBool: 1 byte;
+// - kTypeInt: int64_t;
+// - kTypeDouble: double;
+// - kTypeString: uint32_t length, then the characters;
+// - kTypeStartDict, kTypeStartArray: the items, then kTypeEndDict or
+//   kTypeEndArray, which have no name.
+// Nothing is aligned; the fields are read with memcpy().
+const char kTypeStartDict = '{';
+const char kTypeEndDict = '}';
+const char kTypeStartArray = '[';
+const char kTypeEndArray = ']';
+const char kTypeBool = 'b';
+const char kTypeInt = 'i';
+const char kTypeDouble = 'd';
+const char kTypeString = 's';
+
+template <typename T>
+T ReadField(const char** ptr) {
+  T value;
+  memcpy(&value, *ptr, sizeof(value));
+  *ptr += sizeof(value);
+  return value;
+}
+
+}  // namespace
+
+TraceArgumentEncoder::TraceArgumentEncoder()
+    : buffer_(inline_buffer_),
+      size_(sizeof(uint32_t)),
+      capacity_(kInlineCapacity),
+      depth_(0),
+      array_bits_(0) {
+  const uint32_t size = static_cast<uint32_t>(size_);
+  memcpy(buffer_, &size, sizeof(size));
+}
+
+TraceArgumentEncoder::~TraceArgumentEncoder() = default;
+
+void TraceArgumentEncoder::SetInteger(const char* name, int64_t value) {
+  AppendTag(kTypeInt);
+  AppendName(name);
+  memcpy(Append(sizeof(value)), &value, sizeof(value));
+}
+
+void TraceArgumentEncoder::SetDouble(const char* name, double value) {
+  AppendTag(kTypeDouble);
+  AppendName(name);
+  memcpy(Append(sizeof(value)), &value, sizeof(value));
+}
+
+void TraceArgumentEncoder::SetBoolean(const char* name, bool value) {
+  AppendTag(kTypeBool);
+  AppendName(name);
+  *Append(1) = value ? 1 : 0;
+}
+
+void TraceArgumentEncoder::SetString(const char* name, StringPiece value) {
+  AppendTag(kTypeString);
+  AppendName(name);
+  AppendStringValue(value);
+}
+
+void TraceArgumentEncoder::BeginDictionary(const char* name) {
+  AppendTag(kTypeStartDict);
+  AppendName(name);
+  PushContainer(false);
+}
+
+void TraceArgumentEncoder::BeginArray(const char* name) {
+  AppendTag(kTypeStartArray);
+  AppendName(name);
+  PushContainer(true);
+}
+
+void TraceArgumentEncoder::AppendInteger(int64_t value) {
+  DCHECK(in_array());
+  AppendTag(kTypeInt);
+  memcpy(Append(sizeof(value)), &value, sizeof(value));
+}
+
+void TraceArgumentEncoder::AppendDouble(double value) {
+  DCHECK(in_array());
+  AppendTag(kTypeDouble);
+  memcpy(Append(sizeof(value)), &value, sizeof(value));
+}
+
+void TraceArgumentEncoder::AppendBoolean(bool value) {
+  DCHECK(in_array());
+  AppendTag(kTypeBool);
+  *Append(1) = value ? 1 : 0;
+}
+
+void TraceArgumentEncoder::AppendString(StringPiece value) {
+  DCHECK(in_array());
+  AppendTag(kTypeString);
+  AppendStringValue(value);
+}
+
+void TraceArgumentEncoder::BeginDictionary() {
+  DCHECK(in_array());
+  AppendTag(kTypeStartDict);
+  PushContainer(false);
+}
+
+void TraceArgumentEncoder::BeginArray() {
+  DCHECK(in_array());
+  AppendTag(kTypeStartArray);
+  PushContainer(true);
+}
+
+void TraceArgumentEncoder::EndDictionary() {
+  PopContainer(false);
+  AppendTag(kTypeEndDict);
+}
+
+void TraceArgumentEncoder::EndArray() {
+  PopContainer(true);
+  AppendTag(kTypeEndArray);
+}
+
+const void* TraceArgumentEncoder::encoded() const {
+  DCHECK_EQ(0u, depth_);
+  return buffer_;
+}
+
+// static
+size_t TraceArgumentEncoder::EncodedSize(const void* encoded) {
+  uint32_t size;
+  memcpy(&size, encoded, sizeof(size));
+  return size;
+}
+
+// static
+void TraceArgumentEncoder::AppendAsJSON(const void* encoded,
+                                        std::string* out) {
+  const char* ptr = static_cast<const char*>(encoded);
+  const char* const end = ptr + EncodedSize(encoded);
+  ptr += sizeof(uint32_t);
+
+  // Bit |depth| tells whether the current container is an array, and whether
+  // it has an item already.
+  uint32_t depth = 0;
+  uint64_t array_bits = 0;
+  uint64_t comma_bits = 0;
+  out->append("{");
+  while (ptr < end) {
+    const char type = *ptr++;
+    if (type == kTypeEndDict || type == kTypeEndArray) {
+      DCHECK_GT(depth, 0u);
+      out->append(type == kTypeEndDict ? "}" : "]");
+      --depth;
+      continue;
+    }
+
+    const uint64_t depth_bit = uint64_t{1} << depth;
+    if (comma_bits & depth_bit)
+      out->append(",");
+    comma_bits |= depth_bit;
+    if (!(array_bits & depth_bit)) {
+      EscapeJSONString(ReadField<const char*>(&ptr), true, out);
+      out->append(":");
+    }
+
+    TraceEvent::TraceValue value;
+    switch (type) {
+      case kTypeStartDict:
+      case kTypeStartArray: {
+        out->append(type == kTypeStartDict ? "{" : "[");
+        ++depth;
+        const uint64_t inner_bit = uint64_t{1} << depth;
+        if (type == kTypeStartArray)
+          array_bits |= inner_bit;
+        else
+          array_bits &= ~inner_bit;
+        comma_bits &= ~inner_bit;
+        break;
+      }
+      case kTypeBool:
+        value.as_bool = ReadField<char>(&ptr) != 0;
+        TraceEvent::AppendValueAsJSON(TRACE_VALUE_TYPE_BOOL, value, out);
+        break;
+      case kTypeInt:
+        value.as_int = ReadField<int64_t>(&ptr);
+        TraceEvent::AppendValueAsJSON(TRACE_VALUE_TYPE_INT, value, out);
+        break;
+      case kTypeDouble:
+        value.as_double = ReadField<double>(&ptr);
+        TraceEvent::AppendValueAsJSON(TRACE_VALUE_TYPE_DOUBLE, value, out);
+        break;
+      case kTypeString: {
+        const uint32_t length = ReadField<uint32_t>(&ptr);
+        EscapeJSONString(StringPiece(ptr, length), true, out);
+        ptr += length;
+        break;
+      }
+      default:
+        NOTREACHED();
+        return;
+    }
+  }
+  DCHECK_EQ(0u, depth);
+  out->append("}");
+}
+
+char* TraceArgumentEncoder::Append(size_t size) {
+  if (size_ + size > capacity_) {
+    const size_t new_capacity = std::max(2 * capacity_, size_ + size);
+    std::unique_ptr<char[]> new_buffer(new char[new_capacity]);
+    memcpy(new_buffer.get(), buffer_, size_);
+    heap_buffer_ = std::move(new_buffer);
+    buffer_ = heap_buffer_.get();
+    capacity_ = new_capacity;
+  }
+  char* result = buffer_ + size_;
+  size_ += size;
+  const uint32_t encoded_size = static_cast<uint32_t>(size_);
+  memcpy(buffer_, &encoded_size, sizeof(encoded_size));
+  return result;
+}
+
+void TraceArgumentEncoder::AppendTag(char tag) {
+  *Append(1) = tag;
+}
+
+void TraceArgumentEncoder::AppendName(const char* name) {
+  DCHECK(!in_array());
+  DCHECK(name);
+  memcpy(Append(sizeof(name)), &name, sizeof(name));
+}
+
+void TraceArgumentEncoder::AppendStringValue(StringPiece value) {
+  const uint32_t length = static_cast<uint32_t>(value.size());
+  memcpy(Append(sizeof(length)), &length, sizeof(length));
+  if (length)
+    memcpy(Append(length), value.data(), length);
+}
+
+void TraceArgumentEncoder::PushContainer(bool is_array) {
+  CHECK_LT(depth_ + 1, kMaxNestingDepth);
+  ++depth_;
+  const uint64_t depth_bit = uint64_t{1} << depth_;
+  if (is_array)
+    array_bits_ |= depth_bit;
+  else
+    array_bits_ &= ~depth_bit;
+}
+
+void TraceArgumentEncoder::PopContainer(bool is_array) {
+  DCHECK_GT(depth_, 0u);
+  DCHECK_EQ(is_array, in_array());
+  --depth_;
+}
+
+}  // namespace trace_event
+}  // namespace base
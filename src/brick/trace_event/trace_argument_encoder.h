@@ -0,0 +1,106 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TRACE_EVENT_TRACE_ARGUMENT_ENCODER_H_
+#define BRICK_TRACE_EVENT_TRACE_ARGUMENT_ENCODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "brick/base_export.h"
+#include "brick/macros.h"
+#include "brick/strings/string_piece.h"
+
+namespace base {
+namespace trace_event {
+
+// Encodes a structured trace event argument, a dictionary of typed values,
+// into a compact flat buffer. Unlike a TracedValue, which is a heap allocated
+// ConvertableToTraceFormat, the encoded bytes are copied into the storage of
+// the TraceBufferChunk which receives the event, so recording an event costs
+// no allocation. Encoders up to |kInlineCapacity| bytes don't allocate either:
+//
+//   if (TRACE_EVENT_CATEGORY_GROUP_ENABLED ...) {
+//     TraceArgumentEncoder args;
+//     args.SetInteger("width", width);
+//     args.BeginArray("sizes");
+//     args.AppendInteger(size);
+//     args.EndArray();
+//     TRACE_EVENT_INSTANT1("cat", "name", TRACE_EVENT_SCOPE_THREAD, "args",
+//                          args);
+//   }
+//
+// The names must be long lived, like the names of the other arguments. The
+// string values are copied.
+class BRICK_EXPORT TraceArgumentEncoder {
+ public:
+  // Enough for a dozen fields without allocating.
+  static constexpr size_t kInlineCapacity = 256;
+  static constexpr size_t kMaxNestingDepth = 32;
+
+  TraceArgumentEncoder();
+  ~TraceArgumentEncoder();
+
+  void SetInteger(const char* name, int64_t value);
+  void SetDouble(const char* name, double value);
+  void SetBoolean(const char* name, bool value);
+  void SetString(const char* name, StringPiece value);
+  void BeginDictionary(const char* name);
+  void BeginArray(const char* name);
+
+  void AppendInteger(int64_t value);
+  void AppendDouble(double value);
+  void AppendBoolean(bool value);
+  void AppendString(StringPiece value);
+  void BeginDictionary();
+  void BeginArray();
+
+  void EndDictionary();
+  void EndArray();
+
+  // The encoded arguments, a self-describing block of EncodedSize() bytes
+  // that can be copied around. All the containers must have been ended.
+  const void* encoded() const;
+
+  // Whether the arguments outgrew the inline buffer. Exposed for testing.
+  bool is_inline() const { return !heap_buffer_; }
+
+  // Returns the size of the encoded block at |encoded|.
+  static size_t EncodedSize(const void* encoded);
+
+  // Appends the encoded block at |encoded| as a JSON dictionary.
+  static void AppendAsJSON(const void* encoded, std::string* out);
+
+ private:
+  // Returns room for |size| more bytes, and accounts them.
+  char* Append(size_t size);
+  void AppendTag(char tag);
+  void AppendName(const char* name);
+  void AppendStringValue(StringPiece value);
+  void PushContainer(bool is_array);
+  void PopContainer(bool is_array);
+  bool in_array() const { return (array_bits_ >> depth_) & 1; }
+
+  char* buffer_;
+  size_t size_;
+  size_t capacity_;
+  std::unique_ptr<char[]> heap_buffer_;
+
+  // Bit |depth_| of |array_bits_| tells whether the current container is an
+  // array. The outermost one, at depth 0, is a dictionary.
+  uint32_t depth_;
+  uint64_t array_bits_;
+
+  char inline_buffer_[kInlineCapacity];
+
+  DISALLOW_COPY_AND_ASSIGN(TraceArgumentEncoder);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BRICK_TRACE_EVENT_TRACE_ARGUMENT_ENCODER_H_
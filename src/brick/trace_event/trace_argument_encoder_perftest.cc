@@ -0,0 +1,100 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the cost of recording an event with no arguments, with two plain
+// arguments, and with a nested argument encoded by TraceArgumentEncoder or
+// built as a TracedValue.
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "brick/time/time.h"
+#include "brick/trace_event/trace_argument_encoder.h"
+#include "brick/trace_event/trace_event.h"
+#include "brick/trace_event/trace_event_argument.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+constexpr int kNumEvents = 100000;
+
+class TraceArgumentEncoderPerfTest : public testing::Test {
+ public:
+  void SetUp() override {
+    // Record continuously, so that the buffer never fills up.
+    TraceLog::GetInstance()->SetEnabled(
+        TraceConfig("perf", "record-continuously"), TraceLog::RECORDING_MODE);
+  }
+
+  void TearDown() override { TraceLog::GetInstance()->SetDisabled(); }
+
+  template <typename TraceFunction>
+  void RunTest(const std::string& trace, TraceFunction trace_function) {
+    const TimeTicks start = TimeTicks::Now();
+    for (int i = 0; i < kNumEvents; ++i)
+      trace_function(i);
+    const TimeDelta elapsed = TimeTicks::Now() - start;
+    perf_test::PrintResult("event_time", "", trace,
+                           elapsed.InNanoseconds() /
+                               static_cast<double>(kNumEvents),
+                           "ns/event", true);
+  }
+};
+
+}  // namespace
+
+TEST_F(TraceArgumentEncoderPerfTest, NoArguments) {
+  RunTest("no_args", [](int i) {
+    TRACE_EVENT_INSTANT0("perf", "event", TRACE_EVENT_SCOPE_THREAD);
+  });
+}
+
+TEST_F(TraceArgumentEncoderPerfTest, TwoArguments) {
+  RunTest("two_args", [](int i) {
+    TRACE_EVENT_INSTANT2("perf", "event", TRACE_EVENT_SCOPE_THREAD, "index", i,
+                         "name", "value");
+  });
+}
+
+TEST_F(TraceArgumentEncoderPerfTest, NestedArgumentEncoder) {
+  RunTest("nested_args_encoder", [](int i) {
+    TraceArgumentEncoder args;
+    args.SetInteger("index", i);
+    args.BeginDictionary("size");
+    args.SetInteger("width", 640);
+    args.SetInteger("height", 480);
+    args.EndDictionary();
+    args.BeginArray("values");
+    for (int j = 0; j < 4; ++j)
+      args.AppendInteger(j);
+    args.EndArray();
+    TRACE_EVENT_INSTANT1("perf", "event", TRACE_EVENT_SCOPE_THREAD, "args",
+                         args);
+  });
+}
+
+TEST_F(TraceArgumentEncoderPerfTest, NestedTracedValue) {
+  RunTest("nested_args_traced_value", [](int i) {
+    std::unique_ptr<TracedValue> args(new TracedValue());
+    args->SetInteger("index", i);
+    args->BeginDictionary("size");
+    args->SetInteger("width", 640);
+    args->SetInteger("height", 480);
+    args->EndDictionary();
+    args->BeginArray("values");
+    for (int j = 0; j < 4; ++j)
+      args->AppendInteger(j);
+    args->EndArray();
+    TRACE_EVENT_INSTANT1("perf", "event", TRACE_EVENT_SCOPE_THREAD, "args",
+                         std::move(args));
+  });
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,166 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/trace_argument_encoder.h"
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include "brick/trace_event/trace_buffer.h"
+#include "brick/trace_event/trace_event.h"
+#include "brick/trace_event/trace_event_argument.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+std::string ToJSON(const TraceArgumentEncoder& encoder) {
+  std::string json;
+  TraceArgumentEncoder::AppendAsJSON(encoder.encoded(), &json);
+  return json;
+}
+
+void InitializeEvent(TraceEvent* event,
+                     const TraceArgumentEncoder& encoder,
+                     unsigned int flags) {
+  const char* arg_names[] = {"args"};
+  unsigned char arg_types[1];
+  unsigned long long arg_values[1];
+  trace_event_internal::SetTraceValue(encoder, &arg_types[0], &arg_values[0]);
+  event->Initialize(0, TimeTicks(), ThreadTicks(), TRACE_EVENT_PHASE_INSTANT,
+                    TraceLog::GetCategoryGroupEnabled("cat"), "name",
+                    trace_event_internal::kGlobalScope,
+                    trace_event_internal::kNoId, trace_event_internal::kNoId,
+                    1, arg_names, arg_types, arg_values, nullptr, flags);
+}
+
+}  // namespace
+
+TEST(TraceArgumentEncoderTest, Empty) {
+  TraceArgumentEncoder encoder;
+  EXPECT_EQ("{}", ToJSON(encoder));
+}
+
+TEST(TraceArgumentEncoderTest, FlatDictionary) {
+  TraceArgumentEncoder encoder;
+  encoder.SetInteger("int", -42);
+  encoder.SetDouble("double", 0.5);
+  encoder.SetBoolean("bool", true);
+  encoder.SetString("string", "a \"quoted\" string");
+  EXPECT_EQ(
+      "{\"int\":-42,\"double\":0.5,\"bool\":true,"
+      "\"string\":\"a \\\"quoted\\\" string\"}",
+      ToJSON(encoder));
+  EXPECT_TRUE(encoder.is_inline());
+}
+
+TEST(TraceArgumentEncoderTest, Nested) {
+  TraceArgumentEncoder encoder;
+  encoder.BeginDictionary("dict");
+  encoder.SetInteger("a", 1);
+  encoder.BeginArray("list");
+  encoder.AppendInteger(2);
+  encoder.BeginDictionary();
+  encoder.EndDictionary();
+  encoder.BeginArray();
+  encoder.AppendString("x");
+  encoder.AppendBoolean(false);
+  encoder.EndArray();
+  encoder.AppendDouble(1.0);
+  encoder.EndArray();
+  encoder.EndDictionary();
+  encoder.BeginArray("empty");
+  encoder.EndArray();
+  EXPECT_EQ(
+      "{\"dict\":{\"a\":1,\"list\":[2,{},[\"x\",false],1.0]},\"empty\":[]}",
+      ToJSON(encoder));
+}
+
+TEST(TraceArgumentEncoderTest, MatchesTracedValue) {
+  TraceArgumentEncoder encoder;
+  TracedValue traced_value;
+  encoder.SetInteger("width", 100);
+  traced_value.SetInteger("width", 100);
+  encoder.BeginArray("sizes");
+  traced_value.BeginArray("sizes");
+  for (int i = 0; i < 3; ++i) {
+    encoder.AppendInteger(i);
+    traced_value.AppendInteger(i);
+  }
+  encoder.EndArray();
+  traced_value.EndArray();
+  encoder.SetString("label", "label");
+  traced_value.SetString("label", "label");
+  EXPECT_EQ(traced_value.ToString(), ToJSON(encoder));
+}
+
+TEST(TraceArgumentEncoderTest, GrowsPastInlineCapacity) {
+  TraceArgumentEncoder encoder;
+  const std::string long_string(TraceArgumentEncoder::kInlineCapacity, 'x');
+  encoder.SetString("first", "1");
+  EXPECT_TRUE(encoder.is_inline());
+  encoder.BeginArray("strings");
+  for (int i = 0; i < 4; ++i)
+    encoder.AppendString(long_string);
+  encoder.EndArray();
+  EXPECT_FALSE(encoder.is_inline());
+  EXPECT_GT(TraceArgumentEncoder::EncodedSize(encoder.encoded()),
+            4 * long_string.size());
+
+  const std::string json = ToJSON(encoder);
+  EXPECT_EQ(0u, json.find("{\"first\":\"1\",\"strings\":[\"" + long_string));
+  EXPECT_EQ('}', json.back());
+}
+
+// The encoded arguments are copied into the storage of the chunk.
+TEST(TraceArgumentEncoderTest, CopiedIntoChunk) {
+  std::unique_ptr<TraceBufferChunk> chunk(new TraceBufferChunk(1));
+  std::string expected_json;
+  size_t event_index;
+  {
+    TraceArgumentEncoder encoder;
+    encoder.BeginDictionary("nested");
+    encoder.SetString("name", "value");
+    encoder.EndDictionary();
+    expected_json = ToJSON(encoder);
+    InitializeEvent(chunk->AddTraceEvent(&event_index), encoder,
+                    TRACE_EVENT_FLAG_NONE);
+  }
+
+  const TraceEvent* event = chunk->GetEventAt(event_index);
+  EXPECT_EQ(TRACE_VALUE_TYPE_ENCODED, event->arg_type(0));
+  EXPECT_FALSE(event->parameter_copy_storage());
+  std::string json;
+  TraceEvent::AppendValueAsJSON(event->arg_type(0), event->arg_value(0),
+                                &json);
+  EXPECT_EQ(expected_json, json);
+}
+
+// Once the storage of the chunk is used up, the arguments are copied along
+// with the other parameters of the event.
+TEST(TraceArgumentEncoderTest, CopiedIntoEventWhenChunkIsFull) {
+  std::unique_ptr<TraceBufferChunk> chunk(new TraceBufferChunk(1));
+  TraceArgumentEncoder encoder;
+  const std::string long_string(TraceBufferChunk::kArgumentStorageSize, 'x');
+  encoder.SetString("long", long_string);
+  const std::string expected_json = ToJSON(encoder);
+
+  size_t event_index;
+  InitializeEvent(chunk->AddTraceEvent(&event_index), encoder,
+                  TRACE_EVENT_FLAG_COPY);
+  const TraceEvent* event = chunk->GetEventAt(event_index);
+  ASSERT_TRUE(event->parameter_copy_storage());
+  EXPECT_STREQ("args", event->arg_name(0));
+  std::string json;
+  TraceEvent::AppendValueAsJSON(event->arg_type(0), event->arg_value(0),
+                                &json);
+  EXPECT_EQ(expected_json, json);
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -4,19 +4,80 @@
 
 #include "brick/trace_event/trace_buffer.h"
 
+#include <atomic>
 #include <memory>
+#include <new>
 #include <utility>
 #include <vector>
 
 #include "brick/macros.h"
 #include "brick/trace_event/heap_profiler.h"
 #include "brick/trace_event/trace_event_impl.h"
+#include "brick/trace_event/trace_stream_writer.h"
 
 namespace base {
 namespace trace_event {
 
 namespace {
 
+// Bounds the memory kept by ChunkFreeList, about 10KB per chunk.
+constexpr size_t kMaxFreeChunks = 64;
+
+// A bounded lock-free stack of the memory of deleted TraceBufferChunks.
+class ChunkFreeList {
+ public:
+  constexpr ChunkFreeList() : head_(nullptr), size_(0) {}
+
+  void* Pop() {
+    // Popping only the head with a compare-and-swap is exposed to ABA, as
+    // another thread may pop it, pop its successor and push it back between
+    // the load and the swap. Taking the whole list is not, and the rest of it
+    // can be pushed back safely.
+    Block* head = head_.exchange(nullptr, std::memory_order_acquire);
+    if (!head)
+      return nullptr;
+    if (Block* rest = head->next) {
+      Block* last = rest;
+      while (last->next)
+        last = last->next;
+      PushList(rest, last);
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return head;
+  }
+
+  // Returns false if the list is full.
+  bool Push(void* memory) {
+    if (size_.fetch_add(1, std::memory_order_relaxed) >= kMaxFreeChunks) {
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    }
+    Block* block = static_cast<Block*>(memory);
+    PushList(block, block);
+    return true;
+  }
+
+ private:
+  struct Block {
+    Block* next;
+  };
+
+  void PushList(Block* first, Block* last) {
+    Block* head = head_.load(std::memory_order_relaxed);
+    do {
+      last->next = head;
+    } while (!head_.compare_exchange_weak(head, first,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  std::atomic<Block*> head_;
+  std::atomic<size_t> size_;
+};
+
+// Constant initialized, so it needs no static initializer or destructor.
+ChunkFreeList g_chunk_free_list;
+
 class TraceBufferRingBuffer : public TraceBuffer {
  public:
   TraceBufferRingBuffer(size_t max_chunks)
@@ -242,16 +303,106 @@ class TraceBufferVector : public TraceBuffer {
   DISALLOW_COPY_AND_ASSIGN(TraceBufferVector);
 };
 
+class TraceBufferStreaming : public TraceBuffer {
+ public:
+  explicit TraceBufferStreaming(TraceStreamWriter* stream_writer)
+      : stream_writer_(stream_writer),
+        in_flight_chunk_count_(0),
+        current_chunk_seq_(1) {}
+
+  std::unique_ptr<TraceBufferChunk> GetChunk(size_t* index) override {
+    HEAP_PROFILER_SCOPED_IGNORE;
+
+    // The chunks are gone once returned, so the index only has to tell apart
+    // the in-flight ones, together with the seq.
+    const uint32_t seq = current_chunk_seq_++;
+    // Zero chunk_seq is not allowed.
+    if (!current_chunk_seq_)
+      current_chunk_seq_ = 1;
+    *index = seq & TraceBufferChunk::kMaxChunkIndex;
+    ++in_flight_chunk_count_;
+
+    std::unique_ptr<TraceBufferChunk> chunk = stream_writer_->TakeFreeChunk();
+    if (chunk)
+      chunk->Reset(seq);
+    else
+      chunk.reset(new TraceBufferChunk(seq));
+    return chunk;
+  }
+
+  void ReturnChunk(size_t index,
+                   std::unique_ptr<TraceBufferChunk> chunk) override {
+    DCHECK_GT(in_flight_chunk_count_, 0u);
+    DCHECK(chunk);
+    --in_flight_chunk_count_;
+    stream_writer_->AddChunk(std::move(chunk));
+  }
+
+  bool IsFull() const override { return false; }
+
+  size_t Size() const override {
+    // Only the in-flight chunks are held; this is approximate because not all
+    // of them are full.
+    return in_flight_chunk_count_ * TraceBufferChunk::kTraceBufferChunkSize;
+  }
+
+  size_t Capacity() const override {
+    return stream_writer_->max_pending_chunks() *
+           TraceBufferChunk::kTraceBufferChunkSize;
+  }
+
+  TraceEvent* GetEventByHandle(TraceEventHandle handle) override {
+    // Returned chunks belong to the stream writer.
+    return nullptr;
+  }
+
+  const TraceBufferChunk* NextChunk() override { return nullptr; }
+
+  void EstimateTraceMemoryOverhead(
+      TraceEventMemoryOverhead* overhead) override {
+    overhead->Add(TraceEventMemoryOverhead::kTraceBuffer, sizeof(*this));
+    // The in-flight chunks are accounted by the per-thread-local dumpers, see
+    // ThreadLocalEventBuffer::OnMemoryDump.
+    stream_writer_->EstimateTraceMemoryOverhead(overhead);
+  }
+
+ private:
+  TraceStreamWriter* const stream_writer_;
+  size_t in_flight_chunk_count_;
+  uint32_t current_chunk_seq_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBufferStreaming);
+};
+
 }  // namespace
 
-TraceBufferChunk::TraceBufferChunk(uint32_t seq) : next_free_(0), seq_(seq) {}
+TraceBufferChunk::TraceBufferChunk(uint32_t seq)
+    : next_free_(0), argument_storage_used_(0), seq_(seq) {
+  for (TraceEvent& event : chunk_)
+    event.chunk_ = this;
+}
 
 TraceBufferChunk::~TraceBufferChunk() = default;
 
+// static
+void* TraceBufferChunk::operator new(size_t size) {
+  DCHECK_EQ(sizeof(TraceBufferChunk), size);
+  if (void* memory = g_chunk_free_list.Pop())
+    return memory;
+  return ::operator new(size);
+}
+
+// static
+void TraceBufferChunk::operator delete(void* ptr) {
+  if (ptr && !g_chunk_free_list.Push(ptr))
+    ::operator delete(ptr);
+}
+
 void TraceBufferChunk::Reset(uint32_t new_seq) {
   for (size_t i = 0; i < next_free_; ++i)
     chunk_[i].Reset();
   next_free_ = 0;
+  argument_storage_used_ = 0;
   seq_ = new_seq;
   cached_overhead_estimate_.reset();
 }
@@ -262,6 +413,14 @@ TraceEvent* TraceBufferChunk::AddTraceEvent(size_t* event_index) {
   return &chunk_[*event_index];
 }
 
+char* TraceBufferChunk::AllocateArgumentStorage(size_t size) {
+  if (size > kArgumentStorageSize - argument_storage_used_)
+    return nullptr;
+  char* storage = argument_storage_ + argument_storage_used_;
+  argument_storage_used_ += size;
+  return storage;
+}
+
 void TraceBufferChunk::EstimateTraceMemoryOverhead(
     TraceEventMemoryOverhead* overhead) {
   if (!cached_overhead_estimate_) {
@@ -343,5 +502,10 @@ TraceBuffer* TraceBuffer::CreateTraceBufferVectorOfSize(size_t max_chunks) {
   return new TraceBufferVector(max_chunks);
 }
 
+TraceBuffer* TraceBuffer::CreateTraceBufferStreaming(
+    TraceStreamWriter* stream_writer) {
+  return new TraceBufferStreaming(stream_writer);
+}
+
 }  // namespace trace_event
 }  // namespace base
@@ -16,16 +16,28 @@ namespace base {
 
 namespace trace_event {
 
+class TraceStreamWriter;
+
 // TraceBufferChunk is the basic unit of TraceBuffer.
 class BRICK_EXPORT TraceBufferChunk {
  public:
   explicit TraceBufferChunk(uint32_t seq);
   ~TraceBufferChunk();
 
+  // The memory of deleted chunks is kept in a small lock-free free list and
+  // reused by the next chunks, so that the threads which run out of chunk
+  // space while holding the TraceLog lock don't wait for the heap.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr);
+
   void Reset(uint32_t new_seq);
   TraceEvent* AddTraceEvent(size_t* event_index);
   bool IsFull() const { return next_free_ == kTraceBufferChunkSize; }
 
+  // Returns |size| bytes that live as long as the events of the chunk, or null
+  // if the chunk has no room left. See TraceArgumentEncoder.
+  char* AllocateArgumentStorage(size_t size);
+
   uint32_t seq() const { return seq_; }
   size_t capacity() const { return kTraceBufferChunkSize; }
   size_t size() const { return next_free_; }
@@ -46,12 +58,16 @@ class BRICK_EXPORT TraceBufferChunk {
   // (in trace_event_impl.h).
   static const size_t kMaxChunkIndex = (1u << 26) - 1;
   static const size_t kTraceBufferChunkSize = 64;
+  // 32 bytes per event, enough for a few fields each.
+  static const size_t kArgumentStorageSize = 2048;
 
  private:
   size_t next_free_;
+  size_t argument_storage_used_;
   std::unique_ptr<TraceEventMemoryOverhead> cached_overhead_estimate_;
   TraceEvent chunk_[kTraceBufferChunkSize];
   uint32_t seq_;
+  char argument_storage_[kArgumentStorageSize];
 };
 
 // TraceBuffer holds the events as they are collected.
@@ -79,6 +95,10 @@ class BRICK_EXPORT TraceBuffer {
 
   static TraceBuffer* CreateTraceBufferRingBuffer(size_t max_chunks);
   static TraceBuffer* CreateTraceBufferVectorOfSize(size_t max_chunks);
+  // Keeps no events: hands the chunks to |stream_writer| as they are
+  // returned. |stream_writer| must outlive the buffer.
+  static TraceBuffer* CreateTraceBufferStreaming(
+      TraceStreamWriter* stream_writer);
 };
 
 // TraceResultBuffer collects and converts trace fragments returned by TraceLog
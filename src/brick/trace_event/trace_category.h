@@ -26,9 +26,16 @@ struct TraceCategory {
     DEPRECATED_ENABLED_FOR_EVENT_CALLBACK = 1 << 2,
 
     ENABLED_FOR_ETW_EXPORT = 1 << 3,
-    ENABLED_FOR_FILTERING = 1 << 4
+    ENABLED_FOR_FILTERING = 1 << 4,
+
+    // Set along with ENABLED_FOR_RECORDING when only some of the events are
+    // recorded. It doesn't enable the category on its own.
+    ENABLED_FOR_SAMPLING = 1 << 5
   };
 
+  // The unit of sampling_ratio().
+  static constexpr uint32_t kSamplingRatioScale = 1 << 24;
+
   static const TraceCategory* FromStatePtr(const uint8_t* state_ptr) {
     static_assert(
         offsetof(TraceCategory, state_) == 0,
@@ -77,9 +84,24 @@ struct TraceCategory {
     *const_cast<volatile uint32_t*>(&enabled_filters_) = enabled_filters;
   }
 
+  uint32_t sampling_ratio() const {
+    return *const_cast<volatile const uint32_t*>(&sampling_ratio_);
+  }
+
+  uint32_t max_events_per_second() const {
+    return *const_cast<volatile const uint32_t*>(&max_events_per_second_);
+  }
+
+  void set_sampling(uint32_t sampling_ratio, uint32_t max_events_per_second) {
+    *const_cast<volatile uint32_t*>(&sampling_ratio_) = sampling_ratio;
+    *const_cast<volatile uint32_t*>(&max_events_per_second_) =
+        max_events_per_second;
+  }
+
   void reset_for_testing() {
     set_state(0);
     set_enabled_filters(0);
+    set_sampling(0, 0);
   }
 
   // These fields should not be accessed directly, not even by tracing code.
@@ -101,6 +123,12 @@ struct TraceCategory {
 
   // TraceCategory group names are long lived static strings.
   const char* name_;
+
+  // When ENABLED_FOR_SAMPLING is set, the fraction of the events to record, in
+  // units of 1 / kSamplingRatioScale, and the maximum number of events to
+  // record per second and thread, or 0 for no limit.
+  uint32_t sampling_ratio_;
+  uint32_t max_events_per_second_;
 };
 
 }  // namespace trace_event
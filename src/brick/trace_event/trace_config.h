@@ -175,6 +175,13 @@ class BRICK_EXPORT TraceConfig {
   //                             "inc_pattern*",
   //                             "disabled-by-default-memory-infra"],
   //     "excluded_categories": ["excluded", "exc_pattern*"],
+  //     "category_sampling": [
+  //       {
+  //         "category": "verbose*",
+  //         "sampling_ratio": 0.1,
+  //         "max_events_per_second": 1000
+  //       }
+  //     ],
   //     "memory_dump_config": {
   //       "triggers": [
   //         {
@@ -187,6 +194,9 @@ class BRICK_EXPORT TraceConfig {
   //
   // Note: memory_dump_config can be specified only if
   // disabled-by-default-memory-infra category is enabled.
+  //
+  // category_sampling bounds the cost of the enabled categories it matches;
+  // see TraceConfigCategoryFilter::SamplingRule.
   explicit TraceConfig(StringPiece config_string);
 
   // Functionally identical to the above, but takes a parsed dictionary as input
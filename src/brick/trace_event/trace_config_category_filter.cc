@@ -4,6 +4,8 @@
 
 #include "brick/trace_event/trace_config_category_filter.h"
 
+#include <algorithm>
+
 #include "brick/memory/ptr_util.h"
 #include "brick/strings/pattern.h"
 #include "brick/strings/string_split.h"
@@ -18,8 +20,20 @@ namespace trace_event {
 namespace {
 const char kIncludedCategoriesParam[] = "included_categories";
 const char kExcludedCategoriesParam[] = "excluded_categories";
+const char kCategorySamplingParam[] = "category_sampling";
+const char kSamplingCategoryParam[] = "category";
+const char kSamplingRatioParam[] = "sampling_ratio";
+const char kMaxEventsPerSecondParam[] = "max_events_per_second";
 }
 
+TraceConfigCategoryFilter::SamplingRule::SamplingRule()
+    : sampling_ratio(1.0), max_events_per_second(0) {}
+
+TraceConfigCategoryFilter::SamplingRule::SamplingRule(
+    const SamplingRule& other) = default;
+
+TraceConfigCategoryFilter::SamplingRule::~SamplingRule() = default;
+
 TraceConfigCategoryFilter::TraceConfigCategoryFilter() = default;
 
 TraceConfigCategoryFilter::TraceConfigCategoryFilter(
@@ -57,6 +71,8 @@ void TraceConfigCategoryFilter::InitializeFromConfigDict(
     SetCategoriesFromIncludedList(*category_list);
   if (dict.GetList(kExcludedCategoriesParam, &category_list))
     SetCategoriesFromExcludedList(*category_list);
+  if (dict.GetList(kCategorySamplingParam, &category_list))
+    SetSamplingRulesFromList(*category_list);
 }
 
 bool TraceConfigCategoryFilter::IsCategoryGroupEnabled(
@@ -131,6 +147,22 @@ bool TraceConfigCategoryFilter::IsCategoryEnabled(
   return false;
 }
 
+const TraceConfigCategoryFilter::SamplingRule*
+TraceConfigCategoryFilter::GetSamplingRule(
+    const StringPiece& category_group_name) const {
+  if (sampling_rules_.empty())
+    return nullptr;
+  for (const SamplingRule& rule : sampling_rules_) {
+    CStringTokenizer category_group_tokens(category_group_name.begin(),
+                                           category_group_name.end(), ",");
+    while (category_group_tokens.GetNext()) {
+      if (MatchPattern(category_group_tokens.token_piece(), rule.category))
+        return &rule;
+    }
+  }
+  return nullptr;
+}
+
 void TraceConfigCategoryFilter::Merge(const TraceConfigCategoryFilter& config) {
   // Keep included patterns only if both filters have an included entry.
   // Otherwise, one of the filter was specifying "*" and we want to honor the
@@ -149,12 +181,17 @@ void TraceConfigCategoryFilter::Merge(const TraceConfigCategoryFilter& config) {
   excluded_categories_.insert(excluded_categories_.end(),
                               config.excluded_categories_.begin(),
                               config.excluded_categories_.end());
+  // The first matching rule wins, so the rules of this filter take precedence.
+  sampling_rules_.insert(sampling_rules_.end(),
+                         config.sampling_rules_.begin(),
+                         config.sampling_rules_.end());
 }
 
 void TraceConfigCategoryFilter::Clear() {
   included_categories_.clear();
   disabled_categories_.clear();
   excluded_categories_.clear();
+  sampling_rules_.clear();
 }
 
 void TraceConfigCategoryFilter::ToDict(DictionaryValue* dict) const {
@@ -163,6 +200,19 @@ void TraceConfigCategoryFilter::ToDict(DictionaryValue* dict) const {
                     disabled_categories_.end());
   AddCategoriesToDict(categories, kIncludedCategoriesParam, dict);
   AddCategoriesToDict(excluded_categories_, kExcludedCategoriesParam, dict);
+
+  if (sampling_rules_.empty())
+    return;
+  auto sampling_list = std::make_unique<ListValue>();
+  for (const SamplingRule& rule : sampling_rules_) {
+    auto rule_dict = std::make_unique<DictionaryValue>();
+    rule_dict->SetString(kSamplingCategoryParam, rule.category);
+    rule_dict->SetDouble(kSamplingRatioParam, rule.sampling_ratio);
+    rule_dict->SetInteger(kMaxEventsPerSecondParam,
+                          static_cast<int>(rule.max_events_per_second));
+    sampling_list->Append(std::move(rule_dict));
+  }
+  dict->Set(kCategorySamplingParam, std::move(sampling_list));
 }
 
 std::string TraceConfigCategoryFilter::ToFilterString() const {
@@ -199,6 +249,31 @@ void TraceConfigCategoryFilter::SetCategoriesFromExcludedList(
   }
 }
 
+void TraceConfigCategoryFilter::SetSamplingRulesFromList(
+    const ListValue& sampling_list) {
+  sampling_rules_.clear();
+  for (size_t i = 0; i < sampling_list.GetSize(); ++i) {
+    const DictionaryValue* rule_dict = nullptr;
+    SamplingRule rule;
+    if (!sampling_list.GetDictionary(i, &rule_dict) ||
+        !rule_dict->GetString(kSamplingCategoryParam, &rule.category) ||
+        !IsCategoryNameAllowed(rule.category)) {
+      continue;
+    }
+    double sampling_ratio;
+    if (rule_dict->GetDouble(kSamplingRatioParam, &sampling_ratio))
+      rule.sampling_ratio = std::min(std::max(sampling_ratio, 0.0), 1.0);
+    int max_events_per_second;
+    if (rule_dict->GetInteger(kMaxEventsPerSecondParam,
+                              &max_events_per_second) &&
+        max_events_per_second > 0) {
+      rule.max_events_per_second =
+          static_cast<uint32_t>(max_events_per_second);
+    }
+    sampling_rules_.push_back(rule);
+  }
+}
+
 void TraceConfigCategoryFilter::AddCategoriesToDict(
     const StringList& categories,
     const char* param,
@@ -5,6 +5,8 @@
 #ifndef BRICK_TRACE_EVENT_TRACE_CONFIG_CATEGORY_FILTER_H_
 #define BRICK_TRACE_EVENT_TRACE_CONFIG_CATEGORY_FILTER_H_
 
+#include <stdint.h>
+
 #include <string>
 #include <vector>
 
@@ -20,6 +22,25 @@ class BRICK_EXPORT TraceConfigCategoryFilter {
  public:
   using StringList = std::vector<std::string>;
 
+  // Limits the events recorded for the categories matching |category|, so
+  // that verbose categories can stay enabled at a bounded cost. Of the events
+  // that stand on their own (complete, instant and counter events), only the
+  // fraction |sampling_ratio| is recorded, and then no more than
+  // |max_events_per_second| per thread, with bursts of up to one second worth
+  // of events. A |max_events_per_second| of 0 means no limit. Begin and end
+  // events, async and flow events are always recorded, since dropping one half
+  // of a pair would corrupt the trace.
+  struct BRICK_EXPORT SamplingRule {
+    SamplingRule();
+    SamplingRule(const SamplingRule& other);
+    ~SamplingRule();
+
+    std::string category;
+    double sampling_ratio;
+    uint32_t max_events_per_second;
+  };
+  using SamplingRules = std::vector<SamplingRule>;
+
   TraceConfigCategoryFilter();
   TraceConfigCategoryFilter(const TraceConfigCategoryFilter& other);
   ~TraceConfigCategoryFilter();
@@ -48,6 +69,11 @@ class BRICK_EXPORT TraceConfigCategoryFilter {
   // category is enabled from the tracing runtime's perspective.
   bool IsCategoryEnabled(const StringPiece& category_name) const;
 
+  // Returns the first sampling rule matching one of the categories in the
+  // group, or nullptr if the events of the group are all recorded.
+  const SamplingRule* GetSamplingRule(
+      const StringPiece& category_group_name) const;
+
   void ToDict(DictionaryValue* dict) const;
 
   std::string ToFilterString() const;
@@ -57,10 +83,12 @@ class BRICK_EXPORT TraceConfigCategoryFilter {
 
   const StringList& included_categories() const { return included_categories_; }
   const StringList& excluded_categories() const { return excluded_categories_; }
+  const SamplingRules& sampling_rules() const { return sampling_rules_; }
 
  private:
   void SetCategoriesFromIncludedList(const ListValue& included_list);
   void SetCategoriesFromExcludedList(const ListValue& excluded_list);
+  void SetSamplingRulesFromList(const ListValue& sampling_list);
 
   void AddCategoriesToDict(const StringList& categories,
                            const char* param,
@@ -73,6 +101,7 @@ class BRICK_EXPORT TraceConfigCategoryFilter {
   StringList included_categories_;
   StringList disabled_categories_;
   StringList excluded_categories_;
+  SamplingRules sampling_rules_;
 };
 
 }  // namespace trace_event
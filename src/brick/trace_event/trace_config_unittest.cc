@@ -565,6 +565,71 @@ TEST(TraceConfigTest, IsCategoryGroupEnabled) {
   EXPECT_FALSE(tc.IsCategoryGroupEnabled("excluded,disabled-by-default-cc"));
 }
 
+TEST(TraceConfigTest, CategorySampling) {
+  const char kSamplingConfigString[] =
+      "{"
+      "\"category_sampling\":["
+      "{"
+      "\"category\":\"verbose*\","
+      "\"max_events_per_second\":100,"
+      "\"sampling_ratio\":0.5"
+      "},"
+      "{"
+      "\"category\":\"limited\","
+      "\"max_events_per_second\":10,"
+      "\"sampling_ratio\":1.0"
+      "}"
+      "],"
+      "\"enable_argument_filter\":false,"
+      "\"enable_systrace\":false,"
+      "\"record_mode\":\"record-until-full\""
+      "}";
+  TraceConfig tc(kSamplingConfigString);
+  EXPECT_STREQ(kSamplingConfigString, tc.ToString().c_str());
+  EXPECT_TRUE(tc.IsCategoryGroupEnabled("verbose_cat"));
+
+  const TraceConfigCategoryFilter& filter = tc.category_filter();
+  ASSERT_EQ(2u, filter.sampling_rules().size());
+  EXPECT_FALSE(filter.GetSamplingRule("other"));
+  const TraceConfigCategoryFilter::SamplingRule* rule =
+      filter.GetSamplingRule("other,verbose_cat");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ("verbose*", rule->category);
+  EXPECT_EQ(0.5, rule->sampling_ratio);
+  EXPECT_EQ(100u, rule->max_events_per_second);
+  rule = filter.GetSamplingRule("limited");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ(1.0, rule->sampling_ratio);
+  EXPECT_EQ(10u, rule->max_events_per_second);
+
+  // Out of range values are clamped, and rules without a category ignored.
+  tc = TraceConfig(
+      "{\"category_sampling\":["
+      "{\"category\":\"a\",\"sampling_ratio\":2.0,"
+      "\"max_events_per_second\":-1},"
+      "{\"category\":\"b\",\"sampling_ratio\":-1.0},"
+      "{\"sampling_ratio\":0.5}"
+      "]}");
+  ASSERT_EQ(2u, tc.category_filter().sampling_rules().size());
+  rule = tc.category_filter().GetSamplingRule("a");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ(1.0, rule->sampling_ratio);
+  EXPECT_EQ(0u, rule->max_events_per_second);
+  rule = tc.category_filter().GetSamplingRule("b");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ(0.0, rule->sampling_ratio);
+
+  // The rules of the config merged into take precedence.
+  TraceConfig tc2("{\"category_sampling\":["
+                  "{\"category\":\"a\",\"sampling_ratio\":0.25}]}");
+  tc2.Merge(tc);
+  ASSERT_EQ(3u, tc2.category_filter().sampling_rules().size());
+  EXPECT_EQ(0.25, tc2.category_filter().GetSamplingRule("a")->sampling_ratio);
+
+  tc2.Clear();
+  EXPECT_TRUE(tc2.category_filter().sampling_rules().empty());
+}
+
 TEST(TraceConfigTest, IsCategoryNameAllowed) {
   // Test that IsCategoryNameAllowed actually catches categories that are
   // explicitly forbidden. This method is called in a DCHECK to assert that we
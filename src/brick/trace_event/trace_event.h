@@ -21,6 +21,7 @@
 #include "brick/time/time_override.h"
 #include "brick/trace_event/common/trace_event_common.h"
 #include "brick/trace_event/heap_profiler.h"
+#include "brick/trace_event/trace_argument_encoder.h"
 #include "brick/trace_event/trace_category.h"
 #include "brick/trace_event/trace_event_system_stats_monitor.h"
 #include "brick/trace_event/trace_log.h"
@@ -744,6 +745,17 @@ static inline void SetTraceValue(const base::ThreadTicks arg,
   *value = arg.ToInternalValue();
 }
 
+// The encoded arguments are copied into the trace buffer with the event.
+static inline void SetTraceValue(
+    const base::trace_event::TraceArgumentEncoder& arg,
+    unsigned char* type,
+    unsigned long long* value) {
+  TraceValueUnion type_value;
+  type_value.as_pointer = arg.encoded();
+  *type = TRACE_VALUE_TYPE_ENCODED;
+  *value = type_value.as_uint;
+}
+
 // These AddTraceEvent and AddTraceEventWithThreadIdAndTimestamp template
 // functions are defined here instead of in the macro, because the arg_values
 // could be temporary objects, such as std::string. In order to store
@@ -15,6 +15,8 @@
 #include "brick/strings/string_util.h"
 #include "brick/strings/stringprintf.h"
 #include "brick/strings/utf_string_conversions.h"
+#include "brick/trace_event/trace_argument_encoder.h"
+#include "brick/trace_event/trace_buffer.h"
 #include "brick/trace_event/trace_event.h"
 #include "brick/trace_event/trace_event_argument.h"
 #include "brick/trace_event/trace_log.h"
@@ -47,6 +49,7 @@ TraceEvent::TraceEvent()
       id_(0u),
       category_group_enabled_(nullptr),
       name_(nullptr),
+      chunk_(nullptr),
       thread_id_(0),
       flags_(0),
       phase_(TRACE_EVENT_PHASE_BEGIN) {
@@ -142,6 +145,7 @@ void TraceEvent::Initialize(
   }
 
   bool arg_is_copy[kTraceMaxNumArgs];
+  size_t encoded_size = 0;
   for (i = 0; i < num_args; ++i) {
     // No copying of convertable types, we retain ownership.
     if (arg_types_[i] == TRACE_VALUE_TYPE_CONVERTABLE)
@@ -151,6 +155,20 @@ void TraceEvent::Initialize(
     arg_is_copy[i] = (arg_types_[i] == TRACE_VALUE_TYPE_COPY_STRING);
     if (arg_is_copy[i])
       alloc_size += GetAllocLength(arg_values_[i].as_string);
+    if (arg_types_[i] == TRACE_VALUE_TYPE_ENCODED) {
+      encoded_size +=
+          TraceArgumentEncoder::EncodedSize(arg_values_[i].as_pointer);
+    }
+  }
+
+  // The encoded arguments are copied into the storage of the chunk, and only
+  // share |parameter_copy_storage_| if it's full.
+  char* encoded_storage = nullptr;
+  if (encoded_size) {
+    if (chunk_)
+      encoded_storage = chunk_->AllocateArgumentStorage(encoded_size);
+    if (!encoded_storage)
+      alloc_size += encoded_size;
   }
 
   if (alloc_size) {
@@ -171,8 +189,22 @@ void TraceEvent::Initialize(
       if (arg_is_copy[i])
         CopyTraceEventParameter(&ptr, &arg_values_[i].as_string, end);
     }
+    if (encoded_size && !encoded_storage) {
+      encoded_storage = ptr;
+      ptr += encoded_size;
+    }
     DCHECK_EQ(end, ptr) << "Overrun by " << ptr - end;
   }
+
+  for (i = 0; i < num_args; ++i) {
+    if (arg_types_[i] != TRACE_VALUE_TYPE_ENCODED)
+      continue;
+    const size_t size =
+        TraceArgumentEncoder::EncodedSize(arg_values_[i].as_pointer);
+    memcpy(encoded_storage, arg_values_[i].as_pointer, size);
+    arg_values_[i].as_pointer = encoded_storage;
+    encoded_storage += size;
+  }
 }
 
 void TraceEvent::Reset() {
@@ -268,6 +300,9 @@ void TraceEvent::AppendValueAsJSON(unsigned char type,
     case TRACE_VALUE_TYPE_COPY_STRING:
       EscapeJSONString(value.as_string ? value.as_string : "NULL", true, out);
       break;
+    case TRACE_VALUE_TYPE_ENCODED:
+      TraceArgumentEncoder::AppendAsJSON(value.as_pointer, out);
+      break;
     default:
       NOTREACHED() << "Don't know how to print this value";
       break;
@@ -29,6 +29,8 @@
 namespace base {
 namespace trace_event {
 
+class TraceBufferChunk;
+
 typedef base::Callback<bool(const char* arg_name)> ArgumentNameFilterPredicate;
 
 typedef base::Callback<bool(const char* category_group_name,
@@ -169,6 +171,9 @@ class BRICK_EXPORT TraceEvent {
       convertable_values_[kTraceMaxNumArgs];
   const unsigned char* category_group_enabled_;
   const char* name_;
+  // The chunk holding this event, if any. Its storage receives the encoded
+  // arguments, see TraceArgumentEncoder.
+  TraceBufferChunk* chunk_;
   std::unique_ptr<std::string> parameter_copy_storage_;
   // Depending on TRACE_EVENT_FLAG_HAS_PROCESS_ID the event will have either:
   //  tid: thread_id_, pid: current_process_id (default case).
@@ -182,6 +187,8 @@ class BRICK_EXPORT TraceEvent {
   unsigned char arg_types_[kTraceMaxNumArgs];
   char phase_;
 
+  friend class TraceBufferChunk;
+
   DISALLOW_COPY_AND_ASSIGN(TraceEvent);
 };
 
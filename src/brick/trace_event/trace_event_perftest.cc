@@ -0,0 +1,226 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the tracing hot path: the cost of trace macros when their category
+// is disabled, of recording events on one or several threads, of event
+// filtering and sampling, and the throughput of the JSON flush.
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "brick/bind.h"
+#include "brick/logging.h"
+#include "brick/macros.h"
+#include "brick/memory/ref_counted_memory.h"
+#include "brick/strings/stringprintf.h"
+#include "brick/threading/simple_thread.h"
+#include "brick/time/time.h"
+#include "brick/trace_event/event_name_filter.h"
+#include "brick/trace_event/trace_event.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+constexpr int kNumEvents = 100000;
+// Filled in one go for the flush test, well within the default buffer size.
+constexpr int kNumFlushedEvents = 200000;
+
+void PrintNanosecondsPerEvent(const std::string& trace,
+                              TimeDelta elapsed,
+                              int num_events) {
+  perf_test::PrintResult("event_time", "", trace,
+                         elapsed.InNanoseconds() /
+                             static_cast<double>(num_events),
+                         "ns/event", true);
+}
+
+void AppendFlushedData(size_t* total_size,
+                       const scoped_refptr<RefCountedString>& events_str,
+                       bool has_more_events) {
+  *total_size += events_str->data().size();
+}
+
+class TraceEventEmitter : public DelegateSimpleThread::Delegate {
+ public:
+  explicit TraceEventEmitter(int num_events) : num_events_(num_events) {}
+
+  void Run() override {
+    for (int i = 0; i < num_events_; ++i) {
+      TRACE_EVENT0("perf", "event");
+    }
+  }
+
+ private:
+  const int num_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceEventEmitter);
+};
+
+class TraceEventPerfTest : public testing::Test {
+ public:
+  void SetUp() override { TraceLog::ResetForTesting(); }
+
+  void TearDown() override {
+    TraceLog::GetInstance()->SetDisabled(TraceLog::RECORDING_MODE |
+                                         TraceLog::FILTERING_MODE);
+    // Drop the events.
+    TraceLog::GetInstance()->Flush(TraceLog::OutputCallback());
+  }
+
+  // Record continuously, so that the buffer never fills up.
+  void BeginTrace() {
+    TraceLog::GetInstance()->SetEnabled(
+        TraceConfig("perf", "record-continuously"), TraceLog::RECORDING_MODE);
+  }
+
+  template <typename TraceFunction>
+  void RunTest(const std::string& trace, TraceFunction trace_function) {
+    const TimeTicks start = TimeTicks::Now();
+    for (int i = 0; i < kNumEvents; ++i)
+      trace_function(i);
+    PrintNanosecondsPerEvent(trace, TimeTicks::Now() - start, kNumEvents);
+  }
+};
+
+}  // namespace
+
+TEST_F(TraceEventPerfTest, DisabledCategory) {
+  BeginTrace();
+  RunTest("disabled_event0", [](int i) {
+    TRACE_EVENT0("disabled", "event");
+  });
+  RunTest("disabled_event2", [](int i) {
+    TRACE_EVENT2("disabled", "event", "index", i, "name", "value");
+  });
+  RunTest("disabled_category_enabled_check", [](int i) {
+    bool enabled;
+    TRACE_EVENT_CATEGORY_GROUP_ENABLED("disabled", &enabled);
+    if (enabled)
+      NOTREACHED();
+  });
+  RunTest("disabled_by_default_event0", [](int i) {
+    TRACE_EVENT0(TRACE_DISABLED_BY_DEFAULT("perf"), "event");
+  });
+}
+
+TEST_F(TraceEventPerfTest, EnabledSingleThread) {
+  BeginTrace();
+  RunTest("event0", [](int i) { TRACE_EVENT0("perf", "event"); });
+  RunTest("event1", [](int i) { TRACE_EVENT1("perf", "event", "index", i); });
+  RunTest("event2", [](int i) {
+    TRACE_EVENT2("perf", "event", "index", i, "name", "value");
+  });
+  RunTest("event_copy_string", [](int i) {
+    TRACE_EVENT1("perf", "event", "name", std::string("copied value"));
+  });
+  RunTest("instant0", [](int i) {
+    TRACE_EVENT_INSTANT0("perf", "event", TRACE_EVENT_SCOPE_THREAD);
+  });
+  RunTest("counter1", [](int i) { TRACE_COUNTER1("perf", "counter", i); });
+  RunTest("async_begin_end0", [](int i) {
+    TRACE_EVENT_ASYNC_BEGIN0("perf", "async", i);
+    TRACE_EVENT_ASYNC_END0("perf", "async", i);
+  });
+}
+
+TEST_F(TraceEventPerfTest, EnabledMultiThread) {
+  BeginTrace();
+  for (int num_threads : {1, 2, 4, 8}) {
+    std::vector<std::unique_ptr<TraceEventEmitter>> emitters;
+    std::vector<std::unique_ptr<DelegateSimpleThread>> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      emitters.push_back(std::make_unique<TraceEventEmitter>(kNumEvents));
+      threads.push_back(std::make_unique<DelegateSimpleThread>(
+          emitters.back().get(), "TraceEventPerfTest"));
+    }
+
+    const TimeTicks start = TimeTicks::Now();
+    for (auto& thread : threads)
+      thread->Start();
+    for (auto& thread : threads)
+      thread->Join();
+    PrintNanosecondsPerEvent(StringPrintf("event0_%d_threads", num_threads),
+                             TimeTicks::Now() - start,
+                             kNumEvents * num_threads);
+  }
+}
+
+TEST_F(TraceEventPerfTest, EventNameFilter) {
+  const std::string config_json = StringPrintf(
+      "{"
+      "  \"included_categories\": [\"perf\"],"
+      "  \"record_mode\": \"record-continuously\","
+      "  \"event_filters\": ["
+      "     {"
+      "       \"filter_predicate\": \"%s\", "
+      "       \"included_categories\": [\"perf\"], "
+      "       \"filter_args\": {"
+      "           \"event_name_whitelist\": [\"kept\"]"
+      "         }"
+      "     }"
+      "  ]"
+      "}",
+      EventNameFilter::kName);
+  TraceLog::GetInstance()->SetEnabled(
+      TraceConfig(config_json),
+      TraceLog::RECORDING_MODE | TraceLog::FILTERING_MODE);
+
+  RunTest("filtered_kept_event0", [](int i) { TRACE_EVENT0("perf", "kept"); });
+  RunTest("filtered_dropped_event0",
+          [](int i) { TRACE_EVENT0("perf", "dropped"); });
+}
+
+TEST_F(TraceEventPerfTest, SampledCategory) {
+  TraceLog::GetInstance()->SetEnabled(
+      TraceConfig("{"
+                  "  \"included_categories\": [\"perf\"],"
+                  "  \"record_mode\": \"record-continuously\","
+                  "  \"category_sampling\": ["
+                  "     {"
+                  "       \"category\": \"perf\", "
+                  "       \"sampling_ratio\": 0.01, "
+                  "       \"max_events_per_second\": 1000"
+                  "     }"
+                  "  ]"
+                  "}"),
+      TraceLog::RECORDING_MODE);
+
+  RunTest("sampled_event0", [](int i) { TRACE_EVENT0("perf", "event"); });
+  RunTest("sampled_instant0", [](int i) {
+    TRACE_EVENT_INSTANT0("perf", "event", TRACE_EVENT_SCOPE_THREAD);
+  });
+}
+
+TEST_F(TraceEventPerfTest, JSONFlush) {
+  TraceLog::GetInstance()->SetEnabled(TraceConfig("perf", ""),
+                                      TraceLog::RECORDING_MODE);
+  for (int i = 0; i < kNumFlushedEvents; ++i) {
+    TRACE_EVENT2("perf", "event", "index", i, "name", "value");
+  }
+  TraceLog::GetInstance()->SetDisabled();
+
+  // Without a message loop, the flush completes synchronously.
+  size_t total_size = 0;
+  const TimeTicks start = TimeTicks::Now();
+  TraceLog::GetInstance()->Flush(Bind(&AppendFlushedData, &total_size));
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+
+  perf_test::PrintResult("flush_throughput", "", "json",
+                         total_size / (1024.0 * 1024.0) / elapsed.InSecondsF(),
+                         "MB/s", true);
+  perf_test::PrintResult("flush_time", "", "json",
+                         elapsed.InNanoseconds() /
+                             static_cast<double>(kNumFlushedEvents),
+                         "ns/event", true);
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -9,8 +9,11 @@
 #include <stdint.h>
 
 #include <cstdlib>
+#include <map>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "brick/bind.h"
 #include "brick/command_line.h"
@@ -28,6 +31,7 @@
 #include "brick/strings/stringprintf.h"
 #include "brick/synchronization/waitable_event.h"
 #include "brick/threading/platform_thread.h"
+#include "brick/threading/simple_thread.h"
 #include "brick/threading/thread.h"
 #include "brick/time/time.h"
 #include "brick/trace_event/event_name_filter.h"
@@ -1780,6 +1784,112 @@ TEST_F(TraceEventTestFixture, DataCapturedManyThreads) {
   }
 }
 
+// Traces events, then keeps its thread alive until |exit_event| is signaled.
+class TraceManyInstantEventsDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  TraceManyInstantEventsDelegate(int thread_id,
+                                 int num_events,
+                                 WaitableEvent* exit_event)
+      : thread_id_(thread_id),
+        num_events_(num_events),
+        exit_event_(exit_event),
+        task_complete_event_(WaitableEvent::ResetPolicy::MANUAL,
+                             WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  void Run() override {
+    TraceManyInstantEvents(thread_id_, num_events_, &task_complete_event_);
+    if (exit_event_)
+      exit_event_->Wait();
+  }
+
+  WaitableEvent* task_complete_event() { return &task_complete_event_; }
+
+ private:
+  const int thread_id_;
+  const int num_events_;
+  WaitableEvent* exit_event_;
+  WaitableEvent task_complete_event_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceManyInstantEventsDelegate);
+};
+
+// Test that data sent from threads without a message loop is gathered, both
+// from the threads that have exited and from the live ones.
+TEST_F(TraceEventTestFixture, DataCapturedManyThreadsWithoutMessageLoop) {
+  BeginTrace();
+
+  const int num_threads = 4;
+  const int num_events = 1000;
+  WaitableEvent exit_event(WaitableEvent::ResetPolicy::MANUAL,
+                           WaitableEvent::InitialState::NOT_SIGNALED);
+  std::vector<std::unique_ptr<TraceManyInstantEventsDelegate>> delegates;
+  std::vector<std::unique_ptr<DelegateSimpleThread>> threads;
+  for (int i = 0; i < num_threads; i++) {
+    delegates.push_back(std::make_unique<TraceManyInstantEventsDelegate>(
+        i, num_events, i < num_threads / 2 ? nullptr : &exit_event));
+    threads.push_back(std::make_unique<DelegateSimpleThread>(
+        delegates[i].get(), StringPrintf("Thread %d", i)));
+    threads[i]->Start();
+  }
+  for (int i = 0; i < num_threads; i++)
+    delegates[i]->task_complete_event()->Wait();
+
+  // Let half of the threads exit before flush.
+  for (int i = 0; i < num_threads / 2; i++)
+    threads[i]->Join();
+
+  EndTraceAndFlush();
+  ValidateInstantEventPresentOnEveryThread(trace_parsed_,
+                                           num_threads, num_events);
+
+  exit_event.Signal();
+  for (int i = num_threads / 2; i < num_threads; i++)
+    threads[i]->Join();
+}
+
+// Test that the events of the sampled categories are dropped, except for the
+// begin and end events.
+TEST_F(TraceEventTestFixture, CategorySampling) {
+  TraceLog::GetInstance()->SetEnabled(
+      TraceConfig("{"
+                  "\"included_categories\":"
+                  "[\"sampled\",\"limited\",\"all\"],"
+                  "\"category_sampling\":["
+                  "{\"category\":\"sampled\",\"sampling_ratio\":0.25},"
+                  "{\"category\":\"limited\",\"max_events_per_second\":10}"
+                  "]}"),
+      TraceLog::RECORDING_MODE);
+
+  const int kNumEvents = 100;
+  for (int i = 0; i < kNumEvents; i++) {
+    TRACE_EVENT_INSTANT0("sampled", "sampled instant",
+                         TRACE_EVENT_SCOPE_THREAD);
+    TRACE_EVENT_INSTANT0("all", "all instant", TRACE_EVENT_SCOPE_THREAD);
+    TRACE_EVENT_BEGIN0("sampled", "sampled begin end");
+    TRACE_EVENT_END0("sampled", "sampled begin end");
+  }
+  // The bucket starts full, and refills in one second.
+  const TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNumEvents; i++) {
+    TRACE_EVENT_INSTANT_WITH_TIMESTAMP0(
+        "limited", "limited instant", TRACE_EVENT_SCOPE_THREAD,
+        i < kNumEvents / 2 ? start : start + TimeDelta::FromSeconds(1));
+  }
+  EndTraceAndFlush();
+
+  std::map<std::string, int> event_counts;
+  for (size_t i = 0; i < trace_parsed_.GetSize(); i++) {
+    const DictionaryValue* dict = nullptr;
+    std::string name;
+    if (trace_parsed_.GetDictionary(i, &dict) && dict->GetString("name", &name))
+      event_counts[name]++;
+  }
+  EXPECT_EQ(kNumEvents / 4, event_counts["sampled instant"]);
+  EXPECT_EQ(kNumEvents, event_counts["all instant"]);
+  EXPECT_EQ(2 * kNumEvents, event_counts["sampled begin end"]);
+  EXPECT_EQ(20, event_counts["limited instant"]);
+}
+
 // Test that thread and process names show up in the trace
 TEST_F(TraceEventTestFixture, ThreadNames) {
   // Create threads before we enable tracing to make sure
@@ -5,13 +5,16 @@
 #include "brick/trace_event/trace_log.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <iterator>
 #include <memory>
 #include <utility>
 
 #include "brick/base_switches.h"
 #include "brick/bind.h"
 #include "brick/command_line.h"
+#include "brick/compiler_specific.h"
 #include "brick/debug/leak_annotations.h"
 #include "brick/location.h"
 #include "brick/macros.h"
@@ -34,6 +37,7 @@
 #include "brick/threading/thread_id_name_manager.h"
 #include "brick/threading/thread_task_runner_handle.h"
 #include "brick/time/time.h"
+#include "brick/trace_event/binary_trace_writer.h"
 #include "brick/trace_event/category_registry.h"
 #include "brick/trace_event/event_name_filter.h"
 #include "brick/trace_event/heap_profiler.h"
@@ -196,13 +200,44 @@ class TraceLog::OptionalAutoLock {
   DISALLOW_COPY_AND_ASSIGN(OptionalAutoLock);
 };
 
+// Events are added to the buffer of their thread without locking; |lock_|
+// is only taken once per chunk, to hand it over to |logged_events_|.
+//
+// A thread with a message loop flushes its buffer itself when Flush() posts a
+// task for it, and deletes it with the loop. The buffers of other threads are
+// flushed by Flush() directly, which first waits for their thread to finish
+// the event it may be writing (see BeginWrite()), and are deleted when their
+// thread exits.
 class TraceLog::ThreadLocalEventBuffer
     : public MessageLoopCurrent::DestructionObserver,
       public MemoryDumpProvider {
  public:
-  explicit ThreadLocalEventBuffer(TraceLog* trace_log);
+  // |message_loop| is null if the buffer is flushed by other threads.
+  ThreadLocalEventBuffer(TraceLog* trace_log, MessageLoop* message_loop);
   ~ThreadLocalEventBuffer() override;
 
+  // ThreadLocalStorage destructor of TraceLog::thread_local_event_buffer_.
+  static void OnThreadExit(void* buffer);
+
+  // Must be called by the thread of the buffer before using its events, and
+  // followed by EndWrite() once done. Returns false if the buffer has been
+  // flushed by another thread, in which case it can't be used anymore.
+  bool BeginWrite() {
+    // Sequentially consistent, so that either FlushFromOtherThread() sees
+    // |writing_| or this sees |flushed_|; see Dekker's algorithm.
+    writing_.store(true, std::memory_order_seq_cst);
+    if (flushed_.load(std::memory_order_seq_cst)) {
+      writing_.store(false, std::memory_order_release);
+      return false;
+    }
+    return true;
+  }
+  void EndWrite() { writing_.store(false, std::memory_order_release); }
+
+  // Flushes the buffer of another thread, which must have no message loop.
+  // Must be called with |buffers_without_message_loop_lock_| held.
+  void FlushFromOtherThread();
+
   TraceEvent* AddTraceEvent(TraceEventHandle* handle);
 
   TraceEvent* GetEventByHandle(TraceEventHandle handle) {
@@ -227,60 +262,97 @@ class TraceLog::ThreadLocalEventBuffer
   void FlushWhileLocked();
 
   void CheckThisIsCurrentBuffer() const {
-    DCHECK(trace_log_->thread_local_event_buffer_.Get() == this);
+    DCHECK(trace_log_->GetThreadLocalEventBuffer() == this);
   }
 
   // Since TraceLog is a leaky singleton, trace_log_ will always be valid
   // as long as the thread exists.
   TraceLog* trace_log_;
+  MessageLoop* const message_loop_;
   std::unique_ptr<TraceBufferChunk> chunk_;
   size_t chunk_index_;
   int generation_;
 
+  // Set by the thread of the buffer while it uses |chunk_| without |lock_|.
+  std::atomic<bool> writing_;
+  // Set once FlushFromOtherThread() is about to take |chunk_|.
+  std::atomic<bool> flushed_;
+
   DISALLOW_COPY_AND_ASSIGN(ThreadLocalEventBuffer);
 };
 
-TraceLog::ThreadLocalEventBuffer::ThreadLocalEventBuffer(TraceLog* trace_log)
+TraceLog::ThreadLocalEventBuffer::ThreadLocalEventBuffer(
+    TraceLog* trace_log,
+    MessageLoop* message_loop)
     : trace_log_(trace_log),
+      message_loop_(message_loop),
       chunk_index_(0),
-      generation_(trace_log->generation()) {
-  // ThreadLocalEventBuffer is created only if the thread has a message loop, so
-  // the following message_loop won't be NULL.
-  MessageLoop* message_loop = MessageLoop::current();
-  message_loop->AddDestructionObserver(this);
+      generation_(trace_log->generation()),
+      writing_(false),
+      flushed_(false) {
+  if (!message_loop_) {
+    AutoLock buffers_lock(trace_log->buffers_without_message_loop_lock_);
+    trace_log->buffers_without_message_loop_.push_back(this);
+    return;
+  }
+
+  message_loop_->AddDestructionObserver(this);
 
   // This is to report the local memory usage when memory-infra is enabled.
   MemoryDumpManager::GetInstance()->RegisterDumpProvider(
       this, "ThreadLocalEventBuffer", ThreadTaskRunnerHandle::Get());
 
   AutoLock lock(trace_log->lock_);
-  trace_log->thread_message_loops_.insert(message_loop);
+  trace_log->thread_message_loops_.insert(message_loop_);
 }
 
 TraceLog::ThreadLocalEventBuffer::~ThreadLocalEventBuffer() {
-  CheckThisIsCurrentBuffer();
-  MessageLoop::current()->RemoveDestructionObserver(this);
-  MemoryDumpManager::GetInstance()->UnregisterDumpProvider(this);
+  // The slot is already cleared when called by OnThreadExit().
+  DCHECK(!trace_log_->GetThreadLocalEventBuffer() ||
+         trace_log_->GetThreadLocalEventBuffer() == this);
 
-  {
+  if (message_loop_) {
+    message_loop_->RemoveDestructionObserver(this);
+    MemoryDumpManager::GetInstance()->UnregisterDumpProvider(this);
+
+    AutoLock lock(trace_log_->lock_);
+    FlushWhileLocked();
+    trace_log_->thread_message_loops_.erase(message_loop_);
+  } else {
+    AutoLock buffers_lock(trace_log_->buffers_without_message_loop_lock_);
     AutoLock lock(trace_log_->lock_);
     FlushWhileLocked();
-    trace_log_->thread_message_loops_.erase(MessageLoop::current());
+    Erase(trace_log_->buffers_without_message_loop_, this);
   }
   trace_log_->thread_local_event_buffer_.Set(nullptr);
 }
 
+// static
+void TraceLog::ThreadLocalEventBuffer::OnThreadExit(void* buffer) {
+  delete static_cast<ThreadLocalEventBuffer*>(buffer);
+}
+
+void TraceLog::ThreadLocalEventBuffer::FlushFromOtherThread() {
+  DCHECK(!message_loop_);
+  trace_log_->buffers_without_message_loop_lock_.AssertAcquired();
+
+  flushed_.store(true, std::memory_order_seq_cst);
+  // The event being written may need |lock_| to get a new chunk.
+  while (writing_.load(std::memory_order_seq_cst))
+    PlatformThread::YieldCurrentThread();
+
+  AutoLock lock(trace_log_->lock_);
+  FlushWhileLocked();
+}
+
 TraceEvent* TraceLog::ThreadLocalEventBuffer::AddTraceEvent(
     TraceEventHandle* handle) {
   CheckThisIsCurrentBuffer();
 
-  if (chunk_ && chunk_->IsFull()) {
+  if (!chunk_ || chunk_->IsFull()) {
+    // Hand the full chunk over and take the next one at once.
     AutoLock lock(trace_log_->lock_);
     FlushWhileLocked();
-    chunk_.reset();
-  }
-  if (!chunk_) {
-    AutoLock lock(trace_log_->lock_);
     chunk_ = trace_log_->logged_events_->GetChunk(&chunk_index_);
     trace_log_->CheckIfBufferIsFullWhileLocked();
   }
@@ -324,6 +396,80 @@ void TraceLog::ThreadLocalEventBuffer::FlushWhileLocked() {
   // find the generation mismatch and delete this buffer soon.
 }
 
+// The sampling state of the categories with ENABLED_FOR_SAMPLING, for the
+// events of one thread. Keeping it per thread spares the trace macros any
+// synchronization, at the price of rate limits that apply to each thread.
+class TraceLog::ThreadLocalSampler {
+ public:
+  ThreadLocalSampler() : generation_(-1) {}
+  ~ThreadLocalSampler() = default;
+
+  bool ShouldRecord(const TraceCategory* category,
+                    int generation,
+                    const TimeTicks& timestamp);
+
+  // ThreadLocalStorage destructor of TraceLog::thread_local_sampler_.
+  static void OnThreadExit(void* sampler);
+
+ private:
+  struct CategoryState {
+    uint32_t ratio_accumulator = 0;
+    // Token bucket of the rate limit, filled on the first event.
+    double tokens = 0;
+    TimeTicks last_refill;
+  };
+
+  int generation_;
+  CategoryState states_[CategoryRegistry::kMaxCategories];
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadLocalSampler);
+};
+
+bool TraceLog::ThreadLocalSampler::ShouldRecord(const TraceCategory* category,
+                                                int generation,
+                                                const TimeTicks& timestamp) {
+  if (generation != generation_) {
+    // The sampling rules may have changed; start over.
+    std::fill(std::begin(states_), std::end(states_), CategoryState());
+    generation_ = generation;
+  }
+  CategoryState& state = states_[CategoryRegistry::GetCategoryIndex(category)];
+
+  // Keeps the events which carry the accumulated ratio over a whole unit, so
+  // exactly the requested fraction is recorded, without random numbers.
+  const uint32_t sampling_ratio = category->sampling_ratio();
+  if (sampling_ratio < TraceCategory::kSamplingRatioScale) {
+    state.ratio_accumulator += sampling_ratio;
+    if (state.ratio_accumulator < TraceCategory::kSamplingRatioScale)
+      return false;
+    state.ratio_accumulator -= TraceCategory::kSamplingRatioScale;
+  }
+
+  const uint32_t max_events_per_second = category->max_events_per_second();
+  if (!max_events_per_second)
+    return true;
+  // The bucket holds up to one second worth of events.
+  if (state.last_refill.is_null()) {
+    state.tokens = max_events_per_second;
+    state.last_refill = timestamp;
+  } else if (timestamp > state.last_refill) {
+    state.tokens = std::min<double>(
+        max_events_per_second,
+        state.tokens + (timestamp - state.last_refill).InSecondsF() *
+                           max_events_per_second);
+    state.last_refill = timestamp;
+  }
+  if (state.tokens < 1.0)
+    return false;
+  state.tokens -= 1.0;
+  return true;
+}
+
+// static
+void TraceLog::ThreadLocalSampler::OnThreadExit(void* sampler) {
+  delete static_cast<ThreadLocalSampler*>(sampler);
+}
+
 void TraceLog::SetAddTraceEventOverride(
     const AddTraceEventOverrideCallback& override) {
   subtle::NoBarrier_Store(&trace_event_override_,
@@ -367,7 +513,11 @@ TraceLog::TraceLog()
       process_id_(0),
       trace_options_(kInternalRecordUntilFull),
       trace_config_(TraceConfig()),
+      thread_local_event_buffer_(&ThreadLocalEventBuffer::OnThreadExit),
+      thread_local_sampler_(&ThreadLocalSampler::OnThreadExit),
+      sampling_generation_(0),
       thread_shared_chunk_index_(0),
+      flush_stops_stream_(false),
       generation_(0),
       use_worker_thread_(false),
       trace_event_override_(0),
@@ -399,22 +549,19 @@ TraceLog::TraceLog()
 TraceLog::~TraceLog() = default;
 
 void TraceLog::InitializeThreadLocalEventBufferIfSupported() {
-  // A ThreadLocalEventBuffer needs the message loop
-  // - to know when the thread exits;
-  // - to handle the final flush.
-  // For a thread without a message loop or the message loop may be blocked, the
-  // trace events will be added into the main buffer directly.
-  if (thread_blocks_message_loop_.Get() || !MessageLoopCurrent::IsSet())
-    return;
   HEAP_PROFILER_SCOPED_IGNORE;
-  auto* thread_local_event_buffer = thread_local_event_buffer_.Get();
+  auto* thread_local_event_buffer = GetThreadLocalEventBuffer();
   if (thread_local_event_buffer &&
       !CheckGeneration(thread_local_event_buffer->generation())) {
     delete thread_local_event_buffer;
     thread_local_event_buffer = nullptr;
   }
   if (!thread_local_event_buffer) {
-    thread_local_event_buffer = new ThreadLocalEventBuffer(this);
+    // A message loop that may be blocked can't be relied on for the flush.
+    MessageLoop* message_loop = nullptr;
+    if (!thread_blocks_message_loop_.Get() && MessageLoopCurrent::IsSet())
+      message_loop = MessageLoop::current();
+    thread_local_event_buffer = new ThreadLocalEventBuffer(this, message_loop);
     thread_local_event_buffer_.Set(thread_local_event_buffer);
   }
 }
@@ -505,12 +652,30 @@ void TraceLog::UpdateCategoryState(TraceCategory* category) {
     }
   }
   category->set_enabled_filters(enabled_filters_bitmap);
+
+  const TraceConfigCategoryFilter::SamplingRule* sampling_rule = nullptr;
+  if (state_flags & TraceCategory::ENABLED_FOR_RECORDING &&
+      category != CategoryRegistry::kCategoryMetadata) {
+    sampling_rule =
+        trace_config_.category_filter().GetSamplingRule(category->name());
+  }
+  if (sampling_rule && (sampling_rule->sampling_ratio < 1.0 ||
+                        sampling_rule->max_events_per_second)) {
+    category->set_sampling(
+        static_cast<uint32_t>(sampling_rule->sampling_ratio *
+                              TraceCategory::kSamplingRatioScale),
+        sampling_rule->max_events_per_second);
+    state_flags |= TraceCategory::ENABLED_FOR_SAMPLING;
+  } else {
+    category->set_sampling(0, 0);
+  }
   category->set_state(state_flags);
 }
 
 void TraceLog::UpdateCategoryRegistry() {
   lock_.AssertAcquired();
   CreateFiltersForTraceConfig();
+  subtle::NoBarrier_AtomicIncrement(&sampling_generation_, 1);
   for (TraceCategory& category : CategoryRegistry::GetAllCategories()) {
     UpdateCategoryState(&category);
   }
@@ -569,6 +734,8 @@ void TraceLog::SetEnabled(const TraceConfig& trace_config,
 
     InternalTraceOptions new_options =
         GetInternalOptionsFromTraceConfig(trace_config);
+    if (stream_writer_)
+      new_options |= kInternalStreamToWriter;
 
     InternalTraceOptions old_options = trace_options();
 
@@ -618,6 +785,19 @@ void TraceLog::SetEnabled(const TraceConfig& trace_config,
     if (!(modes_to_enable & RECORDING_MODE) || already_recording)
       return;
 
+    if (stream_writer_) {
+      stream_writer_->SetDropWhenFull(true);
+      if (!stream_writer_->Start((new_options & kInternalEnableArgumentFilter)
+                                     ? argument_filter_predicate_
+                                     : ArgumentFilterPredicate())) {
+        // Without its thread, the writer would never drain the chunks.
+        LOG(ERROR) << "Failed to start the trace stream writer, recording "
+                      "the trace in memory instead";
+        stream_writer_.reset();
+        new_options &= ~kInternalStreamToWriter;
+      }
+    }
+
     if (new_options != old_options) {
       subtle::NoBarrier_Store(&trace_options_, new_options);
       UseNextTraceBuffer();
@@ -824,8 +1004,9 @@ void TraceLog::CheckIfBufferIsFullWhileLocked() {
 // Flush() works as the following:
 // 1. Flush() is called in thread A whose task runner is saved in
 //    flush_task_runner_;
-// 2. If thread_message_loops_ is not empty, thread A posts task to each message
-//    loop to flush the thread local buffers; otherwise finish the flush;
+// 2. Thread A flushes the thread local buffers of the threads without a message
+//    loop itself, then if thread_message_loops_ is not empty, posts task to
+//    each message loop to flush their buffers; otherwise finish the flush;
 // 3. FlushCurrentThread() deletes the thread local event buffer:
 //    - The last batch of events of the thread are flushed into the main buffer;
 //    - The message loop will be removed from thread_message_loops_;
@@ -836,6 +1017,70 @@ void TraceLog::Flush(const TraceLog::OutputCallback& cb,
   FlushInternal(cb, use_worker_thread, false);
 }
 
+void TraceLog::FlushToBinaryWriter(std::unique_ptr<BinaryTraceWriter> writer,
+                                   BinaryFlushCallback callback,
+                                   bool use_worker_thread) {
+  DCHECK(writer);
+  if (IsEnabled()) {
+    // See FlushInternal().
+    LOG(WARNING) << "Ignored TraceLog::FlushToBinaryWriter called when tracing "
+                    "is enabled";
+    if (!callback.is_null())
+      std::move(callback).Run(std::move(writer));
+    return;
+  }
+  {
+    AutoLock lock(lock_);
+    DCHECK(!flush_binary_writer_);
+    flush_binary_writer_ = std::move(writer);
+    flush_binary_callback_ = std::move(callback);
+  }
+  FlushInternal(OutputCallback(), use_worker_thread, false);
+}
+
+bool TraceLog::StartStreaming(std::unique_ptr<BinaryTraceWriter> writer,
+                              size_t max_pending_chunks) {
+  DCHECK(writer);
+  AutoLock lock(lock_);
+  if ((enabled_modes_ & RECORDING_MODE) || stream_writer_) {
+    LOG(WARNING) << "Ignored TraceLog::StartStreaming called when tracing is "
+                    "enabled or streaming already";
+    return false;
+  }
+  stream_writer_.reset(
+      new TraceStreamWriter(std::move(writer), max_pending_chunks));
+  return true;
+}
+
+void TraceLog::StopStreaming(BinaryFlushCallback callback) {
+  bool stopping = false;
+  {
+    AutoLock lock(lock_);
+    if (stream_writer_ && !(enabled_modes_ & RECORDING_MODE)) {
+      DCHECK(!flush_binary_writer_);
+      flush_stops_stream_ = true;
+      flush_binary_callback_ = std::move(callback);
+      stopping = true;
+    }
+  }
+  if (!stopping) {
+    LOG(WARNING) << "Ignored TraceLog::StopStreaming called without a stream "
+                    "or when tracing is enabled";
+    if (!callback.is_null())
+      std::move(callback).Run(nullptr);
+    return;
+  }
+  FlushInternal(OutputCallback(), false, false);
+}
+
+bool TraceLog::GetStreamStats(TraceStreamWriter::Stats* stats) const {
+  AutoLock lock(lock_);
+  if (!stream_writer_)
+    return false;
+  *stats = stream_writer_->GetStats();
+  return true;
+}
+
 void TraceLog::CancelTracing(const OutputCallback& cb) {
   SetDisabled();
   FlushInternal(cb, false, true);
@@ -879,6 +1124,12 @@ void TraceLog::FlushInternal(const TraceLog::OutputCallback& cb,
       thread_message_loop_task_runners.push_back(loop->task_runner());
   }
 
+  {
+    AutoLock buffers_lock(buffers_without_message_loop_lock_);
+    for (ThreadLocalEventBuffer* buffer : buffers_without_message_loop_)
+      buffer->FlushFromOtherThread();
+  }
+
   if (!thread_message_loop_task_runners.empty()) {
     for (auto& task_runner : thread_message_loop_task_runners) {
       task_runner->PostTask(
@@ -927,9 +1178,27 @@ void TraceLog::ConvertTraceEventsToTraceFormat(
   flush_output_callback.Run(json_events_str_ptr, false);
 }
 
+// Usually it runs on a different thread.
+void TraceLog::ConvertTraceEventsToBinaryFormat(
+    std::unique_ptr<TraceBuffer> logged_events,
+    std::unique_ptr<BinaryTraceWriter> writer,
+    BinaryFlushCallback callback,
+    const ArgumentFilterPredicate& argument_filter_predicate) {
+  HEAP_PROFILER_SCOPED_IGNORE;
+  // The writer writes out its buffer as it fills up.
+  while (const TraceBufferChunk* chunk = logged_events->NextChunk())
+    writer->AddChunk(*chunk, argument_filter_predicate);
+  writer->Flush();
+  if (!callback.is_null())
+    std::move(callback).Run(std::move(writer));
+}
+
 void TraceLog::FinishFlush(int generation, bool discard_events) {
   std::unique_ptr<TraceBuffer> previous_logged_events;
   OutputCallback flush_output_callback;
+  std::unique_ptr<BinaryTraceWriter> flush_binary_writer;
+  BinaryFlushCallback flush_binary_callback;
+  std::unique_ptr<TraceStreamWriter> stream_writer;
   ArgumentFilterPredicate argument_filter_predicate;
 
   if (!CheckGeneration(generation))
@@ -938,6 +1207,12 @@ void TraceLog::FinishFlush(int generation, bool discard_events) {
   {
     AutoLock lock(lock_);
 
+    if (flush_stops_stream_) {
+      flush_stops_stream_ = false;
+      stream_writer = std::move(stream_writer_);
+      subtle::NoBarrier_Store(&trace_options_,
+                              trace_options() & ~kInternalStreamToWriter);
+    }
     previous_logged_events.swap(logged_events_);
     UseNextTraceBuffer();
     thread_message_loops_.clear();
@@ -945,6 +1220,8 @@ void TraceLog::FinishFlush(int generation, bool discard_events) {
     flush_task_runner_ = nullptr;
     flush_output_callback = flush_output_callback_;
     flush_output_callback_.Reset();
+    flush_binary_writer = std::move(flush_binary_writer_);
+    flush_binary_callback = std::move(flush_binary_callback_);
 
     if (trace_options() & kInternalEnableArgumentFilter) {
       CHECK(!argument_filter_predicate_.is_null());
@@ -952,6 +1229,40 @@ void TraceLog::FinishFlush(int generation, bool discard_events) {
     }
   }
 
+  if (stream_writer) {
+    // The streaming buffer doesn't keep any events; they are all in the
+    // stream already, or about to be written.
+    previous_logged_events.reset();
+    std::unique_ptr<BinaryTraceWriter> writer = stream_writer->Finish();
+    if (!flush_binary_callback.is_null())
+      std::move(flush_binary_callback).Run(std::move(writer));
+    return;
+  }
+
+  if (flush_binary_writer) {
+    if (discard_events) {
+      if (!flush_binary_callback.is_null())
+        std::move(flush_binary_callback).Run(std::move(flush_binary_writer));
+      return;
+    }
+    if (use_worker_thread_) {
+      base::PostTaskWithTraits(
+          FROM_HERE,
+          {MayBlock(), TaskPriority::BACKGROUND,
+           TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN},
+          BindOnce(&TraceLog::ConvertTraceEventsToBinaryFormat,
+                   std::move(previous_logged_events),
+                   std::move(flush_binary_writer),
+                   std::move(flush_binary_callback),
+                   argument_filter_predicate));
+      return;
+    }
+    ConvertTraceEventsToBinaryFormat(
+        std::move(previous_logged_events), std::move(flush_binary_writer),
+        std::move(flush_binary_callback), argument_filter_predicate);
+    return;
+  }
+
   if (discard_events) {
     if (!flush_output_callback.is_null()) {
       scoped_refptr<RefCountedString> empty_result = new RefCountedString;
@@ -987,7 +1298,7 @@ void TraceLog::FlushCurrentThread(int generation, bool discard_events) {
   }
 
   // This will flush the thread local buffer.
-  delete thread_local_event_buffer_.Get();
+  delete GetThreadLocalEventBuffer();
 
   // Scheduler uses TRACE_EVENT macros when posting a task, which can lead
   // to acquiring a tracing lock. Given that posting a task requires grabbing
@@ -1035,6 +1346,37 @@ void TraceLog::UseNextTraceBuffer() {
   thread_shared_chunk_index_ = 0;
 }
 
+bool TraceLog::ShouldRecordSampledEvent(
+    char phase,
+    const unsigned char* category_group_enabled,
+    const TimeTicks& timestamp) {
+  switch (phase) {
+    case TRACE_EVENT_PHASE_COMPLETE:
+      // The override gets the end of the event as a separate _END event,
+      // which couldn't be matched with a dropped beginning.
+      if (subtle::NoBarrier_Load(&trace_event_override_))
+        return true;
+      break;
+    case TRACE_EVENT_PHASE_INSTANT:
+    case TRACE_EVENT_PHASE_COUNTER:
+      break;
+    default:
+      // The other events come in pairs, or are needed to make sense of the
+      // trace.
+      return true;
+  }
+
+  auto* sampler = static_cast<ThreadLocalSampler*>(thread_local_sampler_.Get());
+  if (!sampler) {
+    HEAP_PROFILER_SCOPED_IGNORE;
+    sampler = new ThreadLocalSampler();
+    thread_local_sampler_.Set(sampler);
+  }
+  return sampler->ShouldRecord(
+      CategoryRegistry::GetCategoryByStatePtr(category_group_enabled),
+      subtle::NoBarrier_Load(&sampling_generation_), timestamp);
+}
+
 TraceEventHandle TraceLog::AddTraceEvent(
     char phase,
     const unsigned char* category_group_enabled,
@@ -1192,6 +1534,12 @@ TraceEventHandle TraceLog::AddTraceEventWithThreadIdAndTimestamp(
   DCHECK(name);
   DCHECK(!timestamp.is_null());
 
+  if (UNLIKELY(*category_group_enabled &
+               TraceCategory::ENABLED_FOR_SAMPLING) &&
+      !ShouldRecordSampledEvent(phase, category_group_enabled, timestamp)) {
+    return handle;
+  }
+
   if (flags & TRACE_EVENT_FLAG_MANGLE_ID) {
     if ((flags & TRACE_EVENT_FLAG_FLOW_IN) ||
         (flags & TRACE_EVENT_FLAG_FLOW_OUT))
@@ -1204,10 +1552,8 @@ TraceEventHandle TraceLog::AddTraceEventWithThreadIdAndTimestamp(
 
   ThreadLocalEventBuffer* thread_local_event_buffer = nullptr;
   if (*category_group_enabled & RECORDING_MODE) {
-    // |thread_local_event_buffer_| can be null if the current thread doesn't
-    // have a message loop or the message loop is blocked.
     InitializeThreadLocalEventBufferIfSupported();
-    thread_local_event_buffer = thread_local_event_buffer_.Get();
+    thread_local_event_buffer = GetThreadLocalEventBuffer();
   }
 
   // Check and update the current thread name only if the event is for the
@@ -1301,6 +1647,10 @@ TraceEventHandle TraceLog::AddTraceEventWithThreadIdAndTimestamp(
       !disabled_by_filters) {
     OptionalAutoLock lock(&lock_);
 
+    // Once flushed by another thread, the events go to the shared chunk.
+    if (thread_local_event_buffer && !thread_local_event_buffer->BeginWrite())
+      thread_local_event_buffer = nullptr;
+
     TraceEvent* trace_event = nullptr;
     if (thread_local_event_buffer) {
       trace_event = thread_local_event_buffer->AddTraceEvent(&handle);
@@ -1323,6 +1673,8 @@ TraceEventHandle TraceLog::AddTraceEventWithThreadIdAndTimestamp(
       trace_event->SendToATrace();
 #endif
     }
+    if (thread_local_event_buffer)
+      thread_local_event_buffer->EndWrite();
 
     if (trace_options() & kInternalEchoToConsole) {
       console_message = EventToConsoleMessage(
@@ -1446,6 +1798,13 @@ void TraceLog::UpdateTraceEventDurationExplicit(
   if (!category_group_enabled_local)
     return;
 
+  // There is nothing to end for a complete event dropped by the sampling,
+  // see ShouldRecordSampledEvent().
+  if (category_group_enabled_local & TraceCategory::ENABLED_FOR_SAMPLING &&
+      !handle.chunk_seq && !subtle::NoBarrier_Load(&trace_event_override_)) {
+    return;
+  }
+
   // Avoid re-entrance of AddTraceEvent. This may happen in GPU process when
   // ECHO_TO_CONSOLE is enabled: AddTraceEvent -> LOG(ERROR) ->
   // GpuProcessLogMessageHandler -> PostPendingTask -> TRACE_EVENT ...
@@ -1460,6 +1819,7 @@ void TraceLog::UpdateTraceEventDurationExplicit(
 #endif  // OS_WIN
 
   std::string console_message;
+  bool add_end_event = false;
   if (category_group_enabled_local & TraceCategory::ENABLED_FOR_RECORDING) {
     AddTraceEventOverrideCallback trace_event_override =
         reinterpret_cast<AddTraceEventOverrideCallback>(
@@ -1481,7 +1841,15 @@ void TraceLog::UpdateTraceEventDurationExplicit(
       return;
     }
 
+    ThreadLocalEventBuffer* thread_local_event_buffer =
+        GetThreadLocalEventBuffer();
     OptionalAutoLock lock(&lock_);
+    // A buffer flushed by another thread may only be looked into with the
+    // lock held.
+    if (thread_local_event_buffer && !thread_local_event_buffer->BeginWrite())
+      thread_local_event_buffer = nullptr;
+    if (!thread_local_event_buffer)
+      lock.EnsureAcquired();
 
     TraceEvent* trace_event = GetEventByHandleInternal(handle, &lock);
     if (trace_event) {
@@ -1502,12 +1870,24 @@ void TraceLog::UpdateTraceEventDurationExplicit(
 #if defined(OS_ANDROID)
       trace_event->SendToATrace();
 #endif
+    } else if (handle.chunk_seq &&
+               (trace_options() & kInternalStreamToWriter)) {
+      // The event was streamed out before it finished and was written as a
+      // _BEGIN event, see TraceStreamWriter.
+      add_end_event = true;
     }
 
     if (trace_options() & kInternalEchoToConsole) {
       console_message =
           EventToConsoleMessage(TRACE_EVENT_PHASE_END, now, trace_event);
     }
+    if (thread_local_event_buffer)
+      thread_local_event_buffer->EndWrite();
+  }
+
+  if (add_end_event) {
+    AddEndEventForStreamedCompleteEvent(category_group_enabled, name, now,
+                                        thread_now);
   }
 
   if (!console_message.empty())
@@ -1517,6 +1897,37 @@ void TraceLog::UpdateTraceEventDurationExplicit(
     EndFilteredEvent(category_group_enabled, name, handle);
 }
 
+void TraceLog::AddEndEventForStreamedCompleteEvent(
+    const unsigned char* category_group_enabled,
+    const char* name,
+    const TimeTicks& now,
+    const ThreadTicks& thread_now) {
+  InitializeThreadLocalEventBufferIfSupported();
+  ThreadLocalEventBuffer* thread_local_event_buffer =
+      GetThreadLocalEventBuffer();
+
+  OptionalAutoLock lock(&lock_);
+  if (thread_local_event_buffer && !thread_local_event_buffer->BeginWrite())
+    thread_local_event_buffer = nullptr;
+  TraceEvent* trace_event = nullptr;
+  if (thread_local_event_buffer) {
+    trace_event = thread_local_event_buffer->AddTraceEvent(nullptr);
+  } else {
+    lock.EnsureAcquired();
+    trace_event = AddEventToThreadSharedChunkWhileLocked(nullptr, true);
+  }
+  if (trace_event) {
+    trace_event->Initialize(
+        static_cast<int>(PlatformThread::CurrentId()), now, thread_now,
+        TRACE_EVENT_PHASE_END, category_group_enabled, name,
+        trace_event_internal::kGlobalScope, trace_event_internal::kNoId,
+        trace_event_internal::kNoId, 0, nullptr, nullptr, nullptr, nullptr,
+        TRACE_EVENT_FLAG_NONE);
+  }
+  if (thread_local_event_buffer)
+    thread_local_event_buffer->EndWrite();
+}
+
 uint64_t TraceLog::MangleEventId(uint64_t id) {
   return id ^ process_id_hash_;
 }
@@ -1599,10 +2010,36 @@ void TraceLog::AddMetadataEventsWhileLocked() {
         current_thread_id, "trace_buffer_overflowed", "overflowed_at_ts",
         buffer_limit_reached_timestamp_);
   }
+
+  // If the stream writer fell behind, report how much was dropped. The tail
+  // of the trace is never dropped, so the count is final.
+  if (stream_writer_) {
+    stream_writer_->SetDropWhenFull(false);
+    const size_t events_dropped = stream_writer_->GetStats().events_dropped;
+    if (events_dropped) {
+      InitializeMetadataEvent(
+          AddEventToThreadSharedChunkWhileLocked(nullptr, false),
+          current_thread_id, "trace_stream_dropped_events", "count",
+          static_cast<uint64_t>(events_dropped));
+    }
+  }
 }
 
 TraceEvent* TraceLog::GetEventByHandle(TraceEventHandle handle) {
-  return GetEventByHandleInternal(handle, nullptr);
+  // Like UpdateTraceEventDuration(), keep another thread from flushing the
+  // buffer of this thread while looking into it.
+  ThreadLocalEventBuffer* thread_local_event_buffer =
+      GetThreadLocalEventBuffer();
+  OptionalAutoLock lock(&lock_);
+  if (thread_local_event_buffer && !thread_local_event_buffer->BeginWrite())
+    thread_local_event_buffer = nullptr;
+  if (!thread_local_event_buffer)
+    lock.EnsureAcquired();
+
+  TraceEvent* trace_event = GetEventByHandleInternal(handle, &lock);
+  if (thread_local_event_buffer)
+    thread_local_event_buffer->EndWrite();
+  return trace_event;
 }
 
 TraceEvent* TraceLog::GetEventByHandleInternal(TraceEventHandle handle,
@@ -1614,9 +2051,9 @@ TraceEvent* TraceLog::GetEventByHandleInternal(TraceEventHandle handle,
   DCHECK(handle.chunk_index <= TraceBufferChunk::kMaxChunkIndex);
   DCHECK(handle.event_index <= TraceBufferChunk::kTraceBufferChunkSize - 1);
 
-  if (thread_local_event_buffer_.Get()) {
+  if (GetThreadLocalEventBuffer()) {
     TraceEvent* trace_event =
-        thread_local_event_buffer_.Get()->GetEventByHandle(handle);
+        GetThreadLocalEventBuffer()->GetEventByHandle(handle);
     if (trace_event)
       return trace_event;
   }
@@ -1681,12 +2118,16 @@ size_t TraceLog::GetObserverCountForTest() const {
 void TraceLog::SetCurrentThreadBlocksMessageLoop() {
   thread_blocks_message_loop_.Set(true);
   // This will flush the thread local buffer.
-  delete thread_local_event_buffer_.Get();
+  delete GetThreadLocalEventBuffer();
 }
 
 TraceBuffer* TraceLog::CreateTraceBuffer() {
   HEAP_PROFILER_SCOPED_IGNORE;
   InternalTraceOptions options = trace_options();
+  if (options & kInternalStreamToWriter) {
+    DCHECK(stream_writer_);
+    return TraceBuffer::CreateTraceBufferStreaming(stream_writer_.get());
+  }
   if (options & kInternalRecordContinuously) {
     return TraceBuffer::CreateTraceBufferRingBuffer(
         kTraceEventRingBufferChunks);
@@ -14,13 +14,17 @@
 #include <vector>
 
 #include "brick/atomicops.h"
+#include "brick/callback.h"
 #include "brick/containers/stack.h"
 #include "brick/gtest_prod_util.h"
 #include "brick/macros.h"
+#include "brick/synchronization/lock.h"
+#include "brick/threading/thread_local_storage.h"
 #include "brick/time/time_override.h"
 #include "brick/trace_event/memory_dump_provider.h"
 #include "brick/trace_event/trace_config.h"
 #include "brick/trace_event/trace_event_impl.h"
+#include "brick/trace_event/trace_stream_writer.h"
 #include "build/build_config.h"
 
 namespace base {
@@ -34,6 +38,7 @@ class NoDestructor;
 namespace trace_event {
 
 struct TraceCategory;
+class BinaryTraceWriter;
 class TraceBuffer;
 class TraceBufferChunk;
 class TraceEvent;
@@ -68,8 +73,8 @@ class BRICK_EXPORT TraceLog : public MemoryDumpProvider {
   // Retrieves a copy (for thread-safety) of the current TraceConfig.
   TraceConfig GetCurrentTraceConfig() const;
 
-  // Initializes the thread-local event buffer, if not already initialized and
-  // if the current thread supports that (has a message loop).
+  // Initializes the thread-local event buffer, if not already initialized.
+  // Every thread gets one, with or without a message loop.
   void InitializeThreadLocalEventBufferIfSupported();
 
   // See TraceConfig comments for details on how to control which categories
@@ -175,6 +180,41 @@ class BRICK_EXPORT TraceLog : public MemoryDumpProvider {
                               bool has_more_events)> OutputCallback;
   void Flush(const OutputCallback& cb, bool use_worker_thread = false);
 
+  // Like Flush(), but serializes the events with |writer| in the compact
+  // binary format of binary_trace_format.h instead of JSON. |callback| gets
+  // the writer back once every event has been written to it and flushed. Like
+  // the OutputCallback of Flush(), it runs on the thread that serialized the
+  // events, which is a worker thread if |use_worker_thread| is set.
+  using BinaryFlushCallback =
+      OnceCallback<void(std::unique_ptr<BinaryTraceWriter> writer)>;
+  void FlushToBinaryWriter(std::unique_ptr<BinaryTraceWriter> writer,
+                           BinaryFlushCallback callback,
+                           bool use_worker_thread = false);
+
+  // Streams the trace to |writer| on a background thread while tracing
+  // continues, instead of keeping it in the trace buffer until it is flushed.
+  // This lets tracing run for hours with bounded memory. Takes effect at the
+  // next SetEnabled() and lasts until StopStreaming(); Flush() returns no
+  // events in between. When the writer falls behind, the full chunks beyond
+  // |max_pending_chunks| are dropped; see GetStreamStats() and the
+  // "trace_stream_dropped_events" metadata event. Complete events that end
+  // after being streamed are split into begin and end events. Returns false
+  // if tracing is enabled or a stream is set already. If the writer thread
+  // can't be started, SetEnabled() drops the stream and records the trace in
+  // the trace buffer as usual.
+  bool StartStreaming(std::unique_ptr<BinaryTraceWriter> writer,
+                      size_t max_pending_chunks =
+                          TraceStreamWriter::kDefaultMaxPendingChunks);
+
+  // To be called after SetDisabled(). Streams the remaining events and the
+  // metadata, stops the stream and passes |writer| back to |callback| once
+  // it is flushed, on the calling thread. The callback gets null if there is
+  // no stream or tracing is still enabled, in which case the stream goes on.
+  void StopStreaming(BinaryFlushCallback callback);
+
+  // Returns false if there is no stream.
+  bool GetStreamStats(TraceStreamWriter::Stats* stats) const;
+
   // Cancels tracing and discards collected data.
   void CancelTracing(const OutputCallback& cb);
 
@@ -388,18 +428,38 @@ class BRICK_EXPORT TraceLog : public MemoryDumpProvider {
       const TraceConfig& config);
 
   class ThreadLocalEventBuffer;
+  class ThreadLocalSampler;
   class OptionalAutoLock;
   struct RegisteredAsyncObserver;
 
   TraceLog();
   ~TraceLog() override;
   void AddMetadataEventsWhileLocked();
+  // Records the end of a complete event that was streamed out before it
+  // finished, as a separate _END event.
+  void AddEndEventForStreamedCompleteEvent(
+      const unsigned char* category_group_enabled,
+      const char* name,
+      const TimeTicks& now,
+      const ThreadTicks& thread_now);
+
+  // Applies the sampling ratio and the rate limit of a category with
+  // ENABLED_FOR_SAMPLING to an event of the current thread. Returns false if
+  // the event must be dropped.
+  bool ShouldRecordSampledEvent(char phase,
+                                const unsigned char* category_group_enabled,
+                                const TimeTicks& timestamp);
 
   InternalTraceOptions trace_options() const {
     return static_cast<InternalTraceOptions>(
         subtle::NoBarrier_Load(&trace_options_));
   }
 
+  ThreadLocalEventBuffer* GetThreadLocalEventBuffer() {
+    return static_cast<ThreadLocalEventBuffer*>(
+        thread_local_event_buffer_.Get());
+  }
+
   TraceBuffer* trace_buffer() const { return logged_events_.get(); }
   TraceBuffer* CreateTraceBuffer();
 
@@ -427,6 +487,11 @@ class BRICK_EXPORT TraceLog : public MemoryDumpProvider {
       std::unique_ptr<TraceBuffer> logged_events,
       const TraceLog::OutputCallback& flush_output_callback,
       const ArgumentFilterPredicate& argument_filter_predicate);
+  static void ConvertTraceEventsToBinaryFormat(
+      std::unique_ptr<TraceBuffer> logged_events,
+      std::unique_ptr<BinaryTraceWriter> writer,
+      BinaryFlushCallback callback,
+      const ArgumentFilterPredicate& argument_filter_predicate);
   void FinishFlush(int generation, bool discard_events);
   void OnFlushTimeout(int generation, bool discard_events);
 
@@ -454,6 +519,7 @@ class BRICK_EXPORT TraceLog : public MemoryDumpProvider {
   static const InternalTraceOptions kInternalEchoToConsole;
   static const InternalTraceOptions kInternalRecordAsMuchAsPossible;
   static const InternalTraceOptions kInternalEnableArgumentFilter;
+  static const InternalTraceOptions kInternalStreamToWriter;
 
   // This lock protects TraceLog member accesses (except for members protected
   // by thread_info_lock_) from arbitrary threads.
@@ -495,7 +561,13 @@ class BRICK_EXPORT TraceLog : public MemoryDumpProvider {
   TraceConfig trace_config_;
   TraceConfig::EventFilters enabled_event_filters_;
 
-  ThreadLocalPointer<ThreadLocalEventBuffer> thread_local_event_buffer_;
+  // Deletes the buffer of a thread without a message loop when it exits.
+  ThreadLocalStorage::Slot thread_local_event_buffer_;
+  // Deletes the sampling state of a thread when it exits.
+  ThreadLocalStorage::Slot thread_local_sampler_;
+  // Incremented whenever the sampling rules may change, to reset the sampling
+  // state of all the threads.
+  subtle::Atomic32 sampling_generation_;
   ThreadLocalBoolean thread_blocks_message_loop_;
   ThreadLocalBoolean thread_is_in_trace_event_;
 
@@ -504,13 +576,29 @@ class BRICK_EXPORT TraceLog : public MemoryDumpProvider {
   // because we need to know the life time of the message loops.
   hash_set<MessageLoop*> thread_message_loops_;
 
-  // For events which can't be added into the thread local buffer, e.g. events
-  // from threads without a message loop.
+  // The buffers of the threads that have no message loop to flush them, or
+  // whose message loop may be blocked. Flush() collects their chunks itself.
+  // Acquired before |lock_|.
+  Lock buffers_without_message_loop_lock_;
+  // Protected by |buffers_without_message_loop_lock_|.
+  std::vector<ThreadLocalEventBuffer*> buffers_without_message_loop_;
+
+  // Set by StartStreaming(); the destination of |logged_events_| while
+  // |trace_options_| has kInternalStreamToWriter.
+  std::unique_ptr<TraceStreamWriter> stream_writer_;
+
+  // For events which can't be added into the thread local buffer, e.g. the
+  // metadata events and the events of a thread whose buffer was flushed.
   std::unique_ptr<TraceBufferChunk> thread_shared_chunk_;
   size_t thread_shared_chunk_index_;
 
   // Set when asynchronous Flush is in progress.
   OutputCallback flush_output_callback_;
+  // Set instead of |flush_output_callback_| by FlushToBinaryWriter().
+  std::unique_ptr<BinaryTraceWriter> flush_binary_writer_;
+  BinaryFlushCallback flush_binary_callback_;
+  // Set by StopStreaming() for the flush that ends the stream.
+  bool flush_stops_stream_;
   scoped_refptr<SequencedTaskRunner> flush_task_runner_;
   ArgumentFilterPredicate argument_filter_predicate_;
   subtle::AtomicWord generation_;
@@ -0,0 +1,169 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/trace_stream_writer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "brick/logging.h"
+#include "brick/trace_event/binary_trace_writer.h"
+#include "brick/trace_event/trace_buffer.h"
+#include "brick/trace_event/trace_event_memory_overhead.h"
+
+namespace base {
+namespace trace_event {
+
+TraceStreamWriter::TraceStreamWriter(std::unique_ptr<BinaryTraceWriter> writer,
+                                     size_t max_pending_chunks)
+    : max_pending_chunks_(max_pending_chunks),
+      chunk_queued_(&lock_),
+      writer_(std::move(writer)) {
+  DCHECK(writer_);
+  DCHECK_GT(max_pending_chunks_, 0u);
+  // Unfinished complete events are written before their end is known.
+  writer_->set_write_unfinished_complete_events_as_begin(true);
+}
+
+TraceStreamWriter::~TraceStreamWriter() {
+  if (!stopping_)
+    Finish();
+}
+
+bool TraceStreamWriter::Start(
+    const ArgumentFilterPredicate& argument_filter_predicate) {
+  AutoLock lock(lock_);
+  DCHECK(!stopping_);
+  if (started_)
+    return true;
+  argument_filter_predicate_ = argument_filter_predicate;
+  if (!PlatformThread::CreateWithPriority(0, this, &thread_handle_,
+                                          ThreadPriority::BACKGROUND)) {
+    DLOG(ERROR) << "Failed to create the trace stream writer thread";
+    return false;
+  }
+  started_ = true;
+  return true;
+}
+
+void TraceStreamWriter::AddChunk(std::unique_ptr<TraceBufferChunk> chunk) {
+  DCHECK(chunk);
+  AutoLock lock(lock_);
+  DCHECK(!stopping_);
+  if (!chunk->size()) {
+    if (free_chunks_.size() < max_pending_chunks_)
+      free_chunks_.push_back(std::move(chunk));
+    return;
+  }
+  if (drop_when_full_ && chunk->IsFull() &&
+      pending_chunks_.size() >= max_pending_chunks_) {
+    ++stats_.chunks_dropped;
+    stats_.events_dropped += chunk->size();
+    // Reuse the chunk, as the writer is evidently busy.
+    chunk->Reset(chunk->seq());
+    if (free_chunks_.size() < max_pending_chunks_)
+      free_chunks_.push_back(std::move(chunk));
+    return;
+  }
+  pending_chunks_.push_back(std::move(chunk));
+  stats_.peak_pending_chunks =
+      std::max(stats_.peak_pending_chunks, pending_chunks_.size());
+  chunk_queued_.Signal();
+}
+
+std::unique_ptr<TraceBufferChunk> TraceStreamWriter::TakeFreeChunk() {
+  AutoLock lock(lock_);
+  if (free_chunks_.empty())
+    return nullptr;
+  std::unique_ptr<TraceBufferChunk> chunk = std::move(free_chunks_.back());
+  free_chunks_.pop_back();
+  return chunk;
+}
+
+void TraceStreamWriter::SetDropWhenFull(bool drop_when_full) {
+  AutoLock lock(lock_);
+  drop_when_full_ = drop_when_full;
+}
+
+std::unique_ptr<BinaryTraceWriter> TraceStreamWriter::Finish() {
+  bool started;
+  {
+    AutoLock lock(lock_);
+    DCHECK(!stopping_);
+    stopping_ = true;
+    started = started_;
+    chunk_queued_.Signal();
+  }
+  if (started)
+    PlatformThread::Join(thread_handle_);
+  else
+    WriteChunksUntilStopped();
+
+  writer_->Flush();
+  AutoLock lock(lock_);
+  stats_.bytes_written = writer_->bytes_encoded();
+  stats_.has_error = writer_->has_error();
+  return std::move(writer_);
+}
+
+TraceStreamWriter::Stats TraceStreamWriter::GetStats() const {
+  AutoLock lock(lock_);
+  return stats_;
+}
+
+void TraceStreamWriter::EstimateTraceMemoryOverhead(
+    TraceEventMemoryOverhead* overhead) {
+  // The pending chunks are being read by the writer thread, so their events
+  // can't be inspected; count them at their fixed size.
+  AutoLock lock(lock_);
+  overhead->Add(TraceEventMemoryOverhead::kTraceBuffer, sizeof(*this));
+  const size_t chunk_count = pending_chunks_.size() + free_chunks_.size();
+  overhead->Add(TraceEventMemoryOverhead::kTraceBufferChunk,
+                chunk_count * sizeof(TraceBufferChunk));
+}
+
+void TraceStreamWriter::ThreadMain() {
+  PlatformThread::SetName("TraceStreamWriter");
+  WriteChunksUntilStopped();
+}
+
+void TraceStreamWriter::WriteChunksUntilStopped() {
+  AutoLock lock(lock_);
+  for (;;) {
+    while (pending_chunks_.empty() && !stopping_)
+      chunk_queued_.Wait();
+    if (pending_chunks_.empty())
+      return;
+
+    std::unique_ptr<TraceBufferChunk> chunk =
+        std::move(pending_chunks_.front());
+    pending_chunks_.pop_front();
+    const bool caught_up = pending_chunks_.empty();
+    const size_t event_count = chunk->size();
+    uint64_t bytes_written;
+    bool has_error;
+    {
+      AutoUnlock unlock(lock_);
+      writer_->AddChunk(*chunk, argument_filter_predicate_);
+      // Keep the output current whenever there's a lull, so that a reader of
+      // the stream isn't left behind by a trace that goes quiet.
+      if (caught_up)
+        writer_->Flush();
+      bytes_written = writer_->bytes_encoded();
+      has_error = writer_->has_error();
+      // Destroy the events here rather than in TakeFreeChunk(), which is
+      // called with the TraceLog lock held.
+      chunk->Reset(chunk->seq());
+    }
+    ++stats_.chunks_written;
+    stats_.events_written += event_count;
+    stats_.bytes_written = bytes_written;
+    stats_.has_error = has_error;
+    if (free_chunks_.size() < max_pending_chunks_)
+      free_chunks_.push_back(std::move(chunk));
+  }
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,129 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRICK_TRACE_EVENT_TRACE_STREAM_WRITER_H_
+#define BRICK_TRACE_EVENT_TRACE_STREAM_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "brick/base_export.h"
+#include "brick/containers/circular_deque.h"
+#include "brick/macros.h"
+#include "brick/synchronization/condition_variable.h"
+#include "brick/synchronization/lock.h"
+#include "brick/threading/platform_thread.h"
+#include "brick/trace_event/trace_event_impl.h"
+
+namespace base {
+namespace trace_event {
+
+class BinaryTraceWriter;
+class TraceBufferChunk;
+class TraceEventMemoryOverhead;
+
+// Writes TraceBufferChunks to a BinaryTraceWriter on a background thread, so
+// that the trace can be streamed to a file or pipe while tracing continues.
+// See TraceLog::StartStreaming().
+//
+// Memory is bounded: at most |max_pending_chunks| full chunks wait to be
+// written and as many written chunks are kept for reuse. When the writer
+// falls behind, the full chunks beyond the limit are dropped and counted in
+// Stats. Blocking the threads that return them instead isn't an option, as
+// they hold the TraceLog lock that the writer thread may need to record its
+// own trace events.
+//
+// Thread safe.
+class BRICK_EXPORT TraceStreamWriter : public PlatformThread::Delegate {
+ public:
+  // 256 chunks of 64 events.
+  static constexpr size_t kDefaultMaxPendingChunks = 256;
+
+  struct BRICK_EXPORT Stats {
+    size_t chunks_written = 0;
+    size_t events_written = 0;
+    size_t chunks_dropped = 0;
+    size_t events_dropped = 0;
+    // The most chunks that were waiting to be written at once.
+    size_t peak_pending_chunks = 0;
+    uint64_t bytes_written = 0;
+    // Whether writing to the output failed, after which the rest of the
+    // stream is discarded.
+    bool has_error = false;
+  };
+
+  TraceStreamWriter(std::unique_ptr<BinaryTraceWriter> writer,
+                    size_t max_pending_chunks);
+  // Calls Finish() if it wasn't called, dropping the writer.
+  ~TraceStreamWriter() override;
+
+  // Starts the writer thread, if it isn't running yet. The arguments of the
+  // events are filtered with |argument_filter_predicate|, see
+  // TraceEvent::AppendAsJSON(). Returns false if the thread can't be created.
+  bool Start(const ArgumentFilterPredicate& argument_filter_predicate);
+
+  // Queues |chunk| to be written. A full chunk is dropped if
+  // |max_pending_chunks| are pending already and SetDropWhenFull(false) wasn't
+  // called. Partially filled chunks, which are returned when a thread exits or
+  // on flush, are always taken: there is at most one per thread.
+  void AddChunk(std::unique_ptr<TraceBufferChunk> chunk);
+
+  // Returns an empty chunk that was written already, or null if there is
+  // none.
+  std::unique_ptr<TraceBufferChunk> TakeFreeChunk();
+
+  // Whether full chunks are dropped once |max_pending_chunks| are pending.
+  // Turn this off once the last events of a trace are being collected, so
+  // that its tail isn't lost.
+  void SetDropWhenFull(bool drop_when_full);
+
+  // Writes the pending chunks, stops the writer thread, flushes the writer
+  // and returns it. No chunks may be added afterwards. Blocks until all of
+  // that is done.
+  std::unique_ptr<BinaryTraceWriter> Finish();
+
+  Stats GetStats() const;
+
+  void EstimateTraceMemoryOverhead(TraceEventMemoryOverhead* overhead);
+
+  size_t max_pending_chunks() const { return max_pending_chunks_; }
+
+ private:
+  // PlatformThread::Delegate:
+  void ThreadMain() override;
+
+  // Writes chunks as they are queued, until Finish() is called and none are
+  // left.
+  void WriteChunksUntilStopped();
+
+  const size_t max_pending_chunks_;
+
+  mutable Lock lock_;
+  // Signaled when a chunk is queued or the writer is stopping.
+  ConditionVariable chunk_queued_;
+
+  // Protected by |lock_|.
+  circular_deque<std::unique_ptr<TraceBufferChunk>> pending_chunks_;
+  std::vector<std::unique_ptr<TraceBufferChunk>> free_chunks_;
+  Stats stats_;
+  bool drop_when_full_ = true;
+  bool started_ = false;
+  bool stopping_ = false;
+
+  // Only used by the writer thread, or by Finish() once it's done.
+  std::unique_ptr<BinaryTraceWriter> writer_;
+  ArgumentFilterPredicate argument_filter_predicate_;
+
+  PlatformThreadHandle thread_handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceStreamWriter);
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BRICK_TRACE_EVENT_TRACE_STREAM_WRITER_H_
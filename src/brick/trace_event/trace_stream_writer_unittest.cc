@@ -0,0 +1,147 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brick/trace_event/trace_stream_writer.h"
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "brick/bind.h"
+#include "brick/trace_event/binary_trace_reader.h"
+#include "brick/trace_event/binary_trace_writer.h"
+#include "brick/trace_event/trace_buffer.h"
+#include "brick/trace_event/trace_event.h"
+#include "brick/trace_event/trace_log.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+std::unique_ptr<TraceBufferChunk> MakeChunk(uint32_t seq, size_t size) {
+  std::unique_ptr<TraceBufferChunk> chunk(new TraceBufferChunk(seq));
+  for (size_t i = 0; i < size; ++i) {
+    size_t event_index;
+    chunk->AddTraceEvent(&event_index)
+        ->Initialize(1, TimeTicks::FromInternalValue(i + 1), ThreadTicks(),
+                     TRACE_EVENT_PHASE_INSTANT,
+                     TraceLog::GetCategoryGroupEnabled("stream"), "event",
+                     trace_event_internal::kGlobalScope,
+                     trace_event_internal::kNoId, trace_event_internal::kNoId,
+                     0, nullptr, nullptr, nullptr, nullptr,
+                     TRACE_EVENT_FLAG_NONE);
+  }
+  return chunk;
+}
+
+size_t CountOccurrences(const std::string& str, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+void SaveWriter(std::unique_ptr<BinaryTraceWriter>* out,
+                std::unique_ptr<BinaryTraceWriter> writer) {
+  *out = std::move(writer);
+}
+
+}  // namespace
+
+TEST(TraceStreamWriterTest, DropsFullChunksBeyondLimit) {
+  const size_t kChunkSize = TraceBufferChunk::kTraceBufferChunkSize;
+  std::string binary;
+  TraceStreamWriter stream_writer(std::make_unique<BinaryTraceWriter>(&binary),
+                                  1);
+
+  // Without Start(), the chunks stay pending until Finish().
+  stream_writer.AddChunk(MakeChunk(1, kChunkSize));
+  stream_writer.AddChunk(MakeChunk(2, kChunkSize));
+  // Partially filled chunks are never dropped.
+  stream_writer.AddChunk(MakeChunk(3, 1));
+
+  TraceStreamWriter::Stats stats = stream_writer.GetStats();
+  EXPECT_EQ(1u, stats.chunks_dropped);
+  EXPECT_EQ(kChunkSize, stats.events_dropped);
+  EXPECT_EQ(2u, stats.peak_pending_chunks);
+  // The dropped chunk is kept for reuse.
+  std::unique_ptr<TraceBufferChunk> free_chunk = stream_writer.TakeFreeChunk();
+  ASSERT_TRUE(free_chunk);
+  EXPECT_EQ(0u, free_chunk->size());
+  EXPECT_FALSE(stream_writer.TakeFreeChunk());
+
+  stream_writer.SetDropWhenFull(false);
+  stream_writer.AddChunk(MakeChunk(4, kChunkSize));
+
+  std::unique_ptr<BinaryTraceWriter> writer = stream_writer.Finish();
+  ASSERT_TRUE(writer);
+  EXPECT_EQ(2 * kChunkSize + 1, writer->events_encoded());
+  stats = stream_writer.GetStats();
+  EXPECT_EQ(3u, stats.chunks_written);
+  EXPECT_EQ(2 * kChunkSize + 1, stats.events_written);
+  EXPECT_EQ(1u, stats.chunks_dropped);
+  EXPECT_EQ(binary.size(), stats.bytes_written);
+  EXPECT_FALSE(stats.has_error);
+
+  std::string json;
+  ASSERT_TRUE(ConvertBinaryTraceToJSON(binary, &json));
+  EXPECT_EQ(2 * kChunkSize + 1, CountOccurrences(json, "\"name\":\"event\""));
+}
+
+TEST(TraceStreamWriterTest, StreamWhileTracing) {
+  const int kEventCount = 1000;
+  TraceLog* trace_log = TraceLog::GetInstance();
+  std::string binary;
+  ASSERT_TRUE(
+      trace_log->StartStreaming(std::make_unique<BinaryTraceWriter>(&binary)));
+  EXPECT_FALSE(
+      trace_log->StartStreaming(std::make_unique<BinaryTraceWriter>(&binary)));
+
+  trace_log->SetEnabled(TraceConfig("stream", ""), TraceLog::RECORDING_MODE);
+  {
+    // Ends after its chunk has been streamed.
+    TRACE_EVENT0("stream", "outer");
+    for (int i = 0; i < kEventCount; ++i) {
+      TRACE_EVENT_INSTANT1("stream", "inner", TRACE_EVENT_SCOPE_THREAD, "i",
+                           i);
+    }
+  }
+  {
+    // Ends while its chunk is still being filled.
+    TRACE_EVENT0("stream", "last");
+  }
+
+  // The stream can't be stopped while tracing.
+  std::unique_ptr<BinaryTraceWriter> writer;
+  trace_log->StopStreaming(BindOnce(&SaveWriter, &writer));
+  EXPECT_FALSE(writer);
+
+  trace_log->SetDisabled();
+  trace_log->StopStreaming(BindOnce(&SaveWriter, &writer));
+  ASSERT_TRUE(writer);
+  EXPECT_FALSE(writer->has_error());
+  TraceStreamWriter::Stats stats;
+  EXPECT_FALSE(trace_log->GetStreamStats(&stats));
+
+  std::string json;
+  ASSERT_TRUE(ConvertBinaryTraceToJSON(binary, &json));
+  EXPECT_EQ(static_cast<size_t>(kEventCount),
+            CountOccurrences(json, "\"name\":\"inner\""));
+  EXPECT_EQ(1u, CountOccurrences(
+                    json, "\"ph\":\"B\",\"cat\":\"stream\",\"name\":\"outer\""));
+  EXPECT_EQ(1u, CountOccurrences(
+                    json, "\"ph\":\"E\",\"cat\":\"stream\",\"name\":\"outer\""));
+  EXPECT_EQ(1u, CountOccurrences(
+                    json, "\"ph\":\"X\",\"cat\":\"stream\",\"name\":\"last\""));
+  EXPECT_EQ(std::string::npos, json.find("trace_stream_dropped_events"));
+}
+
+}  // namespace trace_event
+}  // namespace base